@@ -0,0 +1,147 @@
+#!/usr/bin/env python3
+# SPDX-License-Identifier: BSD-3-Clause
+#
+# Copyright (C) Telechips Inc.
+#
+# Synthetic PNG corpus for png_bench (Python 3 standard library only).
+#
+#   python3 gen_corpus.py [-o DIR] [--max-pixels N] [--seed S]
+#
+# The filtered scanlines are generated directly (filter type byte + residuals with the
+# statistics of a photo : mostly 0 and small values), so the files cost nothing to make
+# at any size while the decoder still runs every filter on every row.
+#
+#   icon_*   16x16, every colour type / bit depth, interlaced or not
+#   mat_*    256x256, every colour type / bit depth, interlaced or not,
+#            dynamic blocks with each filter type (0..4) and a mix of them,
+#            stored and fixed blocks with the mix
+#   big_*    1920x1080 to 7680x4320, the usual formats, dynamic blocks, filter mix
+#
+# File names : <tier>_<w>x<h>_ct<colour type>_bd<bit depth>_i<interlace>_<blocks>_f<filter>.png
+
+import argparse
+import os
+import random
+import struct
+import zlib
+
+DEPTHS = {0: (1, 2, 4, 8, 16), 2: (8, 16), 3: (1, 2, 4, 8), 4: (8, 16), 6: (8, 16)}
+CHANNELS = {0: 1, 2: 3, 3: 1, 4: 2, 6: 4}
+# Adam7 passes : x start, y start, x step, y step
+ADAM7 = ((0, 0, 8, 8), (4, 0, 8, 8), (0, 4, 4, 8), (2, 0, 4, 4), (0, 2, 2, 4), (1, 0, 2, 2), (0, 1, 1, 2))
+
+BIG = (
+    (1920, 1080, 0, 8, 0),
+    (1920, 1080, 2, 8, 0),
+    (1920, 1080, 2, 16, 0),
+    (1920, 1080, 3, 8, 0),
+    (1920, 1080, 6, 8, 0),
+    (1920, 1080, 6, 8, 1),
+    (3840, 2160, 2, 8, 0),
+    (3840, 2160, 6, 8, 0),
+    (7680, 4320, 2, 8, 0),
+    (7680, 4320, 6, 8, 0),
+)
+
+
+def chunk(ctype, data):
+    body = ctype + data
+    return struct.pack('>I', len(data)) + body + struct.pack('>I', zlib.crc32(body) & 0xffffffff)
+
+
+def residual_pool(rnd, size):
+    # 0 most of the time, small steps often, anything now and then
+    values = [0, 1, 255, 2, 254, 3, 253] + list(range(256))
+    weights = [60, 9, 9, 5, 5, 1, 1] + [10 / 256.0] * 256
+    return bytes(rnd.choices(values, weights, k=size))
+
+
+def scanlines(rnd, pool, width, height, ct, bd, interlace, ftype):
+    """Raw zlib payload : filter byte + residual bytes for every row (of every pass)."""
+    bpp_bits = CHANNELS[ct] * bd
+    if interlace:
+        passes = []
+        for xs, ys, xi, yi in ADAM7:
+            pw = (width - xs + xi - 1) // xi if width > xs else 0
+            ph = (height - ys + yi - 1) // yi if height > ys else 0
+            if pw and ph:
+                passes.append((pw, ph))
+    else:
+        passes = [(width, height)]
+
+    out = bytearray()
+    limit = len(pool)
+    for pw, ph in passes:
+        row_bytes = (pw * bpp_bits + 7) // 8
+        for y in range(ph):
+            out.append(y % 5 if ftype == 'mix' else ftype)
+            start = rnd.randrange(0, limit - row_bytes) if row_bytes < limit else 0
+            if row_bytes <= limit:
+                out += pool[start:start + row_bytes]
+            else:
+                out += (pool * (row_bytes // limit + 1))[:row_bytes]
+    return bytes(out)
+
+
+def compress(raw, blocks):
+    if blocks == 'stored':
+        return zlib.compress(raw, 0)
+    if blocks == 'fixed':
+        co = zlib.compressobj(6, zlib.DEFLATED, 15, 8, zlib.Z_FIXED)
+    else:
+        co = zlib.compressobj(6, zlib.DEFLATED, 15, 8, zlib.Z_DEFAULT_STRATEGY)
+    return co.compress(raw) + co.flush()
+
+
+def write_png(path, rnd, pool, width, height, ct, bd, interlace, blocks, ftype):
+    data = compress(scanlines(rnd, pool, width, height, ct, bd, interlace, ftype), blocks)
+    png = b'\x89PNG\r\n\x1a\n'
+    png += chunk(b'IHDR', struct.pack('>IIBBBBB', width, height, bd, ct, 0, 0, interlace))
+    if ct == 3:
+        entries = 1 << bd
+        png += chunk(b'PLTE', bytes(rnd.randrange(256) for _ in range(entries * 3)))
+        png += chunk(b'tRNS', bytes(rnd.randrange(256) for _ in range(entries // 2)))
+    # IDAT split in 64 KB chunks as most encoders do
+    for i in range(0, max(len(data), 1), 65536):
+        png += chunk(b'IDAT', data[i:i + 65536])
+    png += chunk(b'IEND', b'')
+    with open(path, 'wb') as f:
+        f.write(png)
+    return len(png)
+
+
+def main():
+    ap = argparse.ArgumentParser(description='Generate the synthetic PNG corpus of png_bench.')
+    ap.add_argument('-o', '--out', default='corpus', help='output directory (default: corpus)')
+    ap.add_argument('--max-pixels', type=int, default=7680 * 4320,
+                    help='skip the big images above this many pixels (default: 8K)')
+    ap.add_argument('--seed', type=int, default=2024, help='random seed (default: 2024)')
+    args = ap.parse_args()
+
+    os.makedirs(args.out, exist_ok=True)
+    rnd = random.Random(args.seed)
+    pool = residual_pool(rnd, 1 << 20)
+    jobs = []
+
+    for ct, depths in DEPTHS.items():
+        for bd in depths:
+            for il in (0, 1):
+                jobs.append(('icon', 16, 16, ct, bd, il, 'dyn', 'mix'))
+                for ftype in (0, 1, 2, 3, 4, 'mix'):
+                    jobs.append(('mat', 256, 256, ct, bd, il, 'dyn', ftype))
+                jobs.append(('mat', 256, 256, ct, bd, il, 'stored', 'mix'))
+                jobs.append(('mat', 256, 256, ct, bd, il, 'fixed', 'mix'))
+
+    for w, h, ct, bd, il in BIG:
+        if w * h <= args.max_pixels:
+            jobs.append(('big', w, h, ct, bd, il, 'dyn', 'mix'))
+
+    total = 0
+    for tier, w, h, ct, bd, il, blocks, ftype in jobs:
+        name = '%s_%dx%d_ct%d_bd%d_i%d_%s_f%s.png' % (tier, w, h, ct, bd, il, blocks, ftype)
+        total += write_png(os.path.join(args.out, name), rnd, pool, w, h, ct, bd, il, blocks, ftype)
+    print('%d files, %d bytes in %s' % (len(jobs), total, args.out))
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,644 @@
+// SPDX-License-Identifier: BSD-3-Clause
+/*
+ * Copyright (C) Telechips Inc.
+ */
+/******************************************************************************
+ file name : png_bench.c
+ Decoding benchmark of the PNG decoder, results in JSON.
+
+	png_bench [options] file.png ...
+
+	-n N		timed decodes of every file (5), after one untimed
+	-l WxH		LCD size (the image size by default : no resize)
+	-r LEVEL	RESOURCE_OCCUPATION, PD_RESOURCE_LEVEL_NONE..ALL (4)
+	-b US		TCCXXX_PNG_Dec_DecodeTimed() with this budget instead of -r
+	-f FMT		output : pixel, row, argb8888 (default), rgb565, yuv420, index8, index_packed,
+				l8, la88, rgba16, l16
+	-p			PD_PIPELINE_2THREADS (PD_INIT_OPT_PIPELINE)
+	-c			ERROR_DET_MODE = PD_ERROR_CHK_ALL (CRC-32 and Adler-32)
+	-a			PD_INIT_OPT_RESIZE_AREA
+	-R			PD_INIT_OPT_ROUND_16 (16-bit samples rounded into the 8-bit outputs)
+	-o FILE		JSON output (stdout by default)
+
+	Every file is read into memory first (PD_INIT_OPT_MEMORY_INPUT), so read_func and
+	the disk are not measured. A decode is TCCXXX_PNG_Dec_Init() and every
+	TCCXXX_PNG_Dec_Decode() call until DONE.
+	With a library built with PNGDEC_OPT_STATS every image also gets the "stats" of
+	its last decode (TCCXXX_PNG_Dec_GetStats()).
+	"crc32" is the CRC-32 of the output : the destination surface after the last decode,
+	or the pixels given to write_func / write_row_func by the untimed decode. It changes
+	with the decoded pixels only, so the JSON of two versions tells if their outputs differ.
+	-f pixel and -f row give the same crc32 (make check compares them on the corpus).
+******************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/resource.h>
+
+#include "TCCXXX_PNG_DEC.h"
+
+#define PB_DEFAULT_ITERATIONS	5
+
+typedef struct {
+	int				iterations;
+	int				lcd_width;			//0 : image size
+	int				lcd_height;
+	int				resource;
+	long			budget_us;			//-1 : TCCXXX_PNG_Dec_Decode
+	int				output;				//PB_OUT_xxx
+	int				pipeline;
+	int				check;
+	int				area;
+	int				round16;
+	const char		*json_path;
+}PB_OPTIONS;
+
+#define PB_OUT_PIXEL			0
+#define PB_OUT_ROW				1
+#define PB_OUT_ARGB8888			2
+#define PB_OUT_RGB565			3
+#define PB_OUT_YUV420			4
+#define PB_OUT_INDEX8			5
+#define PB_OUT_INDEX_PACKED		6
+#define PB_OUT_L8				7
+#define PB_OUT_LA88				8
+#define PB_OUT_RGBA16			9
+#define PB_OUT_L16				10
+
+static const char * const PB_Out_Name[] = { "pixel", "row", "argb8888", "rgb565", "yuv420", "index8", "index_packed",
+											"l8", "la88", "rgba16", "l16" };
+//PD_PIXFMT_xxx of the surface outputs (-1 : callbacks)
+static const int PB_Out_Format[] = { -1, -1, PD_PIXFMT_ARGB8888, PD_PIXFMT_RGB565, PD_PIXFMT_YUV420,
+									 PD_PIXFMT_INDEX8, PD_PIXFMT_INDEX_PACKED, PD_PIXFMT_L8, PD_PIXFMT_LA88,
+									 PD_PIXFMT_RGBA16, PD_PIXFMT_L16 };
+
+//Latencies of the decode calls (microseconds), grown as needed
+typedef struct {
+	double			*pValue;
+	long			iNum;
+	long			iMax;
+}PB_SAMPLES;
+
+static double PB_Now_Us(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double)ts.tv_sec * 1e6 + (double)ts.tv_nsec / 1e3;
+}
+
+static int PB_Add_Sample(PB_SAMPLES *s, double v)
+{
+	if(s->iNum == s->iMax)
+	{
+		long max = s->iMax ? s->iMax * 2 : 4096;
+		double *p = (double *)realloc(s->pValue, max * sizeof(double));
+
+		if(p == NULL)
+			return -1;
+		s->pValue = p;
+		s->iMax = max;
+	}
+	s->pValue[s->iNum++] = v;
+	return 0;
+}
+
+static int PB_Compare(const void *a, const void *b)
+{
+	double x = *(const double *)a, y = *(const double *)b;
+
+	return (x > y) - (x < y);
+}
+
+//p-th percentile (0..100) of sorted values, nearest rank
+static double PB_Percentile(const double *sorted, long num, double p)
+{
+	long rank;
+
+	if(num == 0)
+		return 0;
+	rank = (long)(p / 100.0 * num + 0.999999);
+	if(rank < 1)
+		rank = 1;
+	if(rank > num)
+		rank = num;
+	return sorted[rank - 1];
+}
+
+static long PB_Peak_Rss_Kb(void)
+{
+	struct rusage ru;
+
+	if(getrusage(RUSAGE_SELF, &ru) != 0)
+		return 0;
+	return ru.ru_maxrss;		//kilobytes on Linux
+}
+
+//CRC-32 (polynomial 0xEDB88320, as zlib) : crc starts and ends inverted, pass 0 first
+static unsigned int g_Crc_Table[256];
+
+static void PB_Crc32_Init(void)
+{
+	unsigned int c, n, k;
+
+	for(n = 0;n < 256;n++)
+	{
+		c = n;
+		for(k = 0;k < 8;k++)
+			c = (c & 1) ? (0xEDB88320U ^ (c >> 1)) : (c >> 1);
+		g_Crc_Table[n] = c;
+	}
+}
+
+static unsigned int PB_Crc32(unsigned int crc, const unsigned char *buf, unsigned long len)
+{
+	crc = ~crc;
+	while(len--)
+		crc = g_Crc_Table[(crc ^ *buf++) & 0xFF] ^ (crc >> 8);
+	return ~crc;
+}
+
+//Output sinks : keep the compiler from dropping the work, do not measure a frame buffer.
+//g_Crc_On : the pixels are added to g_Crc (untimed decode only)
+//g_Alpha : PD_INIT.alpha_available, write_func gets no alpha (Comp_4 is not set) without it
+static volatile unsigned int g_Sink;
+static int g_Crc_On;
+static unsigned int g_Crc;
+static unsigned int g_Alpha;
+
+static void PB_Write_Pixel(IM_PIX_INFO out_info)
+{
+	unsigned int alpha = g_Alpha ? out_info.Comp_4 : 0;
+
+	g_Sink += out_info.Comp_1 + out_info.Comp_2 + out_info.Comp_3 + alpha;
+	if(g_Crc_On)
+	{
+		unsigned char px[4];
+
+		//as the row output : 0 in the alpha byte of an image without alpha
+		px[0] = (unsigned char)out_info.Comp_1;
+		px[1] = (unsigned char)out_info.Comp_2;
+		px[2] = (unsigned char)out_info.Comp_3;
+		px[3] = (unsigned char)alpha;
+		g_Crc = PB_Crc32(g_Crc, px, 4);
+	}
+}
+
+static void PB_Write_Row(IM_ROW_INFO *row_info)
+{
+	g_Sink += row_info->pPixel[0] + row_info->Width;
+	if(g_Crc_On)
+		g_Crc = PB_Crc32(g_Crc, row_info->pPixel, (unsigned long)row_info->Width * 4);
+}
+
+static void PB_Json_String(FILE *fp, const char *s)
+{
+	fputc('"', fp);
+	for(; *s; s++)
+	{
+		if(*s == '"' || *s == '\\')
+			fputc('\\', fp);
+		if((unsigned char)*s >= 0x20)
+			fputc(*s, fp);
+	}
+	fputc('"', fp);
+}
+
+static unsigned char * PB_Load_File(const char *path, unsigned int *pSize)
+{
+	FILE *fp = fopen(path, "rb");
+	unsigned char *buf = NULL;
+	long size;
+
+	if(fp == NULL)
+		return NULL;
+	if(fseek(fp, 0, SEEK_END) == 0 && (size = ftell(fp)) > 0 && fseek(fp, 0, SEEK_SET) == 0)
+	{
+		buf = (unsigned char *)malloc(size);
+		if(buf != NULL && fread(buf, 1, size, fp) != (size_t)size)
+		{
+			free(buf);
+			buf = NULL;
+		}
+		*pSize = (unsigned int)size;
+	}
+	fclose(fp);
+	return buf;
+}
+
+typedef struct {
+	const char		*path;
+	unsigned int	file_size;
+	unsigned int	width, height;
+	int				color_type, bit_depth, interlace;
+	int				result;				//PD_RETURN_DECODE_xxx of the last decode
+	int				error;
+	unsigned int	decoder_bytes;		//instance buffer + heap
+	unsigned int	output_bytes;		//destination surface
+	unsigned int	crc32;				//CRC-32 of the output
+	double			init_us;			//median TCCXXX_PNG_Dec_Init()
+	double			decode_us_min, decode_us_median;
+	double			call_us_p50, call_us_p99, call_us_max;
+	long			calls;				//decode calls of one decode
+	int				stats_on;			//stats is filled (PNGDEC_OPT_STATS)
+	PD_STATS		stats;				//counters of the last decode
+}PB_RESULT;
+
+//Bytes per line of the first plane of a surface output
+static long PB_Pitch(int output, int bit_depth, long lw)
+{
+	switch(PB_Out_Format[output])
+	{
+	case PD_PIXFMT_RGBA16:
+		return lw * 8;
+	case PD_PIXFMT_ARGB8888:
+		return lw * 4;
+	case PD_PIXFMT_RGB565:
+	case PD_PIXFMT_LA88:
+	case PD_PIXFMT_L16:
+		return lw * 2;
+	case PD_PIXFMT_INDEX_PACKED:
+		return (lw * bit_depth + 7) / 8;
+	default:
+		return lw;
+	}
+}
+
+//One decode of a file in memory : returns PD_RETURN_DECODE_xxx, adds the call latencies to pCalls
+static int PB_Decode(const PB_OPTIONS *opt, PB_RESULT *res, const unsigned char *src, void *inst, unsigned char **pPlane,
+					 unsigned char **pHeap, unsigned int *pHeapSize, double *pInit, double *pTotal, PB_SAMPLES *pCalls, long *pNum)
+{
+	PD_HANDLE h;
+	PD_INIT init;
+	PD_CUSTOM_DECODE dec;
+	int ret, lw, lh;
+	double t0, t1, start;
+
+	memset(&init, 0, sizeof(init));
+	memset(&dec, 0, sizeof(dec));
+	h = TCCXXX_PNG_Dec_Create(inst, PD_INSTANCE_MEM_SIZE);
+	if(h == NULL)
+		return PD_RETURN_DECODE_FAIL;
+
+	lw = opt->lcd_width ? opt->lcd_width : (int)res->width;
+	lh = opt->lcd_height ? opt->lcd_height : (int)res->height;
+	init.lcd_width = lw;
+	init.lcd_height = lh;
+	init.iTotFileSize = res->file_size;
+	init.pSrcBuf = src;
+	init.iOption = PD_INIT_OPT_MEMORY_INPUT | (opt->area ? PD_INIT_OPT_RESIZE_AREA : 0) | (opt->round16 ? PD_INIT_OPT_ROUND_16 : 0) |
+				   (opt->pipeline ? PD_INIT_OPT_PIPELINE : 0);
+
+	start = PB_Now_Us();
+	ret = TCCXXX_PNG_Dec_Init(h, &init, NULL);
+	*pInit = PB_Now_Us() - start;
+	if(ret != PD_RETURN_INIT_DONE)
+	{
+		res->error = TCCXXX_PNG_Dec_GetError(h);
+		TCCXXX_PNG_Dec_Destroy(h);
+		return PD_RETURN_DECODE_FAIL;
+	}
+
+	if(*pHeapSize < init.heap_size)
+	{
+		free(*pHeap);
+		*pHeap = (unsigned char *)malloc(init.heap_size);
+		*pHeapSize = (*pHeap != NULL) ? init.heap_size : 0;
+		if(*pHeap == NULL)
+		{
+			TCCXXX_PNG_Dec_Destroy(h);
+			return PD_RETURN_DECODE_FAIL;
+		}
+	}
+	res->decoder_bytes = PD_INSTANCE_MEM_SIZE + init.heap_size;
+	g_Alpha = init.alpha_available;
+
+	dec.Heap_Memory = *pHeap;
+	dec.ERROR_DET_MODE = opt->check ? PD_ERROR_CHK_ALL : PD_ERROR_CHK_NONE;
+	dec.RESOURCE_OCCUPATION = opt->resource;
+	dec.USE_ALPHA_DATA = PD_ALPHA_AVAILABLE;
+	dec.PIPELINE_MODE = opt->pipeline ? PD_PIPELINE_2THREADS : PD_PIPELINE_NONE;
+	switch(opt->output)
+	{
+	case PB_OUT_PIXEL:
+		dec.OUTPUT_MODE = PD_OUTPUT_PIXEL;
+		dec.write_func = PB_Write_Pixel;
+		break;
+	case PB_OUT_ROW:
+		dec.OUTPUT_MODE = PD_OUTPUT_ROW;
+		dec.write_row_func = PB_Write_Row;
+		break;
+	default:
+		dec.OUTPUT_MODE = PD_OUTPUT_SURFACE;
+		dec.pDstAddr[0] = pPlane[0];
+		dec.pDstAddr[1] = pPlane[1];
+		dec.pDstAddr[2] = pPlane[2];
+		dec.DST_FORMAT = PB_Out_Format[opt->output];
+		dec.iDstPitch[0] = (int)PB_Pitch(opt->output, res->bit_depth, lw);
+		if(opt->output == PB_OUT_YUV420)
+			dec.iDstPitch[1] = dec.iDstPitch[2] = (lw + 1) / 2;
+		break;
+	}
+
+	*pNum = 0;
+	do {
+		t0 = PB_Now_Us();
+		if(opt->budget_us >= 0)
+			ret = TCCXXX_PNG_Dec_DecodeTimed(h, &dec, (unsigned int)opt->budget_us);
+		else
+			ret = TCCXXX_PNG_Dec_Decode(h, &dec);
+		t1 = PB_Now_Us();
+		if(pCalls != NULL)
+			PB_Add_Sample(pCalls, t1 - t0);
+		(*pNum)++;
+	} while(ret == PD_RETURN_DECODE_PROCESSING);
+	*pTotal = t1 - start;
+
+	if(ret != PD_RETURN_DECODE_DONE)
+		res->error = TCCXXX_PNG_Dec_GetError(h);
+	res->stats_on = (TCCXXX_PNG_Dec_GetStats(h, &res->stats) == PD_RETURN_DECODE_DONE);
+	TCCXXX_PNG_Dec_Destroy(h);
+	return ret;
+}
+
+static void PB_Bench_File(const PB_OPTIONS *opt, PB_RESULT *res, void *inst, unsigned char **pHeap, unsigned int *pHeapSize)
+{
+	unsigned char *src, *plane[3] = { NULL, NULL, NULL };
+	PB_SAMPLES calls = { NULL, 0, 0 };
+	double *total, *init, t;
+	long lw, lh, num;
+	int i;
+
+	src = PB_Load_File(res->path, &res->file_size);
+	if(src == NULL || res->file_size < 33 || memcmp(src + 12, "IHDR", 4) != 0)
+	{
+		res->result = PD_RETURN_DECODE_FAIL;
+		free(src);
+		return;
+	}
+	res->width = ((unsigned int)src[16] << 24) | (src[17] << 16) | (src[18] << 8) | src[19];
+	res->height = ((unsigned int)src[20] << 24) | (src[21] << 16) | (src[22] << 8) | src[23];
+	res->bit_depth = src[24];
+	res->color_type = src[25];
+	res->interlace = src[28];
+
+	lw = opt->lcd_width ? opt->lcd_width : (long)res->width;
+	lh = opt->lcd_height ? opt->lcd_height : (long)res->height;
+	if(opt->output == PB_OUT_YUV420)
+		res->output_bytes = (unsigned int)(lw * lh + 2 * ((lw + 1) / 2) * lh);
+	else if(PB_Out_Format[opt->output] >= 0)
+		res->output_bytes = (unsigned int)(PB_Pitch(opt->output, res->bit_depth, lw) * lh);
+	if(res->output_bytes)
+	{
+		plane[0] = (unsigned char *)calloc(res->output_bytes, 1);
+		plane[1] = plane[0] + lw * lh;
+		plane[2] = plane[1] + ((lw + 1) / 2) * lh;
+	}
+
+	total = (double *)malloc(opt->iterations * sizeof(double));
+	init = (double *)malloc(opt->iterations * sizeof(double));
+	if((res->output_bytes && plane[0] == NULL) || total == NULL || init == NULL)
+		res->result = PD_RETURN_DECODE_FAIL;
+	else
+	{
+		//untimed : page in the surface and the code, checksum of the callback output
+		g_Crc = 0;
+		g_Crc_On = 1;
+		res->result = PB_Decode(opt, res, src, inst, plane, pHeap, pHeapSize, &t, &t, NULL, &num);
+		g_Crc_On = 0;
+		res->crc32 = g_Crc;
+		for(i = 0;i < opt->iterations && res->result == PD_RETURN_DECODE_DONE;i++)
+			res->result = PB_Decode(opt, res, src, inst, plane, pHeap, pHeapSize, &init[i], &total[i], &calls, &res->calls);
+		if(res->output_bytes)
+			res->crc32 = PB_Crc32(0, plane[0], res->output_bytes);
+	}
+
+	if(res->result == PD_RETURN_DECODE_DONE)
+	{
+		qsort(total, opt->iterations, sizeof(double), PB_Compare);
+		qsort(init, opt->iterations, sizeof(double), PB_Compare);
+		qsort(calls.pValue, calls.iNum, sizeof(double), PB_Compare);
+		res->decode_us_min = total[0];
+		res->decode_us_median = PB_Percentile(total, opt->iterations, 50);
+		res->init_us = PB_Percentile(init, opt->iterations, 50);
+		res->call_us_p50 = PB_Percentile(calls.pValue, calls.iNum, 50);
+		res->call_us_p99 = PB_Percentile(calls.pValue, calls.iNum, 99);
+		res->call_us_max = calls.iNum ? calls.pValue[calls.iNum - 1] : 0;
+	}
+
+	free(calls.pValue);
+	free(total);
+	free(init);
+	free(plane[0]);
+	free(src);
+}
+
+static void PB_Json_Array(FILE *fp, const char *name, const unsigned long long *v, int num)
+{
+	int i;
+
+	fprintf(fp, ", \"%s\": [", name);
+	for(i = 0;i < num;i++)
+		fprintf(fp, "%s%llu", i ? ", " : "", v[i]);
+	fprintf(fp, "]");
+}
+
+//"stats" of an image : job_us and job_runs indexed by PD_STATS_JOB_xxx
+static void PB_Write_Stats(FILE *fp, const PD_STATS *s)
+{
+	unsigned long long v[PD_STATS_JOB_NUM];
+	int i;
+
+	for(i = 0;i < PD_STATS_JOB_NUM;i++)
+		v[i] = (s->job_ns[i] + 500) / 1000;
+	fprintf(fp, ", \"stats\": {\"read_calls\": %u, \"read_bytes\": %llu, \"seek_calls\": %u, \"seek_bytes\": %llu",
+			s->read_calls, s->read_bytes, s->seek_calls, s->seek_bytes);
+	PB_Json_Array(fp, "job_us", v, PD_STATS_JOB_NUM);
+	for(i = 0;i < PD_STATS_JOB_NUM;i++)
+		v[i] = s->job_runs[i];
+	PB_Json_Array(fp, "job_runs", v, PD_STATS_JOB_NUM);
+	for(i = 0;i < 3;i++)
+		v[i] = s->blocks[i];
+	PB_Json_Array(fp, "blocks", v, 3);
+	PB_Json_Array(fp, "inflated_bytes", s->inflated_bytes, 3);
+	for(i = 0;i < 5;i++)
+		v[i] = s->filter_rows[i];
+	PB_Json_Array(fp, "filter_rows", v, 5);
+	PB_Json_Array(fp, "filter_bytes", s->filter_bytes, 5);
+	fprintf(fp, "}");
+}
+
+static void PB_Write_Json(FILE *fp, const PB_OPTIONS *opt, const PB_RESULT *res, int num, double wall_s)
+{
+	double pix = 0, bytes = 0, us = 0;
+	int i, ok = 0;
+
+	fprintf(fp, "{\n  \"library\": \"TCCxxxx_PNG_DEC V2.00\",\n");
+	fprintf(fp, "  \"compiler\": ");
+#if defined(__VERSION__)
+	PB_Json_String(fp, __VERSION__);
+#else
+	PB_Json_String(fp, "unknown");
+#endif
+	fprintf(fp, ",\n  \"options\": {\"iterations\": %d, \"lcd\": \"%s\", \"lcd_width\": %d, \"lcd_height\": %d, "
+				"\"resource_level\": %d, \"budget_us\": %ld, \"output\": \"%s\", \"pipeline\": %s, \"checks\": %s, \"resize_area\": %s, \"round_16\": %s},\n",
+			opt->iterations, opt->lcd_width ? "fixed" : "image", opt->lcd_width, opt->lcd_height,
+			opt->resource, opt->budget_us, PB_Out_Name[opt->output],
+			opt->pipeline ? "true" : "false", opt->check ? "true" : "false", opt->area ? "true" : "false",
+			opt->round16 ? "true" : "false");
+	fprintf(fp, "  \"images\": [\n");
+	for(i = 0;i < num;i++)
+	{
+		const PB_RESULT *r = &res[i];
+		const char *name = strrchr(r->path, '/');
+
+		fprintf(fp, "    {\"file\": ");
+		PB_Json_String(fp, name ? name + 1 : r->path);
+		fprintf(fp, ", \"bytes\": %u, \"width\": %u, \"height\": %u, \"color_type\": %d, \"bit_depth\": %d, \"interlace\": %d, ",
+				r->file_size, r->width, r->height, r->color_type, r->bit_depth, r->interlace);
+		if(r->result != PD_RETURN_DECODE_DONE)
+		{
+			fprintf(fp, "\"ok\": false, \"error\": %d}%s\n", r->error, (i + 1 < num) ? "," : "");
+			continue;
+		}
+		fprintf(fp, "\"ok\": true, \"init_ms\": %.4f, \"decode_ms_min\": %.4f, \"decode_ms_median\": %.4f, "
+					"\"mpixel_per_s\": %.2f, \"mb_per_s\": %.2f, \"calls\": %ld, "
+					"\"call_us_p50\": %.2f, \"call_us_p99\": %.2f, \"call_us_max\": %.2f, \"decoder_bytes\": %u, \"output_bytes\": %u, "
+					"\"crc32\": \"%08x\"",
+				r->init_us / 1e3, r->decode_us_min / 1e3, r->decode_us_median / 1e3,
+				(double)r->width * r->height / r->decode_us_median, r->file_size / r->decode_us_median,
+				r->calls, r->call_us_p50, r->call_us_p99, r->call_us_max, r->decoder_bytes, r->output_bytes, r->crc32);
+		if(r->stats_on)
+			PB_Write_Stats(fp, &r->stats);
+		fprintf(fp, "}%s\n", (i + 1 < num) ? "," : "");
+		ok++;
+		pix += (double)r->width * r->height;
+		bytes += r->file_size;
+		us += r->decode_us_median;
+	}
+	fprintf(fp, "  ],\n");
+	fprintf(fp, "  \"summary\": {\"files\": %d, \"decoded\": %d, \"mpixel_per_s\": %.2f, \"mb_per_s\": %.2f, "
+				"\"decode_ms_total\": %.3f, \"peak_rss_kb\": %ld, \"wall_s\": %.2f}\n}\n",
+			num, ok, us > 0 ? pix / us : 0, us > 0 ? bytes / us : 0, us / 1e3, PB_Peak_Rss_Kb(), wall_s);
+}
+
+static void PB_Usage(void)
+{
+	fprintf(stderr,
+		"usage: png_bench [-n N] [-l WxH] [-r LEVEL] [-b US] [-f pixel|row|argb8888|rgb565|yuv420|index8|index_packed|l8|la88|rgba16|l16]\n"
+		"                 [-p] [-c] [-a] [-R] [-o FILE] file.png ...\n");
+}
+
+int main(int argc, char **argv)
+{
+	PB_OPTIONS opt;
+	PB_RESULT *res;
+	void *inst;
+	unsigned char *heap = NULL;
+	unsigned int heap_size = 0;
+	double start;
+	FILE *fp;
+	int i, j, num;
+
+	memset(&opt, 0, sizeof(opt));
+	opt.iterations = PB_DEFAULT_ITERATIONS;
+	opt.resource = PD_RESOURCE_LEVEL_ALL;
+	opt.budget_us = -1;
+	opt.output = PB_OUT_ARGB8888;
+	PB_Crc32_Init();
+
+	for(i = 1;i < argc && argv[i][0] == '-';i++)
+	{
+		const char *arg = (i + 1 < argc) ? argv[i + 1] : NULL;
+
+		switch(argv[i][1])
+		{
+		case 'p': opt.pipeline = 1; continue;
+		case 'c': opt.check = 1; continue;
+		case 'a': opt.area = 1; continue;
+		case 'R': opt.round16 = 1; continue;
+		default: break;
+		}
+		if(arg == NULL)
+		{
+			PB_Usage();
+			return 2;
+		}
+		i++;
+		switch(argv[i - 1][1])
+		{
+		case 'n':
+			opt.iterations = atoi(arg);
+			break;
+		case 'l':
+			if(sscanf(arg, "%dx%d", &opt.lcd_width, &opt.lcd_height) != 2 || opt.lcd_width <= 0 || opt.lcd_height <= 0)
+			{
+				PB_Usage();
+				return 2;
+			}
+			break;
+		case 'r':
+			opt.resource = atoi(arg);
+			break;
+		case 'b':
+			opt.budget_us = atol(arg);
+			break;
+		case 'f':
+			for(j = 0;j < (int)(sizeof(PB_Out_Name) / sizeof(PB_Out_Name[0]));j++)
+				if(strcmp(arg, PB_Out_Name[j]) == 0)
+					break;
+			if(j == (int)(sizeof(PB_Out_Name) / sizeof(PB_Out_Name[0])))
+			{
+				PB_Usage();
+				return 2;
+			}
+			opt.output = j;
+			break;
+		case 'o':
+			opt.json_path = arg;
+			break;
+		default:
+			PB_Usage();
+			return 2;
+		}
+	}
+	num = argc - i;
+	if(num <= 0 || opt.iterations <= 0)
+	{
+		PB_Usage();
+		return 2;
+	}
+
+	res = (PB_RESULT *)calloc(num, sizeof(PB_RESULT));
+	inst = malloc(PD_INSTANCE_MEM_SIZE);
+	if(res == NULL || inst == NULL)
+		return 1;
+
+	start = PB_Now_Us();
+	for(j = 0;j < num;j++)
+	{
+		res[j].path = argv[i + j];
+		PB_Bench_File(&opt, &res[j], inst, &heap, &heap_size);
+		fprintf(stderr, "%s : %s\n", res[j].path, (res[j].result == PD_RETURN_DECODE_DONE) ? "ok" : "FAIL");
+	}
+
+	fp = opt.json_path ? fopen(opt.json_path, "w") : stdout;
+	if(fp == NULL)
+	{
+		perror(opt.json_path);
+		return 1;
+	}
+	PB_Write_Json(fp, &opt, res, num, (PB_Now_Us() - start) / 1e6);
+	if(fp != stdout)
+		fclose(fp);
+
+	for(j = 0;j < num;j++)
+		if(res[j].result != PD_RETURN_DECODE_DONE)
+			break;
+	free(heap);
+	free(inst);
+	free(res);
+	return (j == num) ? 0 : 1;
+}
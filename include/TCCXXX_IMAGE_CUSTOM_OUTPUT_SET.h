@@ -20,6 +20,19 @@ typedef struct {
 	int Src_Fmt;
 }IM_PIX_INFO;
 
+//Row output (V2.00~) : one call per output row instead of one call per pixel
+#define IM_ROW_PIXEL_SIZE	4	//bytes per pixel in IM_ROW_INFO.pPixel : Comp_1, Comp_2, Comp_3, Comp_4
+
+typedef struct {
+	unsigned char *pPixel;	//converted pixels (IM_ROW_PIXEL_SIZE bytes per pixel, Comp_4 is 0 unless alpha is used)
+	int Width;				//the number of pixels in pPixel
+	int x;					//x of the first pixel
+	int x_step;				//distance between two pixels on the LCD (1, or 2/4/8 for ADAM7 passes)
+	int y;
+	int Src_Fmt;
+	void *pUserData;		//PD_CUSTOM_DECODE.pRowUserData
+}IM_ROW_INFO;
+
 #define IM_SRC_YUV		0
 #define IM_SRC_RGB		1
 #define IM_SRC_OTHER	2
@@ -20,7 +20,10 @@
 #define PD_RETURN_DECODE_FAIL			-1
 #define PD_RETURN_DECODE_DONE			0
 #define PD_RETURN_DECODE_PROCESSING		1
+#define PD_RETURN_NEED_MORE_DATA		2		//PD_INIT_OPT_PUSH_INPUT : init or decode stopped at the end of the bytes pushed so far,
+												//call it again after TCCXXX_PNG_Dec_Push()
 
+//ERROR_DET_MODE (a CRC failure in the chunks read by PD_DEC_INIT is reported by the first PD_DEC_DECODE)
 #define PD_ERROR_CHK_NONE				0
 #define PD_ERROR_CHK_ALL				1
 #define PD_ERROR_CHK_CRC				2
@@ -36,7 +39,78 @@
 #define PD_ALPHA_DISABLE				0
 #define PD_ALPHA_AVAILABLE				1
 
-#define PD_INSTANCE_MEM_SIZE			(49412)	// the size of instance buffer
+#define PD_OUTPUT_PIXEL					0		//write_func is called for every pixel (default, any other value is taken as this one)
+#define PD_OUTPUT_ROW					1		//write_row_func is called for every output row
+#define PD_OUTPUT_SURFACE				2		//rows are written into pDstAddr[] (no callback).
+												//The other modes ignore pDstAddr, iDstPitch and DST_FORMAT.
+
+//Pixel format of the destination surface (PD_OUTPUT_SURFACE)
+#define PD_PIXFMT_RGB565				0		//uint16 : R[15:11] G[10:5] B[4:0]
+#define PD_PIXFMT_ARGB8888				1		//uint32 : A[31:24] R[23:16] G[15:8] B[7:0] (A = 0xFF without alpha)
+#define PD_PIXFMT_RGB888				2		//3 bytes : B, G, R
+#define PD_PIXFMT_YUV444				3		//planar Y, U, V (BT.601)
+#define PD_PIXFMT_YUV420				4		//planar Y, U, V (BT.601), U/V sampled at even x and even y
+#define PD_PIXFMT_INDEX8				5		//uint8 : palette index (colour type 3 only, TCCXXX_PNG_Dec_GetPalette)
+#define PD_PIXFMT_INDEX_PACKED			6		//palette indices at the bit depth of the image (1, 2, 4 or 8 bits),
+												//first pixel in the high bits : x * bit depth is the bit offset in the line.
+												//The other pixels of a partly written byte are kept.
+												//PD_INIT_OPT_RESIZE_AREA does not apply to the index formats.
+#define PD_PIXFMT_L8					7		//uint8 : grey (full-range BT.601 luma of colour images)
+#define PD_PIXFMT_LA88					8		//2 bytes : grey, alpha (A as in PD_PIXFMT_ARGB8888)
+#define PD_PIXFMT_RGBA16				9		//4 x uint16 : R, G, B, A (A as in PD_PIXFMT_ARGB8888, 0xFFFF without alpha)
+#define PD_PIXFMT_L16					10		//uint16 : grey (luma of colour images as in PD_PIXFMT_L8)
+												//The samples of 16-bit images are written as they are, lower depths are
+												//widened (v * 257). PD_INIT_OPT_RESIZE_AREA averages them in 8 bits.
+
+//PD_CUSTOM_DECODE.PIPELINE_MODE (PD_INIT_OPT_PIPELINE)
+#define PD_PIPELINE_NONE				0		//everything on the caller's thread
+#define PD_PIPELINE_2THREADS			1		//a second thread inflates IDAT (and calls read_func),
+												//the caller's thread defilters, resizes and outputs the rows.
+												//Falls back to PD_PIPELINE_NONE where threads are not available,
+												//on a single CPU and for interlaced images resized to the LCD.
+												//Decode until DONE or FAIL, or call TCCXXX_PNG_Dec_Destroy(), before freeing the buffers.
+
+//PD_INIT.iOption
+#define PD_INIT_OPT_MEMORY_INPUT		(1<<5)	//decode from pSrcBuf (iTotFileSize bytes) in place, read_func is not used
+#define PD_INIT_OPT_RESIZE_AREA			(1<<6)	//an image larger than the LCD is reduced by averaging every pixel of each box
+												//instead of taking one pixel per box (non-interlaced images, heap_size grows)
+#define PD_INIT_OPT_THUMBNAIL			(1<<7)	//an interlaced image reduced 2x or more is sampled from the first Adam7 passes only,
+												//decoding ends once they are done (the rest of the stream is not read)
+#define PD_INIT_OPT_SEEKABLE_INPUT		(1<<8)	//the datasource of read_func can be moved forward by seek_func : the data of the chunks
+												//the decoder does not use (text, ICC profile, ...) is jumped over instead of read,
+												//and the CRC of what is jumped over is not checked
+#define PD_INIT_OPT_PUSH_INPUT			(1<<9)	//as PD_INIT_OPT_MEMORY_INPUT, but pSrcBuf is filled while the file arrives :
+												//only the bytes given to TCCXXX_PNG_Dec_Push() are read (handle API only)
+#define PD_INIT_OPT_ROUND_16			(1<<10)	//16-bit samples are rounded into the 8-bit outputs (v * 255 / 65535)
+												//instead of keeping their high byte (PD_OUTPUT_ROW and PD_OUTPUT_SURFACE)
+#define PD_INIT_OPT_CROP				(1<<11)	//PD_CUSTOM_DECODE.CROP_IMAGE and the crop rectangle are used (ignored otherwise)
+#define PD_INIT_OPT_PIPELINE			(1<<12)	//PD_CUSTOM_DECODE.PIPELINE_MODE is used (PD_PIPELINE_NONE otherwise)
+
+#define PD_CHUNK_INDEX_NUM				(32)	// the most chunks recorded by TCCXXX_PNG_Dec_GetChunkIndex()
+
+#define PD_INSTANCE_MEM_SIZE			(65536)	// the size of instance buffer (decoder state + work buffers)
+
+//PD_STATS : decoder states (job_ns, job_runs)
+#define PD_STATS_JOB_NUM				11
+#define PD_STATS_JOB_FIXHUFF			0		//fixed Huffman table build
+#define PD_STATS_JOB_VARHUFF			1		//dynamic Huffman table build
+#define PD_STATS_JOB_STORED				2		//stored block copy
+#define PD_STATS_JOB_HUFFMAN			3		//fixed / dynamic block decoding
+#define PD_STATS_JOB_ZLIB_HEADER		4
+#define PD_STATS_JOB_BLOCK_HEADER		5
+#define PD_STATS_JOB_IMAGE				6		//defiltering, resizing, pixel conversion and output (callbacks included)
+#define PD_STATS_JOB_SEARCH_IDAT		8		//(7 is not used)
+#define PD_STATS_JOB_SETUP				9		//first decode call : heap and output set-up
+#define PD_STATS_JOB_END_ZLIB			10		//Adler-32 and CRC after the last block
+
+//PD_STATS : deflate block types (blocks, inflated_bytes)
+#define PD_STATS_BLOCK_STORED			0
+#define PD_STATS_BLOCK_FIXED			1
+#define PD_STATS_BLOCK_DYNAMIC			2
+
+#define PD_RETURN_BATCH_FAIL			-1		//invalid parameters, nothing was decoded
+#define PD_RETURN_BATCH_DONE			0		//every image was decoded
+#define PD_RETURN_BATCH_PARTIAL			1		//some images failed (PD_BATCH_ITEM.iResult)
 
 
 typedef struct {
@@ -44,9 +118,20 @@ typedef struct {
 										/*[IN] PD_CALLBACKS struct 
 											   which indicates desired custom file manipulation routines
 										*/
+	int			(*seek_func)	(void *datasource, long offset);
+										/*[IN] PD_INIT_OPT_SEEKABLE_INPUT : moves the read position offset bytes forward
+											   (as fseek(SEEK_CUR)), returns 0 on success. Not used otherwise.
+										*/
 }PD_CALLBACKS;
 
 
+typedef struct {
+	unsigned int	type;				//[OUT] chunk type, the 4 letters in big-endian order (0x49444154 : IDAT)
+	unsigned int	offset;				//[OUT] file offset of the chunk (its length field)
+	unsigned int	length;				//[OUT] bytes of chunk data (the 12 bytes of length, type and CRC are not counted)
+}PD_CHUNK_INFO;
+
+
 typedef struct {
 	int				lcd_width;			//[IN] Width of lcd_frame_buffer
 	int				lcd_height;			//[IN] Height of lcd_frame_buffer
@@ -59,11 +144,15 @@ typedef struct {
 
 	unsigned int	iTotFileSize;		//[IN] size in bytes of the input file	(V1.65)
 	unsigned int	pixel_depth;		//[OUT] bits per pixel
-	unsigned int	iOption;			//Reserved
+	unsigned int	iOption;			//[IN] PD_INIT_OPT_xxx
 	unsigned int	iReserved;
+	const unsigned char	*pSrcBuf;		//[IN] PD_INIT_OPT_MEMORY_INPUT : the whole PNG file, kept valid until decoding ends
+										//     PD_INIT_OPT_PUSH_INPUT : room for the whole file (iTotFileSize bytes)
 }PD_INIT;
 
 
+//Clear the whole struct (memset 0) before filling it : a field the caller does not know about
+//keeps the behaviour of the versions without it when it is 0 (PD_OUTPUT_PIXEL, no crop, ...).
 typedef struct {
 	unsigned char 	*Heap_Memory;		//[IN] Heap Memory for Decoding
 	int				ERROR_DET_MODE;		//[IN] Use of CRC and Adler
@@ -73,9 +162,60 @@ typedef struct {
 	unsigned int	IMAGE_POS_X;		//[IN] Distance from the left of LCD
 	unsigned int	IMAGE_POS_Y;		//[IN] Distance from the top of LCD
 	void			(*write_func)	(IM_PIX_INFO out_info);	//[IN] A function pointer to output format function
+	int				OUTPUT_MODE;		//[IN] PD_OUTPUT_PIXEL(write_func, 0), PD_OUTPUT_ROW(write_row_func) or PD_OUTPUT_SURFACE
+	void			(*write_row_func)	(IM_ROW_INFO *row_info);	//[IN] PD_OUTPUT_ROW : A function pointer to row output function
+	void			*pRowUserData;		//[IN] PD_OUTPUT_ROW : passed to write_row_func (IM_ROW_INFO.pUserData)
+	unsigned char	*pDstAddr[3];		//[IN] PD_OUTPUT_SURFACE : address of (0,0) in each plane (RGB : [0] only, YUV : Y, U, V)
+	int				iDstPitch[3];		//[IN] PD_OUTPUT_SURFACE : bytes per line of each plane
+	int				DST_FORMAT;			//[IN] PD_OUTPUT_SURFACE : PD_PIXFMT_xxx
+	int				PIPELINE_MODE;		//[IN] PD_INIT_OPT_PIPELINE : PD_PIPELINE_xxx
+	int				CROP_IMAGE;			//[IN] PD_INIT_OPT_CROP : if set, only the pixels of the image inside the crop rectangle are output,
+										//     the rows below it are not decoded (non-interlaced images only, FAIL with TC_PNGDEC_ERR_CROP
+										//     otherwise, or when the rectangle starts outside the image or is empty).
+										//     It keeps its place on the LCD, or its top-left corner goes to IMAGE_POS_X/Y
+										//     with MODIFY_IMAGE_POS.
+	unsigned int	CROP_X;				//[IN] Left of the crop rectangle in image pixels
+	unsigned int	CROP_Y;				//[IN] Top of the crop rectangle in image pixels
+	unsigned int	CROP_WIDTH;			//[IN] Width of the crop rectangle (clipped to the image)
+	unsigned int	CROP_HEIGHT;		//[IN] Height of the crop rectangle (clipped to the image)
+	unsigned int	(*time_func)	(void);	//[IN] TCCXXX_PNG_Dec_DecodeTimed() : a clock in microseconds (may wrap around),
+										//     NULL : the system monotonic clock
 }PD_CUSTOM_DECODE;
 
 
+typedef void *	PD_HANDLE;				// decoder instance created by TCCXXX_PNG_Dec_Create()
+
+
+typedef struct {
+	unsigned long long	job_ns[PD_STATS_JOB_NUM];	//[OUT] time spent in each decoder state (PD_STATS_JOB_xxx) in nanoseconds,
+													//      0 without a monotonic clock
+	unsigned int		job_runs[PD_STATS_JOB_NUM];	//[OUT] times each decoder state ran
+	unsigned int		blocks[3];					//[OUT] deflate blocks of each type (PD_STATS_BLOCK_xxx)
+	unsigned long long	inflated_bytes[3];			//[OUT] bytes inflated from each block type
+	unsigned int		filter_rows[5];				//[OUT] rows defiltered per filter type (None, Sub, Up, Average, Paeth)
+	unsigned long long	filter_bytes[5];			//[OUT] bytes of those rows
+	unsigned int		read_calls;					//[OUT] read_func calls (0 with memory or push input)
+	unsigned long long	read_bytes;					//[OUT] bytes returned by read_func
+	unsigned int		seek_calls;					//[OUT] seek_func calls (PD_INIT_OPT_SEEKABLE_INPUT)
+	unsigned long long	seek_bytes;					//[OUT] bytes jumped over by seek_func
+}PD_STATS;
+
+
+typedef struct _PD_BATCH_ITEM PD_BATCH_ITEM;
+struct _PD_BATCH_ITEM {
+	PD_INIT				init;			//[IN/OUT] as for TCCXXX_PNG_Dec_Init(), pInstanceBuf is not used
+	PD_CALLBACKS		callbacks;		//[IN] may be left empty with PD_INIT_OPT_MEMORY_INPUT
+	PD_CUSTOM_DECODE	decode;			//[IN] as for TCCXXX_PNG_Dec_Decode(), Heap_Memory may be NULL (taken from the pool),
+										//     PIPELINE_MODE is not used
+	void				(*done_func)	(PD_BATCH_ITEM *pItem);	//[IN] called when this image is finished (may be NULL)
+	void				*pUserData;		//[IN] free for done_func
+	int					iResult;		//[OUT] PD_RETURN_DECODE_DONE or PD_RETURN_DECODE_FAIL
+	int					iError;			//[OUT] TC_PNGDEC_ERR_xxx of a failure, 0 otherwise
+};
+
+typedef void *	PD_BATCH_HANDLE;		// thread pool created by TCCXXX_PNG_Batch_Create()
+
+
 /* function definition */
 
 extern int 
@@ -98,4 +238,130 @@ TCCXXX_PNG_Decode(
 );
 
 
+/* multi-instance API
+	Every decoder state is kept in the instance buffer, so different images can be
+	decoded at the same time by different threads (one instance per thread).
+
+	hPngDec = TCCXXX_PNG_Dec_Create(pInstanceBuf, PD_INSTANCE_MEM_SIZE);
+	TCCXXX_PNG_Dec_Init(hPngDec, &init, &callbacks);	// PD_INIT.pInstanceBuf is not used
+														// callbacks may be NULL with PD_INIT_OPT_MEMORY_INPUT
+	while( TCCXXX_PNG_Dec_Decode(hPngDec, &decode) == PD_RETURN_DECODE_PROCESSING );
+	TCCXXX_PNG_Dec_Destroy(hPngDec);
+
+	PD_INIT_OPT_PUSH_INPUT : the file is written into pSrcBuf as it arrives, and every time
+	TCCXXX_PNG_Dec_Push(hPngDec, iFilledBytes) tells how much of it is there.
+	Init or Decode returning PD_RETURN_NEED_MORE_DATA is called again once more bytes are pushed
+	(Init starts again from the beginning of the file, Decode goes on where it stopped).
+
+	TCCXXX_PNG_Dec_DecodeTimed(hPngDec, &decode, iBudgetUs) can be used instead of TCCXXX_PNG_Dec_Decode,
+	on every call or only on some of them : it returns PD_RETURN_DECODE_PROCESSING once iBudgetUs
+	is spent, and the next call goes on exactly where it stopped.
+	TCCXXX_PNG_Dec_Cancel(hPngDec) may be called from any thread (or an output callback) : the
+	current or next Decode returns PD_RETURN_DECODE_FAIL with TC_PNGDEC_ERR_CANCELED.
+*/
+extern PD_HANDLE
+TCCXXX_PNG_Dec_Create(
+	void * pInstanceBuf,		/* [IN] instance buffer (PD_INSTANCE_MEM_SIZE bytes) */
+	unsigned int iBufSize		/* [IN] size of pInstanceBuf in bytes */
+);								/* returns NULL if the buffer is too small */
+
+extern int
+TCCXXX_PNG_Dec_Init(
+	PD_HANDLE hPngDec,
+	PD_INIT * pInit,
+	PD_CALLBACKS * pCallbacks
+);								/* PD_RETURN_INIT_DONE or PD_RETURN_INIT_FAIL */
+
+extern int
+TCCXXX_PNG_Dec_Decode(
+	PD_HANDLE hPngDec,
+	PD_CUSTOM_DECODE * pDecode
+);								/* PD_RETURN_DECODE_DONE, PD_RETURN_DECODE_PROCESSING or PD_RETURN_DECODE_FAIL */
+
+extern int
+TCCXXX_PNG_Dec_Push(
+	PD_HANDLE hPngDec,
+	unsigned int iFilledBytes	/* [IN] bytes of PD_INIT.pSrcBuf filled so far (from the start of the file) */
+);								/* PD_INIT_OPT_PUSH_INPUT : may be called before TCCXXX_PNG_Dec_Init, and between
+								   the calls returning PD_RETURN_NEED_MORE_DATA. PD_RETURN_DECODE_DONE or PD_RETURN_DECODE_FAIL */
+
+extern int
+TCCXXX_PNG_Dec_DecodeTimed(
+	PD_HANDLE hPngDec,
+	PD_CUSTOM_DECODE * pDecode,
+	unsigned int iBudgetUs		/* [IN] microseconds the call may take (RESOURCE_OCCUPATION is not used),
+								   it may run over by the time to inflate a few KB and output their rows */
+);								/* as TCCXXX_PNG_Dec_Decode. Some progress is made on every call, even with 0 us.
+								   Without a clock (no time_func, no system clock) every call is one short step */
+
+extern int
+TCCXXX_PNG_Dec_Cancel(
+	PD_HANDLE hPngDec
+);								/* stops the decoding until the next TCCXXX_PNG_Dec_Init.
+								   PD_RETURN_DECODE_DONE or PD_RETURN_DECODE_FAIL (invalid handle) */
+
+extern int
+TCCXXX_PNG_Dec_GetError(
+	PD_HANDLE hPngDec
+);								/* reason of the last PD_RETURN_xxx_FAIL : TC_PNGDEC_ERR_xxx (TCCXXX_PNG_DEC_ErrorDef.h),
+								   e.g. TC_PNGDEC_ERR_CHUNK_CRC or TC_PNGDEC_ERR_ZLIB_ADLER, 0 if none is recorded */
+
+extern int
+TCCXXX_PNG_Dec_GetChunkIndex(
+	PD_HANDLE hPngDec,
+	PD_CHUNK_INFO * pIndex,		/* [OUT] the chunks after IHDR met so far, in stream order (up to the first IDAT after init) */
+	int iMaxNum					/* [IN] entries of pIndex */
+);								/* number of entries written (PD_CHUNK_INDEX_NUM at most), 0 if not supported */
+
+extern int
+TCCXXX_PNG_Dec_GetPalette(
+	PD_HANDLE hPngDec,
+	unsigned int * pPalette,	/* [OUT] 256 entries of PD_PIXFMT_ARGB8888 : A from tRNS (0xFF without it), 0 past the PLTE entries */
+	int * pEntryNum				/* [OUT] entries of the PLTE chunk (may be NULL) */
+);								/* after TCCXXX_PNG_Dec_Init : PD_RETURN_DECODE_DONE,
+								   PD_RETURN_DECODE_FAIL if the image has no palette (colour type 3 only) */
+
+extern int
+TCCXXX_PNG_Dec_GetStats(
+	PD_HANDLE hPngDec,
+	PD_STATS * pStats			/* [OUT] counters since the last TCCXXX_PNG_Dec_Init (init included) */
+);								/* PD_RETURN_DECODE_DONE, PD_RETURN_DECODE_FAIL (zeroed) if PNGDEC_OPT_STATS is not built in.
+								   With PD_PIPELINE_2THREADS the inflate states are timed on the second thread :
+								   read the counters between the decode calls, or after the last one */
+
+extern void
+TCCXXX_PNG_Dec_Destroy(
+	PD_HANDLE hPngDec
+);								/* the instance buffer is owned (and freed) by the caller */
+
+
+/* batch API
+	Decodes many images at once on a pool of threads : every thread keeps an instance buffer
+	and a heap, and takes images from its share of the array, then from the other threads' shares.
+	done_func, read_func and the output callbacks are called from any thread of the pool
+	(including the caller's), one image at a time per thread.
+	A pool decodes one batch at a time : done_func must not start another batch on the same pool.
+
+	hBatch = TCCXXX_PNG_Batch_Create(0);				// one thread per CPU
+	TCCXXX_PNG_Batch_Decode(hBatch, pItems, iCount);	// returns when every image is finished
+	TCCXXX_PNG_Batch_Destroy(hBatch);
+*/
+extern PD_BATCH_HANDLE
+TCCXXX_PNG_Batch_Create(
+	int iThreads				/* [IN] threads decoding a batch (the caller's included), 0 : number of CPUs */
+);								/* returns NULL if out of memory, one thread is used where threads are not available */
+
+extern int
+TCCXXX_PNG_Batch_Decode(
+	PD_BATCH_HANDLE hBatch,
+	PD_BATCH_ITEM * pItems,
+	int iCount
+);								/* PD_RETURN_BATCH_DONE, PD_RETURN_BATCH_PARTIAL or PD_RETURN_BATCH_FAIL */
+
+extern void
+TCCXXX_PNG_Batch_Destroy(
+	PD_BATCH_HANDLE hBatch
+);								/* stops the threads and frees the pool */
+
+
 #endif //__TCCXXX_PNG_DEC_H__
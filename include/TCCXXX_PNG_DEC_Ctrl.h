@@ -139,11 +139,6 @@
 
 //#define PNGDEC_MOD_RGB_COMP4_RESET
 
-/* modified structure huft */
-#if defined(TCPNGD_COMPILER_LINUX) && !defined(PNGDEC_MOD_TYPE_STRUCT_HUFT)
-#define PNGDEC_MOD_TYPE_STRUCT_HUFT
-#endif
-
 /* Add chunks : PNGEXT 1.2.0 or 1.3.0 (skip) */
 //	PNGEXT 1.2.0(21 Nov. 2000): fRAc, gIFg, gIFt, gIFx, oFFs, pCAL, sCAL
 //	PNGEXT 1.3.0(30 Aug. 2006): sTER  
@@ -163,6 +158,53 @@
 #endif 
 
 
+/* optim. : defiltering kernels (SSE2 or NEON when available, C otherwise) */
+#define PNGDEC_OPT_DEFILTER_SIMD
+
+/* optim. : 64-bit bit buffer, refilled a word at a time inside IDAT */
+#define PNGDEC_OPT_BITBUF_64
+
+/* optim. : LZ77 match copy by memset / words where the ring queue does not wrap */
+#define PNGDEC_OPT_FAST_MATCH_COPY
+
+/* optim. : chunk CRC-32 by PCLMULQDQ (x86) or CRC32 instructions (ARMv8) when the CPU has them */
+#define PNGDEC_OPT_CRC_HW
+
+/* optim. : zlib Adler-32 by SSSE3 / AVX2 (x86, run-time selection) or NEON (ARM) */
+#define PNGDEC_OPT_ADLER_SIMD
+
+/* optim. : PD_PIPELINE_2THREADS, inflate on a second thread (pthreads, link with -pthread) */
+#define PNGDEC_OPT_PIPELINE_THREAD
+
+/* optim. : TCCXXX_PNG_Batch_Decode() on a work-stealing pool of threads (pthreads, one thread otherwise) */
+#define PNGDEC_OPT_BATCH_THREADPOOL
+
+/* optim. : PD_INIT_OPT_RESIZE_AREA, area-averaging reduction (SSE2 or NEON when available, C otherwise) */
+#define PNGDEC_OPT_RESIZE_AREA
+
+/* optim. : palette and tRNS (or the levels of 1/2/4-bit grey) folded into tables of output pixels at the first
+			decode call, indexed rows expanded by table lookups (AVX2 gather on x86, run-time selection),
+			sub-byte rows a whole byte at a time */
+#define PNGDEC_OPT_PLTE_LUT
+
+/* optim. : PD_INIT_OPT_THUMBNAIL, interlaced images reduced to the LCD stop after the Adam7 passes they need */
+#define PNGDEC_OPT_ADAM7_THUMBNAIL
+
+/* optim. : PD_INIT_OPT_SEEKABLE_INPUT, unused chunks are jumped over by PD_CALLBACKS.seek_func,
+			and the chunks met are listed by TCCXXX_PNG_Dec_GetChunkIndex() (needs PNGDEC_CHECK_EOF_2) */
+#define PNGDEC_OPT_CHUNK_SEEK
+#if defined(PNGDEC_OPT_CHUNK_SEEK) && !defined(PNGDEC_CHECK_EOF_2)
+#	undef PNGDEC_OPT_CHUNK_SEEK
+#endif
+
+/* optim. : TCCXXX_PNG_Dec_DecodeTimed(), the clock is read every few KB of inflated data
+			and the call returns once its time budget is spent (instead of RESOURCE_OCCUPATION) */
+#define PNGDEC_OPT_TIME_SLICE
+
+/* debug : time and runs of each decoder state, inflated bytes per block type, defiltered rows per filter type
+		   and read_func use, read by TCCXXX_PNG_Dec_GetStats() (two clock reads a state, a few adds a row) */
+//#define PNGDEC_OPT_STATS
+
 /* stability: Check Bit_depth */
 #define PNGDEC_STABILITY_BIT_DEPTH	// 1,2,4,8,16
 
@@ -175,6 +217,12 @@
 	#define PNGDEC_STABILITY_READ_UNKNOWN_ANC_CHUNK_SKIP
 			//for pngTest.png
 
+	/* stability: CRC-32 of every chunk (ERROR_DET_MODE : PD_ERROR_CHK_ALL or PD_ERROR_CHK_CRC) */
+	#define PNGDEC_STABILITY_CHECK_CRC
+
+	/* stability: Adler-32 of the zlib stream (ERROR_DET_MODE : PD_ERROR_CHK_ALL or PD_ERROR_CHK_ADLER) */
+	#define PNGDEC_STABILITY_CHECK_ADLER
+
 #endif //PNGDEC_STABILITY_ERROR_HANDLE
 
 
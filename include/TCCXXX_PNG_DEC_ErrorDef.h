@@ -13,4 +13,28 @@
 
 #define TC_PNGDEC_ERR_GAMMA_ZERO	(-3000)
 
+//CRC-32 of a chunk does not match
+#define TC_PNGDEC_ERR_CHUNK_CRC		(-4000)
+
+//Adler-32 of the decompressed image data does not match the zlib stream
+#define TC_PNGDEC_ERR_ZLIB_ADLER	(-4100)
+
+//TCCXXX_PNG_Batch_Decode() : no memory for the heap of the image
+#define TC_PNGDEC_ERR_BATCH_MEMORY	(-5000)
+
+//TCCXXX_PNG_Dec_Cancel() stopped the decoding
+#define TC_PNGDEC_ERR_CANCELED		(-6000)
+
+//PD_CUSTOM_DECODE.DST_FORMAT is not a PD_PIXFMT_xxx, or does not fit the image (palette indices of an image without palette)
+#define TC_PNGDEC_ERR_DST_FORMAT	(-7000)
+
+//PD_CUSTOM_DECODE.CROP_IMAGE : interlaced image, or crop rectangle outside the image or empty
+#define TC_PNGDEC_ERR_CROP			(-7100)
+
+//PD_OUTPUT_ROW without PD_CUSTOM_DECODE.write_row_func
+#define TC_PNGDEC_ERR_ROW_FUNC		(-7200)
+
+//PD_OUTPUT_SURFACE without PD_CUSTOM_DECODE.pDstAddr[0] (or pDstAddr[1] / [2] of a YUV format)
+#define TC_PNGDEC_ERR_DST_ADDR		(-7300)
+
 
@@ -11,8 +11,8 @@
 #define int64		signed __int64
 #define uint64		unsigned __int64
 #else
-#define int64		signed long int
-#define uint64		unsigned long int
+#define int64		signed long long
+#define uint64		unsigned long long
 
 #define BYTE		unsigned char
 #endif
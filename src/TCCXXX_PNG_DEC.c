@@ -12,35 +12,106 @@
 #include "TCCXXX_PNG_TYPES.h"
 #include "TCCXXX_PNG_DEC_format.h"
 
-/*******************************************************************/
-/**************************Structure Defines************************/
-/*******************************************************************/
+#include <string.h>			//memcpy
+#include <stdlib.h>			//malloc, free : TCCXXX_PNG_Batch_Create()
+
+#if defined(PNGDEC_OPT_DEFILTER_SIMD)
+#	if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#		include <emmintrin.h>
+#		define PD_DEFILTER_SSE2
+#		define PD_SSE2_TARGET
+#		define PD_SSE2_CHECK()		(1)
+#	elif (defined(__GNUC__) || defined(__clang__)) && (defined(__i386__) || defined(__x86_64__))
+#		include <emmintrin.h>
+#		define PD_DEFILTER_SSE2
+#		define PD_SSE2_TARGET		__attribute__((target("sse2")))
+#		define PD_SSE2_CHECK()		__builtin_cpu_supports("sse2")
+#	elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#		include <arm_neon.h>
+#		define PD_DEFILTER_NEON		//NEON is a build option on ARM (always present on AArch64)
+#	endif
+#endif
 
-//Huffman Code Structure
-#if !defined(PNGDEC_MOD_TYPE_STRUCT_HUFT)
-typedef struct _huft huft;
-typedef struct _huft{
-	uint16 e;		/* number of extra bits or operation */
-	uint16 b;		/* number of bits in this code or subcode */
+#if defined(PNGDEC_STABILITY_CHECK_CRC) && defined(PNGDEC_OPT_CRC_HW)
+#	if (defined(__GNUC__) || defined(__clang__)) && (defined(__i386__) || defined(__x86_64__))
+#		include <emmintrin.h>
+#		include <wmmintrin.h>
+#		define PD_CRC_PCLMUL
+#		define PD_PCLMUL_TARGET		__attribute__((target("sse2,pclmul")))
+#		define PD_PCLMUL_CHECK()	(__builtin_cpu_supports("sse2") && __builtin_cpu_supports("pclmul"))
+#	elif defined(__ARM_FEATURE_CRC32)
+#		include <arm_acle.h>
+#		define PD_CRC_ARMV8
+#		define PD_ARMV8_CRC_TARGET
+#		define PD_ARMV8_CRC_CHECK()	(1)
+#	elif defined(__GNUC__) && defined(__aarch64__) && defined(__linux__)
+#		include <arm_acle.h>
+#		include <sys/auxv.h>
+#		define PD_CRC_ARMV8
+#		define PD_ARMV8_CRC_TARGET	__attribute__((target("+crc")))
+#		define PD_ARMV8_CRC_CHECK()	((getauxval(AT_HWCAP) & HWCAP_CRC32) != 0)
+#	endif
+#endif
 
-	union
-	{
-		uint16 n;	/* literal, length base, or distance base */
-		huft *t;	/* pointer to next level of table */
-	}v;
-}huft;
-#else
-typedef struct _huft{
-	uint16 e;		/* number of extra bits or operation */
-	uint16 b;		/* number of bits in this code or subcode */
+#if defined(PNGDEC_STABILITY_CHECK_ADLER) && defined(PNGDEC_OPT_ADLER_SIMD)
+#	if (defined(__GNUC__) || defined(__clang__)) && (defined(__i386__) || defined(__x86_64__))
+#		include <immintrin.h>
+#		define PD_ADLER_SSSE3
+#		define PD_ADLER_AVX2
+#		define PD_SSSE3_TARGET		__attribute__((target("ssse3")))
+#		define PD_SSSE3_CHECK()		__builtin_cpu_supports("ssse3")
+#		define PD_AVX2_TARGET		__attribute__((target("avx2")))
+#		define PD_AVX2_CHECK()		__builtin_cpu_supports("avx2")
+#	elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#		include <arm_neon.h>
+#		define PD_ADLER_NEON
+#	endif
+#endif
 
-	union
-	{
-		uint16 n;	/* literal, length base, or distance base */
-		void *t;	/* pointer to next level of table */
-	}v;
-}huft;
+#if defined(PNGDEC_OPT_PIPELINE_THREAD) || defined(PNGDEC_OPT_BATCH_THREADPOOL)
+#	if (defined(__GNUC__) || defined(__clang__)) && (defined(__unix__) || defined(__APPLE__))
+#		include <pthread.h>
+#		include <unistd.h>
+#		define PD_THREADS
+#		define PD_CPU_COUNT()			sysconf(_SC_NPROCESSORS_ONLN)
+#		define PD_ATOMIC_LOAD(p)		__atomic_load_n((p), __ATOMIC_ACQUIRE)
+#		define PD_ATOMIC_LOAD_SC(p)		__atomic_load_n((p), __ATOMIC_SEQ_CST)
+#		define PD_ATOMIC_STORE_SC(p, v)	__atomic_store_n((p), (v), __ATOMIC_SEQ_CST)
+#		define PD_ATOMIC_CAS(p, e, v)	__atomic_compare_exchange_n((p), (e), (v), 0, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST)
+#		define PD_ATOMIC_ADD(p, v)		__atomic_add_fetch((p), (v), __ATOMIC_SEQ_CST)
+#		if defined(__i386__) || defined(__x86_64__)
+#			define PD_CPU_RELAX()		__builtin_ia32_pause()
+#		elif defined(__aarch64__) || (defined(__ARM_ARCH) && (__ARM_ARCH >= 7))
+#			define PD_CPU_RELAX()		__asm__ __volatile__("yield" ::: "memory")
+#		else
+#			define PD_CPU_RELAX()
+#		endif
+#	endif
+#endif
+#if defined(PNGDEC_OPT_PLTE_LUT) && (defined(__GNUC__) || defined(__clang__)) && (defined(__i386__) || defined(__x86_64__))
+#	include <immintrin.h>
+#	define PD_PLTE_AVX2
+#	define PD_PLTE_AVX2_TARGET		__attribute__((target("avx2")))
+#	define PD_PLTE_AVX2_CHECK()		__builtin_cpu_supports("avx2")
+#endif
+
+#if defined(PD_THREADS) && defined(PNGDEC_OPT_PIPELINE_THREAD)
+#	define PD_PIPELINE
 #endif
+#if defined(PD_THREADS) && defined(PNGDEC_OPT_BATCH_THREADPOOL)
+#	define PD_BATCH_THREADS
+#endif
+
+#if (defined(PNGDEC_OPT_TIME_SLICE) || defined(PNGDEC_OPT_STATS)) && (defined(__unix__) || defined(__APPLE__))
+#	include <time.h>
+#	if defined(CLOCK_MONOTONIC)
+#		define PD_CLOCK_MONOTONIC	//clock_gettime() : time slices without PD_CUSTOM_DECODE.time_func, statistics
+#	endif
+#endif
+
+/*******************************************************************/
+/**************************Structure Defines************************/
+/*******************************************************************/
 
 //Palette Structure 
 #define PD_PLTE_TABLE_STRUCT_SIZE	4
@@ -51,9 +122,37 @@ typedef struct{
 	uint8 Alpha;
 }PD_PLTE_TABLE;
 
-typedef int (DECODE_IMAGE_BASEDON_BIT_DEPTH) (void);
+typedef struct _PD_INSTANCE PD_INSTANCE;
+
+typedef int (DECODE_IMAGE_BASEDON_BIT_DEPTH) (PD_INSTANCE *pInst);
 typedef DECODE_IMAGE_BASEDON_BIT_DEPTH * Decode_Func_Ptr;
 
+//Defiltering kernel : one row of one filter type
+typedef void (DEFILTER_ROW) (uint8 *row, const uint8 *src, uint32 row_size, uint32 bpp);
+typedef DEFILTER_ROW * Defilter_Func_Ptr;
+
+//CRC-32 kernel : crc is the register before the final inversion
+typedef uint32 (CRC32_UPDATE) (uint32 crc, const uint8 *buf, uint32 len);
+typedef CRC32_UPDATE * Crc32_Func_Ptr;
+
+//Adler-32 kernel
+typedef uint32 (ADLER32_UPDATE) (uint32 adler, const uint8 *buf, uint32 len);
+typedef ADLER32_UPDATE * Adler32_Func_Ptr;
+
+//Area reduction kernel : adds the 8.8 average of each box of a converted row to acc (4 sums per output pixel)
+typedef void (AREA_ROW) (uint32 *acc, const uint8 *src, const uint16 *bound, const uint32 *rcp, uint32 count);
+typedef AREA_ROW * Area_Func_Ptr;
+
+//Palette expansion kernel : count 8-bit indices into the 32-bit entries of lut
+typedef void (PLTE_EXPAND) (uint32 *dst, const uint8 *src, const uint32 *lut, uint32 count);
+typedef PLTE_EXPAND * Plte_Func_Ptr;
+
+//16-bit sample kernels : count big-endian samples narrowed to 8 bits (high byte, or rounded) / into uint16
+typedef void (NARROW16) (uint8 *dst, const uint8 *src, uint32 count, uint32 round);
+typedef NARROW16 * Narrow16_Func_Ptr;
+typedef void (SWAP16) (uint16 *dst, const uint8 *src, uint32 count);
+typedef SWAP16 * Swap16_Func_Ptr;
+
 /*******************************************************************/
 /************************Macro Defines******************************/
 /*******************************************************************/
@@ -66,6 +165,11 @@ typedef DECODE_IMAGE_BASEDON_BIT_DEPTH * Decode_Func_Ptr;
 #define		PD_Conditional_Skip		1
 #define		PD_Absolute_Skip		2
 
+//CRC-32 check of chunks
+#define		PD_CRC_OFF			0	//ERROR_DET_MODE does not ask for it
+#define		PD_CRC_DEFER		1	//TCCXXX_PNGDEC_Init : keep the result until ERROR_DET_MODE is known
+#define		PD_CRC_ON			2
+
 //Return values of Functions in PNG Decoder
 #define		PD_PROCESS_DONE		0
 #define		PD_PROCESS_ERROR		-1
@@ -140,7 +244,7 @@ typedef DECODE_IMAGE_BASEDON_BIT_DEPTH * Decode_Func_Ptr;
 #define		PD_DEFLATE_FIXHUFF		1
 #define		PD_DEFLATE_VARHUFF		2
 
-//Job Specification
+//Job Specification (PD_STATS_JOB_xxx follow these values)
 #define		PD_JOB_BUILD_FIXHUFF		0
 #define		PD_JOB_BUILD_VARHUFF		1
 #define		PD_JOB_DECODE_COPY			2
@@ -151,11 +255,47 @@ typedef DECODE_IMAGE_BASEDON_BIT_DEPTH * Decode_Func_Ptr;
 #define		PD_JOB_DECODE_IMAGE_RESIZE	7
 #define		PD_JOB_SEARCH_IDAT			8
 #define		PD_JOB_DECODE_INIT			9
+#define		PD_JOB_END_ZLIB				10
+
+//Two-thread pipeline
+#define		PD_PIPE_BATCH			4096	//Bytes inflated or taken from the queue between two publications
+#define		PD_PIPE_SPIN			4000	//Polls before blocking on the condition variable
+#define		PD_PIPE_PRODUCER		0		//Index of PD_Pipe_Sleep
+#define		PD_PIPE_CONSUMER		1
 
 //Huffman Table Specification
-#define		PD_HUFF_HASH_MAX_SIZE	1440
 #define		PD_HUFF_BIT_MAX			16
 #define		PD_HUFF_CODE_MAX		288
+#define		PD_HUFF_LITER_BITS		10		//Primary table bits for literal/length codes
+#define		PD_HUFF_DIST_BITS		8		//Primary table bits for distance codes
+#define		PD_HUFF_PRECODE_BITS	7		//Code length codes are 7 bits at most (no subtable)
+#define		PD_HUFF_FIX_LITER_BITS	9		//Fixed Huffman codes fit in the primary table
+#define		PD_HUFF_FIX_DIST_BITS	5
+#define		PD_HUFF_LITER_ENOUGH	1334	//Max. entries including subtables (zlib enough 288 10 15)
+#define		PD_HUFF_DIST_ENOUGH		402		//Ditto (zlib enough 32 8 15)
+
+//Huffman Table Types (symbol to entry mapping)
+#define		PD_HUFF_TABLE_PRECODE	0
+#define		PD_HUFF_TABLE_LITER		1
+#define		PD_HUFF_TABLE_DIST		2
+
+//Packed Huffman Table Entry (uint32)
+//	[3:0]  : bits to drop
+//	[7:4]  : type, 1 ~ PD_HUFF_LITER_MAX is the number of literals in the entry
+//	[31:8] : literals ([15:8] first), or
+//	         [11:8] extra bits and [31:16] base (length, distance), or
+//	         [11:8] subtable bits and [31:16] subtable offset in entries
+#define		PD_HUFF_TYPE_INVALID	0
+#define		PD_HUFF_LITER_MAX		3
+#define		PD_HUFF_TYPE_LENGTH		4
+#define		PD_HUFF_TYPE_END		5
+#define		PD_HUFF_TYPE_SUBTABLE	6
+#define		PD_HUFF_ENTRY(bits, type, data)	((uint32)(bits) | ((uint32)(type) << 4) | ((uint32)(data) << 8))
+#define		PD_HUFF_BITS(e)			((e) & 0xF)
+#define		PD_HUFF_TYPE(e)			(((e) >> 4) & 0xF)
+#define		PD_HUFF_LITER(e, n)		((uint8)((e) >> (8 + ((n) << 3))))
+#define		PD_HUFF_EXTRA(e)		(((e) >> 8) & 0xF)
+#define		PD_HUFF_BASE(e)			((e) >> 16)
 
 //Ancilary Definitions
 
@@ -163,24 +303,76 @@ typedef DECODE_IMAGE_BASEDON_BIT_DEPTH * Decode_Func_Ptr;
 #define		PD_DONE_YET				0
 #define		PD_DONE_ALREADY			1
 #define		PD_IHDR_CHUNK_SIZE		13
+#define		PD_CHUNK_SEARCH_NUM		1024	//Most chunks passed over looking for PLTE or IDAT
+
+//PD_INIT_OPT_PUSH_INPUT : bits an inflate job may read at most (beyond them, the bit buffer refill looks ahead up to 64 bits)
+#define		PD_PUSH_AHEAD_BITS		64
+#define		PD_PUSH_VARHUFF_BITS	(14 + 19 * 3 + 320 * 7)	//HLIT, HDIST, HCLEN, code length codes, code lengths
+#define		PD_PUSH_BLOCK_BITS		(48 + 15)				//a length / distance pair decoded past the limit and the end of block
+#define		PD_PUSH_COPY_BITS		(7 + 32)				//byte alignment, LEN and NLEN of a stored block
+#define		PD_PUSH_ADLER_BITS		(7 + 32)				//byte alignment and the Adler-32
+#define		PD_SLICE_BYTES			4096	//TCCXXX_PNG_Dec_DecodeTimed() : most bytes inflated between two looks at the clock
 #define		PD_RING_QUEUE_MASK		0x00007FFF //Mask for 32Kb
 
+//Bit buffer (little-endian loads assembled from bytes, no alignment needed)
+#define		PD_LOAD_LE32(p)			((uint32)(p)[0] | ((uint32)(p)[1] << 8) | ((uint32)(p)[2] << 16) | ((uint32)(p)[3] << 24))
+#define		PD_LOAD_BE32(p)			(((uint32)(p)[0] << 24) | ((uint32)(p)[1] << 16) | ((uint32)(p)[2] << 8) | (uint32)(p)[3])
+#define		PD_LOAD_BE16(p)			(((uint32)(p)[0] << 8) | (uint32)(p)[1])
+#if defined(PNGDEC_OPT_BITBUF_64)
+#define		PD_BITBUF				uint64
+#define		PD_BITBUF_LOAD(p)		((uint64)PD_LOAD_LE32(p) | ((uint64)PD_LOAD_LE32((p) + 4) << 32))
+#else
+#define		PD_BITBUF				uint32
+#define		PD_BITBUF_LOAD(p)		PD_LOAD_LE32(p)
+#endif
+#define		PD_BITBUF_BYTES			((int)sizeof(PD_BITBUF))
+
+//RGB to YCbCr (BT.601, 8 bit fixed point)
+#define		PD_RGB2Y(r, g, b)		((uint8)(((  66 * (r) + 129 * (g) +  25 * (b) + 128) >> 8) +  16))
+#define		PD_RGB2U(r, g, b)		((uint8)((( -38 * (r) -  74 * (g) + 112 * (b) + 128) >> 8) + 128))
+#define		PD_RGB2V(r, g, b)		((uint8)((( 112 * (r) -  94 * (g) -  18 * (b) + 128) >> 8) + 128))
+//RGB to grey (full range, R = G = B stays as it is)
+#define		PD_RGB2L(r, g, b)		((uint8)((  77 * (r) + 150 * (g) +  29 * (b) + 128) >> 8))
+
+#define		PD_PIXFMT_IS_INDEX(f)	((f) == PD_PIXFMT_INDEX8 || (f) == PD_PIXFMT_INDEX_PACKED)
+#define		PD_PIXFMT_IS_GREY(f)	((f) == PD_PIXFMT_L8 || (f) == PD_PIXFMT_LA88)
+#define		PD_PIXFMT_IS_WIDE(f)	((f) == PD_PIXFMT_RGBA16 || (f) == PD_PIXFMT_L16)
+
+//16-bit sample at p to 8 bits : high byte, or round(v * 255 / 65535) with PD_INIT_OPT_ROUND_16
+#define		PD_SAMPLE8(p, round)	((uint8)((round) ? ((PD_LOAD_BE16(p) * 255 + 32895) >> 16) : (p)[0]))
+
 #define		PD_INPUTBUF_SIZE		(2048)											//  2048 bytes
 #define		PD_INPUTBUF_SIZE2		(PD_INPUTBUF_SIZE * 2)							//  4096 bytes
 #define		PD_PLTE_TABLE_IDX		(256)
 #define		PD_PLTE_TABLE_SIZE		(PD_PLTE_TABLE_STRUCT_SIZE * PD_PLTE_TABLE_IDX)	//  1024 bytes500
 #define		PD_DEFLATE_BUF_LEN		(32768)											// 32768 bytes
-#define		PD_HASH_HEAP_SIZE		(PD_HUFF_HASH_MAX_SIZE * 8)	/* == sizeof(huft) 
-																	PD_HUFF_HASH_MAX_SIZE 1000 =>  8000 bytes
-																	PD_HUFF_HASH_MAX_SIZE 1440 => 11520 bytes(+3520bytes, 20081008)
-																*/
-#define		PD_INSTANCE_BUF_SIZE	(PD_INPUTBUF_SIZE2 + PD_PLTE_TABLE_SIZE + PD_DEFLATE_BUF_LEN + PD_HASH_HEAP_SIZE)
-									//49412 bytes ( = 4096 + 1024 + 32768 + 11520 + 4 /* for align. */)
+#define		PD_HASH_HEAP_SIZE		((PD_HUFF_LITER_ENOUGH + PD_HUFF_DIST_ENOUGH) * sizeof(uint32))	//  6944 bytes (was 11520 with huft)
 
 
 /*******************************************************************/
 /************************Functions Predefines**************************/
 /*******************************************************************/
+#if defined(PNGDEC_OPT_DEFILTER_SIMD)
+static const Defilter_Func_Ptr * PNG_Select_Defilter(void);
+#endif
+#if defined(PNGDEC_STABILITY_CHECK_CRC)
+static Crc32_Func_Ptr PNG_Select_Crc32(void);
+#endif
+#if defined(PNGDEC_STABILITY_CHECK_ADLER)
+static Adler32_Func_Ptr PNG_Select_Adler32(void);
+#endif
+#if defined(PNGDEC_OPT_RESIZE_AREA)
+static Area_Func_Ptr PNG_Select_Area(void);
+#endif
+#if defined(PNGDEC_OPT_PLTE_LUT)
+static Plte_Func_Ptr PNG_Select_Plte(void);
+#endif
+static Narrow16_Func_Ptr PNG_Select_Narrow16(void);
+static Swap16_Func_Ptr PNG_Select_Swap16(void);
+#if defined(PD_PIPELINE)
+static uint32 PNG_Pipe_Push_Check(PD_INSTANCE *pInst);
+static uint32 PNG_Pipe_Pop_Check(PD_INSTANCE *pInst);
+#endif
 
 
 /*******************************************************************/
@@ -223,6 +415,79 @@ static const uint16 PDRO_Dist_Ext[30] = {	 0,  0,  0,  0,  1,  1,  2,  2,
 											 7,  7,  8,  8,  9,  9, 10, 10, 
 											11, 11, 12, 12, 13, 13 };
 
+//Fixed Huffman codes (RFC 1951 3.2.6) as packed tables (see PNG_BuildUp_HuffTable)
+static const uint32 PDRO_FixHuff_Liter[1 << PD_HUFF_FIX_LITER_BITS] = {
+	0x00000057, 0x00005018, 0x00001018, 0x00730448, 0x001F0247, 0x00007018, 0x00003018, 0x0000C019,
+	0x000A0047, 0x00006018, 0x00002018, 0x0000A019, 0x00000018, 0x00008018, 0x00004018, 0x0000E019,
+	0x00060047, 0x00005818, 0x00001818, 0x00009019, 0x003B0347, 0x00007818, 0x00003818, 0x0000D019,
+	0x00110147, 0x00006818, 0x00002818, 0x0000B019, 0x00000818, 0x00008818, 0x00004818, 0x0000F019,
+	0x00040047, 0x00005418, 0x00001418, 0x00E30548, 0x002B0347, 0x00007418, 0x00003418, 0x0000C819,
+	0x000D0147, 0x00006418, 0x00002418, 0x0000A819, 0x00000418, 0x00008418, 0x00004418, 0x0000E819,
+	0x00080047, 0x00005C18, 0x00001C18, 0x00009819, 0x00530447, 0x00007C18, 0x00003C18, 0x0000D819,
+	0x00170247, 0x00006C18, 0x00002C18, 0x0000B819, 0x00000C18, 0x00008C18, 0x00004C18, 0x0000F819,
+	0x00030047, 0x00005218, 0x00001218, 0x00A30548, 0x00230347, 0x00007218, 0x00003218, 0x0000C419,
+	0x000B0147, 0x00006218, 0x00002218, 0x0000A419, 0x00000218, 0x00008218, 0x00004218, 0x0000E419,
+	0x00070047, 0x00005A18, 0x00001A18, 0x00009419, 0x00430447, 0x00007A18, 0x00003A18, 0x0000D419,
+	0x00130247, 0x00006A18, 0x00002A18, 0x0000B419, 0x00000A18, 0x00008A18, 0x00004A18, 0x0000F419,
+	0x00050047, 0x00005618, 0x00001618, 0x00000008, 0x00330347, 0x00007618, 0x00003618, 0x0000CC19,
+	0x000F0147, 0x00006618, 0x00002618, 0x0000AC19, 0x00000618, 0x00008618, 0x00004618, 0x0000EC19,
+	0x00090047, 0x00005E18, 0x00001E18, 0x00009C19, 0x00630447, 0x00007E18, 0x00003E18, 0x0000DC19,
+	0x001B0247, 0x00006E18, 0x00002E18, 0x0000BC19, 0x00000E18, 0x00008E18, 0x00004E18, 0x0000FC19,
+	0x00000057, 0x00005118, 0x00001118, 0x00830548, 0x001F0247, 0x00007118, 0x00003118, 0x0000C219,
+	0x000A0047, 0x00006118, 0x00002118, 0x0000A219, 0x00000118, 0x00008118, 0x00004118, 0x0000E219,
+	0x00060047, 0x00005918, 0x00001918, 0x00009219, 0x003B0347, 0x00007918, 0x00003918, 0x0000D219,
+	0x00110147, 0x00006918, 0x00002918, 0x0000B219, 0x00000918, 0x00008918, 0x00004918, 0x0000F219,
+	0x00040047, 0x00005518, 0x00001518, 0x01020048, 0x002B0347, 0x00007518, 0x00003518, 0x0000CA19,
+	0x000D0147, 0x00006518, 0x00002518, 0x0000AA19, 0x00000518, 0x00008518, 0x00004518, 0x0000EA19,
+	0x00080047, 0x00005D18, 0x00001D18, 0x00009A19, 0x00530447, 0x00007D18, 0x00003D18, 0x0000DA19,
+	0x00170247, 0x00006D18, 0x00002D18, 0x0000BA19, 0x00000D18, 0x00008D18, 0x00004D18, 0x0000FA19,
+	0x00030047, 0x00005318, 0x00001318, 0x00C30548, 0x00230347, 0x00007318, 0x00003318, 0x0000C619,
+	0x000B0147, 0x00006318, 0x00002318, 0x0000A619, 0x00000318, 0x00008318, 0x00004318, 0x0000E619,
+	0x00070047, 0x00005B18, 0x00001B18, 0x00009619, 0x00430447, 0x00007B18, 0x00003B18, 0x0000D619,
+	0x00130247, 0x00006B18, 0x00002B18, 0x0000B619, 0x00000B18, 0x00008B18, 0x00004B18, 0x0000F619,
+	0x00050047, 0x00005718, 0x00001718, 0x00000008, 0x00330347, 0x00007718, 0x00003718, 0x0000CE19,
+	0x000F0147, 0x00006718, 0x00002718, 0x0000AE19, 0x00000718, 0x00008718, 0x00004718, 0x0000EE19,
+	0x00090047, 0x00005F18, 0x00001F18, 0x00009E19, 0x00630447, 0x00007F18, 0x00003F18, 0x0000DE19,
+	0x001B0247, 0x00006F18, 0x00002F18, 0x0000BE19, 0x00000F18, 0x00008F18, 0x00004F18, 0x0000FE19,
+	0x00000057, 0x00005018, 0x00001018, 0x00730448, 0x001F0247, 0x00007018, 0x00003018, 0x0000C119,
+	0x000A0047, 0x00006018, 0x00002018, 0x0000A119, 0x00000018, 0x00008018, 0x00004018, 0x0000E119,
+	0x00060047, 0x00005818, 0x00001818, 0x00009119, 0x003B0347, 0x00007818, 0x00003818, 0x0000D119,
+	0x00110147, 0x00006818, 0x00002818, 0x0000B119, 0x00000818, 0x00008818, 0x00004818, 0x0000F119,
+	0x00040047, 0x00005418, 0x00001418, 0x00E30548, 0x002B0347, 0x00007418, 0x00003418, 0x0000C919,
+	0x000D0147, 0x00006418, 0x00002418, 0x0000A919, 0x00000418, 0x00008418, 0x00004418, 0x0000E919,
+	0x00080047, 0x00005C18, 0x00001C18, 0x00009919, 0x00530447, 0x00007C18, 0x00003C18, 0x0000D919,
+	0x00170247, 0x00006C18, 0x00002C18, 0x0000B919, 0x00000C18, 0x00008C18, 0x00004C18, 0x0000F919,
+	0x00030047, 0x00005218, 0x00001218, 0x00A30548, 0x00230347, 0x00007218, 0x00003218, 0x0000C519,
+	0x000B0147, 0x00006218, 0x00002218, 0x0000A519, 0x00000218, 0x00008218, 0x00004218, 0x0000E519,
+	0x00070047, 0x00005A18, 0x00001A18, 0x00009519, 0x00430447, 0x00007A18, 0x00003A18, 0x0000D519,
+	0x00130247, 0x00006A18, 0x00002A18, 0x0000B519, 0x00000A18, 0x00008A18, 0x00004A18, 0x0000F519,
+	0x00050047, 0x00005618, 0x00001618, 0x00000008, 0x00330347, 0x00007618, 0x00003618, 0x0000CD19,
+	0x000F0147, 0x00006618, 0x00002618, 0x0000AD19, 0x00000618, 0x00008618, 0x00004618, 0x0000ED19,
+	0x00090047, 0x00005E18, 0x00001E18, 0x00009D19, 0x00630447, 0x00007E18, 0x00003E18, 0x0000DD19,
+	0x001B0247, 0x00006E18, 0x00002E18, 0x0000BD19, 0x00000E18, 0x00008E18, 0x00004E18, 0x0000FD19,
+	0x00000057, 0x00005118, 0x00001118, 0x00830548, 0x001F0247, 0x00007118, 0x00003118, 0x0000C319,
+	0x000A0047, 0x00006118, 0x00002118, 0x0000A319, 0x00000118, 0x00008118, 0x00004118, 0x0000E319,
+	0x00060047, 0x00005918, 0x00001918, 0x00009319, 0x003B0347, 0x00007918, 0x00003918, 0x0000D319,
+	0x00110147, 0x00006918, 0x00002918, 0x0000B319, 0x00000918, 0x00008918, 0x00004918, 0x0000F319,
+	0x00040047, 0x00005518, 0x00001518, 0x01020048, 0x002B0347, 0x00007518, 0x00003518, 0x0000CB19,
+	0x000D0147, 0x00006518, 0x00002518, 0x0000AB19, 0x00000518, 0x00008518, 0x00004518, 0x0000EB19,
+	0x00080047, 0x00005D18, 0x00001D18, 0x00009B19, 0x00530447, 0x00007D18, 0x00003D18, 0x0000DB19,
+	0x00170247, 0x00006D18, 0x00002D18, 0x0000BB19, 0x00000D18, 0x00008D18, 0x00004D18, 0x0000FB19,
+	0x00030047, 0x00005318, 0x00001318, 0x00C30548, 0x00230347, 0x00007318, 0x00003318, 0x0000C719,
+	0x000B0147, 0x00006318, 0x00002318, 0x0000A719, 0x00000318, 0x00008318, 0x00004318, 0x0000E719,
+	0x00070047, 0x00005B18, 0x00001B18, 0x00009719, 0x00430447, 0x00007B18, 0x00003B18, 0x0000D719,
+	0x00130247, 0x00006B18, 0x00002B18, 0x0000B719, 0x00000B18, 0x00008B18, 0x00004B18, 0x0000F719,
+	0x00050047, 0x00005718, 0x00001718, 0x00000008, 0x00330347, 0x00007718, 0x00003718, 0x0000CF19,
+	0x000F0147, 0x00006718, 0x00002718, 0x0000AF19, 0x00000718, 0x00008718, 0x00004718, 0x0000EF19,
+	0x00090047, 0x00005F18, 0x00001F18, 0x00009F19, 0x00630447, 0x00007F18, 0x00003F18, 0x0000DF19,
+	0x001B0247, 0x00006F18, 0x00002F18, 0x0000BF19, 0x00000F18, 0x00008F18, 0x00004F18, 0x0000FF19 };
+
+static const uint32 PDRO_FixHuff_Dist[1 << PD_HUFF_FIX_DIST_BITS] = {
+	0x00010045, 0x01010745, 0x00110345, 0x10010B45, 0x00050145, 0x04010945, 0x00410545, 0x40010D45,
+	0x00030045, 0x02010845, 0x00210445, 0x20010C45, 0x00090245, 0x08010A45, 0x00810645, 0x00000000,
+	0x00020045, 0x01810745, 0x00190345, 0x18010B45, 0x00070145, 0x06010945, 0x00610545, 0x60010D45,
+	0x00040045, 0x03010845, 0x00310445, 0x30010C45, 0x000D0245, 0x0C010A45, 0x00C10645, 0x00000000 };
+
 //Masks for different Bit Depth Decoding
 static const uint16 PDRO_Depth_Mask[16] = {	0x80, 0x40, 0x20, 0x10, 0x08, 0x04, 0x02, 0x01,
 					 						0xC0, 0x30, 0x0C, 0x03,	0xF0, 0x0F,	0xFF, 0x00/*dummy*/ };
@@ -235,248 +500,664 @@ static const uint8 PDRO_Hor_Start[8] = {0, 4, 0, 2, 0, 1, 0, 0/*dummy*/};
 static const uint8 PDRO_Ver_Start[8] = {0, 0, 4, 0, 2, 0, 1, 0/*dummy*/};
 static const uint8 PDRO_Hor_Incre[8] = {8, 8, 4, 4, 2, 2, 1, 0/*dummy*/};
 static const uint8 PDRO_Ver_Incre[8] = {8, 8, 8, 4, 4, 2, 2, 0/*dummy*/};
+#if defined(PNGDEC_OPT_ADAM7_THUMBNAIL)
+//Pixel grid complete after each pass
+static const uint8 PDRO_Grid_Hor[7] = {8, 4, 4, 2, 2, 1, 1};
+static const uint8 PDRO_Grid_Ver[7] = {8, 8, 4, 4, 2, 2, 1};
+#endif
+
+#if defined(PNGDEC_STABILITY_CHECK_CRC)
+//CRC-32 (polynomial 0xEDB88320) tables for slicing-by-8 : [k][n] is the CRC of byte n followed by k zero bytes
+static const uint32 PDRO_Crc32_Table[8][256] = {
+	{
+		0x00000000, 0x77073096, 0xEE0E612C, 0x990951BA, 0x076DC419, 0x706AF48F, 0xE963A535, 0x9E6495A3,
+		0x0EDB8832, 0x79DCB8A4, 0xE0D5E91E, 0x97D2D988, 0x09B64C2B, 0x7EB17CBD, 0xE7B82D07, 0x90BF1D91,
+		0x1DB71064, 0x6AB020F2, 0xF3B97148, 0x84BE41DE, 0x1ADAD47D, 0x6DDDE4EB, 0xF4D4B551, 0x83D385C7,
+		0x136C9856, 0x646BA8C0, 0xFD62F97A, 0x8A65C9EC, 0x14015C4F, 0x63066CD9, 0xFA0F3D63, 0x8D080DF5,
+		0x3B6E20C8, 0x4C69105E, 0xD56041E4, 0xA2677172, 0x3C03E4D1, 0x4B04D447, 0xD20D85FD, 0xA50AB56B,
+		0x35B5A8FA, 0x42B2986C, 0xDBBBC9D6, 0xACBCF940, 0x32D86CE3, 0x45DF5C75, 0xDCD60DCF, 0xABD13D59,
+		0x26D930AC, 0x51DE003A, 0xC8D75180, 0xBFD06116, 0x21B4F4B5, 0x56B3C423, 0xCFBA9599, 0xB8BDA50F,
+		0x2802B89E, 0x5F058808, 0xC60CD9B2, 0xB10BE924, 0x2F6F7C87, 0x58684C11, 0xC1611DAB, 0xB6662D3D,
+		0x76DC4190, 0x01DB7106, 0x98D220BC, 0xEFD5102A, 0x71B18589, 0x06B6B51F, 0x9FBFE4A5, 0xE8B8D433,
+		0x7807C9A2, 0x0F00F934, 0x9609A88E, 0xE10E9818, 0x7F6A0DBB, 0x086D3D2D, 0x91646C97, 0xE6635C01,
+		0x6B6B51F4, 0x1C6C6162, 0x856530D8, 0xF262004E, 0x6C0695ED, 0x1B01A57B, 0x8208F4C1, 0xF50FC457,
+		0x65B0D9C6, 0x12B7E950, 0x8BBEB8EA, 0xFCB9887C, 0x62DD1DDF, 0x15DA2D49, 0x8CD37CF3, 0xFBD44C65,
+		0x4DB26158, 0x3AB551CE, 0xA3BC0074, 0xD4BB30E2, 0x4ADFA541, 0x3DD895D7, 0xA4D1C46D, 0xD3D6F4FB,
+		0x4369E96A, 0x346ED9FC, 0xAD678846, 0xDA60B8D0, 0x44042D73, 0x33031DE5, 0xAA0A4C5F, 0xDD0D7CC9,
+		0x5005713C, 0x270241AA, 0xBE0B1010, 0xC90C2086, 0x5768B525, 0x206F85B3, 0xB966D409, 0xCE61E49F,
+		0x5EDEF90E, 0x29D9C998, 0xB0D09822, 0xC7D7A8B4, 0x59B33D17, 0x2EB40D81, 0xB7BD5C3B, 0xC0BA6CAD,
+		0xEDB88320, 0x9ABFB3B6, 0x03B6E20C, 0x74B1D29A, 0xEAD54739, 0x9DD277AF, 0x04DB2615, 0x73DC1683,
+		0xE3630B12, 0x94643B84, 0x0D6D6A3E, 0x7A6A5AA8, 0xE40ECF0B, 0x9309FF9D, 0x0A00AE27, 0x7D079EB1,
+		0xF00F9344, 0x8708A3D2, 0x1E01F268, 0x6906C2FE, 0xF762575D, 0x806567CB, 0x196C3671, 0x6E6B06E7,
+		0xFED41B76, 0x89D32BE0, 0x10DA7A5A, 0x67DD4ACC, 0xF9B9DF6F, 0x8EBEEFF9, 0x17B7BE43, 0x60B08ED5,
+		0xD6D6A3E8, 0xA1D1937E, 0x38D8C2C4, 0x4FDFF252, 0xD1BB67F1, 0xA6BC5767, 0x3FB506DD, 0x48B2364B,
+		0xD80D2BDA, 0xAF0A1B4C, 0x36034AF6, 0x41047A60, 0xDF60EFC3, 0xA867DF55, 0x316E8EEF, 0x4669BE79,
+		0xCB61B38C, 0xBC66831A, 0x256FD2A0, 0x5268E236, 0xCC0C7795, 0xBB0B4703, 0x220216B9, 0x5505262F,
+		0xC5BA3BBE, 0xB2BD0B28, 0x2BB45A92, 0x5CB36A04, 0xC2D7FFA7, 0xB5D0CF31, 0x2CD99E8B, 0x5BDEAE1D,
+		0x9B64C2B0, 0xEC63F226, 0x756AA39C, 0x026D930A, 0x9C0906A9, 0xEB0E363F, 0x72076785, 0x05005713,
+		0x95BF4A82, 0xE2B87A14, 0x7BB12BAE, 0x0CB61B38, 0x92D28E9B, 0xE5D5BE0D, 0x7CDCEFB7, 0x0BDBDF21,
+		0x86D3D2D4, 0xF1D4E242, 0x68DDB3F8, 0x1FDA836E, 0x81BE16CD, 0xF6B9265B, 0x6FB077E1, 0x18B74777,
+		0x88085AE6, 0xFF0F6A70, 0x66063BCA, 0x11010B5C, 0x8F659EFF, 0xF862AE69, 0x616BFFD3, 0x166CCF45,
+		0xA00AE278, 0xD70DD2EE, 0x4E048354, 0x3903B3C2, 0xA7672661, 0xD06016F7, 0x4969474D, 0x3E6E77DB,
+		0xAED16A4A, 0xD9D65ADC, 0x40DF0B66, 0x37D83BF0, 0xA9BCAE53, 0xDEBB9EC5, 0x47B2CF7F, 0x30B5FFE9,
+		0xBDBDF21C, 0xCABAC28A, 0x53B39330, 0x24B4A3A6, 0xBAD03605, 0xCDD70693, 0x54DE5729, 0x23D967BF,
+		0xB3667A2E, 0xC4614AB8, 0x5D681B02, 0x2A6F2B94, 0xB40BBE37, 0xC30C8EA1, 0x5A05DF1B, 0x2D02EF8D
+	},
+	{
+		0x00000000, 0x191B3141, 0x32366282, 0x2B2D53C3, 0x646CC504, 0x7D77F445, 0x565AA786, 0x4F4196C7,
+		0xC8D98A08, 0xD1C2BB49, 0xFAEFE88A, 0xE3F4D9CB, 0xACB54F0C, 0xB5AE7E4D, 0x9E832D8E, 0x87981CCF,
+		0x4AC21251, 0x53D92310, 0x78F470D3, 0x61EF4192, 0x2EAED755, 0x37B5E614, 0x1C98B5D7, 0x05838496,
+		0x821B9859, 0x9B00A918, 0xB02DFADB, 0xA936CB9A, 0xE6775D5D, 0xFF6C6C1C, 0xD4413FDF, 0xCD5A0E9E,
+		0x958424A2, 0x8C9F15E3, 0xA7B24620, 0xBEA97761, 0xF1E8E1A6, 0xE8F3D0E7, 0xC3DE8324, 0xDAC5B265,
+		0x5D5DAEAA, 0x44469FEB, 0x6F6BCC28, 0x7670FD69, 0x39316BAE, 0x202A5AEF, 0x0B07092C, 0x121C386D,
+		0xDF4636F3, 0xC65D07B2, 0xED705471, 0xF46B6530, 0xBB2AF3F7, 0xA231C2B6, 0x891C9175, 0x9007A034,
+		0x179FBCFB, 0x0E848DBA, 0x25A9DE79, 0x3CB2EF38, 0x73F379FF, 0x6AE848BE, 0x41C51B7D, 0x58DE2A3C,
+		0xF0794F05, 0xE9627E44, 0xC24F2D87, 0xDB541CC6, 0x94158A01, 0x8D0EBB40, 0xA623E883, 0xBF38D9C2,
+		0x38A0C50D, 0x21BBF44C, 0x0A96A78F, 0x138D96CE, 0x5CCC0009, 0x45D73148, 0x6EFA628B, 0x77E153CA,
+		0xBABB5D54, 0xA3A06C15, 0x888D3FD6, 0x91960E97, 0xDED79850, 0xC7CCA911, 0xECE1FAD2, 0xF5FACB93,
+		0x7262D75C, 0x6B79E61D, 0x4054B5DE, 0x594F849F, 0x160E1258, 0x0F152319, 0x243870DA, 0x3D23419B,
+		0x65FD6BA7, 0x7CE65AE6, 0x57CB0925, 0x4ED03864, 0x0191AEA3, 0x188A9FE2, 0x33A7CC21, 0x2ABCFD60,
+		0xAD24E1AF, 0xB43FD0EE, 0x9F12832D, 0x8609B26C, 0xC94824AB, 0xD05315EA, 0xFB7E4629, 0xE2657768,
+		0x2F3F79F6, 0x362448B7, 0x1D091B74, 0x04122A35, 0x4B53BCF2, 0x52488DB3, 0x7965DE70, 0x607EEF31,
+		0xE7E6F3FE, 0xFEFDC2BF, 0xD5D0917C, 0xCCCBA03D, 0x838A36FA, 0x9A9107BB, 0xB1BC5478, 0xA8A76539,
+		0x3B83984B, 0x2298A90A, 0x09B5FAC9, 0x10AECB88, 0x5FEF5D4F, 0x46F46C0E, 0x6DD93FCD, 0x74C20E8C,
+		0xF35A1243, 0xEA412302, 0xC16C70C1, 0xD8774180, 0x9736D747, 0x8E2DE606, 0xA500B5C5, 0xBC1B8484,
+		0x71418A1A, 0x685ABB5B, 0x4377E898, 0x5A6CD9D9, 0x152D4F1E, 0x0C367E5F, 0x271B2D9C, 0x3E001CDD,
+		0xB9980012, 0xA0833153, 0x8BAE6290, 0x92B553D1, 0xDDF4C516, 0xC4EFF457, 0xEFC2A794, 0xF6D996D5,
+		0xAE07BCE9, 0xB71C8DA8, 0x9C31DE6B, 0x852AEF2A, 0xCA6B79ED, 0xD37048AC, 0xF85D1B6F, 0xE1462A2E,
+		0x66DE36E1, 0x7FC507A0, 0x54E85463, 0x4DF36522, 0x02B2F3E5, 0x1BA9C2A4, 0x30849167, 0x299FA026,
+		0xE4C5AEB8, 0xFDDE9FF9, 0xD6F3CC3A, 0xCFE8FD7B, 0x80A96BBC, 0x99B25AFD, 0xB29F093E, 0xAB84387F,
+		0x2C1C24B0, 0x350715F1, 0x1E2A4632, 0x07317773, 0x4870E1B4, 0x516BD0F5, 0x7A468336, 0x635DB277,
+		0xCBFAD74E, 0xD2E1E60F, 0xF9CCB5CC, 0xE0D7848D, 0xAF96124A, 0xB68D230B, 0x9DA070C8, 0x84BB4189,
+		0x03235D46, 0x1A386C07, 0x31153FC4, 0x280E0E85, 0x674F9842, 0x7E54A903, 0x5579FAC0, 0x4C62CB81,
+		0x8138C51F, 0x9823F45E, 0xB30EA79D, 0xAA1596DC, 0xE554001B, 0xFC4F315A, 0xD7626299, 0xCE7953D8,
+		0x49E14F17, 0x50FA7E56, 0x7BD72D95, 0x62CC1CD4, 0x2D8D8A13, 0x3496BB52, 0x1FBBE891, 0x06A0D9D0,
+		0x5E7EF3EC, 0x4765C2AD, 0x6C48916E, 0x7553A02F, 0x3A1236E8, 0x230907A9, 0x0824546A, 0x113F652B,
+		0x96A779E4, 0x8FBC48A5, 0xA4911B66, 0xBD8A2A27, 0xF2CBBCE0, 0xEBD08DA1, 0xC0FDDE62, 0xD9E6EF23,
+		0x14BCE1BD, 0x0DA7D0FC, 0x268A833F, 0x3F91B27E, 0x70D024B9, 0x69CB15F8, 0x42E6463B, 0x5BFD777A,
+		0xDC656BB5, 0xC57E5AF4, 0xEE530937, 0xF7483876, 0xB809AEB1, 0xA1129FF0, 0x8A3FCC33, 0x9324FD72
+	},
+	{
+		0x00000000, 0x01C26A37, 0x0384D46E, 0x0246BE59, 0x0709A8DC, 0x06CBC2EB, 0x048D7CB2, 0x054F1685,
+		0x0E1351B8, 0x0FD13B8F, 0x0D9785D6, 0x0C55EFE1, 0x091AF964, 0x08D89353, 0x0A9E2D0A, 0x0B5C473D,
+		0x1C26A370, 0x1DE4C947, 0x1FA2771E, 0x1E601D29, 0x1B2F0BAC, 0x1AED619B, 0x18ABDFC2, 0x1969B5F5,
+		0x1235F2C8, 0x13F798FF, 0x11B126A6, 0x10734C91, 0x153C5A14, 0x14FE3023, 0x16B88E7A, 0x177AE44D,
+		0x384D46E0, 0x398F2CD7, 0x3BC9928E, 0x3A0BF8B9, 0x3F44EE3C, 0x3E86840B, 0x3CC03A52, 0x3D025065,
+		0x365E1758, 0x379C7D6F, 0x35DAC336, 0x3418A901, 0x3157BF84, 0x3095D5B3, 0x32D36BEA, 0x331101DD,
+		0x246BE590, 0x25A98FA7, 0x27EF31FE, 0x262D5BC9, 0x23624D4C, 0x22A0277B, 0x20E69922, 0x2124F315,
+		0x2A78B428, 0x2BBADE1F, 0x29FC6046, 0x283E0A71, 0x2D711CF4, 0x2CB376C3, 0x2EF5C89A, 0x2F37A2AD,
+		0x709A8DC0, 0x7158E7F7, 0x731E59AE, 0x72DC3399, 0x7793251C, 0x76514F2B, 0x7417F172, 0x75D59B45,
+		0x7E89DC78, 0x7F4BB64F, 0x7D0D0816, 0x7CCF6221, 0x798074A4, 0x78421E93, 0x7A04A0CA, 0x7BC6CAFD,
+		0x6CBC2EB0, 0x6D7E4487, 0x6F38FADE, 0x6EFA90E9, 0x6BB5866C, 0x6A77EC5B, 0x68315202, 0x69F33835,
+		0x62AF7F08, 0x636D153F, 0x612BAB66, 0x60E9C151, 0x65A6D7D4, 0x6464BDE3, 0x662203BA, 0x67E0698D,
+		0x48D7CB20, 0x4915A117, 0x4B531F4E, 0x4A917579, 0x4FDE63FC, 0x4E1C09CB, 0x4C5AB792, 0x4D98DDA5,
+		0x46C49A98, 0x4706F0AF, 0x45404EF6, 0x448224C1, 0x41CD3244, 0x400F5873, 0x4249E62A, 0x438B8C1D,
+		0x54F16850, 0x55330267, 0x5775BC3E, 0x56B7D609, 0x53F8C08C, 0x523AAABB, 0x507C14E2, 0x51BE7ED5,
+		0x5AE239E8, 0x5B2053DF, 0x5966ED86, 0x58A487B1, 0x5DEB9134, 0x5C29FB03, 0x5E6F455A, 0x5FAD2F6D,
+		0xE1351B80, 0xE0F771B7, 0xE2B1CFEE, 0xE373A5D9, 0xE63CB35C, 0xE7FED96B, 0xE5B86732, 0xE47A0D05,
+		0xEF264A38, 0xEEE4200F, 0xECA29E56, 0xED60F461, 0xE82FE2E4, 0xE9ED88D3, 0xEBAB368A, 0xEA695CBD,
+		0xFD13B8F0, 0xFCD1D2C7, 0xFE976C9E, 0xFF5506A9, 0xFA1A102C, 0xFBD87A1B, 0xF99EC442, 0xF85CAE75,
+		0xF300E948, 0xF2C2837F, 0xF0843D26, 0xF1465711, 0xF4094194, 0xF5CB2BA3, 0xF78D95FA, 0xF64FFFCD,
+		0xD9785D60, 0xD8BA3757, 0xDAFC890E, 0xDB3EE339, 0xDE71F5BC, 0xDFB39F8B, 0xDDF521D2, 0xDC374BE5,
+		0xD76B0CD8, 0xD6A966EF, 0xD4EFD8B6, 0xD52DB281, 0xD062A404, 0xD1A0CE33, 0xD3E6706A, 0xD2241A5D,
+		0xC55EFE10, 0xC49C9427, 0xC6DA2A7E, 0xC7184049, 0xC25756CC, 0xC3953CFB, 0xC1D382A2, 0xC011E895,
+		0xCB4DAFA8, 0xCA8FC59F, 0xC8C97BC6, 0xC90B11F1, 0xCC440774, 0xCD866D43, 0xCFC0D31A, 0xCE02B92D,
+		0x91AF9640, 0x906DFC77, 0x922B422E, 0x93E92819, 0x96A63E9C, 0x976454AB, 0x9522EAF2, 0x94E080C5,
+		0x9FBCC7F8, 0x9E7EADCF, 0x9C381396, 0x9DFA79A1, 0x98B56F24, 0x99770513, 0x9B31BB4A, 0x9AF3D17D,
+		0x8D893530, 0x8C4B5F07, 0x8E0DE15E, 0x8FCF8B69, 0x8A809DEC, 0x8B42F7DB, 0x89044982, 0x88C623B5,
+		0x839A6488, 0x82580EBF, 0x801EB0E6, 0x81DCDAD1, 0x8493CC54, 0x8551A663, 0x8717183A, 0x86D5720D,
+		0xA9E2D0A0, 0xA820BA97, 0xAA6604CE, 0xABA46EF9, 0xAEEB787C, 0xAF29124B, 0xAD6FAC12, 0xACADC625,
+		0xA7F18118, 0xA633EB2F, 0xA4755576, 0xA5B73F41, 0xA0F829C4, 0xA13A43F3, 0xA37CFDAA, 0xA2BE979D,
+		0xB5C473D0, 0xB40619E7, 0xB640A7BE, 0xB782CD89, 0xB2CDDB0C, 0xB30FB13B, 0xB1490F62, 0xB08B6555,
+		0xBBD72268, 0xBA15485F, 0xB853F606, 0xB9919C31, 0xBCDE8AB4, 0xBD1CE083, 0xBF5A5EDA, 0xBE9834ED
+	},
+	{
+		0x00000000, 0xB8BC6765, 0xAA09C88B, 0x12B5AFEE, 0x8F629757, 0x37DEF032, 0x256B5FDC, 0x9DD738B9,
+		0xC5B428EF, 0x7D084F8A, 0x6FBDE064, 0xD7018701, 0x4AD6BFB8, 0xF26AD8DD, 0xE0DF7733, 0x58631056,
+		0x5019579F, 0xE8A530FA, 0xFA109F14, 0x42ACF871, 0xDF7BC0C8, 0x67C7A7AD, 0x75720843, 0xCDCE6F26,
+		0x95AD7F70, 0x2D111815, 0x3FA4B7FB, 0x8718D09E, 0x1ACFE827, 0xA2738F42, 0xB0C620AC, 0x087A47C9,
+		0xA032AF3E, 0x188EC85B, 0x0A3B67B5, 0xB28700D0, 0x2F503869, 0x97EC5F0C, 0x8559F0E2, 0x3DE59787,
+		0x658687D1, 0xDD3AE0B4, 0xCF8F4F5A, 0x7733283F, 0xEAE41086, 0x525877E3, 0x40EDD80D, 0xF851BF68,
+		0xF02BF8A1, 0x48979FC4, 0x5A22302A, 0xE29E574F, 0x7F496FF6, 0xC7F50893, 0xD540A77D, 0x6DFCC018,
+		0x359FD04E, 0x8D23B72B, 0x9F9618C5, 0x272A7FA0, 0xBAFD4719, 0x0241207C, 0x10F48F92, 0xA848E8F7,
+		0x9B14583D, 0x23A83F58, 0x311D90B6, 0x89A1F7D3, 0x1476CF6A, 0xACCAA80F, 0xBE7F07E1, 0x06C36084,
+		0x5EA070D2, 0xE61C17B7, 0xF4A9B859, 0x4C15DF3C, 0xD1C2E785, 0x697E80E0, 0x7BCB2F0E, 0xC377486B,
+		0xCB0D0FA2, 0x73B168C7, 0x6104C729, 0xD9B8A04C, 0x446F98F5, 0xFCD3FF90, 0xEE66507E, 0x56DA371B,
+		0x0EB9274D, 0xB6054028, 0xA4B0EFC6, 0x1C0C88A3, 0x81DBB01A, 0x3967D77F, 0x2BD27891, 0x936E1FF4,
+		0x3B26F703, 0x839A9066, 0x912F3F88, 0x299358ED, 0xB4446054, 0x0CF80731, 0x1E4DA8DF, 0xA6F1CFBA,
+		0xFE92DFEC, 0x462EB889, 0x549B1767, 0xEC277002, 0x71F048BB, 0xC94C2FDE, 0xDBF98030, 0x6345E755,
+		0x6B3FA09C, 0xD383C7F9, 0xC1366817, 0x798A0F72, 0xE45D37CB, 0x5CE150AE, 0x4E54FF40, 0xF6E89825,
+		0xAE8B8873, 0x1637EF16, 0x048240F8, 0xBC3E279D, 0x21E91F24, 0x99557841, 0x8BE0D7AF, 0x335CB0CA,
+		0xED59B63B, 0x55E5D15E, 0x47507EB0, 0xFFEC19D5, 0x623B216C, 0xDA874609, 0xC832E9E7, 0x708E8E82,
+		0x28ED9ED4, 0x9051F9B1, 0x82E4565F, 0x3A58313A, 0xA78F0983, 0x1F336EE6, 0x0D86C108, 0xB53AA66D,
+		0xBD40E1A4, 0x05FC86C1, 0x1749292F, 0xAFF54E4A, 0x322276F3, 0x8A9E1196, 0x982BBE78, 0x2097D91D,
+		0x78F4C94B, 0xC048AE2E, 0xD2FD01C0, 0x6A4166A5, 0xF7965E1C, 0x4F2A3979, 0x5D9F9697, 0xE523F1F2,
+		0x4D6B1905, 0xF5D77E60, 0xE762D18E, 0x5FDEB6EB, 0xC2098E52, 0x7AB5E937, 0x680046D9, 0xD0BC21BC,
+		0x88DF31EA, 0x3063568F, 0x22D6F961, 0x9A6A9E04, 0x07BDA6BD, 0xBF01C1D8, 0xADB46E36, 0x15080953,
+		0x1D724E9A, 0xA5CE29FF, 0xB77B8611, 0x0FC7E174, 0x9210D9CD, 0x2AACBEA8, 0x38191146, 0x80A57623,
+		0xD8C66675, 0x607A0110, 0x72CFAEFE, 0xCA73C99B, 0x57A4F122, 0xEF189647, 0xFDAD39A9, 0x45115ECC,
+		0x764DEE06, 0xCEF18963, 0xDC44268D, 0x64F841E8, 0xF92F7951, 0x41931E34, 0x5326B1DA, 0xEB9AD6BF,
+		0xB3F9C6E9, 0x0B45A18C, 0x19F00E62, 0xA14C6907, 0x3C9B51BE, 0x842736DB, 0x96929935, 0x2E2EFE50,
+		0x2654B999, 0x9EE8DEFC, 0x8C5D7112, 0x34E11677, 0xA9362ECE, 0x118A49AB, 0x033FE645, 0xBB838120,
+		0xE3E09176, 0x5B5CF613, 0x49E959FD, 0xF1553E98, 0x6C820621, 0xD43E6144, 0xC68BCEAA, 0x7E37A9CF,
+		0xD67F4138, 0x6EC3265D, 0x7C7689B3, 0xC4CAEED6, 0x591DD66F, 0xE1A1B10A, 0xF3141EE4, 0x4BA87981,
+		0x13CB69D7, 0xAB770EB2, 0xB9C2A15C, 0x017EC639, 0x9CA9FE80, 0x241599E5, 0x36A0360B, 0x8E1C516E,
+		0x866616A7, 0x3EDA71C2, 0x2C6FDE2C, 0x94D3B949, 0x090481F0, 0xB1B8E695, 0xA30D497B, 0x1BB12E1E,
+		0x43D23E48, 0xFB6E592D, 0xE9DBF6C3, 0x516791A6, 0xCCB0A91F, 0x740CCE7A, 0x66B96194, 0xDE0506F1
+	},
+	{
+		0x00000000, 0x3D6029B0, 0x7AC05360, 0x47A07AD0, 0xF580A6C0, 0xC8E08F70, 0x8F40F5A0, 0xB220DC10,
+		0x30704BC1, 0x0D106271, 0x4AB018A1, 0x77D03111, 0xC5F0ED01, 0xF890C4B1, 0xBF30BE61, 0x825097D1,
+		0x60E09782, 0x5D80BE32, 0x1A20C4E2, 0x2740ED52, 0x95603142, 0xA80018F2, 0xEFA06222, 0xD2C04B92,
+		0x5090DC43, 0x6DF0F5F3, 0x2A508F23, 0x1730A693, 0xA5107A83, 0x98705333, 0xDFD029E3, 0xE2B00053,
+		0xC1C12F04, 0xFCA106B4, 0xBB017C64, 0x866155D4, 0x344189C4, 0x0921A074, 0x4E81DAA4, 0x73E1F314,
+		0xF1B164C5, 0xCCD14D75, 0x8B7137A5, 0xB6111E15, 0x0431C205, 0x3951EBB5, 0x7EF19165, 0x4391B8D5,
+		0xA121B886, 0x9C419136, 0xDBE1EBE6, 0xE681C256, 0x54A11E46, 0x69C137F6, 0x2E614D26, 0x13016496,
+		0x9151F347, 0xAC31DAF7, 0xEB91A027, 0xD6F18997, 0x64D15587, 0x59B17C37, 0x1E1106E7, 0x23712F57,
+		0x58F35849, 0x659371F9, 0x22330B29, 0x1F532299, 0xAD73FE89, 0x9013D739, 0xD7B3ADE9, 0xEAD38459,
+		0x68831388, 0x55E33A38, 0x124340E8, 0x2F236958, 0x9D03B548, 0xA0639CF8, 0xE7C3E628, 0xDAA3CF98,
+		0x3813CFCB, 0x0573E67B, 0x42D39CAB, 0x7FB3B51B, 0xCD93690B, 0xF0F340BB, 0xB7533A6B, 0x8A3313DB,
+		0x0863840A, 0x3503ADBA, 0x72A3D76A, 0x4FC3FEDA, 0xFDE322CA, 0xC0830B7A, 0x872371AA, 0xBA43581A,
+		0x9932774D, 0xA4525EFD, 0xE3F2242D, 0xDE920D9D, 0x6CB2D18D, 0x51D2F83D, 0x167282ED, 0x2B12AB5D,
+		0xA9423C8C, 0x9422153C, 0xD3826FEC, 0xEEE2465C, 0x5CC29A4C, 0x61A2B3FC, 0x2602C92C, 0x1B62E09C,
+		0xF9D2E0CF, 0xC4B2C97F, 0x8312B3AF, 0xBE729A1F, 0x0C52460F, 0x31326FBF, 0x7692156F, 0x4BF23CDF,
+		0xC9A2AB0E, 0xF4C282BE, 0xB362F86E, 0x8E02D1DE, 0x3C220DCE, 0x0142247E, 0x46E25EAE, 0x7B82771E,
+		0xB1E6B092, 0x8C869922, 0xCB26E3F2, 0xF646CA42, 0x44661652, 0x79063FE2, 0x3EA64532, 0x03C66C82,
+		0x8196FB53, 0xBCF6D2E3, 0xFB56A833, 0xC6368183, 0x74165D93, 0x49767423, 0x0ED60EF3, 0x33B62743,
+		0xD1062710, 0xEC660EA0, 0xABC67470, 0x96A65DC0, 0x248681D0, 0x19E6A860, 0x5E46D2B0, 0x6326FB00,
+		0xE1766CD1, 0xDC164561, 0x9BB63FB1, 0xA6D61601, 0x14F6CA11, 0x2996E3A1, 0x6E369971, 0x5356B0C1,
+		0x70279F96, 0x4D47B626, 0x0AE7CCF6, 0x3787E546, 0x85A73956, 0xB8C710E6, 0xFF676A36, 0xC2074386,
+		0x4057D457, 0x7D37FDE7, 0x3A978737, 0x07F7AE87, 0xB5D77297, 0x88B75B27, 0xCF1721F7, 0xF2770847,
+		0x10C70814, 0x2DA721A4, 0x6A075B74, 0x576772C4, 0xE547AED4, 0xD8278764, 0x9F87FDB4, 0xA2E7D404,
+		0x20B743D5, 0x1DD76A65, 0x5A7710B5, 0x67173905, 0xD537E515, 0xE857CCA5, 0xAFF7B675, 0x92979FC5,
+		0xE915E8DB, 0xD475C16B, 0x93D5BBBB, 0xAEB5920B, 0x1C954E1B, 0x21F567AB, 0x66551D7B, 0x5B3534CB,
+		0xD965A31A, 0xE4058AAA, 0xA3A5F07A, 0x9EC5D9CA, 0x2CE505DA, 0x11852C6A, 0x562556BA, 0x6B457F0A,
+		0x89F57F59, 0xB49556E9, 0xF3352C39, 0xCE550589, 0x7C75D999, 0x4115F029, 0x06B58AF9, 0x3BD5A349,
+		0xB9853498, 0x84E51D28, 0xC34567F8, 0xFE254E48, 0x4C059258, 0x7165BBE8, 0x36C5C138, 0x0BA5E888,
+		0x28D4C7DF, 0x15B4EE6F, 0x521494BF, 0x6F74BD0F, 0xDD54611F, 0xE03448AF, 0xA794327F, 0x9AF41BCF,
+		0x18A48C1E, 0x25C4A5AE, 0x6264DF7E, 0x5F04F6CE, 0xED242ADE, 0xD044036E, 0x97E479BE, 0xAA84500E,
+		0x4834505D, 0x755479ED, 0x32F4033D, 0x0F942A8D, 0xBDB4F69D, 0x80D4DF2D, 0xC774A5FD, 0xFA148C4D,
+		0x78441B9C, 0x4524322C, 0x028448FC, 0x3FE4614C, 0x8DC4BD5C, 0xB0A494EC, 0xF704EE3C, 0xCA64C78C
+	},
+	{
+		0x00000000, 0xCB5CD3A5, 0x4DC8A10B, 0x869472AE, 0x9B914216, 0x50CD91B3, 0xD659E31D, 0x1D0530B8,
+		0xEC53826D, 0x270F51C8, 0xA19B2366, 0x6AC7F0C3, 0x77C2C07B, 0xBC9E13DE, 0x3A0A6170, 0xF156B2D5,
+		0x03D6029B, 0xC88AD13E, 0x4E1EA390, 0x85427035, 0x9847408D, 0x531B9328, 0xD58FE186, 0x1ED33223,
+		0xEF8580F6, 0x24D95353, 0xA24D21FD, 0x6911F258, 0x7414C2E0, 0xBF481145, 0x39DC63EB, 0xF280B04E,
+		0x07AC0536, 0xCCF0D693, 0x4A64A43D, 0x81387798, 0x9C3D4720, 0x57619485, 0xD1F5E62B, 0x1AA9358E,
+		0xEBFF875B, 0x20A354FE, 0xA6372650, 0x6D6BF5F5, 0x706EC54D, 0xBB3216E8, 0x3DA66446, 0xF6FAB7E3,
+		0x047A07AD, 0xCF26D408, 0x49B2A6A6, 0x82EE7503, 0x9FEB45BB, 0x54B7961E, 0xD223E4B0, 0x197F3715,
+		0xE82985C0, 0x23755665, 0xA5E124CB, 0x6EBDF76E, 0x73B8C7D6, 0xB8E41473, 0x3E7066DD, 0xF52CB578,
+		0x0F580A6C, 0xC404D9C9, 0x4290AB67, 0x89CC78C2, 0x94C9487A, 0x5F959BDF, 0xD901E971, 0x125D3AD4,
+		0xE30B8801, 0x28575BA4, 0xAEC3290A, 0x659FFAAF, 0x789ACA17, 0xB3C619B2, 0x35526B1C, 0xFE0EB8B9,
+		0x0C8E08F7, 0xC7D2DB52, 0x4146A9FC, 0x8A1A7A59, 0x971F4AE1, 0x5C439944, 0xDAD7EBEA, 0x118B384F,
+		0xE0DD8A9A, 0x2B81593F, 0xAD152B91, 0x6649F834, 0x7B4CC88C, 0xB0101B29, 0x36846987, 0xFDD8BA22,
+		0x08F40F5A, 0xC3A8DCFF, 0x453CAE51, 0x8E607DF4, 0x93654D4C, 0x58399EE9, 0xDEADEC47, 0x15F13FE2,
+		0xE4A78D37, 0x2FFB5E92, 0xA96F2C3C, 0x6233FF99, 0x7F36CF21, 0xB46A1C84, 0x32FE6E2A, 0xF9A2BD8F,
+		0x0B220DC1, 0xC07EDE64, 0x46EAACCA, 0x8DB67F6F, 0x90B34FD7, 0x5BEF9C72, 0xDD7BEEDC, 0x16273D79,
+		0xE7718FAC, 0x2C2D5C09, 0xAAB92EA7, 0x61E5FD02, 0x7CE0CDBA, 0xB7BC1E1F, 0x31286CB1, 0xFA74BF14,
+		0x1EB014D8, 0xD5ECC77D, 0x5378B5D3, 0x98246676, 0x852156CE, 0x4E7D856B, 0xC8E9F7C5, 0x03B52460,
+		0xF2E396B5, 0x39BF4510, 0xBF2B37BE, 0x7477E41B, 0x6972D4A3, 0xA22E0706, 0x24BA75A8, 0xEFE6A60D,
+		0x1D661643, 0xD63AC5E6, 0x50AEB748, 0x9BF264ED, 0x86F75455, 0x4DAB87F0, 0xCB3FF55E, 0x006326FB,
+		0xF135942E, 0x3A69478B, 0xBCFD3525, 0x77A1E680, 0x6AA4D638, 0xA1F8059D, 0x276C7733, 0xEC30A496,
+		0x191C11EE, 0xD240C24B, 0x54D4B0E5, 0x9F886340, 0x828D53F8, 0x49D1805D, 0xCF45F2F3, 0x04192156,
+		0xF54F9383, 0x3E134026, 0xB8873288, 0x73DBE12D, 0x6EDED195, 0xA5820230, 0x2316709E, 0xE84AA33B,
+		0x1ACA1375, 0xD196C0D0, 0x5702B27E, 0x9C5E61DB, 0x815B5163, 0x4A0782C6, 0xCC93F068, 0x07CF23CD,
+		0xF6999118, 0x3DC542BD, 0xBB513013, 0x700DE3B6, 0x6D08D30E, 0xA65400AB, 0x20C07205, 0xEB9CA1A0,
+		0x11E81EB4, 0xDAB4CD11, 0x5C20BFBF, 0x977C6C1A, 0x8A795CA2, 0x41258F07, 0xC7B1FDA9, 0x0CED2E0C,
+		0xFDBB9CD9, 0x36E74F7C, 0xB0733DD2, 0x7B2FEE77, 0x662ADECF, 0xAD760D6A, 0x2BE27FC4, 0xE0BEAC61,
+		0x123E1C2F, 0xD962CF8A, 0x5FF6BD24, 0x94AA6E81, 0x89AF5E39, 0x42F38D9C, 0xC467FF32, 0x0F3B2C97,
+		0xFE6D9E42, 0x35314DE7, 0xB3A53F49, 0x78F9ECEC, 0x65FCDC54, 0xAEA00FF1, 0x28347D5F, 0xE368AEFA,
+		0x16441B82, 0xDD18C827, 0x5B8CBA89, 0x90D0692C, 0x8DD55994, 0x46898A31, 0xC01DF89F, 0x0B412B3A,
+		0xFA1799EF, 0x314B4A4A, 0xB7DF38E4, 0x7C83EB41, 0x6186DBF9, 0xAADA085C, 0x2C4E7AF2, 0xE712A957,
+		0x15921919, 0xDECECABC, 0x585AB812, 0x93066BB7, 0x8E035B0F, 0x455F88AA, 0xC3CBFA04, 0x089729A1,
+		0xF9C19B74, 0x329D48D1, 0xB4093A7F, 0x7F55E9DA, 0x6250D962, 0xA90C0AC7, 0x2F987869, 0xE4C4ABCC
+	},
+	{
+		0x00000000, 0xA6770BB4, 0x979F1129, 0x31E81A9D, 0xF44F2413, 0x52382FA7, 0x63D0353A, 0xC5A73E8E,
+		0x33EF4E67, 0x959845D3, 0xA4705F4E, 0x020754FA, 0xC7A06A74, 0x61D761C0, 0x503F7B5D, 0xF64870E9,
+		0x67DE9CCE, 0xC1A9977A, 0xF0418DE7, 0x56368653, 0x9391B8DD, 0x35E6B369, 0x040EA9F4, 0xA279A240,
+		0x5431D2A9, 0xF246D91D, 0xC3AEC380, 0x65D9C834, 0xA07EF6BA, 0x0609FD0E, 0x37E1E793, 0x9196EC27,
+		0xCFBD399C, 0x69CA3228, 0x582228B5, 0xFE552301, 0x3BF21D8F, 0x9D85163B, 0xAC6D0CA6, 0x0A1A0712,
+		0xFC5277FB, 0x5A257C4F, 0x6BCD66D2, 0xCDBA6D66, 0x081D53E8, 0xAE6A585C, 0x9F8242C1, 0x39F54975,
+		0xA863A552, 0x0E14AEE6, 0x3FFCB47B, 0x998BBFCF, 0x5C2C8141, 0xFA5B8AF5, 0xCBB39068, 0x6DC49BDC,
+		0x9B8CEB35, 0x3DFBE081, 0x0C13FA1C, 0xAA64F1A8, 0x6FC3CF26, 0xC9B4C492, 0xF85CDE0F, 0x5E2BD5BB,
+		0x440B7579, 0xE27C7ECD, 0xD3946450, 0x75E36FE4, 0xB044516A, 0x16335ADE, 0x27DB4043, 0x81AC4BF7,
+		0x77E43B1E, 0xD19330AA, 0xE07B2A37, 0x460C2183, 0x83AB1F0D, 0x25DC14B9, 0x14340E24, 0xB2430590,
+		0x23D5E9B7, 0x85A2E203, 0xB44AF89E, 0x123DF32A, 0xD79ACDA4, 0x71EDC610, 0x4005DC8D, 0xE672D739,
+		0x103AA7D0, 0xB64DAC64, 0x87A5B6F9, 0x21D2BD4D, 0xE47583C3, 0x42028877, 0x73EA92EA, 0xD59D995E,
+		0x8BB64CE5, 0x2DC14751, 0x1C295DCC, 0xBA5E5678, 0x7FF968F6, 0xD98E6342, 0xE86679DF, 0x4E11726B,
+		0xB8590282, 0x1E2E0936, 0x2FC613AB, 0x89B1181F, 0x4C162691, 0xEA612D25, 0xDB8937B8, 0x7DFE3C0C,
+		0xEC68D02B, 0x4A1FDB9F, 0x7BF7C102, 0xDD80CAB6, 0x1827F438, 0xBE50FF8C, 0x8FB8E511, 0x29CFEEA5,
+		0xDF879E4C, 0x79F095F8, 0x48188F65, 0xEE6F84D1, 0x2BC8BA5F, 0x8DBFB1EB, 0xBC57AB76, 0x1A20A0C2,
+		0x8816EAF2, 0x2E61E146, 0x1F89FBDB, 0xB9FEF06F, 0x7C59CEE1, 0xDA2EC555, 0xEBC6DFC8, 0x4DB1D47C,
+		0xBBF9A495, 0x1D8EAF21, 0x2C66B5BC, 0x8A11BE08, 0x4FB68086, 0xE9C18B32, 0xD82991AF, 0x7E5E9A1B,
+		0xEFC8763C, 0x49BF7D88, 0x78576715, 0xDE206CA1, 0x1B87522F, 0xBDF0599B, 0x8C184306, 0x2A6F48B2,
+		0xDC27385B, 0x7A5033EF, 0x4BB82972, 0xEDCF22C6, 0x28681C48, 0x8E1F17FC, 0xBFF70D61, 0x198006D5,
+		0x47ABD36E, 0xE1DCD8DA, 0xD034C247, 0x7643C9F3, 0xB3E4F77D, 0x1593FCC9, 0x247BE654, 0x820CEDE0,
+		0x74449D09, 0xD23396BD, 0xE3DB8C20, 0x45AC8794, 0x800BB91A, 0x267CB2AE, 0x1794A833, 0xB1E3A387,
+		0x20754FA0, 0x86024414, 0xB7EA5E89, 0x119D553D, 0xD43A6BB3, 0x724D6007, 0x43A57A9A, 0xE5D2712E,
+		0x139A01C7, 0xB5ED0A73, 0x840510EE, 0x22721B5A, 0xE7D525D4, 0x41A22E60, 0x704A34FD, 0xD63D3F49,
+		0xCC1D9F8B, 0x6A6A943F, 0x5B828EA2, 0xFDF58516, 0x3852BB98, 0x9E25B02C, 0xAFCDAAB1, 0x09BAA105,
+		0xFFF2D1EC, 0x5985DA58, 0x686DC0C5, 0xCE1ACB71, 0x0BBDF5FF, 0xADCAFE4B, 0x9C22E4D6, 0x3A55EF62,
+		0xABC30345, 0x0DB408F1, 0x3C5C126C, 0x9A2B19D8, 0x5F8C2756, 0xF9FB2CE2, 0xC813367F, 0x6E643DCB,
+		0x982C4D22, 0x3E5B4696, 0x0FB35C0B, 0xA9C457BF, 0x6C636931, 0xCA146285, 0xFBFC7818, 0x5D8B73AC,
+		0x03A0A617, 0xA5D7ADA3, 0x943FB73E, 0x3248BC8A, 0xF7EF8204, 0x519889B0, 0x6070932D, 0xC6079899,
+		0x304FE870, 0x9638E3C4, 0xA7D0F959, 0x01A7F2ED, 0xC400CC63, 0x6277C7D7, 0x539FDD4A, 0xF5E8D6FE,
+		0x647E3AD9, 0xC209316D, 0xF3E12BF0, 0x55962044, 0x90311ECA, 0x3646157E, 0x07AE0FE3, 0xA1D90457,
+		0x579174BE, 0xF1E67F0A, 0xC00E6597, 0x66796E23, 0xA3DE50AD, 0x05A95B19, 0x34414184, 0x92364A30
+	},
+	{
+		0x00000000, 0xCCAA009E, 0x4225077D, 0x8E8F07E3, 0x844A0EFA, 0x48E00E64, 0xC66F0987, 0x0AC50919,
+		0xD3E51BB5, 0x1F4F1B2B, 0x91C01CC8, 0x5D6A1C56, 0x57AF154F, 0x9B0515D1, 0x158A1232, 0xD92012AC,
+		0x7CBB312B, 0xB01131B5, 0x3E9E3656, 0xF23436C8, 0xF8F13FD1, 0x345B3F4F, 0xBAD438AC, 0x767E3832,
+		0xAF5E2A9E, 0x63F42A00, 0xED7B2DE3, 0x21D12D7D, 0x2B142464, 0xE7BE24FA, 0x69312319, 0xA59B2387,
+		0xF9766256, 0x35DC62C8, 0xBB53652B, 0x77F965B5, 0x7D3C6CAC, 0xB1966C32, 0x3F196BD1, 0xF3B36B4F,
+		0x2A9379E3, 0xE639797D, 0x68B67E9E, 0xA41C7E00, 0xAED97719, 0x62737787, 0xECFC7064, 0x205670FA,
+		0x85CD537D, 0x496753E3, 0xC7E85400, 0x0B42549E, 0x01875D87, 0xCD2D5D19, 0x43A25AFA, 0x8F085A64,
+		0x562848C8, 0x9A824856, 0x140D4FB5, 0xD8A74F2B, 0xD2624632, 0x1EC846AC, 0x9047414F, 0x5CED41D1,
+		0x299DC2ED, 0xE537C273, 0x6BB8C590, 0xA712C50E, 0xADD7CC17, 0x617DCC89, 0xEFF2CB6A, 0x2358CBF4,
+		0xFA78D958, 0x36D2D9C6, 0xB85DDE25, 0x74F7DEBB, 0x7E32D7A2, 0xB298D73C, 0x3C17D0DF, 0xF0BDD041,
+		0x5526F3C6, 0x998CF358, 0x1703F4BB, 0xDBA9F425, 0xD16CFD3C, 0x1DC6FDA2, 0x9349FA41, 0x5FE3FADF,
+		0x86C3E873, 0x4A69E8ED, 0xC4E6EF0E, 0x084CEF90, 0x0289E689, 0xCE23E617, 0x40ACE1F4, 0x8C06E16A,
+		0xD0EBA0BB, 0x1C41A025, 0x92CEA7C6, 0x5E64A758, 0x54A1AE41, 0x980BAEDF, 0x1684A93C, 0xDA2EA9A2,
+		0x030EBB0E, 0xCFA4BB90, 0x412BBC73, 0x8D81BCED, 0x8744B5F4, 0x4BEEB56A, 0xC561B289, 0x09CBB217,
+		0xAC509190, 0x60FA910E, 0xEE7596ED, 0x22DF9673, 0x281A9F6A, 0xE4B09FF4, 0x6A3F9817, 0xA6959889,
+		0x7FB58A25, 0xB31F8ABB, 0x3D908D58, 0xF13A8DC6, 0xFBFF84DF, 0x37558441, 0xB9DA83A2, 0x7570833C,
+		0x533B85DA, 0x9F918544, 0x111E82A7, 0xDDB48239, 0xD7718B20, 0x1BDB8BBE, 0x95548C5D, 0x59FE8CC3,
+		0x80DE9E6F, 0x4C749EF1, 0xC2FB9912, 0x0E51998C, 0x04949095, 0xC83E900B, 0x46B197E8, 0x8A1B9776,
+		0x2F80B4F1, 0xE32AB46F, 0x6DA5B38C, 0xA10FB312, 0xABCABA0B, 0x6760BA95, 0xE9EFBD76, 0x2545BDE8,
+		0xFC65AF44, 0x30CFAFDA, 0xBE40A839, 0x72EAA8A7, 0x782FA1BE, 0xB485A120, 0x3A0AA6C3, 0xF6A0A65D,
+		0xAA4DE78C, 0x66E7E712, 0xE868E0F1, 0x24C2E06F, 0x2E07E976, 0xE2ADE9E8, 0x6C22EE0B, 0xA088EE95,
+		0x79A8FC39, 0xB502FCA7, 0x3B8DFB44, 0xF727FBDA, 0xFDE2F2C3, 0x3148F25D, 0xBFC7F5BE, 0x736DF520,
+		0xD6F6D6A7, 0x1A5CD639, 0x94D3D1DA, 0x5879D144, 0x52BCD85D, 0x9E16D8C3, 0x1099DF20, 0xDC33DFBE,
+		0x0513CD12, 0xC9B9CD8C, 0x4736CA6F, 0x8B9CCAF1, 0x8159C3E8, 0x4DF3C376, 0xC37CC495, 0x0FD6C40B,
+		0x7AA64737, 0xB60C47A9, 0x3883404A, 0xF42940D4, 0xFEEC49CD, 0x32464953, 0xBCC94EB0, 0x70634E2E,
+		0xA9435C82, 0x65E95C1C, 0xEB665BFF, 0x27CC5B61, 0x2D095278, 0xE1A352E6, 0x6F2C5505, 0xA386559B,
+		0x061D761C, 0xCAB77682, 0x44387161, 0x889271FF, 0x825778E6, 0x4EFD7878, 0xC0727F9B, 0x0CD87F05,
+		0xD5F86DA9, 0x19526D37, 0x97DD6AD4, 0x5B776A4A, 0x51B26353, 0x9D1863CD, 0x1397642E, 0xDF3D64B0,
+		0x83D02561, 0x4F7A25FF, 0xC1F5221C, 0x0D5F2282, 0x079A2B9B, 0xCB302B05, 0x45BF2CE6, 0x89152C78,
+		0x50353ED4, 0x9C9F3E4A, 0x121039A9, 0xDEBA3937, 0xD47F302E, 0x18D530B0, 0x965A3753, 0x5AF037CD,
+		0xFF6B144A, 0x33C114D4, 0xBD4E1337, 0x71E413A9, 0x7B211AB0, 0xB78B1A2E, 0x39041DCD, 0xF5AE1D53,
+		0x2C8E0FFF, 0xE0240F61, 0x6EAB0882, 0xA201081C, 0xA8C40105, 0x646E019B, 0xEAE10678, 0x264B06E6
+	} };
+#endif
 
 
 /*******************************************************************/
-/******************************Variables******************************/
+/**************************Instance Structure************************/
 /*******************************************************************/
+//All decoding state is kept in the instance buffer given by the caller,
+//so that several images can be decoded at the same time (one instance per image).
+#define		PD_INSTANCE_MAGIC		0x504E4744	//"PNGD"
+
+struct _PD_INSTANCE {
+	uint32			PD_Magic;				//PD_INSTANCE_MAGIC while the instance is valid
 
 #if defined(PNGDEC_CHECK_CHUNK)
-volatile int32	PD_nPngDecCheck_Chunk;
+	int32			PD_nPngDecCheck_Chunk;
 #endif
 
 #if defined(PNGDEC_STABILITY_ERROR_HANDLE)
-static int32	PD_nPngDecErrorCode;
+	int32			PD_nPngDecErrorCode;
 #endif
 
-// Variables for PC Version
-static uint32		PCD_Global_Pix_Pos;
-
-//IO_Related
-static uint32		PD_2nd_Strm;
-static int16		PD_Valid_Bit; //c
-static int16		PD_Cur_Buf;
-static PD_CALLBACKS	PD_callbacks;
-static void *		PD_Datasource;
-static BYTE *		PD_FileBuf_Ptr;
-static int32		PD_Read_Point;
-
+	// Variables for PC Version
+	uint32			PCD_Global_Pix_Pos;
+
+	//IO_Related
+	PD_BITBUF		PD_2nd_Strm;
+	int16			PD_Valid_Bit; //c
+	int16			PD_Cur_Buf;
+	PD_CALLBACKS	PD_callbacks;
+	void *			PD_Datasource;
+	BYTE *			PD_FileBuf_Ptr;
+	const BYTE *	PD_Src_Buf;				//PD_INIT_OPT_MEMORY_INPUT : caller's buffer, NULL otherwise
+	uint32			PD_Push_Size;			//PD_INIT_OPT_PUSH_INPUT : bytes of PD_Src_Buf filled so far (TCCXXX_PNG_Dec_Push)
+	int32			PD_Push_Limit;			//Most bytes the next block decoding may put into the ring queue (push input, time slices)
+	uint8			PD_Push_On;				//PD_INIT_OPT_PUSH_INPUT
+	int32			PD_Read_Point_End;		//End of the current input buffer (PD_INPUTBUF_SIZE, the memory input size or PD_Push_Size)
+	int32			PD_Read_Point;
+
+	uint32			PD_TotFileSize;
 #if defined(PNGDEC_CHECK_EOF_2)
-static uint32		PD_TotFileSize;
-static uint32		PD_ReadFileBytes;
-static uint32		PD_Read_Point_Max;
+	uint32			PD_ReadFileBytes;
+	uint32			PD_Read_Point_Max;
+#endif
+#if defined(PNGDEC_OPT_CHUNK_SEEK)
+	PD_CHUNK_INFO	PD_Chunk_Index[PD_CHUNK_INDEX_NUM];	//Chunks met so far, in stream order
+	int32			PD_Chunk_Num;			//Used entries of PD_Chunk_Index
 #endif
 
 #if defined(PNGDEC_OPTI_INSTANCE_MEM)
-static BYTE *		PD_File_Buf;		//[PD_INPUTBUF_SIZE2]; //4096 bytes
+	BYTE *			PD_File_Buf;		//[PD_INPUTBUF_SIZE2]; //4096 bytes
 #else
-static BYTE		PD_File_Buf[PD_INPUTBUF_SIZE2];
+	BYTE			PD_File_Buf[PD_INPUTBUF_SIZE2];
 #endif
 
-//Output_Related
-static PD_CUSTOM_DECODE	PD_Out_Struct;			//Structure for Output Image Formatting
-static uint32		PD_LCD_Width;
-static uint32		PD_LCD_Height;
-static uint16 *		PD_Pixel_Map_Hor;
-static uint16 *		PD_Pixel_Map_Ver;
-static uint16		PD_Top_Offset;				//Distance from the top of LCD
-static uint16		PD_Left_Offset;				//Distance from the left of LCD
-static uint16		PD_Resized_Width;			//Image Width resized according to LCD
-static uint16		PD_Resized_Height;			//Image Height resized according to LCD
-static uint8		PD_Image_Smaller_LCD;		//Image is smaller than LCD when this is set
-static uint8		PD_Alpha_Available;			//If this field is set, Use of alpha data is allowed.
-static uint8		PD_Alpha_Use;				//If this field is set, output alpha data.
-
-//ADAM7 Interlaced Mode Related
-static uint8		PD_Current_Pass;
-static uint16		PD_ADAM7_Width;				//Image Width of Each Resized Pass
-static uint16		PD_ADAM7_Height;			//Image Height of Each Resized Pass
-static uint16		PD_Remaining_Row;			//Image Row to be decoded
-static uint16		PD_Remaining_Row_ADAM7;		//Image Row to be decoded by interlaced mode
+#if defined(PNGDEC_STABILITY_CHECK_CRC)
+	Crc32_Func_Ptr	PD_Crc32;				//CRC-32 kernel selected for this CPU
+	uint32			PD_Crc;					//CRC-32 register of the current chunk
+	int32			PD_Crc_Point;			//Bytes of the input buffer before this point are already in PD_Crc
+	uint8			PD_Crc_Mode;			//PD_CRC_OFF, PD_CRC_DEFER or PD_CRC_ON
+	uint8			PD_Crc_Active;			//Reading the type or data of a chunk
+	uint8			PD_Crc_Error;			//A chunk read by TCCXXX_PNGDEC_Init has a wrong CRC
+#endif
 
-//Header Parsing Related
-static uint32		PD_Chunk_Size;
-static uint32		PD_Used_Byte;
-
-//Image Information
-static uint32		PD_Global_Width;			//Image Width
-static uint32		PD_Global_Height;			//Image Height
-static uint8		PD_Bit_Depth;
-static uint8		PD_Compo_Num;
-static uint8		PD_Color_Type;
-static uint8		PD_Compression_Method;
-static uint16		PD_Filter_Method;		//c
-static uint8		PD_Interlace_Method;
-static uint8		PD_Bpp;						//The number of bits for one pixel
-
-//Pallete Related
+	//Output_Related
+	PD_CUSTOM_DECODE	PD_Out_Struct;			//Structure for Output Image Formatting
+	uint32			PD_LCD_Width;
+	uint32			PD_LCD_Height;
+	uint16 *		PD_Pixel_Map_Hor;
+	uint16 *		PD_Pixel_Map_Ver;
+	uint16			PD_Top_Offset;				//Distance from the top of LCD
+	uint16			PD_Left_Offset;				//Distance from the left of LCD
+	uint16			PD_Resized_Width;			//Image Width resized according to LCD
+	uint16			PD_Resized_Height;			//Image Height resized according to LCD
+	uint8			PD_Image_Smaller_LCD;		//Image is smaller than LCD when this is set
+	uint8			PD_Alpha_Available;			//If this field is set, Use of alpha data is allowed.
+	uint8			PD_Alpha_Use;				//If this field is set, output alpha data.
+
+	//ADAM7 Interlaced Mode Related
+	uint8			PD_Current_Pass;
+	uint16			PD_ADAM7_Width;				//Image Width of Each Resized Pass
+	uint16			PD_ADAM7_Height;			//Image Height of Each Resized Pass
+	uint16			PD_Remaining_Row;			//Image Row to be decoded
+	uint16			PD_Remaining_Row_ADAM7;		//Image Row to be decoded by interlaced mode
+
+	//Header Parsing Related
+	uint32			PD_Chunk_Size;
+	uint32			PD_Used_Byte;
+
+	//Image Information
+	uint32			PD_Global_Width;			//Image Width
+	uint32			PD_Global_Height;			//Image Height
+	uint8			PD_Bit_Depth;
+	uint8			PD_Compo_Num;
+	uint8			PD_Color_Type;
+	uint8			PD_Compression_Method;
+	uint16			PD_Filter_Method;		//c
+	uint8			PD_Interlace_Method;
+	uint8			PD_Bpp;						//The number of bits for one pixel
+
+	//Pallete Related
 #if defined(PNGDEC_OPTI_INSTANCE_MEM)
-static PD_PLTE_TABLE *	PD_Plte;
+	PD_PLTE_TABLE *	PD_Plte;
 #else
-static PD_PLTE_TABLE	PD_Plte[PD_PLTE_TABLE_IDX];			//1024 bytes
+	PD_PLTE_TABLE	PD_Plte[PD_PLTE_TABLE_IDX];			//1024 bytes
+#endif
+	uint32			PD_Plte_Entry_Num;
+#if defined(PNGDEC_OPT_PLTE_LUT)
+	uint32			PD_Plte_Row[PD_PLTE_TABLE_IDX];	//Palette as PD_Row_Buf pixels (R, G, B, alpha or 0 in memory order)
+	uint32			PD_Plte_Dst[PD_PLTE_TABLE_IDX];	//Palette as PD_PIXFMT_ARGB8888 / RGB565 / L8 / LA88 pixels (PD_Plte_Direct)
+	Plte_Func_Ptr	PD_Plte_Expand;				//Palette expansion kernel selected for this CPU
+	uint8			PD_Plte_On;					//Rows are expanded from the tables (colour type 3, 1/2/4-bit grey)
+	uint8			PD_Plte_Direct;				//and written into the surface from PD_Plte_Dst
 #endif
-static uint32		PD_Plte_Entry_Num;
 
-//Decoding Related
-static Decode_Func_Ptr	PNG_Decode_Image;		//Function Pointer for Variation of Bit depth
-static uint16		PD_Len2Copy;				//To continue copy after image decoding
-static uint16		PD_Dist2Copy;				//Ditto
-static uint8		PD_Still_Decoding;			//Ditto
-static uint8		PD_Last_IDAT;				//Indicates that there is no more IDAT Chunk
-static uint8		PD_Cur_Job;					//Save Next Procedure among Decoding Routine
-static uint8		PD_Prev_Job;				//Save previous Procedure among Decoding Routine
-static uint16		PD_Window_Size;				//The size of window used for refering (MAX == 32KB)
-static uint8		PD_ZLIB_Flevel;				//Degree of Compression in ZLIB structure
-static uint8		PD_Last_Block;				//Indicates whether current block is the last block or not
-static uint32		PD_Ptr_Block_Dec;			//Filled Bytes in Deflate buffer by BLOCK decoding
-static uint32		PD_Ptr_Image_Dec;			//Used bytes in Deflate Buffer for Image decoding 
+	//Decoding Related
+	Decode_Func_Ptr	PNG_Decode_Image;		//Function Pointer for Variation of Bit depth
+	uint16			PD_Len2Copy;				//To continue copy after image decoding
+	uint16			PD_Dist2Copy;				//Ditto
+	uint8			PD_Still_Decoding;			//Ditto
+	uint8			PD_Liter2Push_Num;			//Literals of a packed entry left when the queue filled up
+	uint32			PD_Liter2Push;				//Ditto (first one in the lowest byte)
+	uint8			PD_Last_IDAT;				//Indicates that there is no more IDAT Chunk
+	uint8			PD_Cur_Job;					//Save Next Procedure among Decoding Routine
+	uint8			PD_Prev_Job;				//Save previous Procedure among Decoding Routine
+	uint16			PD_Window_Size;				//The size of window used for refering (MAX == 32KB)
+	uint8			PD_ZLIB_Flevel;				//Degree of Compression in ZLIB structure
+	uint8			PD_Last_Block;				//Indicates whether current block is the last block or not
+	uint32			PD_Ptr_Block_Dec;			//Filled Bytes in Deflate buffer by BLOCK decoding
+#if defined(PNGDEC_STABILITY_CHECK_ADLER)
+	Adler32_Func_Ptr	PD_Adler32;				//Adler-32 kernel selected for this CPU
+	uint32			PD_Adler;					//Adler-32 of the decompressed bytes up to PD_Adler_Ptr
+	uint32			PD_Adler_Ptr;				//Filled bytes already added to PD_Adler
+	uint8			PD_Adler_On;				//ERROR_DET_MODE asks for the Adler-32 check
+#endif
+	uint32			PD_Ptr_Image_Dec;			//Used bytes in Deflate Buffer for Image decoding 
 #if defined(PNGDEC_OPTI_INSTANCE_MEM)
-static uint8 *		PD_Deflate_Buf;	//32KB Deflate Buffer for Literal Refering
+	uint8 *			PD_Deflate_Buf;	//32KB Deflate Buffer for Literal Refering
 #else
-static uint8		PD_Deflate_Buf[PD_DEFLATE_BUF_LEN];	//32KB Deflate Buffer for Literal Refering
+	uint8			PD_Deflate_Buf[PD_DEFLATE_BUF_LEN];	//32KB Deflate Buffer for Literal Refering
+#endif
+	uint8 *			PD_Up_Scanline;				//Upper Scanline for Filtering
+	uint8 *			PD_Diag_Scanline;			//Diagonal Scanline for Filtering
+	uint8 *			PD_Row_Buf;					//Converted pixels of one output row (PD_OUTPUT_ROW)
+	uint32			PD_Crop_Left;				//Output columns [PD_Crop_Left, PD_Crop_Right) are in the crop rectangle
+	uint32			PD_Crop_Right;
+	uint32			PD_Crop_Top;				//Output rows [PD_Crop_Top, PD_Crop_Bottom) are in the crop rectangle
+	uint32			PD_Crop_Bottom;
+	uint16			PD_Scanline_Size;			//The number of bytes for one Scanline
+	uint16			PD_Global_Scanline_Size;		//The number of bytes for one Scanline
+	uint16			PD_Deflate_Type;//c			//0 : copy, 1 : Fixed huffman, 2 : Dynamic Huffman
+	uint16			PD_Scaler;					//Bit Depth Scaling
+	const uint16 * 	PD_Data_Mask;				//Mask for bpp
+	const uint16 * 	PD_Data_Shift;				//Mask for bpp
+#if defined(PNGDEC_OPT_DEFILTER_SIMD)
+	const Defilter_Func_Ptr * PD_Defilter;		//Defiltering kernels selected for this CPU
 #endif
-static uint8 *		PD_Up_Scanline;				//Upper Scanline for Filtering
-static uint8 *		PD_Diag_Scanline;			//Diagonal Scanline for Filtering
-static uint16		PD_Scanline_Size;			//The number of bytes for one Scanline
-static uint16		PD_Global_Scanline_Size;		//The number of bytes for one Scanline
-static uint16		PD_Deflate_Type;//c			//0 : copy, 1 : Fixed huffman, 2 : Dynamic Huffman
-static uint16		PD_Scaler;					//Bit Depth Scaling
-static uint16 * 	PD_Data_Mask;				//Mask for bpp
-static uint16 * 	PD_Data_Shift;				//Mask for bpp
-
-//Huffman Table Related
+#if defined(PNGDEC_OPT_RESIZE_AREA)
+	Area_Func_Ptr	PD_Area_Row;				//Area reduction kernel selected for this CPU
+	uint32 *		PD_Area_Acc;				//Sums of the 8.8 box averages over the source rows of the current output row
+	uint32 *		PD_Area_Rcp;				//(1 << 24) / box width, for each output pixel
+	uint8			PD_Area_On;					//PD_INIT_OPT_RESIZE_AREA applies to this image
+	uint8			PD_Area_Premul;				//Colours are averaged weighted by alpha
+#endif
+#if defined(PNGDEC_OPT_ADAM7_THUMBNAIL)
+	uint8			PD_Thumb_Pass;				//PD_INIT_OPT_THUMBNAIL : last Adam7 pass to decode, 0 for all of them
+#endif
+	Narrow16_Func_Ptr PD_Narrow16;				//16-bit samples to 8 bits, kernel selected for this CPU
+	Swap16_Func_Ptr	PD_Swap16;					//16-bit samples to uint16, kernel selected for this CPU
+	uint8			PD_Round16;					//PD_INIT_OPT_ROUND_16 : 16-bit samples are rounded to 8 bits
+	uint8			PD_Crop_On;					//PD_INIT_OPT_CROP : PD_CUSTOM_DECODE.CROP_IMAGE is used
+	uint8			PD_Pipeline_On;				//PD_INIT_OPT_PIPELINE : PD_CUSTOM_DECODE.PIPELINE_MODE is used
+
+	//Huffman Table Related
 #if defined(PNGDEC_OPTI_INSTANCE_MEM)
-static uint8 *		PD_Heap;	//(20081008:11520 bytes) from 8000 bytes
+	uint8 *			PD_Heap;	//6944 bytes (packed tables) from 11520 bytes
 #else
-static uint8		PD_Heap[PD_HASH_HEAP_SIZE];	//(20081008:11520 bytes) from 8000 bytes
+	uint8			PD_Heap[PD_HASH_HEAP_SIZE];	//6944 bytes (packed tables) from 11520 bytes
+#endif
+	unsigned long	PD_Heap_Ptr;				//Indicates current position of remaining heap memory
+	uint32			PD_Heap_Used_Size;			//Used Heap Size for Huffman Table
+	uint32			PD_Hash_Size;				//The number of used Huffman table entries
+	const uint32 *	PD_Huff_Liter;				//Literal or Length Huffman Table
+	const uint32 *	PD_Huff_Dist;				//Distance Huffman Table
+	uint32			PD_FixHuff_Done;	//c		//Whether Fixed Huffman Table is already built up or not
+	int				PD_Lookup_Bit_Literal;			//Primary Table Bits for Literal or Length Huffman Table
+	int				PD_Lookup_Bit_Distance;			//Primary Table Bits for Distance Huffman Table
+
+	//Temporary Variable
+	uint32			PD_Row;
+	uint32			PD_Resize_Ver_Idx;
+
+#if defined(PNGDEC_OPT_TIME_SLICE)
+	//TCCXXX_PNG_Dec_DecodeTimed()
+	unsigned int	(*PD_Slice_Clock)(void);	//PD_CUSTOM_DECODE.time_func of the running call
+	uint32			PD_Slice_Start;				//Clock when the call started
+	uint32			PD_Slice_Budget;			//Microseconds the call may take
+	uint8			PD_Slice_On;				//A TCCXXX_PNG_Dec_DecodeTimed() call is running
+#endif
+	volatile int32	PD_Cancel;					//Set by TCCXXX_PNG_Dec_Cancel(), cleared by the next init
+#if defined(PNGDEC_OPT_STATS)
+	PD_STATS		PD_Stats;					//TCCXXX_PNG_Dec_GetStats(), cleared by the next init
 #endif
-static unsigned long		PD_Heap_Ptr;				//Indicates current position of remaining heap memory
-static uint32		PD_Heap_Used_Size;			//Used Heap Size for Huffman Table
-static uint32		PD_Hash_Size;				//The number of used "Huffman Table Structure"
-static huft *		PD_Huff_Liter;				//Literal or Length Huffman Table
-static huft *		PD_Huff_Dist;				//Distance Huffman Table
-static uint32		PD_FixHuff_Done;	//c		//Whether Fixed Huffman Table is already built up or not
-static int			PD_Lookup_Bit_Literal;			//Minimum Look-up Bit for Literal or Length Huffman Table
-static int			PD_Lookup_Bit_Distance;			//Minimum Look-up Bit for Distance Huffman Table
-
-//Temporary Variable
-static uint32		PD_Row;
-static uint32		PD_Resize_Ver_Idx;
 
+#if defined(PD_PIPELINE)
+	//Two-thread pipeline : the producer thread runs the inflate jobs, the caller's thread PNG_Decode_Image
+	pthread_t		PD_Pipe_Thread;
+	pthread_mutex_t	PD_Pipe_Mutex;
+	pthread_cond_t	PD_Pipe_Cond;
+	uint32			PD_Pipe_Filled;				//PD_Ptr_Block_Dec published by the producer
+	uint32			PD_Pipe_Used;				//PD_Ptr_Image_Dec published by the consumer
+	uint32			PD_Pipe_Batch;				//Most bytes the consumer takes before publishing PD_Pipe_Used
+	int32			PD_Pipe_End;				//PD_PROCESS_CONTINUE while the producer runs, then PD_PROCESS_EOF or PD_PROCESS_ERROR
+	uint8			PD_Pipe_On;					//The producer thread is started and not joined yet
+	uint8			PD_Pipe_Stop;				//The consumer asks the producer to quit
+	uint8			PD_Pipe_Sleep[2];			//The producer / consumer is blocked on PD_Pipe_Cond
+#endif
+};
 
+//Instance buffer layout : [PD_INSTANCE][File Buf][PLTE][Deflate Buf][Huffman Heap]
+#define		PD_INSTANCE_ALIGN		(8)
+#define		PD_INSTANCE_CTX_SIZE	((sizeof(PD_INSTANCE) + PD_INSTANCE_ALIGN - 1) & ~(PD_INSTANCE_ALIGN - 1))
 #if defined(PNGDEC_OPTI_INSTANCE_MEM)
-//////////////////////
-//Instance buffer allocation
-//////////////////////
-static int PNG_Init_instanceMem(char * pAddr, unsigned int iLength)
-{
-	unsigned long iAddr;
+#define		PD_INSTANCE_BUF_SIZE	(PD_INSTANCE_CTX_SIZE + PD_INPUTBUF_SIZE2 + PD_PLTE_TABLE_SIZE + PD_DEFLATE_BUF_LEN + PD_HASH_HEAP_SIZE)
+#else
+#define		PD_INSTANCE_BUF_SIZE	(PD_INSTANCE_CTX_SIZE)
+#endif
 
-	iAddr = (unsigned long) pAddr;
+//Compile-time check : PD_INSTANCE_MEM_SIZE (TCCXXX_PNG_DEC.h) must cover the instance and its alignment
+typedef char PD_INSTANCE_MEM_SIZE_CHECK[(PD_INSTANCE_BUF_SIZE + PD_INSTANCE_ALIGN <= PD_INSTANCE_MEM_SIZE) ? 1 : -1];
 
-	PD_File_Buf = NULL;
-	PD_Plte = NULL;
-	PD_Deflate_Buf = NULL;
-	PD_Heap = NULL;
 
-	if( (pAddr == NULL) || (iLength < PD_INSTANCE_BUF_SIZE) ) {
-		return PD_INSTANCE_BUF_SIZE;
-	}
+/*******************************************************************/
+/******************************Variables******************************/
+/*******************************************************************/
 
-	if( iAddr & 0x3 ) { 
-		iLength -= (4- (iAddr&0x3) );
-		iAddr = ( ( (iAddr>>2) + 1 ) << 2 );		
-	}
+#if defined(PNGDEC_CHECK_CHUNK)
+volatile int32	PD_nPngDecCheck_Chunk;		//Chunks found by the last TCCXXX_PNG_Decode(PD_DEC_INIT)
+#endif
 
-	PD_File_Buf = (unsigned char *)iAddr;;
-	iAddr += PD_INPUTBUF_SIZE2;
-	PD_Plte = (PD_PLTE_TABLE *)iAddr;
-	iAddr += PD_PLTE_TABLE_SIZE;
-	PD_Deflate_Buf = (unsigned char *)iAddr;
-	iAddr += PD_DEFLATE_BUF_LEN;
-	PD_Heap = (unsigned char *)iAddr;
+//Instance used by TCCXXX_PNG_Decode() (single image API)
+static PD_INSTANCE *	PD_Default_Inst;
+
+
+//////////////////////
+//Statistics (PNGDEC_OPT_STATS)
+//////////////////////
+#if defined(PNGDEC_OPT_STATS)
+//A decoder state is timed from PD_STATS_START to PD_STATS_STOP (locals stats_t and stats_job)
+#define PD_STATS_START(job)		{ stats_job = (job); stats_t = PNG_Stats_Clock(); }
+#define PD_STATS_STOP()			PNG_Stats_Job(pInst, stats_job, stats_t)
+#define PD_STATS_ADD(field, v)	(pInst->PD_Stats.field += (v))
+
+//Nanoseconds of the monotonic clock, 0 without one
+static uint64 PNG_Stats_Clock(void)
+{
+#if defined(PD_CLOCK_MONOTONIC)
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64)ts.tv_sec * 1000000000 + (uint64)ts.tv_nsec;
+#else
+	return 0;
+#endif
+}
 
-	return 0;	//success
+static void PNG_Stats_Job(PD_INSTANCE *pInst, uint32 job, uint64 start)
+{
+	if(job < PD_STATS_JOB_NUM)
+	{
+		pInst->PD_Stats.job_ns[job] += PNG_Stats_Clock() - start;
+		pInst->PD_Stats.job_runs[job]++;
+	}
 }
+#else
+#define PD_STATS_START(job)
+#define PD_STATS_STOP()
+#define PD_STATS_ADD(field, v)
 #endif
 
+
 //////////////////////
 //Input Related Functions
 //////////////////////
 
-static uint8 _read_byte(void)
+//read_func of the caller (counted by PNGDEC_OPT_STATS)
+static int PNG_Read_Input(PD_INSTANCE *pInst, void *ptr, int size, int nmemb)
+{
+	int ret = (pInst->PD_callbacks.read_func)(ptr, size, nmemb, pInst->PD_Datasource);
+
+	PD_STATS_ADD(read_calls, 1);
+	PD_STATS_ADD(read_bytes, (ret > 0) ? (uint64)ret * size : 0);
+	return ret;
+}
+
+static uint8 _read_byte(PD_INSTANCE *pInst)
 {
 	BYTE ret;
 
-	if (PD_Read_Point == PD_INPUTBUF_SIZE)
+	if (pInst->PD_Read_Point == pInst->PD_Read_Point_End)
 	{
 		int tRet = 0;
 	#if defined(PNGDEC_CHECK_EOF_2)
 		int iReadBytes;
 	#endif
 	
-		PD_Read_Point=0;
+		if(pInst->PD_Src_Buf)
+		{
+			//memory input : no more data (push input : not yet)
+			pInst->PD_nPngDecErrorCode = TC_PNGDEC_ERR_STREAM_READING;
+			return 0;
+		}
+
+	#if defined(PNGDEC_STABILITY_CHECK_CRC)
+		//the buffer is refilled : add the rest of it to the chunk CRC
+		if(pInst->PD_Crc_Active)
+		{
+			pInst->PD_Crc = pInst->PD_Crc32(pInst->PD_Crc, pInst->PD_FileBuf_Ptr + pInst->PD_Crc_Point, pInst->PD_Read_Point - pInst->PD_Crc_Point);
+			pInst->PD_Crc_Point = 0;
+		}
+	#endif
 
-		if(PD_Cur_Buf==1)
+		pInst->PD_Read_Point=0;
+
+		if(pInst->PD_Cur_Buf==1)
 		{
-			PD_FileBuf_Ptr = PD_File_Buf;
+			pInst->PD_FileBuf_Ptr = pInst->PD_File_Buf;
 
 		#if defined(PNGDEC_CHECK_EOF_2)
 			iReadBytes = PD_INPUTBUF_SIZE;
-			if( (PD_ReadFileBytes+PD_INPUTBUF_SIZE) > PD_TotFileSize )
+			if( (pInst->PD_ReadFileBytes+PD_INPUTBUF_SIZE) > pInst->PD_TotFileSize )
 			{
-				iReadBytes = PD_TotFileSize - PD_ReadFileBytes;
+				iReadBytes = pInst->PD_TotFileSize - pInst->PD_ReadFileBytes;
 				if( iReadBytes > PD_INPUTBUF_SIZE ) {
 					iReadBytes = PD_INPUTBUF_SIZE;
 				}
 			}
 			if( iReadBytes > 0 ) {	
-				PD_Read_Point_Max = iReadBytes + PD_INPUTBUF_SIZE;
-				tRet = (PD_callbacks.read_func)( \
-							&PD_File_Buf[PD_INPUTBUF_SIZE], \
-							1, iReadBytes, \
-							PD_Datasource);
+				pInst->PD_Read_Point_Max = iReadBytes + PD_INPUTBUF_SIZE;
+				tRet = PNG_Read_Input(pInst, &pInst->PD_File_Buf[PD_INPUTBUF_SIZE], 1, iReadBytes);
 				if( tRet < PNGDEC_FREAD_FAILURE_RET ) {
-					PD_nPngDecErrorCode = PD_RETURN_DECODE_FAIL;
+					pInst->PD_nPngDecErrorCode = PD_RETURN_DECODE_FAIL;
 					return 0;
 				}else
 				{
-					PD_ReadFileBytes += iReadBytes;
+					pInst->PD_ReadFileBytes += iReadBytes;
 				}
 			}else
 			{
-				if( PD_Read_Point_Max > PD_INPUTBUF_SIZE )
+				if( pInst->PD_Read_Point_Max > PD_INPUTBUF_SIZE )
 				{
-					PD_Read_Point_Max -= PD_INPUTBUF_SIZE;
+					pInst->PD_Read_Point_Max -= PD_INPUTBUF_SIZE;
 				}
 				else
 				{
-					PD_nPngDecErrorCode = TC_PNGDEC_ERR_STREAM_READING;
+					pInst->PD_nPngDecErrorCode = TC_PNGDEC_ERR_STREAM_READING;
 					return 0;
 				}
 			}
 		#else
-			tRet = (PD_callbacks.read_func)( \
-							&PD_File_Buf[PD_INPUTBUF_SIZE], \
-							1, PD_INPUTBUF_SIZE, \
-							PD_Datasource);
+			tRet = PNG_Read_Input(pInst, &pInst->PD_File_Buf[PD_INPUTBUF_SIZE], 1, PD_INPUTBUF_SIZE);
 
 			if( tRet < PNGDEC_FREAD_FAILURE_RET ) {
-				PD_nPngDecErrorCode = TC_PNGDEC_ERR_STREAM_READING;
+				pInst->PD_nPngDecErrorCode = TC_PNGDEC_ERR_STREAM_READING;
 				return 0;
 			}
 		#endif
 
-			PD_Cur_Buf=0;
+			pInst->PD_Cur_Buf=0;
 		}else
 		{
-			PD_FileBuf_Ptr = &PD_File_Buf[PD_INPUTBUF_SIZE];
+			pInst->PD_FileBuf_Ptr = &pInst->PD_File_Buf[PD_INPUTBUF_SIZE];
 
 		#if defined(PNGDEC_CHECK_EOF_2)
 			iReadBytes = PD_INPUTBUF_SIZE;
-			if( (PD_ReadFileBytes+PD_INPUTBUF_SIZE) > PD_TotFileSize )
+			if( (pInst->PD_ReadFileBytes+PD_INPUTBUF_SIZE) > pInst->PD_TotFileSize )
 			{
-				iReadBytes = PD_TotFileSize - PD_ReadFileBytes;
+				iReadBytes = pInst->PD_TotFileSize - pInst->PD_ReadFileBytes;
 				if( iReadBytes > PD_INPUTBUF_SIZE )
 				{
 					iReadBytes = PD_INPUTBUF_SIZE;
@@ -484,93 +1165,123 @@ static uint8 _read_byte(void)
 			}
 			if( iReadBytes > 0 )
 			{	
-				PD_Read_Point_Max = iReadBytes + PD_INPUTBUF_SIZE;
-				tRet = (PD_callbacks.read_func)( \
-							PD_File_Buf, \
-							1, iReadBytes, \
-							PD_Datasource);
+				pInst->PD_Read_Point_Max = iReadBytes + PD_INPUTBUF_SIZE;
+				tRet = PNG_Read_Input(pInst, pInst->PD_File_Buf, 1, iReadBytes);
 				if( tRet < PNGDEC_FREAD_FAILURE_RET ) {
-					PD_nPngDecErrorCode = PD_RETURN_DECODE_FAIL;
+					pInst->PD_nPngDecErrorCode = PD_RETURN_DECODE_FAIL;
 					return 0;
 				}else {
-					PD_ReadFileBytes += iReadBytes;
+					pInst->PD_ReadFileBytes += iReadBytes;
 				}
 			}else
 			{
-				if( PD_Read_Point_Max > PD_INPUTBUF_SIZE )
+				if( pInst->PD_Read_Point_Max > PD_INPUTBUF_SIZE )
 				{
-					PD_Read_Point_Max -= PD_INPUTBUF_SIZE;
+					pInst->PD_Read_Point_Max -= PD_INPUTBUF_SIZE;
 				}
 				else
 				{
-					PD_nPngDecErrorCode = TC_PNGDEC_ERR_STREAM_READING;
+					pInst->PD_nPngDecErrorCode = TC_PNGDEC_ERR_STREAM_READING;
 					return 0;
 				}
 			}
 		#else
-			tRet = (PD_callbacks.read_func)( \
-						PD_File_Buf, \
-						1, PD_INPUTBUF_SIZE, \
-						PD_Datasource);
+			tRet = PNG_Read_Input(pInst, pInst->PD_File_Buf, 1, PD_INPUTBUF_SIZE);
 			if( tRet < PNGDEC_FREAD_FAILURE_RET ) {
-				PD_nPngDecErrorCode = TC_PNGDEC_ERR_STREAM_READING;
+				pInst->PD_nPngDecErrorCode = TC_PNGDEC_ERR_STREAM_READING;
 				return 0;
 			}
 		#endif
 
-			PD_Cur_Buf=1;
+			pInst->PD_Cur_Buf=1;
 		}
 	}
 
 #if defined(PNGDEC_CHECK_EOF_2)
-	if( PD_Read_Point > PD_Read_Point_Max )
+	if( pInst->PD_Read_Point > pInst->PD_Read_Point_Max )
 	{
-		PD_nPngDecErrorCode = TC_PNGDEC_ERR_STREAM_READING;
+		pInst->PD_nPngDecErrorCode = TC_PNGDEC_ERR_STREAM_READING;
 		return 0;
 	}
-	ret=PD_FileBuf_Ptr[PD_Read_Point++];
+	ret=pInst->PD_FileBuf_Ptr[pInst->PD_Read_Point++];
 #else
-	ret=PD_FileBuf_Ptr[PD_Read_Point++];
+	ret=pInst->PD_FileBuf_Ptr[pInst->PD_Read_Point++];
 #endif
 
 	return ret;
 }
 
 
-static void PNG_Init_IO(void)
-{
-
 #if defined(PNGDEC_CHECK_EOF_2)
+//Fill both halves of the input buffer from PD_ReadFileBytes on, reading starts again at the first half
+static void PNG_Fill_Input(PD_INSTANCE *pInst)
+{
 	int iReadBytes;
 
+	pInst->PD_Read_Point = 0;
+	pInst->PD_Cur_Buf = 0;
+	pInst->PD_FileBuf_Ptr = pInst->PD_File_Buf;
+
 	iReadBytes = PD_INPUTBUF_SIZE;
-	if( PD_TotFileSize < PD_INPUTBUF_SIZE )
-		iReadBytes = PD_TotFileSize;
-	(PD_callbacks.read_func)(PD_File_Buf, 1, iReadBytes, PD_Datasource);
-	PD_ReadFileBytes = iReadBytes;
-	PD_Read_Point_Max = iReadBytes;
+	if( pInst->PD_TotFileSize - pInst->PD_ReadFileBytes < PD_INPUTBUF_SIZE )
+		iReadBytes = pInst->PD_TotFileSize - pInst->PD_ReadFileBytes;
+	PNG_Read_Input(pInst, pInst->PD_File_Buf, 1, iReadBytes);
+	pInst->PD_ReadFileBytes += iReadBytes;
+	pInst->PD_Read_Point_Max = iReadBytes;
 
-	if( PD_TotFileSize > PD_ReadFileBytes )
+	if( pInst->PD_TotFileSize > pInst->PD_ReadFileBytes )
 	{
-		iReadBytes = PD_TotFileSize - PD_ReadFileBytes;
+		iReadBytes = pInst->PD_TotFileSize - pInst->PD_ReadFileBytes;
 		if( iReadBytes > PD_INPUTBUF_SIZE )
 			iReadBytes = PD_INPUTBUF_SIZE;
-		(PD_callbacks.read_func)(&PD_File_Buf[PD_INPUTBUF_SIZE], 1, iReadBytes, PD_Datasource);
-		PD_ReadFileBytes += iReadBytes;
-		PD_Read_Point_Max += iReadBytes;
-	}	
+		PNG_Read_Input(pInst, &pInst->PD_File_Buf[PD_INPUTBUF_SIZE], 1, iReadBytes);
+		pInst->PD_ReadFileBytes += iReadBytes;
+		pInst->PD_Read_Point_Max += iReadBytes;
+	}
+}
+#endif
 
-#else
-	(PD_callbacks.read_func)(PD_File_Buf, PD_INPUTBUF_SIZE, 1, PD_Datasource);
-	(PD_callbacks.read_func)(&PD_File_Buf[PD_INPUTBUF_SIZE], PD_INPUTBUF_SIZE, 1, PD_Datasource);
+#if defined(PNGDEC_OPT_CHUNK_SEEK)
+//File offset of the next byte to read
+static uint32 PNG_Input_Offset(PD_INSTANCE *pInst)
+{
+	if(pInst->PD_Src_Buf)
+		return (uint32)pInst->PD_Read_Point;
+	return pInst->PD_ReadFileBytes - pInst->PD_Read_Point_Max + (uint32)pInst->PD_Read_Point;
+}
 #endif
 
-	PD_Read_Point = 0;
-	PD_Cur_Buf = 0;
-	PD_FileBuf_Ptr = PD_File_Buf;
+static void PNG_Init_IO(PD_INSTANCE *pInst)
+{
+	pInst->PD_Valid_Bit = 0;
+	pInst->PD_2nd_Strm = 0;
+	pInst->PD_Read_Point = 0;
+	pInst->PD_Cur_Buf = 0;
+
+	if(pInst->PD_Src_Buf)
+	{
+		//memory input : read in place
+		pInst->PD_FileBuf_Ptr = (BYTE *)pInst->PD_Src_Buf;
+		pInst->PD_Read_Point_End = (int32)pInst->PD_TotFileSize;
+		if(pInst->PD_Push_On && pInst->PD_Push_Size < pInst->PD_TotFileSize)
+			pInst->PD_Read_Point_End = (int32)pInst->PD_Push_Size;
+	#if defined(PNGDEC_CHECK_EOF_2)
+		pInst->PD_ReadFileBytes = pInst->PD_TotFileSize;
+		pInst->PD_Read_Point_Max = (uint32)pInst->PD_Read_Point_End;
+	#endif
+		return;
+	}
+	pInst->PD_Read_Point_End = PD_INPUTBUF_SIZE;
+
+#if defined(PNGDEC_CHECK_EOF_2)
+	pInst->PD_ReadFileBytes = 0;
+	PNG_Fill_Input(pInst);
+#else
+	PNG_Read_Input(pInst, pInst->PD_File_Buf, PD_INPUTBUF_SIZE, 1);
+	PNG_Read_Input(pInst, &pInst->PD_File_Buf[PD_INPUTBUF_SIZE], PD_INPUTBUF_SIZE, 1);
+#endif
 
-	PD_Valid_Bit = 0;
-	PD_2nd_Strm = 0;
+	pInst->PD_FileBuf_Ptr = pInst->PD_File_Buf;
 }
 
 
@@ -580,28 +1291,28 @@ static void PNG_Init_IO(void)
 //Bitstream Related Macro Functions
 #define NEEDBITS(bits)						\
 {								\
-	while(PD_Valid_Bit < bits)					\
+	while(pInst->PD_Valid_Bit < bits)					\
 	{							\
-		PD_2nd_Strm += _read_byte() << PD_Valid_Bit;	\
-		PD_Valid_Bit += 8;				\
+		pInst->PD_2nd_Strm += (PD_BITBUF)_read_byte(pInst) << pInst->PD_Valid_Bit;	\
+		pInst->PD_Valid_Bit += 8;				\
 	}							\
 }
 
 #define READBITS(bits, temp)					\
 {								\
-	temp = (uint16)(PD_2nd_Strm & PDRO_Bit_Mask[bits]);	\
+	temp = (uint16)(pInst->PD_2nd_Strm & PDRO_Bit_Mask[bits]);	\
 	DROPBITS(bits);						\
 }
 
 #define SHOWBITS(bits, temp)					\
 {								\
-	temp = (uint16)(PD_2nd_Strm & PDRO_Bit_Mask[bits]);	\
+	temp = (uint16)(pInst->PD_2nd_Strm & PDRO_Bit_Mask[bits]);	\
 }
 
 #define DROPBITS(bits)			\
 {					\
-	PD_2nd_Strm >>= bits;		\
-	PD_Valid_Bit -= bits;		\
+	pInst->PD_2nd_Strm >>= bits;		\
+	pInst->PD_Valid_Bit -= bits;		\
 }
 
 #define READWORD(v)			\
@@ -649,34 +1360,52 @@ static void PNG_Init_IO(void)
 //Ring-Queue Related Macro Functions
 #define QUEUE_PUSH(v)	\
 {\
-	PD_Deflate_Buf[PD_RING_QUEUE_MASK & (PD_Ptr_Block_Dec++)] = v;\
+	pInst->PD_Deflate_Buf[PD_RING_QUEUE_MASK & (pInst->PD_Ptr_Block_Dec++)] = v;\
 }
 
 #if defined(PNGDEC_OPT_CHECK_DEFLATE_BUF_SIZE)
 #define QUEUE_POP_NOMASK(v)	\
 {\
-	v = PD_Deflate_Buf[(PD_Ptr_Image_Dec++)];\
+	v = pInst->PD_Deflate_Buf[(pInst->PD_Ptr_Image_Dec++)];\
 }
 #endif
 
 #define QUEUE_POP(v)	\
 {\
-	v = PD_Deflate_Buf[PD_RING_QUEUE_MASK & (PD_Ptr_Image_Dec++)];\
+	v = pInst->PD_Deflate_Buf[PD_RING_QUEUE_MASK & (pInst->PD_Ptr_Image_Dec++)];\
+}
+
+#if defined(PD_PIPELINE)
+#define QUEUE_PUSH_CHECK(size)	\
+{\
+	if(pInst->PD_Pipe_On)\
+		size = PNG_Pipe_Push_Check(pInst);\
+	else\
+		size = PD_DEFLATE_BUF_LEN - (pInst->PD_Ptr_Block_Dec - pInst->PD_Ptr_Image_Dec);\
 }
 
+#define QUEUE_POP_CHECK(size)	\
+{\
+	if(pInst->PD_Pipe_On)\
+		size = PNG_Pipe_Pop_Check(pInst);\
+	else\
+		size = pInst->PD_Ptr_Block_Dec - pInst->PD_Ptr_Image_Dec;\
+}
+#else
 #define QUEUE_PUSH_CHECK(size)	\
 {\
-	size = PD_DEFLATE_BUF_LEN - (PD_Ptr_Block_Dec - PD_Ptr_Image_Dec);\
+	size = PD_DEFLATE_BUF_LEN - (pInst->PD_Ptr_Block_Dec - pInst->PD_Ptr_Image_Dec);\
 }
 
 #define QUEUE_POP_CHECK(size)	\
 {\
-	size = PD_Ptr_Block_Dec - PD_Ptr_Image_Dec;\
+	size = pInst->PD_Ptr_Block_Dec - pInst->PD_Ptr_Image_Dec;\
 }
+#endif
 
 #define QUEUE_VISIT(v, d)	\
 {\
-	v = PD_Deflate_Buf[(PD_Ptr_Block_Dec - d) & PD_RING_QUEUE_MASK];\
+	v = pInst->PD_Deflate_Buf[(pInst->PD_Ptr_Block_Dec - d) & PD_RING_QUEUE_MASK];\
 }
 
 #if !defined(PNGDEC_ABS_INTERNAL)
@@ -726,7 +1455,7 @@ static void PNG_Init_IO(void)
 #define PNGD_MEMSET(X,Y,Z)								\
 {														\
 	char *pAddr = (char*)X;								\
-	char cVal = (char)Y;								\
+	unsigned char cVal = (unsigned char)Y;				\
 	unsigned int iSize = (unsigned int)Z;				\
 	if( iSize < 8 )										\
 	{													\
@@ -759,7 +1488,8 @@ static void PNG_Init_IO(void)
 		/* Writing in 4 bytes */						\
 		iSize4 = (iSize>>2);							\
 		iVal = (unsigned int)cVal;						\
-		iVal = (cVal<<24)|(cVal<<16)|(cVal<<8)|(iVal);	\
+		iVal |= (iVal<<8);								\
+		iVal |= (iVal<<16);								\
 		for(i=0;i<iSize4;i++)							\
 		{												\
 			*pAddr4++ = iVal;							\
@@ -783,441 +1513,1105 @@ static void PNG_Init_IO(void)
 /*************************Functions Defines****************************/
 /*******************************************************************/
 
+//////////////////////
+//Instance buffer allocation
+//////////////////////
+static PD_INSTANCE * PNG_Init_instanceMem(char * pAddr, unsigned int iLength)
+{
+	PD_INSTANCE *pInst;
+	unsigned long iAddr;
+
+	iAddr = (unsigned long) pAddr;
+
+	if( (pAddr == NULL) || (iLength < PD_INSTANCE_BUF_SIZE + PD_INSTANCE_ALIGN) ) {
+		return NULL;
+	}
+
+	if( iAddr & (PD_INSTANCE_ALIGN - 1) ) {
+		iAddr = ( iAddr + PD_INSTANCE_ALIGN - 1 ) & ~((unsigned long)PD_INSTANCE_ALIGN - 1);
+	}
+
+	pInst = (PD_INSTANCE *)iAddr;
+	PNGD_MEMSET(pInst, 0, sizeof(PD_INSTANCE));
+	iAddr += PD_INSTANCE_CTX_SIZE;
+
+#if defined(PNGDEC_OPTI_INSTANCE_MEM)
+	pInst->PD_File_Buf = (unsigned char *)iAddr;
+	iAddr += PD_INPUTBUF_SIZE2;
+	pInst->PD_Plte = (PD_PLTE_TABLE *)iAddr;
+	iAddr += PD_PLTE_TABLE_SIZE;
+	pInst->PD_Deflate_Buf = (unsigned char *)iAddr;
+	iAddr += PD_DEFLATE_BUF_LEN;
+	pInst->PD_Heap = (unsigned char *)iAddr;
+#endif
+
+	pInst->PD_Magic = PD_INSTANCE_MAGIC;
+
+	return pInst;	//success
+}
+
 //////////////////////
 //Initialization Related
 //////////////////////
-static void PNG_Init_Variable(void)
+static void PNG_Init_Variable(PD_INSTANCE *pInst)
 {
-	PD_FixHuff_Done = PD_DONE_YET;
-	PD_Last_IDAT = PD_DONE_YET;
-	PCD_Global_Pix_Pos = 0;	
-	PD_Ptr_Block_Dec = 0;
-	PD_Ptr_Image_Dec = 0;
+	pInst->PD_FixHuff_Done = PD_DONE_YET;
+	pInst->PD_Last_IDAT = PD_DONE_YET;
+	pInst->PCD_Global_Pix_Pos = 0;	
+	pInst->PD_Ptr_Block_Dec = 0;
+	pInst->PD_Ptr_Image_Dec = 0;
 #if defined(PNGDEC_CHECK_CHUNK)
-	PD_nPngDecCheck_Chunk = 0;
+	pInst->PD_nPngDecCheck_Chunk = 0;
 #endif	
-	PD_Still_Decoding = PD_DONE_ALREADY;
-	PD_Hash_Size = 0;
-	PD_Heap_Ptr = PD_Heap;
-	PD_Heap_Used_Size = 0;
-	PD_Last_Block = 0;
-	PD_Row = 0;
-	PD_Resize_Ver_Idx = 0;
-	PD_Current_Pass = 0;
-	PD_Remaining_Row = 0;
-	PD_Alpha_Available = 0;
+	pInst->PD_Still_Decoding = PD_DONE_ALREADY;
+	pInst->PD_Liter2Push_Num = 0;
+	pInst->PD_Hash_Size = 0;
+	pInst->PD_Heap_Ptr = (unsigned long)pInst->PD_Heap;
+	pInst->PD_Heap_Used_Size = 0;
+	pInst->PD_Last_Block = 0;
+	pInst->PD_Row = 0;
+	pInst->PD_Resize_Ver_Idx = 0;
+	pInst->PD_Current_Pass = 0;
+	pInst->PD_Remaining_Row = 0;
+	pInst->PD_Alpha_Available = 0;
+#if defined(PNGDEC_OPT_DEFILTER_SIMD)
+	pInst->PD_Defilter = PNG_Select_Defilter();
+#endif
+#if defined(PNGDEC_OPT_RESIZE_AREA)
+	pInst->PD_Area_Row = PNG_Select_Area();
+	pInst->PD_Area_On = 0;
+#endif
+#if defined(PNGDEC_OPT_PLTE_LUT)
+	pInst->PD_Plte_Expand = PNG_Select_Plte();
+	pInst->PD_Plte_On = 0;
+	pInst->PD_Plte_Direct = 0;
+#endif
+	pInst->PD_Narrow16 = PNG_Select_Narrow16();
+	pInst->PD_Swap16 = PNG_Select_Swap16();
+#if defined(PNGDEC_OPT_ADAM7_THUMBNAIL)
+	pInst->PD_Thumb_Pass = 0;
+#endif
+	pInst->PD_Push_Limit = PD_DEFLATE_BUF_LEN;
+#if defined(PNGDEC_STABILITY_CHECK_ADLER)
+	pInst->PD_Adler32 = PNG_Select_Adler32();
+	pInst->PD_Adler = 1;
+	pInst->PD_Adler_Ptr = 0;
+	pInst->PD_Adler_On = 0;
+#endif
+#if defined(PNGDEC_STABILITY_CHECK_CRC)
+	pInst->PD_Crc32 = PNG_Select_Crc32();
+	pInst->PD_Crc_Mode = PD_CRC_DEFER;
+	pInst->PD_Crc_Active = 0;
+	pInst->PD_Crc_Error = 0;
+#endif
 #if defined(PNGDEC_STABILITY_ERROR_HANDLE)
-	PD_nPngDecErrorCode = 0; //init.
+	pInst->PD_nPngDecErrorCode = 0; //init.
 #endif
 }
 
 //Generation of Resized Pixel Map
-static int PNG_Init_ADAM7_Map(int pass)
+static int PNG_Init_ADAM7_Map(PD_INSTANCE *pInst, int pass)
 {
-	if(PD_Current_Pass != pass)
+	if(pInst->PD_Current_Pass != pass)
 	{
-		PD_Row = 0;
-		PD_Current_Pass = pass;
-		PD_Resize_Ver_Idx = 0;
-		PNGD_MEMSET(PD_Diag_Scanline, 0, PD_Global_Scanline_Size);
+		pInst->PD_Row = 0;
+		pInst->PD_Current_Pass = pass;
+		pInst->PD_Resize_Ver_Idx = 0;
+		PNGD_MEMSET(pInst->PD_Diag_Scanline, 0, pInst->PD_Global_Scanline_Size);
 		
-		switch(PD_Current_Pass)
+		switch(pInst->PD_Current_Pass)
 		{
 		case 1:
-			PD_ADAM7_Width = (PD_Global_Width + 7) / 8;
-			PD_ADAM7_Height = (PD_Global_Height + 7) / 8;
+			pInst->PD_ADAM7_Width = (pInst->PD_Global_Width + 7) / 8;
+			pInst->PD_ADAM7_Height = (pInst->PD_Global_Height + 7) / 8;
 			break;
 		case 2:
-			PD_ADAM7_Width = (PD_Global_Width + 3) / 8;
-			PD_ADAM7_Height = (PD_Global_Height + 7) / 8;
+			pInst->PD_ADAM7_Width = (pInst->PD_Global_Width + 3) / 8;
+			pInst->PD_ADAM7_Height = (pInst->PD_Global_Height + 7) / 8;
 			break;
 		case 3:
-			PD_ADAM7_Width = (PD_Global_Width + 7) / 8 + (PD_Global_Width + 3) / 8;
-			PD_ADAM7_Height = (PD_Global_Height + 3) / 8;
+			pInst->PD_ADAM7_Width = (pInst->PD_Global_Width + 7) / 8 + (pInst->PD_Global_Width + 3) / 8;
+			pInst->PD_ADAM7_Height = (pInst->PD_Global_Height + 3) / 8;
 			break;
 		case 4:
-			PD_ADAM7_Width = (PD_Global_Width + 1) / 8 + (PD_Global_Width + 5) / 8;
-			PD_ADAM7_Height = (PD_Global_Height + 7) / 8 + (PD_Global_Height + 3) / 8;
+			pInst->PD_ADAM7_Width = (pInst->PD_Global_Width + 1) / 8 + (pInst->PD_Global_Width + 5) / 8;
+			pInst->PD_ADAM7_Height = (pInst->PD_Global_Height + 7) / 8 + (pInst->PD_Global_Height + 3) / 8;
 			break;
 		case 5:
-			PD_ADAM7_Width = (PD_Global_Width + 1) / 2;
-			PD_ADAM7_Height = (PD_Global_Height + 1) / 8 + (PD_Global_Height + 5) / 8;
+			pInst->PD_ADAM7_Width = (pInst->PD_Global_Width + 1) / 2;
+			pInst->PD_ADAM7_Height = (pInst->PD_Global_Height + 1) / 8 + (pInst->PD_Global_Height + 5) / 8;
 			break;
 		case 6:
-			PD_ADAM7_Width = PD_Global_Width / 2;
-			PD_ADAM7_Height = (PD_Global_Height + 1) / 2;
+			pInst->PD_ADAM7_Width = pInst->PD_Global_Width / 2;
+			pInst->PD_ADAM7_Height = (pInst->PD_Global_Height + 1) / 2;
 			break;
 		case 7:
-			PD_ADAM7_Width = PD_Global_Width;
-			PD_ADAM7_Height = PD_Global_Height / 2;
+			pInst->PD_ADAM7_Width = pInst->PD_Global_Width;
+			pInst->PD_ADAM7_Height = pInst->PD_Global_Height / 2;
 			break;
 		default:
 			return PD_PROCESS_ERROR;
 		}
 
-		if(PD_ADAM7_Width == 0 || PD_ADAM7_Height == 0)//If pass image is NULL, skip current pass
-			PNG_Init_ADAM7_Map(PD_Current_Pass + 1);
+		if(pInst->PD_ADAM7_Width == 0 || pInst->PD_ADAM7_Height == 0)//If pass image is NULL, skip current pass
+			PNG_Init_ADAM7_Map(pInst, pInst->PD_Current_Pass + 1);
 
-		PD_Remaining_Row = PD_ADAM7_Height;
-		PD_Remaining_Row_ADAM7 = 0;
-		PD_Scanline_Size = ((PD_ADAM7_Width * PD_Bit_Depth * PD_Compo_Num - 1) >> 3) + 1;
+		pInst->PD_Remaining_Row = pInst->PD_ADAM7_Height;
+		pInst->PD_Remaining_Row_ADAM7 = 0;
+		pInst->PD_Scanline_Size = ((pInst->PD_ADAM7_Width * pInst->PD_Bit_Depth * pInst->PD_Compo_Num - 1) >> 3) + 1;
 	}
 	return PD_PROCESS_DONE;
 }
 
+#if defined(PNGDEC_OPT_ADAM7_THUMBNAIL)
+//First pass whose grid is not coarser than the boxes of the resized image, 0 if all seven are needed
+static uint8 PNG_Thumbnail_Pass(PD_INSTANCE *pInst)
+{
+	uint32 hor_ratio = pInst->PD_Global_Width / pInst->PD_Resized_Width;
+	uint32 ver_ratio = pInst->PD_Global_Height / pInst->PD_Resized_Height;
+	uint8 pass;
+
+	for(pass = 1;pass < 7;pass++)
+	{
+		if(PDRO_Grid_Hor[pass - 1] <= hor_ratio && PDRO_Grid_Ver[pass - 1] <= ver_ratio)
+			return pass;
+	}
+	return 0;
+}
+#endif
+
 //Initialize Heap Memory and Scaler Factors
 
-static void PNG_Init_Heap(void)
+static void PNG_Init_Heap(PD_INSTANCE *pInst)
 {
 	int i;
 	uint32 hor_ratio;
 	uint32 ver_ratio;
+	uint32 map_end = 0;		//PD_INIT_OPT_RESIZE_AREA : each map ends with the end of the last box
+	unsigned long row_buf;
 	
+#if defined(PNGDEC_OPT_RESIZE_AREA)
+	map_end = pInst->PD_Area_On;
+#endif
+
 	//Memory for Upper Scanline
-	PD_Diag_Scanline = (uint8 *)(PD_Out_Struct.Heap_Memory);
-	PD_Up_Scanline = PD_Diag_Scanline + PD_Bpp;
+	pInst->PD_Diag_Scanline = (uint8 *)(pInst->PD_Out_Struct.Heap_Memory);
+	pInst->PD_Up_Scanline = pInst->PD_Diag_Scanline + pInst->PD_Bpp;
+	PNGD_MEMSET(pInst->PD_Diag_Scanline, 0, pInst->PD_Global_Scanline_Size);	//the row above the first row, Heap_Memory may be reused
 
 	//Set Resizing Factor
-	if(PD_Out_Struct.MODIFY_IMAGE_POS)
+	if(pInst->PD_Out_Struct.MODIFY_IMAGE_POS)
 	{
-		PD_Left_Offset = PD_Out_Struct.IMAGE_POS_X;
-		PD_Top_Offset = PD_Out_Struct.IMAGE_POS_Y;
+		pInst->PD_Left_Offset = pInst->PD_Out_Struct.IMAGE_POS_X;
+		pInst->PD_Top_Offset = pInst->PD_Out_Struct.IMAGE_POS_Y;
 	}
 	else
 	{
-		PD_Left_Offset = (PD_LCD_Width - PD_Resized_Width) >> 1;
-		PD_Top_Offset = (PD_LCD_Height - PD_Resized_Height) >> 1;
+		pInst->PD_Left_Offset = (pInst->PD_LCD_Width - pInst->PD_Resized_Width) >> 1;
+		pInst->PD_Top_Offset = (pInst->PD_LCD_Height - pInst->PD_Resized_Height) >> 1;
 	}
 
-	if(PD_Image_Smaller_LCD != PD_TRUE)
+	if(pInst->PD_Image_Smaller_LCD != PD_TRUE)
 	{
 		//Memory for Resizing Matrix
 	#if !defined(PNGDEC_MOD_MEM_ALIGN)
-		PD_Pixel_Map_Hor = (uint16 *)((uint32)PD_Up_Scanline + PD_Scanline_Size + PD_Bpp);
-		PD_Pixel_Map_Ver = (uint16 *)((uint32)PD_Pixel_Map_Hor + PD_Resized_Width * 2);
+		pInst->PD_Pixel_Map_Hor = (uint16 *)((unsigned long)pInst->PD_Up_Scanline + pInst->PD_Scanline_Size + pInst->PD_Bpp);
+		pInst->PD_Pixel_Map_Ver = (uint16 *)((unsigned long)pInst->PD_Pixel_Map_Hor + (pInst->PD_Resized_Width + map_end) * 2);
 	#else
-		PD_Pixel_Map_Hor = (uint16 *)((((uint32)PD_Up_Scanline + PD_Scanline_Size + PD_Bpp + 3)>>1)<<1);
-		PD_Pixel_Map_Ver = (uint16 *)((((uint32)PD_Pixel_Map_Hor + PD_Resized_Width * 2 + 3)>>1)<<1);
+		pInst->PD_Pixel_Map_Hor = (uint16 *)((((unsigned long)pInst->PD_Up_Scanline + pInst->PD_Scanline_Size + pInst->PD_Bpp + 3)>>1)<<1);
+		pInst->PD_Pixel_Map_Ver = (uint16 *)((((unsigned long)pInst->PD_Pixel_Map_Hor + (pInst->PD_Resized_Width + map_end) * 2 + 3)>>1)<<1);
 	#endif
 
-		hor_ratio = (PD_Global_Width << 16) / PD_Resized_Width;
-		ver_ratio = (PD_Global_Height << 16) / PD_Resized_Height;
+		hor_ratio = (pInst->PD_Global_Width << 16) / pInst->PD_Resized_Width;
+		ver_ratio = (pInst->PD_Global_Height << 16) / pInst->PD_Resized_Height;
+
+		for(i = 0;i < pInst->PD_Resized_Width;i++) {
+			pInst->PD_Pixel_Map_Hor[i] = (uint16)((i * hor_ratio) >> 16);
+		}
+
+		for(i = 0;i < pInst->PD_Resized_Height;i++) {
+			pInst->PD_Pixel_Map_Ver[i] = (uint16)((i * ver_ratio) >> 16);	
+		}
 
-		for(i = 0;i < PD_Resized_Width;i++) {
-			PD_Pixel_Map_Hor[i] = (uint16)((i * hor_ratio) >> 16);
+		if(map_end)
+		{
+			pInst->PD_Pixel_Map_Hor[pInst->PD_Resized_Width] = (uint16)pInst->PD_Global_Width;
+			pInst->PD_Pixel_Map_Ver[pInst->PD_Resized_Height] = (uint16)pInst->PD_Global_Height;
 		}
 
-		for(i = 0;i < PD_Resized_Height;i++) {
-			PD_Pixel_Map_Ver[i] = (uint16)((i * ver_ratio) >> 16);	
+	#if defined(PNGDEC_OPT_ADAM7_THUMBNAIL)
+		//move every sample onto the grid of the passes up to PD_Thumb_Pass
+		if(pInst->PD_Thumb_Pass)
+		{
+			for(i = 0;i < pInst->PD_Resized_Width;i++)
+				pInst->PD_Pixel_Map_Hor[i] &= (uint16)~(PDRO_Grid_Hor[pInst->PD_Thumb_Pass - 1] - 1);
+
+			for(i = 0;i < pInst->PD_Resized_Height;i++)
+				pInst->PD_Pixel_Map_Ver[i] &= (uint16)~(PDRO_Grid_Ver[pInst->PD_Thumb_Pass - 1] - 1);
 		}
+	#endif
+
+		row_buf = (unsigned long)(pInst->PD_Pixel_Map_Ver + pInst->PD_Resized_Height + map_end);
+	}
+	else
+		row_buf = (unsigned long)(pInst->PD_Up_Scanline + pInst->PD_Scanline_Size);
+
+	//Memory for Row Output
+#if defined(PNGDEC_MOD_MEM_ALIGN)
+	row_buf = ((row_buf + 3)>>2)<<2;
+#endif
+	pInst->PD_Row_Buf = (uint8 *)row_buf;
+
+#if defined(PNGDEC_OPT_RESIZE_AREA)
+	//PD_Row_Buf holds a whole source row, then the sums and the reciprocals of the boxes
+	if(pInst->PD_Area_On)
+	{
+		row_buf = (((row_buf + pInst->PD_Global_Width * IM_ROW_PIXEL_SIZE) + 3)>>2)<<2;
+		pInst->PD_Area_Acc = (uint32 *)row_buf;
+		pInst->PD_Area_Rcp = pInst->PD_Area_Acc + pInst->PD_Resized_Width * 4;
+
+		PNGD_MEMSET(pInst->PD_Area_Acc, 0, pInst->PD_Resized_Width * 4 * sizeof(uint32));
+		for(i = 0;i < pInst->PD_Resized_Width;i++)
+			pInst->PD_Area_Rcp[i] = (1 << 24) / (pInst->PD_Pixel_Map_Hor[i + 1] - pInst->PD_Pixel_Map_Hor[i]);
 	}
+#endif
 
-	if(PD_Interlace_Method == PD_INTERLACE_ADAM)
-		PNG_Init_ADAM7_Map(PD_Current_Pass + 1);
+	if(pInst->PD_Interlace_Method == PD_INTERLACE_ADAM)
+		PNG_Init_ADAM7_Map(pInst, pInst->PD_Current_Pass + 1);
 }
 
-//////////////////////
-//Error Resilience Related
-//////////////////////
-static int PNG_Check_CRC(void)
+//Output rows and columns of the crop rectangle (every one without CROP_IMAGE), after PNG_Init_Heap().
+//PD_Left_Offset and PD_Top_Offset become the position of the top-left corner of the rectangle.
+static int PNG_Init_Crop(PD_INSTANCE *pInst)
 {
-	_read_byte();
-	_read_byte();
-	_read_byte();
-	_read_byte();
+	uint32 left, top, right, bottom;
+
+	pInst->PD_Crop_Left = 0;
+	pInst->PD_Crop_Right = pInst->PD_Resized_Width;
+	pInst->PD_Crop_Top = 0;
+	pInst->PD_Crop_Bottom = 0xFFFFFFFF;		//the rows after the image are not looked for
+
+	if(!pInst->PD_Out_Struct.CROP_IMAGE)
+		return PD_PROCESS_DONE;
 
-	if( PD_nPngDecErrorCode < 0 ) {
+	left = pInst->PD_Out_Struct.CROP_X;
+	top = pInst->PD_Out_Struct.CROP_Y;
+	if(pInst->PD_Interlace_Method == PD_INTERLACE_ADAM ||
+		left >= pInst->PD_Global_Width || top >= pInst->PD_Global_Height ||
+		pInst->PD_Out_Struct.CROP_WIDTH == 0 || pInst->PD_Out_Struct.CROP_HEIGHT == 0)
 		return PD_PROCESS_ERROR;
+
+	right = (pInst->PD_Out_Struct.CROP_WIDTH < pInst->PD_Global_Width - left) ?
+			left + pInst->PD_Out_Struct.CROP_WIDTH : pInst->PD_Global_Width;
+	bottom = (pInst->PD_Out_Struct.CROP_HEIGHT < pInst->PD_Global_Height - top) ?
+			top + pInst->PD_Out_Struct.CROP_HEIGHT : pInst->PD_Global_Height;
+
+	if(pInst->PD_Image_Smaller_LCD != PD_TRUE)
+	{
+		//output pixels whose sample is in the rectangle
+		pInst->PD_Crop_Left = 0;
+		while(pInst->PD_Crop_Left < pInst->PD_Resized_Width && pInst->PD_Pixel_Map_Hor[pInst->PD_Crop_Left] < left)
+			pInst->PD_Crop_Left++;
+		pInst->PD_Crop_Right = pInst->PD_Crop_Left;
+		while(pInst->PD_Crop_Right < pInst->PD_Resized_Width && pInst->PD_Pixel_Map_Hor[pInst->PD_Crop_Right] < right)
+			pInst->PD_Crop_Right++;
+
+		pInst->PD_Crop_Top = 0;
+		while(pInst->PD_Crop_Top < pInst->PD_Resized_Height && pInst->PD_Pixel_Map_Ver[pInst->PD_Crop_Top] < top)
+			pInst->PD_Crop_Top++;
+		pInst->PD_Crop_Bottom = pInst->PD_Crop_Top;
+		while(pInst->PD_Crop_Bottom < pInst->PD_Resized_Height && pInst->PD_Pixel_Map_Ver[pInst->PD_Crop_Bottom] < bottom)
+			pInst->PD_Crop_Bottom++;
+
+		pInst->PD_Resize_Ver_Idx = pInst->PD_Crop_Top;
+	}
+	else
+	{
+		pInst->PD_Crop_Left = left;
+		pInst->PD_Crop_Right = right;
+		pInst->PD_Crop_Top = top;
+		pInst->PD_Crop_Bottom = bottom;
 	}
 
+	if(!pInst->PD_Out_Struct.MODIFY_IMAGE_POS)
+	{
+		pInst->PD_Left_Offset += pInst->PD_Crop_Left;
+		pInst->PD_Top_Offset += pInst->PD_Crop_Top;
+	}
 	return PD_PROCESS_DONE;
 }
 
-
-static int PNG_Skip_Current_Chunk(void)
+//////////////////////
+//Error Resilience Related
+//////////////////////
+#if defined(PNGDEC_STABILITY_CHECK_CRC)
+//Slicing-by-8 : 8 bytes per step with 8 table lookups
+static uint32 PNG_Crc32_C(uint32 crc, const uint8 *buf, uint32 len)
 {
-	unsigned int i;
-
-	while(PD_Chunk_Size >= 512)
+	while(len >= 8)
 	{
-		for(i = 0;i < (512 >> 2);i++)	
-		{
-			_read_byte();
-			_read_byte();
-			_read_byte();
-			_read_byte();
+		uint32 lo = crc ^ PD_LOAD_LE32(buf);
+		uint32 hi = PD_LOAD_LE32(buf + 4);
+
+		crc = PDRO_Crc32_Table[7][lo & 0xFF] ^ PDRO_Crc32_Table[6][(lo >> 8) & 0xFF]
+			^ PDRO_Crc32_Table[5][(lo >> 16) & 0xFF] ^ PDRO_Crc32_Table[4][lo >> 24]
+			^ PDRO_Crc32_Table[3][hi & 0xFF] ^ PDRO_Crc32_Table[2][(hi >> 8) & 0xFF]
+			^ PDRO_Crc32_Table[1][(hi >> 16) & 0xFF] ^ PDRO_Crc32_Table[0][hi >> 24];
+		buf += 8;
+		len -= 8;
+	}
+	while(len--)
+		crc = PDRO_Crc32_Table[0][(crc ^ *buf++) & 0xFF] ^ (crc >> 8);
 
-		#if defined(PNGDEC_CHECK_EOF)
-			if( PD_nPngDecErrorCode < 0 ) {
-				return PD_PROCESS_ERROR;
-			}
-		#endif
-		}
-			
-		PD_Chunk_Size -= 512;
+	return crc;
+}
+
+#if defined(PD_CRC_PCLMUL)
+//Carry-less multiply folding (Intel, "Fast CRC Computation Using PCLMULQDQ"), bit-reflected :
+//4 x 128 bits per step, folded down to 128 bits, then to 64 bits and Barrett reduced to 32 bits.
+//Short buffers and the tail (< 16 bytes) go to the slicing-by-8 kernel.
+static PD_PCLMUL_TARGET uint32 PNG_Crc32_PCLMUL(uint32 crc, const uint8 *buf, uint32 len)
+{
+	__m128i x0, x1, x2, x3, x4, x5, x6, x7, x8, mask32;
+	uint32 tail;
+
+	if(len < 64)
+		return PNG_Crc32_C(crc, buf, len);
+	tail = len & 15;
+	len -= tail;
+
+	x1 = _mm_loadu_si128((const __m128i *)(buf + 0x00));
+	x2 = _mm_loadu_si128((const __m128i *)(buf + 0x10));
+	x3 = _mm_loadu_si128((const __m128i *)(buf + 0x20));
+	x4 = _mm_loadu_si128((const __m128i *)(buf + 0x30));
+	x1 = _mm_xor_si128(x1, _mm_cvtsi32_si128((int)crc));
+	x0 = _mm_set_epi32(0x00000001, 0xC6E41596, 0x00000001, 0x54442BD4);	//k1, k2 : fold by 4 x 128 bits
+	buf += 64;
+	len -= 64;
+
+	while(len >= 64)
+	{
+		x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+		x6 = _mm_clmulepi64_si128(x2, x0, 0x00);
+		x7 = _mm_clmulepi64_si128(x3, x0, 0x00);
+		x8 = _mm_clmulepi64_si128(x4, x0, 0x00);
+		x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+		x2 = _mm_clmulepi64_si128(x2, x0, 0x11);
+		x3 = _mm_clmulepi64_si128(x3, x0, 0x11);
+		x4 = _mm_clmulepi64_si128(x4, x0, 0x11);
+		x1 = _mm_xor_si128(_mm_xor_si128(x1, x5), _mm_loadu_si128((const __m128i *)(buf + 0x00)));
+		x2 = _mm_xor_si128(_mm_xor_si128(x2, x6), _mm_loadu_si128((const __m128i *)(buf + 0x10)));
+		x3 = _mm_xor_si128(_mm_xor_si128(x3, x7), _mm_loadu_si128((const __m128i *)(buf + 0x20)));
+		x4 = _mm_xor_si128(_mm_xor_si128(x4, x8), _mm_loadu_si128((const __m128i *)(buf + 0x30)));
+		buf += 64;
+		len -= 64;
 	}
-	for(i=0;i<PD_Chunk_Size;i++) {
-		_read_byte();
-		#if defined(PNGDEC_CHECK_EOF)
-			if( PD_nPngDecErrorCode < 0 ) {
-				return PD_PROCESS_ERROR;
-			}
-		#endif
+
+	//fold 4 x 128 bits into 128 bits
+	x0 = _mm_set_epi32(0x00000000, 0xCCAA009E, 0x00000001, 0x751997D0);	//k3, k4 : fold by 128 bits
+	x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+	x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+	x1 = _mm_xor_si128(_mm_xor_si128(x1, x2), x5);
+	x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+	x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+	x1 = _mm_xor_si128(_mm_xor_si128(x1, x3), x5);
+	x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+	x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+	x1 = _mm_xor_si128(_mm_xor_si128(x1, x4), x5);
+
+	while(len >= 16)
+	{
+		x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+		x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+		x1 = _mm_xor_si128(_mm_xor_si128(x1, _mm_loadu_si128((const __m128i *)buf)), x5);
+		buf += 16;
+		len -= 16;
 	}
 
-	return PNG_Check_CRC();
+	//128 bits to 64 bits
+	mask32 = _mm_setr_epi32(-1, 0, -1, 0);
+	x2 = _mm_clmulepi64_si128(x1, x0, 0x10);
+	x1 = _mm_xor_si128(_mm_srli_si128(x1, 8), x2);
+	x0 = _mm_set_epi32(0x00000000, 0x00000000, 0x00000001, 0x63CD6124);	//k5 : 64 bits to 32 bits
+	x2 = _mm_srli_si128(x1, 4);
+	x1 = _mm_clmulepi64_si128(_mm_and_si128(x1, mask32), x0, 0x00);
+	x1 = _mm_xor_si128(x1, x2);
+
+	//Barrett reduction to 32 bits
+	x0 = _mm_set_epi32(0x00000001, 0xF7011641, 0x00000001, 0xDB710641);	//P(x), floor(x^64 / P(x))
+	x2 = _mm_clmulepi64_si128(_mm_and_si128(x1, mask32), x0, 0x10);
+	x2 = _mm_clmulepi64_si128(_mm_and_si128(x2, mask32), x0, 0x00);
+	x1 = _mm_xor_si128(x1, x2);
+	crc = (uint32)_mm_cvtsi128_si32(_mm_srli_si128(x1, 4));
+
+	return PNG_Crc32_C(crc, buf, tail);
 }
+#endif //PD_CRC_PCLMUL
 
+#if defined(PD_CRC_ARMV8)
+static PD_ARMV8_CRC_TARGET uint32 PNG_Crc32_ARMV8(uint32 crc, const uint8 *buf, uint32 len)
+{
+	while(len >= 8)
+	{
+		crc = __crc32d(crc, (uint64)PD_LOAD_LE32(buf) | ((uint64)PD_LOAD_LE32(buf + 4) << 32));
+		buf += 8;
+		len -= 8;
+	}
+	while(len--)
+		crc = __crc32b(crc, *buf++);
+
+	return crc;
+}
+#endif //PD_CRC_ARMV8
 
-static int PNG_Parse_tRNS_Chunk(void)
+//CRC-32 kernel for this CPU
+static Crc32_Func_Ptr PNG_Select_Crc32(void)
 {
-	unsigned int i;
-	for(i = 0;i < PD_Chunk_Size;i++)
-		READBYTE(PD_Plte[i].Alpha);
-	for(;i < 256;i++)
-		PD_Plte[i].Alpha = 255;
+#if defined(PD_CRC_PCLMUL)
+	if(PD_PCLMUL_CHECK())
+		return PNG_Crc32_PCLMUL;
+#elif defined(PD_CRC_ARMV8)
+	if(PD_ARMV8_CRC_CHECK())
+		return PNG_Crc32_ARMV8;
+#endif
+	return PNG_Crc32_C;
+}
+
 
-	PD_Alpha_Available = 1;
-	return PNG_Check_CRC();
+//The bytes are added in blocks (input buffer switch and PNG_Check_CRC), not one by one.
+static void PNG_Start_CRC(PD_INSTANCE *pInst)
+{
+	pInst->PD_Crc_Active = (pInst->PD_Crc_Mode != PD_CRC_OFF);
+	pInst->PD_Crc = 0xFFFFFFFF;
+	pInst->PD_Crc_Point = pInst->PD_Read_Point;
 }
+#endif //PNGDEC_STABILITY_CHECK_CRC
 
+#if defined(PNGDEC_STABILITY_CHECK_ADLER)
+#define		PD_ADLER_BASE			65521	//largest prime below 65536
+#define		PD_ADLER_NMAX			5552	//bytes that can be summed before the 32-bit sums overflow
+#define		PD_ADLER_BLOCK			32		//bytes per step of the vector kernels
 
-static int PNG_Search_IDAT_Chunk(unsigned int mode)
+static uint32 PNG_Adler32_C(uint32 adler, const uint8 *buf, uint32 len)
 {
-	int iteration = 50;
-	uint32 stream_out;
+	uint32 s1 = adler & 0xFFFF;
+	uint32 s2 = adler >> 16;
 
-	PD_Used_Byte = 0;
-	
-	while(iteration--)
+	while(len)
 	{
-		if(mode)
+		uint32 n = (len < PD_ADLER_NMAX) ? len : PD_ADLER_NMAX;
+
+		len -= n;
+		while(n >= 8)
 		{
-			if(PD_Valid_Bit >= 8)
+			s1 += buf[0]; s2 += s1;
+			s1 += buf[1]; s2 += s1;
+			s1 += buf[2]; s2 += s1;
+			s1 += buf[3]; s2 += s1;
+			s1 += buf[4]; s2 += s1;
+			s1 += buf[5]; s2 += s1;
+			s1 += buf[6]; s2 += s1;
+			s1 += buf[7]; s2 += s1;
+			buf += 8;
+			n -= 8;
+		}
+		while(n--)
+		{
+			s1 += *buf++;
+			s2 += s1;
+		}
+		s1 %= PD_ADLER_BASE;
+		s2 %= PD_ADLER_BASE;
+	}
+
+	return s1 | (s2 << 16);
+}
+
+//Vector kernels : per block of 32 bytes, s1 += sum(b[i]) and s2 += 32 * s1 + sum((32 - i) * b[i]).
+//The 32 * s1 terms are gathered in ps and added once per NMAX run. The tail goes to the C kernel.
+#if defined(PD_ADLER_SSSE3)
+static PD_SSSE3_TARGET uint32 PNG_Adler32_SSSE3(uint32 adler, const uint8 *buf, uint32 len)
+{
+	const __m128i tap1 = _mm_setr_epi8(32, 31, 30, 29, 28, 27, 26, 25, 24, 23, 22, 21, 20, 19, 18, 17);
+	const __m128i tap2 = _mm_setr_epi8(16, 15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1);
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i ones = _mm_set1_epi16(1);
+	uint32 s1 = adler & 0xFFFF;
+	uint32 s2 = adler >> 16;
+	uint32 blocks = len / PD_ADLER_BLOCK;
+
+	len -= blocks * PD_ADLER_BLOCK;
+	while(blocks)
+	{
+		uint32 n = PD_ADLER_NMAX / PD_ADLER_BLOCK;
+		__m128i v_ps, v_s1, v_s2;
+
+		if(n > blocks)
+			n = blocks;
+		blocks -= n;
+
+		v_ps = _mm_cvtsi32_si128((int)(s1 * n));
+		v_s2 = _mm_cvtsi32_si128((int)s2);
+		v_s1 = _mm_setzero_si128();
+		do
+		{
+			const __m128i bytes1 = _mm_loadu_si128((const __m128i *)buf);
+			const __m128i bytes2 = _mm_loadu_si128((const __m128i *)(buf + 16));
+
+			v_ps = _mm_add_epi32(v_ps, v_s1);
+			v_s1 = _mm_add_epi32(v_s1, _mm_sad_epu8(bytes1, zero));
+			v_s2 = _mm_add_epi32(v_s2, _mm_madd_epi16(_mm_maddubs_epi16(bytes1, tap1), ones));
+			v_s1 = _mm_add_epi32(v_s1, _mm_sad_epu8(bytes2, zero));
+			v_s2 = _mm_add_epi32(v_s2, _mm_madd_epi16(_mm_maddubs_epi16(bytes2, tap2), ones));
+			buf += PD_ADLER_BLOCK;
+		} while(--n);
+
+		v_s2 = _mm_add_epi32(v_s2, _mm_slli_epi32(v_ps, 5));
+		v_s1 = _mm_add_epi32(v_s1, _mm_shuffle_epi32(v_s1, _MM_SHUFFLE(2, 3, 0, 1)));
+		v_s1 = _mm_add_epi32(v_s1, _mm_shuffle_epi32(v_s1, _MM_SHUFFLE(1, 0, 3, 2)));
+		v_s2 = _mm_add_epi32(v_s2, _mm_shuffle_epi32(v_s2, _MM_SHUFFLE(2, 3, 0, 1)));
+		v_s2 = _mm_add_epi32(v_s2, _mm_shuffle_epi32(v_s2, _MM_SHUFFLE(1, 0, 3, 2)));
+		s1 = (s1 + (uint32)_mm_cvtsi128_si32(v_s1)) % PD_ADLER_BASE;
+		s2 = (uint32)_mm_cvtsi128_si32(v_s2) % PD_ADLER_BASE;
+	}
+
+	return PNG_Adler32_C(s1 | (s2 << 16), buf, len);
+}
+#endif //PD_ADLER_SSSE3
+
+#if defined(PD_ADLER_AVX2)
+static PD_AVX2_TARGET uint32 PNG_Adler32_AVX2(uint32 adler, const uint8 *buf, uint32 len)
+{
+	const __m256i tap = _mm256_setr_epi8(32, 31, 30, 29, 28, 27, 26, 25, 24, 23, 22, 21, 20, 19, 18, 17,
+										 16, 15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1);
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i ones = _mm256_set1_epi16(1);
+	uint32 s1 = adler & 0xFFFF;
+	uint32 s2 = adler >> 16;
+	uint32 blocks = len / PD_ADLER_BLOCK;
+
+	len -= blocks * PD_ADLER_BLOCK;
+	while(blocks)
+	{
+		uint32 n = PD_ADLER_NMAX / PD_ADLER_BLOCK;
+		__m256i v_ps, v_s1, v_s2;
+		__m128i sum1, sum2;
+
+		if(n > blocks)
+			n = blocks;
+		blocks -= n;
+
+		v_ps = _mm256_set_epi32(0, 0, 0, 0, 0, 0, 0, (int)(s1 * n));
+		v_s2 = _mm256_set_epi32(0, 0, 0, 0, 0, 0, 0, (int)s2);
+		v_s1 = _mm256_setzero_si256();
+		do
+		{
+			const __m256i bytes = _mm256_loadu_si256((const __m256i *)buf);
+
+			v_ps = _mm256_add_epi32(v_ps, v_s1);
+			v_s1 = _mm256_add_epi32(v_s1, _mm256_sad_epu8(bytes, zero));
+			v_s2 = _mm256_add_epi32(v_s2, _mm256_madd_epi16(_mm256_maddubs_epi16(bytes, tap), ones));
+			buf += PD_ADLER_BLOCK;
+		} while(--n);
+
+		v_s2 = _mm256_add_epi32(v_s2, _mm256_slli_epi32(v_ps, 5));
+		sum1 = _mm_add_epi32(_mm256_castsi256_si128(v_s1), _mm256_extracti128_si256(v_s1, 1));
+		sum2 = _mm_add_epi32(_mm256_castsi256_si128(v_s2), _mm256_extracti128_si256(v_s2, 1));
+		sum1 = _mm_add_epi32(sum1, _mm_shuffle_epi32(sum1, _MM_SHUFFLE(2, 3, 0, 1)));
+		sum1 = _mm_add_epi32(sum1, _mm_shuffle_epi32(sum1, _MM_SHUFFLE(1, 0, 3, 2)));
+		sum2 = _mm_add_epi32(sum2, _mm_shuffle_epi32(sum2, _MM_SHUFFLE(2, 3, 0, 1)));
+		sum2 = _mm_add_epi32(sum2, _mm_shuffle_epi32(sum2, _MM_SHUFFLE(1, 0, 3, 2)));
+		s1 = (s1 + (uint32)_mm_cvtsi128_si32(sum1)) % PD_ADLER_BASE;
+		s2 = (uint32)_mm_cvtsi128_si32(sum2) % PD_ADLER_BASE;
+	}
+
+	return PNG_Adler32_C(s1 | (s2 << 16), buf, len);
+}
+#endif //PD_ADLER_AVX2
+
+#if defined(PD_ADLER_NEON)
+static const uint16 PDRO_Adler_Tap[32] = {	32, 31, 30, 29, 28, 27, 26, 25, 24, 23, 22, 21, 20, 19, 18, 17,
+											16, 15, 14, 13, 12, 11, 10,  9,  8,  7,  6,  5,  4,  3,  2,  1 };
+
+//Column sums of the bytes are weighted by the taps once per NMAX run
+static uint32 PNG_Adler32_NEON(uint32 adler, const uint8 *buf, uint32 len)
+{
+	uint32 s1 = adler & 0xFFFF;
+	uint32 s2 = adler >> 16;
+	uint32 blocks = len / PD_ADLER_BLOCK;
+
+	len -= blocks * PD_ADLER_BLOCK;
+	while(blocks)
+	{
+		uint32 n = PD_ADLER_NMAX / PD_ADLER_BLOCK;
+		uint32x4_t v_s1 = vdupq_n_u32(0);
+		uint32x4_t v_ps = vdupq_n_u32(0);
+		uint16x8_t col1 = vdupq_n_u16(0);
+		uint16x8_t col2 = vdupq_n_u16(0);
+		uint16x8_t col3 = vdupq_n_u16(0);
+		uint16x8_t col4 = vdupq_n_u16(0);
+		uint32x2_t sum;
+
+		if(n > blocks)
+			n = blocks;
+		blocks -= n;
+
+		v_ps = vsetq_lane_u32(s1 * n, v_ps, 0);
+		do
+		{
+			const uint8x16_t bytes1 = vld1q_u8(buf);
+			const uint8x16_t bytes2 = vld1q_u8(buf + 16);
+
+			v_ps = vaddq_u32(v_ps, v_s1);
+			v_s1 = vpadalq_u16(v_s1, vpadalq_u8(vpaddlq_u8(bytes1), bytes2));
+			col1 = vaddw_u8(col1, vget_low_u8(bytes1));
+			col2 = vaddw_u8(col2, vget_high_u8(bytes1));
+			col3 = vaddw_u8(col3, vget_low_u8(bytes2));
+			col4 = vaddw_u8(col4, vget_high_u8(bytes2));
+			buf += PD_ADLER_BLOCK;
+		} while(--n);
+
+		v_ps = vshlq_n_u32(v_ps, 5);
+		v_ps = vmlal_u16(v_ps, vget_low_u16(col1), vld1_u16(PDRO_Adler_Tap + 0));
+		v_ps = vmlal_u16(v_ps, vget_high_u16(col1), vld1_u16(PDRO_Adler_Tap + 4));
+		v_ps = vmlal_u16(v_ps, vget_low_u16(col2), vld1_u16(PDRO_Adler_Tap + 8));
+		v_ps = vmlal_u16(v_ps, vget_high_u16(col2), vld1_u16(PDRO_Adler_Tap + 12));
+		v_ps = vmlal_u16(v_ps, vget_low_u16(col3), vld1_u16(PDRO_Adler_Tap + 16));
+		v_ps = vmlal_u16(v_ps, vget_high_u16(col3), vld1_u16(PDRO_Adler_Tap + 20));
+		v_ps = vmlal_u16(v_ps, vget_low_u16(col4), vld1_u16(PDRO_Adler_Tap + 24));
+		v_ps = vmlal_u16(v_ps, vget_high_u16(col4), vld1_u16(PDRO_Adler_Tap + 28));
+
+		sum = vpadd_u32(vpadd_u32(vget_low_u32(v_s1), vget_high_u32(v_s1)),
+						vpadd_u32(vget_low_u32(v_ps), vget_high_u32(v_ps)));
+		s1 = (s1 + vget_lane_u32(sum, 0)) % PD_ADLER_BASE;
+		s2 = (s2 + vget_lane_u32(sum, 1)) % PD_ADLER_BASE;
+	}
+
+	return PNG_Adler32_C(s1 | (s2 << 16), buf, len);
+}
+#endif //PD_ADLER_NEON
+
+//Adler-32 kernel for this CPU
+static Adler32_Func_Ptr PNG_Select_Adler32(void)
+{
+#if defined(PD_ADLER_AVX2)
+	if(PD_AVX2_CHECK())
+		return PNG_Adler32_AVX2;
+#endif
+#if defined(PD_ADLER_SSSE3)
+	if(PD_SSSE3_CHECK())
+		return PNG_Adler32_SSSE3;
+#endif
+#if defined(PD_ADLER_NEON)
+	return PNG_Adler32_NEON;
+#else
+	return PNG_Adler32_C;
+#endif
+}
+#endif //PNGDEC_STABILITY_CHECK_ADLER
+
+//Read the CRC at the end of a chunk (the chunk data is read up to here)
+static int PNG_Check_CRC(PD_INSTANCE *pInst)
+{
+#if defined(PNGDEC_STABILITY_CHECK_CRC)
+	uint32 crc;
+
+	if(pInst->PD_Crc_Active)
+	{
+		pInst->PD_Crc_Active = 0;
+		pInst->PD_Crc = ~pInst->PD_Crc32(pInst->PD_Crc, pInst->PD_FileBuf_Ptr + pInst->PD_Crc_Point, pInst->PD_Read_Point - pInst->PD_Crc_Point);
+
+		crc = _read_byte(pInst);
+		crc = (crc << 8) | _read_byte(pInst);
+		crc = (crc << 8) | _read_byte(pInst);
+		crc = (crc << 8) | _read_byte(pInst);
+
+		if( pInst->PD_nPngDecErrorCode < 0 ) {
+			return PD_PROCESS_ERROR;
+		}
+
+		if(crc != pInst->PD_Crc)
+		{
+			if(pInst->PD_Crc_Mode == PD_CRC_DEFER)
+			{
+				pInst->PD_Crc_Error = 1;
+			}
+			else
+			{
+				pInst->PD_nPngDecErrorCode = TC_PNGDEC_ERR_CHUNK_CRC;
+				return PD_PROCESS_ERROR;
+			}
+		}
+		return PD_PROCESS_DONE;
+	}
+#endif
+
+	_read_byte(pInst);
+	_read_byte(pInst);
+	_read_byte(pInst);
+	_read_byte(pInst);
+
+	if( pInst->PD_nPngDecErrorCode < 0 ) {
+		return PD_PROCESS_ERROR;
+	}
+
+	return PD_PROCESS_DONE;
+}
+
+
+#if defined(PNGDEC_OPT_CHUNK_SEEK)
+//Record the chunk whose length and type were just read
+static void PNG_Index_Chunk(PD_INSTANCE *pInst, uint32 type)
+{
+	PD_CHUNK_INFO *pInfo;
+
+	if(pInst->PD_Chunk_Num >= PD_CHUNK_INDEX_NUM)
+		return;
+
+	pInfo = &pInst->PD_Chunk_Index[pInst->PD_Chunk_Num++];
+	pInfo->type = type;
+	pInfo->offset = PNG_Input_Offset(pInst) - 8;
+	pInfo->length = pInst->PD_Chunk_Size;
+}
+#endif
+
+static int PNG_Skip_Current_Chunk(PD_INSTANCE *pInst)
+{
+	uint32 size;
+	uint32 avail;
+
+	if(pInst->PD_Src_Buf)
+	{
+		//memory input : skip in place
+		if(pInst->PD_Chunk_Size > (uint32)(pInst->PD_Read_Point_End - pInst->PD_Read_Point))
+		{
+			pInst->PD_nPngDecErrorCode = TC_PNGDEC_ERR_STREAM_READING;
+			return PD_PROCESS_ERROR;
+		}
+		pInst->PD_Read_Point += pInst->PD_Chunk_Size;
+		return PNG_Check_CRC(pInst);
+	}
+
+	size = pInst->PD_Chunk_Size;
+
+#if defined(PNGDEC_OPT_CHUNK_SEEK)
+	//the chunk goes on past the buffered input : seek to its CRC and fill the buffer from there
+	if( (pInst->PD_callbacks.seek_func != NULL)
+		&& (size > pInst->PD_Read_Point_Max - (uint32)pInst->PD_Read_Point)
+	#if defined(PNGDEC_STABILITY_CHECK_CRC)
+		&& !(pInst->PD_Crc_Active && (pInst->PD_Crc_Mode == PD_CRC_ON))
+	#endif
+		)
+	{
+		size -= pInst->PD_Read_Point_Max - (uint32)pInst->PD_Read_Point;
+		if( (size > pInst->PD_TotFileSize - pInst->PD_ReadFileBytes)
+			|| ((pInst->PD_callbacks.seek_func)(pInst->PD_Datasource, (long)size) != 0) )
+		{
+			pInst->PD_nPngDecErrorCode = TC_PNGDEC_ERR_STREAM_READING;
+			return PD_PROCESS_ERROR;
+		}
+		pInst->PD_ReadFileBytes += size;
+		PD_STATS_ADD(seek_calls, 1);
+		PD_STATS_ADD(seek_bytes, size);
+		PNG_Fill_Input(pInst);
+	#if defined(PNGDEC_STABILITY_CHECK_CRC)
+		pInst->PD_Crc_Active = 0;
+	#endif
+		return PNG_Check_CRC(pInst);
+	}
+#endif
+
+	//move through the input buffer, which is refilled (and added to the CRC) by _read_byte
+	while(size)
+	{
+		if(pInst->PD_Read_Point == pInst->PD_Read_Point_End)
+		{
+			_read_byte(pInst);
+			if( pInst->PD_nPngDecErrorCode < 0 ) {
+				return PD_PROCESS_ERROR;
+			}
+			size--;
+			continue;
+		}
+
+		avail = (uint32)(pInst->PD_Read_Point_End - pInst->PD_Read_Point);
+		if(avail > size)
+			avail = size;
+		pInst->PD_Read_Point += avail;
+		size -= avail;
+
+	#if defined(PNGDEC_CHECK_EOF_2)
+		if( (uint32)pInst->PD_Read_Point > pInst->PD_Read_Point_Max )
+		{
+			pInst->PD_nPngDecErrorCode = TC_PNGDEC_ERR_STREAM_READING;
+			return PD_PROCESS_ERROR;
+		}
+	#endif
+	}
+
+	return PNG_Check_CRC(pInst);
+}
+
+
+static int PNG_Parse_tRNS_Chunk(PD_INSTANCE *pInst)
+{
+	unsigned int i;
+	for(i = 0;i < pInst->PD_Chunk_Size;i++)
+		READBYTE(pInst->PD_Plte[i].Alpha);
+	for(;i < 256;i++)
+		pInst->PD_Plte[i].Alpha = 255;
+
+	pInst->PD_Alpha_Available = 1;
+	return PNG_Check_CRC(pInst);
+}
+
+
+static int PNG_Search_IDAT_Chunk(PD_INSTANCE *pInst, unsigned int mode)
+{
+	int iteration = PD_CHUNK_SEARCH_NUM;
+	uint32 stream_out;
+
+	pInst->PD_Used_Byte = 0;
+	
+	while(iteration--)
+	{
+		if(mode)
+		{
+			if(pInst->PD_Valid_Bit >= 8)
 			{
-				PD_Used_Byte--;
-				PD_Valid_Bit -= 8;
-				PD_Chunk_Size = (PD_2nd_Strm & (0xFF << PD_Valid_Bit)) >> PD_Valid_Bit;
-				PD_2nd_Strm = PD_2nd_Strm & PDRO_Bit_Mask[PD_Valid_Bit];
+				pInst->PD_Used_Byte--;
+				pInst->PD_Valid_Bit -= 8;
+				pInst->PD_Chunk_Size = (pInst->PD_2nd_Strm & (0xFF << pInst->PD_Valid_Bit)) >> pInst->PD_Valid_Bit;
+				pInst->PD_2nd_Strm = pInst->PD_2nd_Strm & PDRO_Bit_Mask[pInst->PD_Valid_Bit];
 			}else
 			{
-				PD_Chunk_Size = _read_byte();
+				pInst->PD_Chunk_Size = _read_byte(pInst);
 			}
 			
-			if(PD_Valid_Bit >= 8)
+			if(pInst->PD_Valid_Bit >= 8)
 			{
-				PD_Used_Byte--;
-				PD_Valid_Bit -= 8;
-				PD_Chunk_Size = (PD_Chunk_Size << 8) | ((PD_2nd_Strm & (0xFF << PD_Valid_Bit)) >> PD_Valid_Bit);
-				PD_2nd_Strm = PD_2nd_Strm & PDRO_Bit_Mask[PD_Valid_Bit];
+				pInst->PD_Used_Byte--;
+				pInst->PD_Valid_Bit -= 8;
+				pInst->PD_Chunk_Size = (pInst->PD_Chunk_Size << 8) | ((pInst->PD_2nd_Strm & (0xFF << pInst->PD_Valid_Bit)) >> pInst->PD_Valid_Bit);
+				pInst->PD_2nd_Strm = pInst->PD_2nd_Strm & PDRO_Bit_Mask[pInst->PD_Valid_Bit];
 			}else
 			{
-				PD_Chunk_Size = (PD_Chunk_Size << 8) | _read_byte();
+				pInst->PD_Chunk_Size = (pInst->PD_Chunk_Size << 8) | _read_byte(pInst);
 			}
 			
-			if(PD_Valid_Bit >= 8)
+			if(pInst->PD_Valid_Bit >= 8)
 			{
-				PD_Used_Byte--;
-				PD_Valid_Bit -= 8;
-				PD_Chunk_Size = (PD_Chunk_Size << 8) | ((PD_2nd_Strm & (0xFF << PD_Valid_Bit)) >> PD_Valid_Bit);
-				PD_2nd_Strm = PD_2nd_Strm & PDRO_Bit_Mask[PD_Valid_Bit];
+				pInst->PD_Used_Byte--;
+				pInst->PD_Valid_Bit -= 8;
+				pInst->PD_Chunk_Size = (pInst->PD_Chunk_Size << 8) | ((pInst->PD_2nd_Strm & (0xFF << pInst->PD_Valid_Bit)) >> pInst->PD_Valid_Bit);
+				pInst->PD_2nd_Strm = pInst->PD_2nd_Strm & PDRO_Bit_Mask[pInst->PD_Valid_Bit];
 			}else
 			{
-				PD_Chunk_Size = (PD_Chunk_Size << 8) | _read_byte();
+				pInst->PD_Chunk_Size = (pInst->PD_Chunk_Size << 8) | _read_byte(pInst);
 			}
 			
-			if(PD_Valid_Bit >= 8)
+			if(pInst->PD_Valid_Bit >= 8)
 			{
-				PD_Used_Byte--;
-				PD_Valid_Bit -= 8;
-				PD_Chunk_Size = (PD_Chunk_Size << 8) | ((PD_2nd_Strm & (0xFF << PD_Valid_Bit)) >> PD_Valid_Bit);
-				PD_2nd_Strm = PD_2nd_Strm & PDRO_Bit_Mask[PD_Valid_Bit];
+				pInst->PD_Used_Byte--;
+				pInst->PD_Valid_Bit -= 8;
+				pInst->PD_Chunk_Size = (pInst->PD_Chunk_Size << 8) | ((pInst->PD_2nd_Strm & (0xFF << pInst->PD_Valid_Bit)) >> pInst->PD_Valid_Bit);
+				pInst->PD_2nd_Strm = pInst->PD_2nd_Strm & PDRO_Bit_Mask[pInst->PD_Valid_Bit];
 			}else
 			{
-				PD_Chunk_Size = (PD_Chunk_Size << 8) | _read_byte();
+				pInst->PD_Chunk_Size = (pInst->PD_Chunk_Size << 8) | _read_byte(pInst);
 			}
 		}
 		else
 		{
-			PD_Chunk_Size = _read_byte();
-			PD_Chunk_Size = (PD_Chunk_Size << 8) | _read_byte();
-			PD_Chunk_Size = (PD_Chunk_Size << 8) | _read_byte();
-			PD_Chunk_Size = (PD_Chunk_Size << 8) | _read_byte();
+			pInst->PD_Chunk_Size = _read_byte(pInst);
+			pInst->PD_Chunk_Size = (pInst->PD_Chunk_Size << 8) | _read_byte(pInst);
+			pInst->PD_Chunk_Size = (pInst->PD_Chunk_Size << 8) | _read_byte(pInst);
+			pInst->PD_Chunk_Size = (pInst->PD_Chunk_Size << 8) | _read_byte(pInst);
 		}
 
-		stream_out = _read_byte();
-		stream_out = (stream_out << 8) | _read_byte();
-		stream_out = (stream_out << 8) | _read_byte();
-		stream_out = (stream_out << 8) | _read_byte();
+	#if defined(PNGDEC_STABILITY_CHECK_CRC)
+		PNG_Start_CRC(pInst);
+	#endif
+		stream_out = _read_byte(pInst);
+		stream_out = (stream_out << 8) | _read_byte(pInst);
+		stream_out = (stream_out << 8) | _read_byte(pInst);
+		stream_out = (stream_out << 8) | _read_byte(pInst);
 
-		if( PD_nPngDecErrorCode < 0 ) {
+		if( pInst->PD_nPngDecErrorCode < 0 ) {
 			return PD_PROCESS_ERROR;
 		}
+	#if defined(PNGDEC_OPT_CHUNK_SEEK)
+		PNG_Index_Chunk(pInst, stream_out);
+	#endif
 		
 		switch(stream_out)
 		{
 		case PD_MARKER_cHRM:
 			#if defined(PNGDEC_CHECK_CHUNK)
-				PD_nPngDecCheck_Chunk |= ( 1 << PNGDEC_CHUNK_CHRM);
-				PNG_Skip_Current_Chunk();
+				pInst->PD_nPngDecCheck_Chunk |= ( 1 << PNGDEC_CHUNK_CHRM);
+				PNG_Skip_Current_Chunk(pInst);
 				break;
 			#endif
 		case PD_MARKER_gAMA:
 			#if defined(PNGDEC_CHECK_CHUNK)
-				PD_nPngDecCheck_Chunk |= ( 1 << PNGDEC_CHUNK_GAMA );
-				PNG_Skip_Current_Chunk();
+				pInst->PD_nPngDecCheck_Chunk |= ( 1 << PNGDEC_CHUNK_GAMA );
+				PNG_Skip_Current_Chunk(pInst);
 				break;
 			#endif
 		case PD_MARKER_iCCP:
 			#if defined(PNGDEC_CHECK_CHUNK)
-				PD_nPngDecCheck_Chunk |= ( 1 << PNGDEC_CHUNK_ICCP );
-				PNG_Skip_Current_Chunk();
+				pInst->PD_nPngDecCheck_Chunk |= ( 1 << PNGDEC_CHUNK_ICCP );
+				PNG_Skip_Current_Chunk(pInst);
 				break;
 			#endif
 		case PD_MARKER_sBIT:
 			#if defined(PNGDEC_CHECK_CHUNK)
-				PD_nPngDecCheck_Chunk |= ( 1 << PNGDEC_CHUNK_SBIT );
-				PNG_Skip_Current_Chunk();
+				pInst->PD_nPngDecCheck_Chunk |= ( 1 << PNGDEC_CHUNK_SBIT );
+				PNG_Skip_Current_Chunk(pInst);
 				break;
 			#endif
 		case PD_MARKER_sRGB:
 			#if defined(PNGDEC_CHECK_CHUNK)
-				PD_nPngDecCheck_Chunk |= ( 1 << PNGDEC_CHUNK_SRBG );
-				PNG_Skip_Current_Chunk();
+				pInst->PD_nPngDecCheck_Chunk |= ( 1 << PNGDEC_CHUNK_SRBG );
+				PNG_Skip_Current_Chunk(pInst);
 				break;
 			#endif
 		case PD_MARKER_iTXt:
 			#if defined(PNGDEC_CHECK_CHUNK)
-				PD_nPngDecCheck_Chunk |= ( 1 << PNGDEC_CHUNK_ITXT );
-				PNG_Skip_Current_Chunk();
+				pInst->PD_nPngDecCheck_Chunk |= ( 1 << PNGDEC_CHUNK_ITXT );
+				PNG_Skip_Current_Chunk(pInst);
 				break;
 			#endif
 		case PD_MARKER_tEXt:
 			#if defined(PNGDEC_CHECK_CHUNK)
-				PD_nPngDecCheck_Chunk |= ( 1 << PNGDEC_CHUNK_TEXT );
-				PNG_Skip_Current_Chunk();
+				pInst->PD_nPngDecCheck_Chunk |= ( 1 << PNGDEC_CHUNK_TEXT );
+				PNG_Skip_Current_Chunk(pInst);
 				break;
 			#endif
 		case PD_MARKER_zTXt:
 			#if defined(PNGDEC_CHECK_CHUNK)
-				PD_nPngDecCheck_Chunk |= ( 1 << PNGDEC_CHUNK_ZTXT );
-				PNG_Skip_Current_Chunk();
+				pInst->PD_nPngDecCheck_Chunk |= ( 1 << PNGDEC_CHUNK_ZTXT );
+				PNG_Skip_Current_Chunk(pInst);
 				break;
 			#endif
 		case PD_MARKER_bKGD:
 			#if defined(PNGDEC_CHECK_CHUNK)
-				PD_nPngDecCheck_Chunk |= ( 1 << PNGDEC_CHUNK_BKGD );
-				PNG_Skip_Current_Chunk();
+				pInst->PD_nPngDecCheck_Chunk |= ( 1 << PNGDEC_CHUNK_BKGD );
+				PNG_Skip_Current_Chunk(pInst);
 				break;
 			#endif
 		case PD_MARKER_hIST:
 			#if defined(PNGDEC_CHECK_CHUNK)
-				PD_nPngDecCheck_Chunk |= ( 1 << PNGDEC_CHUNK_HIST );
-				PNG_Skip_Current_Chunk();
+				pInst->PD_nPngDecCheck_Chunk |= ( 1 << PNGDEC_CHUNK_HIST );
+				PNG_Skip_Current_Chunk(pInst);
 				break;
 			#endif
 		case PD_MARKER_pHYs:
 			#if defined(PNGDEC_CHECK_CHUNK)
-				PD_nPngDecCheck_Chunk |= ( 1 << PNGDEC_CHUNK_PHYS );
-				PNG_Skip_Current_Chunk();
+				pInst->PD_nPngDecCheck_Chunk |= ( 1 << PNGDEC_CHUNK_PHYS );
+				PNG_Skip_Current_Chunk(pInst);
 				break;
 			#endif
 		case PD_MARKER_sPLT:
 			#if defined(PNGDEC_CHECK_CHUNK)
-				PD_nPngDecCheck_Chunk |= ( 1 << PNGDEC_CHUNK_SPLT );
-				PNG_Skip_Current_Chunk();
+				pInst->PD_nPngDecCheck_Chunk |= ( 1 << PNGDEC_CHUNK_SPLT );
+				PNG_Skip_Current_Chunk(pInst);
 				break;
 			#endif
 		case PD_MARKER_tIME:
 			#if defined(PNGDEC_CHECK_CHUNK)
-				PD_nPngDecCheck_Chunk |= ( 1 << PNGDEC_CHUNK_TIME );
-				PNG_Skip_Current_Chunk();
+				pInst->PD_nPngDecCheck_Chunk |= ( 1 << PNGDEC_CHUNK_TIME );
+				PNG_Skip_Current_Chunk(pInst);
 				break;
 			#endif
 	#if defined(PNGDEC_ADD_ANCILLARY_CHUNK_EXT120130)
 		case PD_MARKER_fRAc:
 			#if defined(PNGDEC_CHECK_CHUNK)
-				PD_nPngDecCheck_Chunk |= ( 1 << PNGDEC_CHUNK_FRAC );
-				PNG_Skip_Current_Chunk();
+				pInst->PD_nPngDecCheck_Chunk |= ( 1 << PNGDEC_CHUNK_FRAC );
+				PNG_Skip_Current_Chunk(pInst);
 				break;
 			#endif
 		case PD_MARKER_gIFg:
 			#if defined(PNGDEC_CHECK_CHUNK)
-				PD_nPngDecCheck_Chunk |= ( 1 << PNGDEC_CHUNK_GIFG );
-				PNG_Skip_Current_Chunk();
+				pInst->PD_nPngDecCheck_Chunk |= ( 1 << PNGDEC_CHUNK_GIFG );
+				PNG_Skip_Current_Chunk(pInst);
 				break;
 			#endif
 		case PD_MARKER_gIFt:
 			#if defined(PNGDEC_CHECK_CHUNK)
-				PD_nPngDecCheck_Chunk |= ( 1 << PNGDEC_CHUNK_GIFT );
-				PNG_Skip_Current_Chunk();
+				pInst->PD_nPngDecCheck_Chunk |= ( 1 << PNGDEC_CHUNK_GIFT );
+				PNG_Skip_Current_Chunk(pInst);
 				break;
 			#endif
 		case PD_MARKER_gIFx:
 			#if defined(PNGDEC_CHECK_CHUNK)
-				PD_nPngDecCheck_Chunk |= ( 1 << PNGDEC_CHUNK_GIFX );
-				PNG_Skip_Current_Chunk();
+				pInst->PD_nPngDecCheck_Chunk |= ( 1 << PNGDEC_CHUNK_GIFX );
+				PNG_Skip_Current_Chunk(pInst);
 				break;
 			#endif
 		case PD_MARKER_oFFs:
 			#if defined(PNGDEC_CHECK_CHUNK)
-				PD_nPngDecCheck_Chunk |= ( 1 << PNGDEC_CHUNK_OFFS );
-				PNG_Skip_Current_Chunk();
+				pInst->PD_nPngDecCheck_Chunk |= ( 1 << PNGDEC_CHUNK_OFFS );
+				PNG_Skip_Current_Chunk(pInst);
 				break;
 			#endif
 		case PD_MARKER_pCAL:
 			#if defined(PNGDEC_CHECK_CHUNK)
-				PD_nPngDecCheck_Chunk |= ( 1 << PNGDEC_CHUNK_PCAL );
-				PNG_Skip_Current_Chunk();
+				pInst->PD_nPngDecCheck_Chunk |= ( 1 << PNGDEC_CHUNK_PCAL );
+				PNG_Skip_Current_Chunk(pInst);
 				break;
 			#endif
 		case PD_MARKER_sCAL:
 			#if defined(PNGDEC_CHECK_CHUNK)
-				PD_nPngDecCheck_Chunk |= ( 1 << PNGDEC_CHUNK_SCAL );
-				PNG_Skip_Current_Chunk();
+				pInst->PD_nPngDecCheck_Chunk |= ( 1 << PNGDEC_CHUNK_SCAL );
+				PNG_Skip_Current_Chunk(pInst);
 				break;
 			#endif
 		case PD_MARKER_sTER:			
 			#if defined(PNGDEC_CHECK_CHUNK)
-				PD_nPngDecCheck_Chunk |= ( 1 << PNGDEC_CHUNK_STER );
-				PNG_Skip_Current_Chunk();
+				pInst->PD_nPngDecCheck_Chunk |= ( 1 << PNGDEC_CHUNK_STER );
+				PNG_Skip_Current_Chunk(pInst);
 				break;
 			#endif
 	#endif //defined(PNGDEC_ADD_ANCILLARY_CHUNK_EXT120130)
-			PNG_Skip_Current_Chunk();
+			PNG_Skip_Current_Chunk(pInst);
 			break;
 		case PD_MARKER_PLTE:
 			#if defined(PNGDEC_CHECK_CHUNK)
-				PD_nPngDecCheck_Chunk |= ( 1 << PNGDEC_CHUNK_PLTE );
+				pInst->PD_nPngDecCheck_Chunk |= ( 1 << PNGDEC_CHUNK_PLTE );
 			#endif
-			PNG_Skip_Current_Chunk();
+			PNG_Skip_Current_Chunk(pInst);
 			break;
 		case PD_MARKER_tRNS:
 			#if defined(PNGDEC_CHECK_CHUNK)
-				PD_nPngDecCheck_Chunk |= ( 1 << PNGDEC_CHUNK_TRNS );
+				pInst->PD_nPngDecCheck_Chunk |= ( 1 << PNGDEC_CHUNK_TRNS );
 			#endif
-			PNG_Parse_tRNS_Chunk();
+			PNG_Parse_tRNS_Chunk(pInst);
 			break;
 		case PD_MARKER_IHDR:
 			#if defined(PNGDEC_CHECK_CHUNK)
-				PD_nPngDecCheck_Chunk |= ( 1 << PNGDEC_CHUNK_IHDR );
+				pInst->PD_nPngDecCheck_Chunk |= ( 1 << PNGDEC_CHUNK_IHDR );
 			#endif
 			return PD_PROCESS_ERROR;
 		case PD_MARKER_IEND:
 			#if defined(PNGDEC_CHECK_CHUNK)
-				PD_nPngDecCheck_Chunk |= ( 1 << PNGDEC_CHUNK_IEND );
+				pInst->PD_nPngDecCheck_Chunk |= ( 1 << PNGDEC_CHUNK_IEND );
+			#endif
+			#if defined(PNGDEC_STABILITY_CHECK_CRC)
+				if(pInst->PD_Crc_Mode == PD_CRC_ON && PNG_Check_CRC(pInst) == PD_PROCESS_ERROR)
+					return PD_PROCESS_ERROR;
 			#endif
 			return PD_PROCESS_EOF;
 		case PD_MARKER_IDAT:
 			#if defined(PNGDEC_CHECK_CHUNK)
-				PD_nPngDecCheck_Chunk |= ( 1 << PNGDEC_CHUNK_IDAT );
+				pInst->PD_nPngDecCheck_Chunk |= ( 1 << PNGDEC_CHUNK_IDAT );
 			#endif
 			return PD_PROCESS_DONE;
 		default:
 		#if !defined(PNGDEC_STABILITY_READ_UNKNOWN_ANC_CHUNK_SKIP)
 			return PD_PROCESS_ERROR;
 		#else
-			PNG_Skip_Current_Chunk();
+			PNG_Skip_Current_Chunk(pInst);
 			break;
 		#endif
 		}
@@ -1226,43 +2620,117 @@ static int PNG_Search_IDAT_Chunk(unsigned int mode)
 }
 
 
+//Refill the bit buffer with IDAT data.
+//Fast path: the chunk and the current input half both hold a whole word, so
+//every byte that fits is loaded at once. Otherwise go byte by byte, which
+//handles the chunk boundary (CRC + next IDAT) and the input buffer switch.
+//The bit buffer never holds bytes beyond the current chunk data.
+static void PNG_Refill_Bits_IDAT(PD_INSTANCE *pInst, int bits)
+{
+	int32 read_point = pInst->PD_Read_Point;
+
+	if(pInst->PD_Chunk_Size - pInst->PD_Used_Byte >= (uint32)PD_BITBUF_BYTES
+		&& read_point + PD_BITBUF_BYTES <= pInst->PD_Read_Point_End
+	#if defined(PNGDEC_CHECK_EOF_2)
+		&& (uint32)(read_point + PD_BITBUF_BYTES) <= pInst->PD_Read_Point_Max
+	#endif
+	)
+	{
+		int bytes = (PD_BITBUF_BYTES * 8 - 1 - pInst->PD_Valid_Bit) >> 3;
+		PD_BITBUF word = PD_BITBUF_LOAD(pInst->PD_FileBuf_Ptr + read_point);
+
+		word &= ((PD_BITBUF)1 << (bytes << 3)) - 1;
+		pInst->PD_2nd_Strm |= word << pInst->PD_Valid_Bit;
+		pInst->PD_Valid_Bit += bytes << 3;
+		pInst->PD_Read_Point = read_point + bytes;
+		pInst->PD_Used_Byte += bytes;
+		return;
+	}
+
+	while(pInst->PD_Valid_Bit < bits)
+	{
+		if(pInst->PD_Used_Byte++ == pInst->PD_Chunk_Size)
+		{
+			PNG_Check_CRC(pInst);
+			PNG_Search_IDAT_Chunk(pInst, 0);
+			pInst->PD_Used_Byte++;
+		}
+		pInst->PD_2nd_Strm += (PD_BITBUF)_read_byte(pInst) << pInst->PD_Valid_Bit;
+		pInst->PD_Valid_Bit += 8;
+	}
+}
+
 #define NEEDBITS_IDAT(bits)						\
 {									\
-	while(PD_Valid_Bit < bits)						\
-	{								\
-		if(PD_Used_Byte++ == PD_Chunk_Size)			\
-		{							\
-			PNG_Check_CRC();				\
-			PNG_Search_IDAT_Chunk(0);			\
-			PD_Used_Byte++;				\
-		}							\
-		PD_2nd_Strm += _read_byte() << PD_Valid_Bit;		\
-		PD_Valid_Bit += 8;					\
-	}								\
+	if(pInst->PD_Valid_Bit < (bits))					\
+		PNG_Refill_Bits_IDAT(pInst, bits);			\
+}
+
+#if defined(PNGDEC_STABILITY_CHECK_ADLER)
+//Add the bytes filled into the ring queue since the last call to the Adler-32.
+//Called after every run of block decoding, while the bytes are still in the queue
+//(and in the cache) : the block decoder never fills more than the free part of the queue.
+static void PNG_Update_Adler32(PD_INSTANCE *pInst)
+{
+	uint32 pos = pInst->PD_Adler_Ptr & PD_RING_QUEUE_MASK;
+	uint32 len = pInst->PD_Ptr_Block_Dec - pInst->PD_Adler_Ptr;
+
+	if(pos + len > PD_DEFLATE_BUF_LEN)
+	{
+		pInst->PD_Adler = pInst->PD_Adler32(pInst->PD_Adler, pInst->PD_Deflate_Buf + pos, PD_DEFLATE_BUF_LEN - pos);
+		len -= PD_DEFLATE_BUF_LEN - pos;
+		pos = 0;
+	}
+	pInst->PD_Adler = pInst->PD_Adler32(pInst->PD_Adler, pInst->PD_Deflate_Buf + pos, len);
+	pInst->PD_Adler_Ptr = pInst->PD_Ptr_Block_Dec;
 }
+#endif
 
-static int PNG_Check_Adler32(void)
+static int PNG_Check_Adler32(PD_INSTANCE *pInst)
 {
-	int temp = PD_Valid_Bit & 7;
+	int temp = pInst->PD_Valid_Bit & 7;
+	uint32 adler = 0;
 
 	NEEDBITS_IDAT(temp);
 	DROPBITS(temp);
 	
-	NEEDBITS_IDAT(16);
-	DROPBITS(16);
-	
-	NEEDBITS_IDAT(16);
-	DROPBITS(16);
+	//big-endian
+	for(temp = 0;temp < 4;temp++)
+	{
+		NEEDBITS_IDAT(8);
+		adler = (adler << 8) | (uint32)(pInst->PD_2nd_Strm & 0xFF);
+		DROPBITS(8);
+	}
+
+	//the refill may run ahead of the zlib stream: drop the rest of the chunk
+	//so that the CRC is read from the right place
+	pInst->PD_2nd_Strm = 0;
+	pInst->PD_Valid_Bit = 0;
+	while(pInst->PD_Used_Byte < pInst->PD_Chunk_Size)
+	{
+		_read_byte(pInst);
+		pInst->PD_Used_Byte++;
+	}
+
+#if defined(PNGDEC_STABILITY_CHECK_ADLER)
+	if(pInst->PD_Adler_On && adler != pInst->PD_Adler)
+	{
+		pInst->PD_nPngDecErrorCode = TC_PNGDEC_ERR_ZLIB_ADLER;
+		return PD_PROCESS_ERROR;
+	}
+#else
+	(void)adler;
+#endif
 	
 	return PD_PROCESS_DONE;
 }
 
-static void * PNG_Malloc(uint32 size)
+static void * PNG_Malloc(PD_INSTANCE *pInst, uint32 size)
 {
-	uint32 ret = PD_Heap_Ptr;
-	PD_Heap_Ptr += size;
-	PD_Heap_Used_Size += size;
-	if(PD_Heap_Used_Size > PD_HASH_HEAP_SIZE)
+	unsigned long ret = pInst->PD_Heap_Ptr;
+	pInst->PD_Heap_Ptr += size;
+	pInst->PD_Heap_Used_Size += size;
+	if(pInst->PD_Heap_Used_Size > PD_HASH_HEAP_SIZE)
 	{
 		return (void *)NULL;
 	}
@@ -1273,231 +2741,179 @@ static void * PNG_Malloc(uint32 size)
 }
 
 
-static int PNG_BuildUp_HuffTable(uint16 * code_length, uint32 code_num, uint32 code_num_simple,
-					uint16 * val_non_simple, uint16 * bit_non_simple, huft ** vld,
-					int * lookup_bit)
+static uint32 PNG_Huff_Entry(uint32 table_type, uint32 symbol, uint32 bits)
 {
-	uint32	bit_leng_count, num_repeat;
-	uint32	i, j;
+	switch(table_type)
+	{
+	case PD_HUFF_TABLE_LITER:
+		if(symbol < 256)
+			return PD_HUFF_ENTRY(bits, 1, symbol);
+		if(symbol == 256)
+			return PD_HUFF_ENTRY(bits, PD_HUFF_TYPE_END, 0);
+		symbol -= 257;
+		if(PDRO_Liter_Ext[symbol] == 99)
+			return PD_HUFF_ENTRY(bits, PD_HUFF_TYPE_INVALID, 0);
+		return PD_HUFF_ENTRY(bits, PD_HUFF_TYPE_LENGTH, PDRO_Liter_Ext[symbol] | ((uint32)PDRO_Liter_Len[symbol] << 8));
+	case PD_HUFF_TABLE_DIST:
+		if(symbol >= 30)
+			return PD_HUFF_ENTRY(bits, PD_HUFF_TYPE_INVALID, 0);
+		return PD_HUFF_ENTRY(bits, PD_HUFF_TYPE_LENGTH, PDRO_Dist_Ext[symbol] | ((uint32)PDRO_Dist_Len[symbol] << 8));
+	default:
+		return PD_HUFF_ENTRY(bits, 1, symbol);
+	}
+}
 
+//Build up a packed Huffman table : a primary table indexed by table_bits of the
+//stream and, for longer codes, subtables right behind it in the heap.
+//Entries which no code reaches stay PD_HUFF_TYPE_INVALID.
+//Return : PD_PROCESS_ERROR(over-subscribed), PD_PROCESS_CONTINUE(incomplete) or PD_PROCESS_DONE
+static int PNG_BuildUp_HuffTable(PD_INSTANCE *pInst, uint16 * code_length, uint32 code_num, uint32 table_type,
+					int table_bits, const uint32 ** vld)
+{
 	uint16	bit_leng_count_tbl[PD_HUFF_BIT_MAX + 1];
 	uint16	bit_offsets[PD_HUFF_BIT_MAX + 1];
 	uint16	bit_order_val[PD_HUFF_CODE_MAX];
-	uint16	cur_num_entry;
-	
-	int	max_leng_code, level_tbl, cur_bit_num;
-	int	bits_per_tbl, prev_bits, num_dummy;
+	uint32	i, j, len, num_code;
+	uint32	code, rev, table_size;
+	uint32	sub_prefix, sub_bits, sub_used;
+	int		max_leng_code, num_dummy;
+	uint32	*pTbl;
+	uint32	*pSubTbl;
 
-	huft tbl_entry;
-	huft *pCurTbl;	
-	huft *huff_tbl_stack[PD_HUFF_BIT_MAX];
-	
-	uint16 *pCBV;
-	uint16 *pX;
-	
 	PNGD_MEMSET(bit_leng_count_tbl, 0, sizeof(bit_leng_count_tbl));
-	
-	i = code_num;
-	pCBV = code_length;
-	do {
-		bit_leng_count_tbl[*pCBV]++;
-		pCBV++;
-	} while(--i);
-	
-	bits_per_tbl = *lookup_bit;
-	for( j = 1; j <= PD_HUFF_BIT_MAX; j++ )
-	{
-		if( bit_leng_count_tbl[j] )
-		{
-			break;
-		}
-	}
-	cur_bit_num = j;
-	if( (uint32)bits_per_tbl < j )
-	{
-		bits_per_tbl = j;
-	}
-
-	for( i = PD_HUFF_BIT_MAX; i; i-- )
-	{
-		if( bit_leng_count_tbl[i] )
-		{
-			break;
-		}
-	}
+	for(i = 0;i < code_num;i++)
+		bit_leng_count_tbl[code_length[i]]++;
 
-	max_leng_code = i;
-	if( (uint32)bits_per_tbl > i )
+	max_leng_code = 0;
+	num_dummy = 1;
+	for(len = 1;len < PD_HUFF_BIT_MAX;len++)
 	{
-		bits_per_tbl = i;
-	}
-	*lookup_bit = bits_per_tbl;
-
-	for( num_dummy = 1 << j; j < i; j++ )
-	{
-		if( (num_dummy -= bit_leng_count_tbl[j]) < 0 )
-		{
+		num_dummy = (num_dummy << 1) - bit_leng_count_tbl[len];
+		if(num_dummy < 0)
 			return PD_PROCESS_ERROR;
-		}
-
-		num_dummy *= 2;
-	}
-
-	if( (num_dummy -= bit_leng_count_tbl[i]) < 0 )
-	{
-		return PD_PROCESS_ERROR;
+		if(bit_leng_count_tbl[len])
+			max_leng_code = len;
 	}
-	bit_leng_count_tbl[i] += num_dummy;
 
+	//sort symbols by code length (canonical order)
 	bit_offsets[1] = 0;
-	pCBV = bit_leng_count_tbl + 1;
-	pX = bit_offsets + 2;
-	j = 0;	
-	while( --i )
+	for(len = 1;len < PD_HUFF_BIT_MAX - 1;len++)
+		bit_offsets[len + 1] = bit_offsets[len] + bit_leng_count_tbl[len];
+	for(i = 0;i < code_num;i++)
 	{
-		*pX++ = (j += *pCBV++);
+		if(code_length[i])
+			bit_order_val[bit_offsets[code_length[i]]++] = (uint16)i;
 	}
-	
-	i = 0;
-	pCBV = code_length;
-	do {
-		if( (j = *pCBV++) != 0 )
-		{
-			bit_order_val[bit_offsets[j]++] = i;
-		}
-	} while( ++i < code_num );
 
-	level_tbl = -1;
-	bit_offsets[0] = 0;
-	huff_tbl_stack[0] = (huft *)NULL;
-	pCBV = bit_order_val;	
-	pCurTbl = (huft *)NULL;
-	prev_bits = -bits_per_tbl;	
-	for( i=0, cur_num_entry=0; cur_bit_num <= max_leng_code; cur_bit_num++ )
+	table_size = 1 << table_bits;
+	pTbl = (uint32 *)PNG_Malloc(pInst, table_size * sizeof(uint32));
+	if(pTbl == NULL)
+		return PD_PROCESS_ERROR;
+	PNGD_MEMSET(pTbl, 0, table_size * sizeof(uint32));
+	pInst->PD_Hash_Size += table_size;
+	*vld = pTbl;
+
+	pSubTbl = NULL;
+	sub_prefix = table_size;
+	sub_bits = 0;
+	code = 0;
+	i = 0;
+	for(len = 1;len <= (uint32)max_leng_code;len++, code <<= 1)
 	{
-		bit_leng_count = bit_leng_count_tbl[cur_bit_num];
-		while( bit_leng_count-- )
+		for(num_code = bit_leng_count_tbl[len];num_code;num_code--, code++)
 		{
-			while( cur_bit_num > prev_bits + bits_per_tbl )
-			{
-				level_tbl++;
-				prev_bits += bits_per_tbl;
-				cur_num_entry = max_leng_code - prev_bits;
-				cur_num_entry = cur_num_entry > (unsigned)bits_per_tbl?bits_per_tbl:cur_num_entry;
-				if( (num_repeat = 1 << (j = cur_bit_num - prev_bits)) > bit_leng_count + 1 )
-				{
-					num_repeat -= bit_leng_count + 1;
-					pX = bit_leng_count_tbl + cur_bit_num;
-					while( ++j < cur_num_entry )
-					{
-						if( (num_repeat <<= 1) <= *++pX )
-						{
-							break;
-						}
-						num_repeat -= *pX;
-					}
-				}
-				cur_num_entry = 1 << j;
+			uint32 symbol = bit_order_val[i++];
 
-				pCurTbl = (huft *)PNG_Malloc((cur_num_entry + 1)*sizeof(huft));
-				if( pCurTbl == (huft *)NULL )
-				{
-					return PD_PROCESS_ERROR;
-				}
-
-				PD_Hash_Size += cur_num_entry + 1;
-				*vld = pCurTbl + 1;
-				*(vld = &(pCurTbl->v.t)) = (huft *)NULL;
-				huff_tbl_stack[level_tbl] = ++pCurTbl;
-				if( level_tbl )
-				{
-					bit_offsets[level_tbl] = i;
-					tbl_entry.v.t = pCurTbl;
-					tbl_entry.e = (uint16)(16 + j);
-					tbl_entry.b = (uint16)bits_per_tbl;					
-					j = i >> (prev_bits - bits_per_tbl);
-					huff_tbl_stack[level_tbl-1][j] = tbl_entry;
-				}
-			}
+			//codes are sent from the MSB : the table is indexed by the reversed code
+			for(rev = 0, j = 0;j < len;j++)
+				rev |= ((code >> j) & 1) << (len - 1 - j);
 
-			tbl_entry.b = (uint16)(cur_bit_num - prev_bits);
-			if( pCBV >= bit_order_val + code_num )
-			{
-				tbl_entry.e = 0x63;
-			}
-			else if( *pCBV < code_num_simple )
-			{
-				tbl_entry.v.n = (uint16)(*pCBV);
-				tbl_entry.e = (uint16)(*pCBV < 0x100 ? 0x10 : 0x0F);				
-				pCBV++;
-			}
-			else
+			if(len <= (uint32)table_bits)
 			{
-				tbl_entry.e = (unsigned short)bit_non_simple[*pCBV - code_num_simple];
-				tbl_entry.v.n = val_non_simple[*pCBV++ - code_num_simple];
+				for(j = rev;j < table_size;j += 1 << len)
+					pTbl[j] = PNG_Huff_Entry(table_type, symbol, len);
+				continue;
 			}
 
-			num_repeat = 1 << (cur_bit_num - prev_bits);
-			for( j = i >> prev_bits; j < cur_num_entry; j += num_repeat )
+			if((rev & (table_size - 1)) != sub_prefix)
 			{
-				pCurTbl[j] = tbl_entry;
-			}
+				//new subtable : big enough for every code sharing this prefix
+				sub_prefix = rev & (table_size - 1);
+				sub_bits = len - table_bits;
+				sub_used = num_code;
+				while(sub_used < (1u << sub_bits) && table_bits + sub_bits < (uint32)max_leng_code)
+				{
+					sub_bits++;
+					sub_used = (sub_used << 1) + bit_leng_count_tbl[table_bits + sub_bits];
+				}
 
-			for( j = 1 << (cur_bit_num - 1); i & j; j >>= 1 )
-			{
-				i ^= j;
+				pSubTbl = (uint32 *)PNG_Malloc(pInst, (1 << sub_bits) * sizeof(uint32));
+				if(pSubTbl == NULL)
+					return PD_PROCESS_ERROR;
+				PNGD_MEMSET(pSubTbl, 0, (1 << sub_bits) * sizeof(uint32));
+				pInst->PD_Hash_Size += 1 << sub_bits;
+				pTbl[sub_prefix] = PD_HUFF_ENTRY(table_bits, PD_HUFF_TYPE_SUBTABLE, sub_bits | ((uint32)(pSubTbl - pTbl) << 8));
 			}
-			i ^= j;
 
-			while( (i & ((1 << prev_bits) - 1)) != bit_offsets[level_tbl] )
+			for(j = rev >> table_bits;j < (1u << sub_bits);j += 1 << (len - table_bits))
+				pSubTbl[j] = PNG_Huff_Entry(table_type, symbol, len - table_bits);
+		}
+	}
+
+	//pack up to PD_HUFF_LITER_MAX literals into one entry when their codes fit in table_bits
+	//(from the top down, so that the entries read are still single ones)
+	if(table_type == PD_HUFF_TABLE_LITER)
+	{
+		i = table_size;
+		while(i--)
+		{
+			uint32 entry = pTbl[i];
+			uint32 next, bits, litlen;
+
+			if(PD_HUFF_TYPE(entry) != 1)
+				continue;
+			bits = PD_HUFF_BITS(entry);
+			litlen = PD_HUFF_LITER(entry, 0);
+
+			next = pTbl[i >> bits];
+			if(PD_HUFF_TYPE(next) != 1 || bits + PD_HUFF_BITS(next) > (uint32)table_bits)
+				continue;
+			j = i >> bits;
+			bits += PD_HUFF_BITS(next);
+			litlen |= (uint32)PD_HUFF_LITER(next, 0) << 8;
+			entry = PD_HUFF_ENTRY(bits, 2, litlen);
+
+			next = pTbl[j >> PD_HUFF_BITS(next)];
+			if(PD_HUFF_TYPE(next) == 1 && bits + PD_HUFF_BITS(next) <= (uint32)table_bits)
 			{
-				prev_bits -= bits_per_tbl;
-				level_tbl--;
+				bits += PD_HUFF_BITS(next);
+				litlen |= (uint32)PD_HUFF_LITER(next, 0) << 16;
+				entry = PD_HUFF_ENTRY(bits, 3, litlen);
 			}
+			pTbl[i] = entry;
 		}
 	}
 
-	return (num_dummy != 0 && max_leng_code != 1);
+	if(num_dummy != 0 && max_leng_code != 1)
+		return PD_PROCESS_CONTINUE;
+	return PD_PROCESS_DONE;
 }
 
 
-static int PNG_Generate_FixHuff_Table(void)
+static int PNG_Generate_FixHuff_Table(PD_INSTANCE *pInst)
 {
-	int i;
-	int msg_ret;
-	uint16 code_length[288];
-
-	PD_Heap_Ptr = PD_Heap;
-	PD_Heap_Used_Size = 0;
-
-	for (i = 0; i < 144; i++)
-		code_length[i] = 8;
-	for (; i < 256; i++)
-		code_length[i] = 9;
-	for (; i < 280; i++)
-		code_length[i] = 7;
-	for (; i < 288; i++)
-		code_length[i] = 8;
-	
-	PD_Lookup_Bit_Literal = 7;
-	msg_ret = PNG_BuildUp_HuffTable(code_length, 288, 257, PDRO_Liter_Len, PDRO_Liter_Ext, &PD_Huff_Liter, &PD_Lookup_Bit_Literal);
-	if(msg_ret == PD_PROCESS_ERROR || msg_ret == PD_PROCESS_CONTINUE)
-		return PD_PROCESS_ERROR;
-
-	for (i = 0; i < 30; i++)
-		code_length[i] = 5;
-	
-	PD_Lookup_Bit_Distance = 5;
-	msg_ret = PNG_BuildUp_HuffTable(code_length, 30, 0, PDRO_Dist_Len, PDRO_Dist_Ext, &PD_Huff_Dist, &PD_Lookup_Bit_Distance);
-	if(msg_ret == PD_PROCESS_ERROR)
-		return PD_PROCESS_ERROR;
+	//precomputed : no heap needed
+	pInst->PD_Huff_Liter = PDRO_FixHuff_Liter;
+	pInst->PD_Lookup_Bit_Literal = PD_HUFF_FIX_LITER_BITS;
+	pInst->PD_Huff_Dist = PDRO_FixHuff_Dist;
+	pInst->PD_Lookup_Bit_Distance = PD_HUFF_FIX_DIST_BITS;
 
-	PD_FixHuff_Done = PD_DONE_ALREADY;
+	pInst->PD_FixHuff_Done = PD_DONE_ALREADY;
 	
 	return PD_PROCESS_DONE;
 }
 
-static int PNG_Generate_VarHuff_Table(void)
+static int PNG_Generate_VarHuff_Table(PD_INSTANCE *pInst)
 {
 	int i;
 	int j;
@@ -1510,14 +2926,13 @@ static int PNG_Generate_VarHuff_Table(void)
 	uint32 num_total_code;
 	uint32 length;
 	uint8 temp;
+	uint32 entry;
 
-	huft * len_for_huffcode;
-	int lookup_bit_for_len;
-	huft * dists_for_huffcode;
+	const uint32 * len_for_huffcode;
 
-	PD_FixHuff_Done = PD_DONE_YET;
-	PD_Heap_Ptr = PD_Heap;
-	PD_Heap_Used_Size = 0;
+	pInst->PD_FixHuff_Done = PD_DONE_YET;
+	pInst->PD_Heap_Ptr = (unsigned long)pInst->PD_Heap;
+	pInst->PD_Heap_Used_Size = 0;
 	
 	NEEDBITS_IDAT(14);
 	READBITS(5, temp);
@@ -1539,8 +2954,7 @@ static int PNG_Generate_VarHuff_Table(void)
 	for(;j < 19;j++)
 		bit_length[PDRO_Length_Order[j]] = 0;
 
-	lookup_bit_for_len = 7;
-	msg_ret = PNG_BuildUp_HuffTable(bit_length, 19, 19, NULL, NULL, &len_for_huffcode, &lookup_bit_for_len);
+	msg_ret = PNG_BuildUp_HuffTable(pInst, bit_length, 19, PD_HUFF_TABLE_PRECODE, PD_HUFF_PRECODE_BITS, &len_for_huffcode);
 	if(msg_ret == PD_PROCESS_ERROR)
 		return PD_PROCESS_ERROR;
 
@@ -1549,11 +2963,13 @@ static int PNG_Generate_VarHuff_Table(void)
 
 	while((uint32)i < num_total_code)
 	{
-		NEEDBITS_IDAT(lookup_bit_for_len);
-		SHOWBITS(lookup_bit_for_len, temp);
-		dists_for_huffcode = len_for_huffcode + (uint32)temp;
-		DROPBITS(dists_for_huffcode->b);
-		j = dists_for_huffcode->v.n;
+		NEEDBITS_IDAT(PD_HUFF_PRECODE_BITS);
+		SHOWBITS(PD_HUFF_PRECODE_BITS, temp);
+		entry = len_for_huffcode[temp];
+		if(PD_HUFF_TYPE(entry) != 1)
+			return PD_PROCESS_ERROR;
+		DROPBITS(PD_HUFF_BITS(entry));
+		j = PD_HUFF_LITER(entry, 0);
 		if(j < 16)
 			bit_length[i++] = length = j;
 		else if(j == 16)
@@ -1590,103 +3006,461 @@ static int PNG_Generate_VarHuff_Table(void)
 		}
 	}
 
-	if( PD_nPngDecErrorCode < 0 ) {
+	if( pInst->PD_nPngDecErrorCode < 0 ) {
 		return PD_PROCESS_ERROR;
 	}
 
-	PD_Hash_Size = 0;
-	PD_Heap_Ptr = PD_Heap;
-	PD_Heap_Used_Size = 0;
+	pInst->PD_Hash_Size = 0;
+	pInst->PD_Heap_Ptr = (unsigned long)pInst->PD_Heap;
+	pInst->PD_Heap_Used_Size = 0;
 
-	PD_Lookup_Bit_Literal = 9;
-	msg_ret = PNG_BuildUp_HuffTable(bit_length, num_literal, 257, PDRO_Liter_Len, PDRO_Liter_Ext,
-						&PD_Huff_Liter, &PD_Lookup_Bit_Literal);
+	pInst->PD_Lookup_Bit_Literal = PD_HUFF_LITER_BITS;
+	msg_ret = PNG_BuildUp_HuffTable(pInst, bit_length, num_literal, PD_HUFF_TABLE_LITER, PD_HUFF_LITER_BITS,
+						&pInst->PD_Huff_Liter);
 	if(msg_ret != PD_PROCESS_DONE)
 		return PD_PROCESS_ERROR;
 
-	PD_Lookup_Bit_Distance = 6;
-	msg_ret = PNG_BuildUp_HuffTable(bit_length + num_literal, num_distance, 0, PDRO_Dist_Len, PDRO_Dist_Ext,
-						&PD_Huff_Dist, &PD_Lookup_Bit_Distance);
+	pInst->PD_Lookup_Bit_Distance = PD_HUFF_DIST_BITS;
+	msg_ret = PNG_BuildUp_HuffTable(pInst, bit_length + num_literal, num_distance, PD_HUFF_TABLE_DIST, PD_HUFF_DIST_BITS,
+						&pInst->PD_Huff_Dist);
 	if(msg_ret == PD_PROCESS_ERROR)
 		return PD_PROCESS_ERROR;
 		
 	return PD_PROCESS_DONE;
 }
 
-static int PNG_Defiltering(uint16 row_size, uint32 mode)
+#if defined(PNGDEC_OPT_DEFILTER_SIMD)
+//////////////////////
+//Defiltering Kernels
+//////////////////////
+//	row : PD_Up_Scanline, the previous row on entry and the reconstructed row on return
+//	      (row[-bpp] ~ row[-1] is PD_Diag_Scanline which stays 0)
+//	src : filtered bytes of the current row, contiguous in PD_Deflate_Buf
+//	bpp : bytes per pixel (1 for bit depth < 8)
+static void PNG_Defilter_None_C(uint8 *row, const uint8 *src, uint32 row_size, uint32 bpp)
 {
-#if !defined(PNGDEC_OPT_DEFILTERING)
-	int i = 0, j;
-	int paeth_pred;
-	uint8 data;
-	
-	if( (mode == PD_Absolute_Skip) ||
-		(mode == PD_Conditional_Skip) && 
-		((PD_Deflate_Buf[PD_RING_QUEUE_MASK & (PD_Ptr_Image_Dec + row_size + 1)] == PD_FILT_NONE) || 
-		 (PD_Deflate_Buf[PD_RING_QUEUE_MASK & (PD_Ptr_Image_Dec + row_size + 1)] == PD_FILT_SUB ))
-		)
-	{
-		PD_Ptr_Image_Dec += (row_size + 1);
-	}
-	else
-	{
-		QUEUE_POP(PD_Filter_Method);
+	uint32 i;
 
-		switch(PD_Filter_Method)
-		{
-		case PD_FILT_NONE:
+	for(i = 0;i < row_size;i++)
+		row[i] = src[i];
+}
+
+static void PNG_Defilter_Sub_C(uint8 *row, const uint8 *src, uint32 row_size, uint32 bpp)
+{
+	const uint8 *left = row - bpp;
+	uint32 i;
+
+	for(i = 0;i < row_size;i++)
+		row[i] = (uint8)(src[i] + left[i]);
+}
+
+static void PNG_Defilter_Up_C(uint8 *row, const uint8 *src, uint32 row_size, uint32 bpp)
+{
+	uint32 i;
+
+	for(i = 0;i < row_size;i++)
+		row[i] = (uint8)(src[i] + row[i]);
+}
+
+static void PNG_Defilter_Avr_C(uint8 *row, const uint8 *src, uint32 row_size, uint32 bpp)
+{
+	const uint8 *left = row - bpp;
+	uint32 i;
+
+	for(i = 0;i < row_size;i++)
+		row[i] = (uint8)(src[i] + (((int)row[i] + (int)left[i]) >> 1));
+}
+
+static void PNG_Defilter_Paeth_C(uint8 *row, const uint8 *src, uint32 row_size, uint32 bpp)
+{
+	const uint8 *left = row - bpp;
+	uint8 up_left[8];		//previous row of the left pixel, overwritten in row[] already
+	uint32 i, j;
+	int a, b, c, paeth_pred;
+
+	//left and upper-left are 0 for the first pixel, so the predictor is the upper byte
+	for(i = 0;i < bpp && i < row_size;i++)
+	{
+		up_left[i] = row[i];
+		row[i] = (uint8)(src[i] + row[i]);
+	}
+	for(j = 0;i < row_size;i++)
+	{
+		a = left[i];
+		b = row[i];
+		c = up_left[j];
+		up_left[j] = (uint8)b;
+		DE_PAETH(a, b, c, paeth_pred);
+		row[i] = (uint8)(src[i] + paeth_pred);
+		if(++j == bpp)
+			j = 0;
+	}
+}
+
+static const Defilter_Func_Ptr PDRO_Defilter_C[5] = {
+	PNG_Defilter_None_C, PNG_Defilter_Sub_C, PNG_Defilter_Up_C, PNG_Defilter_Avr_C, PNG_Defilter_Paeth_C };
+
+//Sub, Average and Paeth depend on the left pixel, so the SIMD kernels reconstruct one pixel
+//(3, 4, 6 or 8 bytes) per step. Other bpp values use the C kernels.
+#define PD_DEFILTER_BPP_DISPATCH(kernel, c_kernel)	\
+{													\
+	switch(bpp)										\
+	{												\
+	case 3: kernel(row, src, row_size, 3); break;	\
+	case 4: kernel(row, src, row_size, 4); break;	\
+	case 6: kernel(row, src, row_size, 6); break;	\
+	case 8: kernel(row, src, row_size, 8); break;	\
+	default: c_kernel(row, src, row_size, bpp); break;	\
+	}												\
+}
+
+#if defined(PD_DEFILTER_SSE2)
+static __inline PD_SSE2_TARGET __m128i PD_Load_Pixel_SSE2(const uint8 *p, uint32 bpp)
+{
+	uint32 lo = 0, hi = 0;
+
+	if(bpp == 8)
+		return _mm_loadl_epi64((const __m128i *)p);
+	if(bpp == 6)
+	{
+		memcpy(&lo, p, 4);
+		memcpy(&hi, p + 4, 2);
+		return _mm_unpacklo_epi32(_mm_cvtsi32_si128((int)lo), _mm_cvtsi32_si128((int)hi));
+	}
+	memcpy(&lo, p, bpp);
+	return _mm_cvtsi32_si128((int)lo);
+}
+
+static __inline PD_SSE2_TARGET void PD_Store_Pixel_SSE2(uint8 *p, __m128i v, uint32 bpp)
+{
+	uint32 lo;
+
+	if(bpp == 8)
+	{
+		_mm_storel_epi64((__m128i *)p, v);
+		return;
+	}
+	lo = (uint32)_mm_cvtsi128_si32(v);
+	if(bpp == 6)
+	{
+		memcpy(p, &lo, 4);
+		lo = (uint32)_mm_cvtsi128_si32(_mm_srli_si128(v, 4));
+		memcpy(p + 4, &lo, 2);
+		return;
+	}
+	memcpy(p, &lo, bpp);
+}
+
+static __inline PD_SSE2_TARGET void PD_Sub_SSE2(uint8 *row, const uint8 *src, uint32 row_size, uint32 bpp)
+{
+	__m128i a = _mm_setzero_si128();
+	uint32 i;
+
+	for(i = 0;i < row_size;i += bpp)
+	{
+		a = _mm_add_epi8(PD_Load_Pixel_SSE2(src + i, bpp), a);
+		PD_Store_Pixel_SSE2(row + i, a, bpp);
+	}
+}
+
+static __inline PD_SSE2_TARGET void PD_Avr_SSE2(uint8 *row, const uint8 *src, uint32 row_size, uint32 bpp)
+{
+	__m128i a = _mm_setzero_si128();
+	__m128i one = _mm_set1_epi8(1);
+	__m128i b, avr;
+	uint32 i;
+
+	for(i = 0;i < row_size;i += bpp)
+	{
+		b = PD_Load_Pixel_SSE2(row + i, bpp);
+		//_mm_avg_epu8 rounds up, (a + b) >> 1 rounds down
+		avr = _mm_sub_epi8(_mm_avg_epu8(a, b), _mm_and_si128(_mm_xor_si128(a, b), one));
+		a = _mm_add_epi8(PD_Load_Pixel_SSE2(src + i, bpp), avr);
+		PD_Store_Pixel_SSE2(row + i, a, bpp);
+	}
+}
+
+static __inline PD_SSE2_TARGET __m128i PD_Abs16_SSE2(__m128i x)
+{
+	return _mm_max_epi16(x, _mm_sub_epi16(_mm_setzero_si128(), x));
+}
+
+static __inline PD_SSE2_TARGET __m128i PD_Select_SSE2(__m128i mask, __m128i t, __m128i e)
+{
+	return _mm_or_si128(_mm_and_si128(mask, t), _mm_andnot_si128(mask, e));
+}
+
+static __inline PD_SSE2_TARGET void PD_Paeth_SSE2(uint8 *row, const uint8 *src, uint32 row_size, uint32 bpp)
+{
+	__m128i zero = _mm_setzero_si128();
+	__m128i a = zero, c = zero;		//16 bit lanes
+	__m128i b, d, pa, pb, pc, smallest, pred;
+	uint32 i;
+
+	for(i = 0;i < row_size;i += bpp)
+	{
+		b = _mm_unpacklo_epi8(PD_Load_Pixel_SSE2(row + i, bpp), zero);
+
+		pa = _mm_sub_epi16(b, c);		//p - a
+		pb = _mm_sub_epi16(a, c);		//p - b
+		pc = _mm_add_epi16(pa, pb);		//p - c
+		pa = PD_Abs16_SSE2(pa);
+		pb = PD_Abs16_SSE2(pb);
+		pc = PD_Abs16_SSE2(pc);
+		smallest = _mm_min_epi16(pc, _mm_min_epi16(pa, pb));
+
+		//same tie order as DE_PAETH : a, b, c
+		pred = PD_Select_SSE2(_mm_cmpeq_epi16(smallest, pa), a,
+					PD_Select_SSE2(_mm_cmpeq_epi16(smallest, pb), b, c));
+
+		d = _mm_add_epi8(PD_Load_Pixel_SSE2(src + i, bpp), _mm_packus_epi16(pred, pred));
+		PD_Store_Pixel_SSE2(row + i, d, bpp);
+
+		a = _mm_unpacklo_epi8(d, zero);
+		c = b;
+	}
+}
+
+static PD_SSE2_TARGET void PNG_Defilter_Sub_SSE2(uint8 *row, const uint8 *src, uint32 row_size, uint32 bpp)
+{
+	PD_DEFILTER_BPP_DISPATCH(PD_Sub_SSE2, PNG_Defilter_Sub_C);
+}
+
+static PD_SSE2_TARGET void PNG_Defilter_Up_SSE2(uint8 *row, const uint8 *src, uint32 row_size, uint32 bpp)
+{
+	uint32 i;
+
+	for(i = 0;i + 16 <= row_size;i += 16)
+		_mm_storeu_si128((__m128i *)(row + i),
+			_mm_add_epi8(_mm_loadu_si128((const __m128i *)(row + i)), _mm_loadu_si128((const __m128i *)(src + i))));
+	for(;i < row_size;i++)
+		row[i] = (uint8)(src[i] + row[i]);
+}
+
+static PD_SSE2_TARGET void PNG_Defilter_Avr_SSE2(uint8 *row, const uint8 *src, uint32 row_size, uint32 bpp)
+{
+	PD_DEFILTER_BPP_DISPATCH(PD_Avr_SSE2, PNG_Defilter_Avr_C);
+}
+
+static PD_SSE2_TARGET void PNG_Defilter_Paeth_SSE2(uint8 *row, const uint8 *src, uint32 row_size, uint32 bpp)
+{
+	PD_DEFILTER_BPP_DISPATCH(PD_Paeth_SSE2, PNG_Defilter_Paeth_C);
+}
+
+static const Defilter_Func_Ptr PDRO_Defilter_SSE2[5] = {
+	PNG_Defilter_None_C, PNG_Defilter_Sub_SSE2, PNG_Defilter_Up_SSE2, PNG_Defilter_Avr_SSE2, PNG_Defilter_Paeth_SSE2 };
+#endif //PD_DEFILTER_SSE2
+
+#if defined(PD_DEFILTER_NEON)
+static __inline uint8x8_t PD_Load_Pixel_NEON(const uint8 *p, uint32 bpp)
+{
+	uint8 t[8] = {0, 0, 0, 0, 0, 0, 0, 0};
+
+	memcpy(t, p, bpp);
+	return vld1_u8(t);
+}
+
+static __inline void PD_Store_Pixel_NEON(uint8 *p, uint8x8_t v, uint32 bpp)
+{
+	uint8 t[8];
+
+	vst1_u8(t, v);
+	memcpy(p, t, bpp);
+}
+
+static __inline void PD_Sub_NEON(uint8 *row, const uint8 *src, uint32 row_size, uint32 bpp)
+{
+	uint8x8_t a = vdup_n_u8(0);
+	uint32 i;
+
+	for(i = 0;i < row_size;i += bpp)
+	{
+		a = vadd_u8(PD_Load_Pixel_NEON(src + i, bpp), a);
+		PD_Store_Pixel_NEON(row + i, a, bpp);
+	}
+}
+
+static __inline void PD_Avr_NEON(uint8 *row, const uint8 *src, uint32 row_size, uint32 bpp)
+{
+	uint8x8_t a = vdup_n_u8(0);
+	uint32 i;
+
+	for(i = 0;i < row_size;i += bpp)
+	{
+		//vhadd_u8 : (a + b) >> 1 without overflow
+		a = vadd_u8(PD_Load_Pixel_NEON(src + i, bpp), vhadd_u8(a, PD_Load_Pixel_NEON(row + i, bpp)));
+		PD_Store_Pixel_NEON(row + i, a, bpp);
+	}
+}
+
+static __inline void PD_Paeth_NEON(uint8 *row, const uint8 *src, uint32 row_size, uint32 bpp)
+{
+	uint8x8_t a = vdup_n_u8(0), c = vdup_n_u8(0);
+	uint8x8_t b, pred_bc;
+	uint16x8_t pa, pb, pc, a_min;
+	uint32 i;
+
+	for(i = 0;i < row_size;i += bpp)
+	{
+		b = PD_Load_Pixel_NEON(row + i, bpp);
+
+		pa = vabdl_u8(b, c);								//|p - a|
+		pb = vabdl_u8(a, c);								//|p - b|
+		pc = vabdq_u16(vaddl_u8(a, b), vaddl_u8(c, c));		//|p - c|
+
+		//same tie order as DE_PAETH : a, b, c
+		a_min = vandq_u16(vcleq_u16(pa, pb), vcleq_u16(pa, pc));
+		pred_bc = vbsl_u8(vmovn_u16(vcleq_u16(pb, pc)), b, c);
+
+		a = vadd_u8(PD_Load_Pixel_NEON(src + i, bpp), vbsl_u8(vmovn_u16(a_min), a, pred_bc));
+		PD_Store_Pixel_NEON(row + i, a, bpp);
+		c = b;
+	}
+}
+
+static void PNG_Defilter_Sub_NEON(uint8 *row, const uint8 *src, uint32 row_size, uint32 bpp)
+{
+	PD_DEFILTER_BPP_DISPATCH(PD_Sub_NEON, PNG_Defilter_Sub_C);
+}
+
+static void PNG_Defilter_Up_NEON(uint8 *row, const uint8 *src, uint32 row_size, uint32 bpp)
+{
+	uint32 i;
+
+	for(i = 0;i + 16 <= row_size;i += 16)
+		vst1q_u8(row + i, vaddq_u8(vld1q_u8(row + i), vld1q_u8(src + i)));
+	for(;i < row_size;i++)
+		row[i] = (uint8)(src[i] + row[i]);
+}
+
+static void PNG_Defilter_Avr_NEON(uint8 *row, const uint8 *src, uint32 row_size, uint32 bpp)
+{
+	PD_DEFILTER_BPP_DISPATCH(PD_Avr_NEON, PNG_Defilter_Avr_C);
+}
+
+static void PNG_Defilter_Paeth_NEON(uint8 *row, const uint8 *src, uint32 row_size, uint32 bpp)
+{
+	PD_DEFILTER_BPP_DISPATCH(PD_Paeth_NEON, PNG_Defilter_Paeth_C);
+}
+
+static const Defilter_Func_Ptr PDRO_Defilter_NEON[5] = {
+	PNG_Defilter_None_C, PNG_Defilter_Sub_NEON, PNG_Defilter_Up_NEON, PNG_Defilter_Avr_NEON, PNG_Defilter_Paeth_NEON };
+#endif //PD_DEFILTER_NEON
+
+//Kernel set for this CPU
+static const Defilter_Func_Ptr * PNG_Select_Defilter(void)
+{
+#if defined(PD_DEFILTER_SSE2)
+	if(PD_SSE2_CHECK())
+		return PDRO_Defilter_SSE2;
+#elif defined(PD_DEFILTER_NEON)
+	return PDRO_Defilter_NEON;
+#endif
+	return PDRO_Defilter_C;
+}
+
+//Defilter the current row with the kernels when its bytes do not wrap around the ring queue.
+//The filter type byte is already popped.
+static int PNG_Defilter_Contiguous(PD_INSTANCE *pInst, uint16 row_size)
+{
+	uint32 pos = pInst->PD_Ptr_Image_Dec & PD_RING_QUEUE_MASK;
+
+	if(pInst->PD_Filter_Method > PD_FILT_PAETH || pos + row_size > PD_DEFLATE_BUF_LEN)
+		return PD_PROCESS_CONTINUE;
+
+	(pInst->PD_Defilter[pInst->PD_Filter_Method])(pInst->PD_Up_Scanline, &pInst->PD_Deflate_Buf[pos], row_size, pInst->PD_Bpp);
+	pInst->PD_Ptr_Image_Dec += row_size;
+	return PD_PROCESS_DONE;
+}
+
+#endif //PNGDEC_OPT_DEFILTER_SIMD
+
+static int PNG_Defiltering(PD_INSTANCE *pInst, uint16 row_size, uint32 mode)
+{
+#if !defined(PNGDEC_OPT_DEFILTERING)
+	int i = 0, j;
+	int paeth_pred;
+	uint8 data;
+	
+	if( (mode == PD_Absolute_Skip) ||
+		(mode == PD_Conditional_Skip) && 
+		((pInst->PD_Deflate_Buf[PD_RING_QUEUE_MASK & (pInst->PD_Ptr_Image_Dec + row_size + 1)] == PD_FILT_NONE) || 
+		 (pInst->PD_Deflate_Buf[PD_RING_QUEUE_MASK & (pInst->PD_Ptr_Image_Dec + row_size + 1)] == PD_FILT_SUB ))
+		)
+	{
+		pInst->PD_Ptr_Image_Dec += (row_size + 1);
+	}
+	else
+	{
+		QUEUE_POP(pInst->PD_Filter_Method);
+	#if defined(PNGDEC_OPT_STATS)
+		if(pInst->PD_Filter_Method <= PD_FILT_PAETH)
+		{
+			pInst->PD_Stats.filter_rows[pInst->PD_Filter_Method]++;
+			pInst->PD_Stats.filter_bytes[pInst->PD_Filter_Method] += row_size;
+		}
+	#endif
+
+	#if defined(PNGDEC_OPT_DEFILTER_SIMD)
+		if(PNG_Defilter_Contiguous(pInst, row_size) == PD_PROCESS_DONE)
+			return PD_PROCESS_DONE;
+	#endif
+
+		switch(pInst->PD_Filter_Method)
+		{
+		case PD_FILT_NONE:
 			for(i = 0;i < row_size;i++)
 			{
 				QUEUE_POP(data);
-				PD_Up_Scanline[i] = data;
+				pInst->PD_Up_Scanline[i] = data;
 			}
 			break;
 		case PD_FILT_UP:
 			for(i = 0;i < row_size;i++)
 			{
 				QUEUE_POP(data);
-				PD_Up_Scanline[i] = ((int)data + (int)(PD_Up_Scanline[i])) & 0xFF;
+				pInst->PD_Up_Scanline[i] = ((int)data + (int)(pInst->PD_Up_Scanline[i])) & 0xFF;
 			}
 			break;
 		case PD_FILT_SUB:
 			for(i = 0;i < row_size;i++)
 			{
 				QUEUE_POP(data);
-				PD_Up_Scanline[i] = ((int)data + (int)(PD_Up_Scanline[i - PD_Bpp])) & 0xFF;
+				pInst->PD_Up_Scanline[i] = ((int)data + (int)(pInst->PD_Up_Scanline[i - pInst->PD_Bpp])) & 0xFF;
 			}
 			break;
 		case PD_FILT_AVR:
 			for(i = 0;i < row_size;i++)
 			{
 				QUEUE_POP(data);
-				PD_Up_Scanline[i] = ((int)data + (((int)(PD_Up_Scanline[i]) + (int)(PD_Up_Scanline[i - PD_Bpp])) >> 1)) & 0xFF;
+				pInst->PD_Up_Scanline[i] = ((int)data + (((int)(pInst->PD_Up_Scanline[i]) + (int)(pInst->PD_Up_Scanline[i - pInst->PD_Bpp])) >> 1)) & 0xFF;
 			}
 			break;
 		case PD_FILT_PAETH:
 			{
-				int iteration = row_size / PD_Bpp - 1;
+				int iteration = row_size / pInst->PD_Bpp - 1;
 				int prev_val[] = {0, 0, 0, 0, 0, 0, 0, 0};
-				for(j = 0;j < PD_Bpp;j++)
+				for(j = 0;j < pInst->PD_Bpp;j++)
 				{
-					DE_PAETH(prev_val[j], (int)(PD_Up_Scanline[i]), (int)(PD_Diag_Scanline[i]), paeth_pred);
+					DE_PAETH(prev_val[j], (int)(pInst->PD_Up_Scanline[i]), (int)(pInst->PD_Diag_Scanline[i]), paeth_pred);
 					QUEUE_POP(data);
 					prev_val[j] = ((int)data + paeth_pred) & 0xFF;
 					i++;
 				}
 				while(iteration--)
 				{
-					for(j = 0;j < PD_Bpp;j++)
+					for(j = 0;j < pInst->PD_Bpp;j++)
 					{
-						DE_PAETH(prev_val[j], (int)(PD_Up_Scanline[i]), (int)(PD_Diag_Scanline[i]), paeth_pred);
-						PD_Up_Scanline[i - PD_Bpp] = prev_val[j];
+						DE_PAETH(prev_val[j], (int)(pInst->PD_Up_Scanline[i]), (int)(pInst->PD_Diag_Scanline[i]), paeth_pred);
+						pInst->PD_Up_Scanline[i - pInst->PD_Bpp] = prev_val[j];
 						QUEUE_POP(data);
 						prev_val[j] = ((int)data + paeth_pred) & 0xFF;
 						i++;
 					}
 				}
-				for(j = 0;j < PD_Bpp;j++)
+				for(j = 0;j < pInst->PD_Bpp;j++)
 				{
-					PD_Up_Scanline[i - PD_Bpp] = prev_val[j];
+					pInst->PD_Up_Scanline[i - pInst->PD_Bpp] = prev_val[j];
 					i++;
 				}
 			}
@@ -1706,41 +3480,46 @@ static int PNG_Defiltering(uint16 row_size, uint32 mode)
 	
 	if( mode != PD_Absolute_Perform )
 	{
-		uint8 temp = PD_Deflate_Buf[PD_RING_QUEUE_MASK & (PD_Ptr_Image_Dec + row_size + 1)];	
+		uint8 temp = pInst->PD_Deflate_Buf[PD_RING_QUEUE_MASK & (pInst->PD_Ptr_Image_Dec + row_size + 1)];	
 		if(temp <= PD_FILT_SUB ) // PD_FILT_NONE or PD_FILT_SUB
 		{
-			PD_Ptr_Image_Dec += (row_size + 1);
+			pInst->PD_Ptr_Image_Dec += (row_size + 1);
 			return PD_PROCESS_DONE;
 		}
 	}
 
 #	if defined(PNGDEC_OPT_CHECK_DEFLATE_BUF_SIZE)
-	if(  (PD_Ptr_Image_Dec + row_size + 1) < PD_DEFLATE_BUF_LEN ) {
+	if(  (pInst->PD_Ptr_Image_Dec + row_size + 1) < PD_DEFLATE_BUF_LEN ) {
 		iSelPopfn = 1;
 	}
 #	endif
 
-	QUEUE_POP(PD_Filter_Method);
+	QUEUE_POP(pInst->PD_Filter_Method);
+
+#	if defined(PNGDEC_OPT_DEFILTER_SIMD)
+	if(PNG_Defilter_Contiguous(pInst, row_size) == PD_PROCESS_DONE)
+		return PD_PROCESS_DONE;
+#	endif
 	
-	switch(PD_Filter_Method)
+	switch(pInst->PD_Filter_Method)
 	{
 	case PD_FILT_NONE:
 	#	if defined(PNGDEC_OPT_CHECK_DEFLATE_BUF_SIZE)
 		if( iSelPopfn ) {
 			for(;i < row_size;i++) {
 				QUEUE_POP_NOMASK(data);
-				PD_Up_Scanline[i] = data;
+				pInst->PD_Up_Scanline[i] = data;
 			}
 		} else {
 			for(;i < row_size;i++) {
 				QUEUE_POP(data);
-				PD_Up_Scanline[i] = data;
+				pInst->PD_Up_Scanline[i] = data;
 			}
 		}
 	#	else
 		for(;i < row_size;i++) {
 			QUEUE_POP(data);
-			PD_Up_Scanline[i] = data;
+			pInst->PD_Up_Scanline[i] = data;
 		}
 	#	endif
 		break;
@@ -1749,18 +3528,18 @@ static int PNG_Defiltering(uint16 row_size, uint32 mode)
 		if( iSelPopfn ) {
 			for(;i < row_size;i++) {
 				QUEUE_POP_NOMASK(data);
-				PD_Up_Scanline[i] = ((int)data + (int)(PD_Up_Scanline[i])) & 0xFF;
+				pInst->PD_Up_Scanline[i] = ((int)data + (int)(pInst->PD_Up_Scanline[i])) & 0xFF;
 			}
 		} else {
 			for(;i < row_size;i++) {
 				QUEUE_POP(data);
-				PD_Up_Scanline[i] = ((int)data + (int)(PD_Up_Scanline[i])) & 0xFF;
+				pInst->PD_Up_Scanline[i] = ((int)data + (int)(pInst->PD_Up_Scanline[i])) & 0xFF;
 			}
 		}
 	#	else
 		for(;i < row_size;i++) {
 			QUEUE_POP(data);
-			PD_Up_Scanline[i] = ((int)data + (int)(PD_Up_Scanline[i])) & 0xFF;
+			pInst->PD_Up_Scanline[i] = ((int)data + (int)(pInst->PD_Up_Scanline[i])) & 0xFF;
 		}
 	#	endif
 		break;
@@ -1769,18 +3548,18 @@ static int PNG_Defiltering(uint16 row_size, uint32 mode)
 		if( iSelPopfn ) {
 			for(;i < row_size;i++) {
 				QUEUE_POP_NOMASK(data);
-				PD_Up_Scanline[i] = ((int)data + (int)(PD_Up_Scanline[i - PD_Bpp])) & 0xFF;
+				pInst->PD_Up_Scanline[i] = ((int)data + (int)(pInst->PD_Up_Scanline[i - pInst->PD_Bpp])) & 0xFF;
 			}			
 		} else {
 			for(;i < row_size;i++) {
 				QUEUE_POP(data);
-				PD_Up_Scanline[i] = ((int)data + (int)(PD_Up_Scanline[i - PD_Bpp])) & 0xFF;
+				pInst->PD_Up_Scanline[i] = ((int)data + (int)(pInst->PD_Up_Scanline[i - pInst->PD_Bpp])) & 0xFF;
 			}
 		}
 	#	else
 		for(;i < row_size;i++) {
 			QUEUE_POP(data);
-			PD_Up_Scanline[i] = ((int)data + (int)(PD_Up_Scanline[i - PD_Bpp])) & 0xFF;
+			pInst->PD_Up_Scanline[i] = ((int)data + (int)(pInst->PD_Up_Scanline[i - pInst->PD_Bpp])) & 0xFF;
 		}
 	#	endif
 		break;
@@ -1789,100 +3568,100 @@ static int PNG_Defiltering(uint16 row_size, uint32 mode)
 		if( iSelPopfn ) {
 			for(;i < row_size;i++) {
 				QUEUE_POP_NOMASK(data);
-				PD_Up_Scanline[i] = ((int)data + (((int)(PD_Up_Scanline[i]) + (int)(PD_Up_Scanline[i - PD_Bpp])) >> 1)) & 0xFF;
+				pInst->PD_Up_Scanline[i] = ((int)data + (((int)(pInst->PD_Up_Scanline[i]) + (int)(pInst->PD_Up_Scanline[i - pInst->PD_Bpp])) >> 1)) & 0xFF;
 			}			
 		} else {
 			for(;i < row_size;i++) {
 				QUEUE_POP(data);
-				PD_Up_Scanline[i] = ((int)data + (((int)(PD_Up_Scanline[i]) + (int)(PD_Up_Scanline[i - PD_Bpp])) >> 1)) & 0xFF;
+				pInst->PD_Up_Scanline[i] = ((int)data + (((int)(pInst->PD_Up_Scanline[i]) + (int)(pInst->PD_Up_Scanline[i - pInst->PD_Bpp])) >> 1)) & 0xFF;
 			}
 		}
 	#	else
 		for(;i < row_size;i++) {
 			QUEUE_POP(data);
-			PD_Up_Scanline[i] = ((int)data + (((int)(PD_Up_Scanline[i]) + (int)(PD_Up_Scanline[i - PD_Bpp])) >> 1)) & 0xFF;
+			pInst->PD_Up_Scanline[i] = ((int)data + (((int)(pInst->PD_Up_Scanline[i]) + (int)(pInst->PD_Up_Scanline[i - pInst->PD_Bpp])) >> 1)) & 0xFF;
 		}
 	#	endif
 		break;
 	case PD_FILT_PAETH:
 		{
 			int j, paeth_pred;
-			int iteration = row_size / PD_Bpp - 1;
+			int iteration = row_size / pInst->PD_Bpp - 1;
 			int prev_val[] = {0, 0, 0, 0, 0, 0, 0, 0};
 
 	#	if defined(PNGDEC_OPT_CHECK_DEFLATE_BUF_SIZE)
 			if( iSelPopfn ) {
-				for(j = 0;j < PD_Bpp;j++)
+				for(j = 0;j < pInst->PD_Bpp;j++)
 				{
-					DE_PAETH(prev_val[j], (int)(PD_Up_Scanline[i]), (int)(PD_Diag_Scanline[i]), paeth_pred);
+					DE_PAETH(prev_val[j], (int)(pInst->PD_Up_Scanline[i]), (int)(pInst->PD_Diag_Scanline[i]), paeth_pred);
 					QUEUE_POP_NOMASK(data);
 					prev_val[j] = ((int)data + paeth_pred) & 0xFF;
 					i++;
 				}
 				while(iteration--)
 				{
-					for(j = 0;j < PD_Bpp;j++)
+					for(j = 0;j < pInst->PD_Bpp;j++)
 					{
-						DE_PAETH(prev_val[j], (int)(PD_Up_Scanline[i]), (int)(PD_Diag_Scanline[i]), paeth_pred);
-						PD_Up_Scanline[i - PD_Bpp] = prev_val[j];
+						DE_PAETH(prev_val[j], (int)(pInst->PD_Up_Scanline[i]), (int)(pInst->PD_Diag_Scanline[i]), paeth_pred);
+						pInst->PD_Up_Scanline[i - pInst->PD_Bpp] = prev_val[j];
 						QUEUE_POP_NOMASK(data);
 						prev_val[j] = ((int)data + paeth_pred) & 0xFF;
 						i++;
 					}
 				}
-				for(j = 0;j < PD_Bpp;j++)
+				for(j = 0;j < pInst->PD_Bpp;j++)
 				{
-					PD_Up_Scanline[i - PD_Bpp] = prev_val[j];
+					pInst->PD_Up_Scanline[i - pInst->PD_Bpp] = prev_val[j];
 					i++;
 				}
 				
 			} else {
-				for(j = 0;j < PD_Bpp;j++)
+				for(j = 0;j < pInst->PD_Bpp;j++)
 				{
-					DE_PAETH(prev_val[j], (int)(PD_Up_Scanline[i]), (int)(PD_Diag_Scanline[i]), paeth_pred);
+					DE_PAETH(prev_val[j], (int)(pInst->PD_Up_Scanline[i]), (int)(pInst->PD_Diag_Scanline[i]), paeth_pred);
 					QUEUE_POP(data);
 					prev_val[j] = ((int)data + paeth_pred) & 0xFF;
 					i++;
 				}
 				while(iteration--)
 				{
-					for(j = 0;j < PD_Bpp;j++)
+					for(j = 0;j < pInst->PD_Bpp;j++)
 					{
-						DE_PAETH(prev_val[j], (int)(PD_Up_Scanline[i]), (int)(PD_Diag_Scanline[i]), paeth_pred);
-						PD_Up_Scanline[i - PD_Bpp] = prev_val[j];
+						DE_PAETH(prev_val[j], (int)(pInst->PD_Up_Scanline[i]), (int)(pInst->PD_Diag_Scanline[i]), paeth_pred);
+						pInst->PD_Up_Scanline[i - pInst->PD_Bpp] = prev_val[j];
 						QUEUE_POP(data);
 						prev_val[j] = ((int)data + paeth_pred) & 0xFF;
 						i++;
 					}
 				}
-				for(j = 0;j < PD_Bpp;j++)
+				for(j = 0;j < pInst->PD_Bpp;j++)
 				{
-					PD_Up_Scanline[i - PD_Bpp] = prev_val[j];
+					pInst->PD_Up_Scanline[i - pInst->PD_Bpp] = prev_val[j];
 					i++;
 				}			
 			}
 	#	else
-			for(j = 0;j < PD_Bpp;j++)
+			for(j = 0;j < pInst->PD_Bpp;j++)
 			{
-				DE_PAETH(prev_val[j], (int)(PD_Up_Scanline[i]), (int)(PD_Diag_Scanline[i]), paeth_pred);
+				DE_PAETH(prev_val[j], (int)(pInst->PD_Up_Scanline[i]), (int)(pInst->PD_Diag_Scanline[i]), paeth_pred);
 				QUEUE_POP(data);
 				prev_val[j] = ((int)data + paeth_pred) & 0xFF;
 				i++;
 			}
 			while(iteration--)
 			{
-				for(j = 0;j < PD_Bpp;j++)
+				for(j = 0;j < pInst->PD_Bpp;j++)
 				{
-					DE_PAETH(prev_val[j], (int)(PD_Up_Scanline[i]), (int)(PD_Diag_Scanline[i]), paeth_pred);
-					PD_Up_Scanline[i - PD_Bpp] = prev_val[j];
+					DE_PAETH(prev_val[j], (int)(pInst->PD_Up_Scanline[i]), (int)(pInst->PD_Diag_Scanline[i]), paeth_pred);
+					pInst->PD_Up_Scanline[i - pInst->PD_Bpp] = prev_val[j];
 					QUEUE_POP(data);
 					prev_val[j] = ((int)data + paeth_pred) & 0xFF;
 					i++;
 				}
 			}
-			for(j = 0;j < PD_Bpp;j++)
+			for(j = 0;j < pInst->PD_Bpp;j++)
 			{
-				PD_Up_Scanline[i - PD_Bpp] = prev_val[j];
+				pInst->PD_Up_Scanline[i - pInst->PD_Bpp] = prev_val[j];
 				i++;
 			}
 	#	endif			
@@ -1896,7 +3675,7 @@ static int PNG_Defiltering(uint16 row_size, uint32 mode)
 }
 
 
-static int Image_Origin_Grey(void)
+static int Image_Origin_Grey(PD_INSTANCE *pInst)
 {
 	int i;
 	int processed_byte;
@@ -1906,111 +3685,111 @@ static int Image_Origin_Grey(void)
 
 	QUEUE_POP_CHECK(prepared_bytes);
 	prepared_bytes--;
-	num_row = prepared_bytes / (PD_Scanline_Size + 1);
+	num_row = prepared_bytes / (pInst->PD_Scanline_Size + 1);
 	out_struct.Src_Fmt = IM_SRC_RGB; //IM_SRC_YUV
 
-	if(PD_Bit_Depth == 8 || PD_Bit_Depth == 16)
+	if(pInst->PD_Bit_Depth == 8 || pInst->PD_Bit_Depth == 16)
 	{
 		uint32 offset;
-		if(PD_Bit_Depth == 8)
+		if(pInst->PD_Bit_Depth == 8)
 			offset = 1;
 		else
 			offset = 2;
 
 		while(num_row--)
 		{
-			out_struct.y = (PCD_Global_Pix_Pos / PD_Global_Width) + PD_Top_Offset;
-			if(out_struct.y >= PD_LCD_Height)
+			out_struct.y = (pInst->PCD_Global_Pix_Pos / pInst->PD_Global_Width) + pInst->PD_Top_Offset;
+			if(out_struct.y >= pInst->PD_LCD_Height)
 			{
-				PD_Last_IDAT = PD_DONE_ALREADY;
+				pInst->PD_Last_IDAT = PD_DONE_ALREADY;
 				return PD_PROCESS_DONE;
 			}
 
-			if(PNG_Defiltering(PD_Scanline_Size, PD_Absolute_Perform) == PD_PROCESS_ERROR)
+			if(PNG_Defiltering(pInst, pInst->PD_Scanline_Size, PD_Absolute_Perform) == PD_PROCESS_ERROR)
 				return PD_PROCESS_ERROR;
 
 			processed_byte = 0;
 
-			if(PD_Color_Type == PD_COLOR_GREY_ALPHA)
+			if(pInst->PD_Color_Type == PD_COLOR_GREY_ALPHA)
 			{
-				for(i = 0;i < PD_Global_Width;i++)
+				for(i = 0;i < pInst->PD_Global_Width;i++)
 				{
-					out_struct.x = (PCD_Global_Pix_Pos++ % PD_Global_Width) + PD_Left_Offset;
-					if(out_struct.x >= PD_LCD_Width)
+					out_struct.x = (pInst->PCD_Global_Pix_Pos++ % pInst->PD_Global_Width) + pInst->PD_Left_Offset;
+					if(out_struct.x >= pInst->PD_LCD_Width)
 					{
-						PCD_Global_Pix_Pos += (PD_Global_Width - i - 1);
+						pInst->PCD_Global_Pix_Pos += (pInst->PD_Global_Width - i - 1);
 						break;
 					}
-					out_struct.Comp_1 = out_struct.Comp_2 = out_struct.Comp_3 = PD_Up_Scanline[processed_byte];
+					out_struct.Comp_1 = out_struct.Comp_2 = out_struct.Comp_3 = pInst->PD_Up_Scanline[processed_byte];
 					processed_byte += offset;
-					if(PD_Alpha_Use == 1)
-						out_struct.Comp_4 = PD_Up_Scanline[processed_byte];
+					if(pInst->PD_Alpha_Use == 1)
+						out_struct.Comp_4 = pInst->PD_Up_Scanline[processed_byte];
 					processed_byte += offset;
 									
-					out_struct.Offset = out_struct.y * PD_LCD_Width + out_struct.x;
-					(PD_Out_Struct.write_func)(out_struct);
+					out_struct.Offset = out_struct.y * pInst->PD_LCD_Width + out_struct.x;
+					(pInst->PD_Out_Struct.write_func)(out_struct);
 				}
 			}
 			else
 			{
-				for(i = 0;i < PD_Global_Width;i++)
+				for(i = 0;i < pInst->PD_Global_Width;i++)
 				{
-					out_struct.x = (PCD_Global_Pix_Pos++ % PD_Global_Width) + PD_Left_Offset;
-					if(out_struct.x >= PD_LCD_Width)
+					out_struct.x = (pInst->PCD_Global_Pix_Pos++ % pInst->PD_Global_Width) + pInst->PD_Left_Offset;
+					if(out_struct.x >= pInst->PD_LCD_Width)
 					{
-						PCD_Global_Pix_Pos += (PD_Global_Width - i - 1);
+						pInst->PCD_Global_Pix_Pos += (pInst->PD_Global_Width - i - 1);
 						break;
 					}
-					out_struct.Comp_1 = out_struct.Comp_2 = out_struct.Comp_3 = PD_Up_Scanline[processed_byte];
+					out_struct.Comp_1 = out_struct.Comp_2 = out_struct.Comp_3 = pInst->PD_Up_Scanline[processed_byte];
 					processed_byte += offset;
 
-					out_struct.Offset = out_struct.y * PD_LCD_Width + out_struct.x;
-					(PD_Out_Struct.write_func)(out_struct);
+					out_struct.Offset = out_struct.y * pInst->PD_LCD_Width + out_struct.x;
+					(pInst->PD_Out_Struct.write_func)(out_struct);
 				}
 			}
 		}
 	}
-	else//PD_Bit_Depth == 1 or 2 or 4
+	else//pInst->PD_Bit_Depth == 1 or 2 or 4
 	{
 		int ppb;//pixel per byte
 		int idx_mask;
 
-		ppb = 8 / PD_Bit_Depth;
+		ppb = 8 / pInst->PD_Bit_Depth;
 		idx_mask = ppb - 1;
 		
 		while(num_row--)
 		{
-			out_struct.y = (PCD_Global_Pix_Pos / PD_Global_Width) + PD_Top_Offset;
-			if(out_struct.y >= PD_LCD_Height)
+			out_struct.y = (pInst->PCD_Global_Pix_Pos / pInst->PD_Global_Width) + pInst->PD_Top_Offset;
+			if(out_struct.y >= pInst->PD_LCD_Height)
 			{
-				PD_Last_IDAT = PD_DONE_ALREADY;
+				pInst->PD_Last_IDAT = PD_DONE_ALREADY;
 				return PD_PROCESS_DONE;
 			}
 
-			if(PNG_Defiltering(PD_Scanline_Size, PD_Absolute_Perform) == PD_PROCESS_ERROR)
+			if(PNG_Defiltering(pInst, pInst->PD_Scanline_Size, PD_Absolute_Perform) == PD_PROCESS_ERROR)
 				return PD_PROCESS_ERROR;
 
-			for(i = 0;i < PD_Global_Width;i++)
+			for(i = 0;i < pInst->PD_Global_Width;i++)
 			{
-				out_struct.x = (PCD_Global_Pix_Pos++ % PD_Global_Width) + PD_Left_Offset;
-				if(out_struct.x >= PD_LCD_Width)
+				out_struct.x = (pInst->PCD_Global_Pix_Pos++ % pInst->PD_Global_Width) + pInst->PD_Left_Offset;
+				if(out_struct.x >= pInst->PD_LCD_Width)
 				{
-					PCD_Global_Pix_Pos += (PD_Global_Width - i - 1);
+					pInst->PCD_Global_Pix_Pos += (pInst->PD_Global_Width - i - 1);
 					break;
 				}
 				out_struct.Comp_1 = out_struct.Comp_2 = out_struct.Comp_3 = 
-					((PD_Up_Scanline[i / ppb] & PD_Data_Mask[i & idx_mask])
-						>> PD_Data_Shift[i & idx_mask]) * PD_Scaler;
+					((pInst->PD_Up_Scanline[i / ppb] & pInst->PD_Data_Mask[i & idx_mask])
+						>> pInst->PD_Data_Shift[i & idx_mask]) * pInst->PD_Scaler;
 				
-				out_struct.Offset = out_struct.y * PD_LCD_Width + out_struct.x;
-				(PD_Out_Struct.write_func)(out_struct);
+				out_struct.Offset = out_struct.y * pInst->PD_LCD_Width + out_struct.x;
+				(pInst->PD_Out_Struct.write_func)(out_struct);
 			}
 		}
 	}
 	return PD_PROCESS_DONE;
 }
 
-static int Image_Origin_True(void)
+static int Image_Origin_True(PD_INSTANCE *pInst)
 {
 	int i;
 	uint32 prepared_bytes, num_row;
@@ -2022,53 +3801,53 @@ static int Image_Origin_True(void)
 
 	QUEUE_POP_CHECK(prepared_bytes);
 	prepared_bytes--;
-	num_row = prepared_bytes / (PD_Scanline_Size + 1);
+	num_row = prepared_bytes / (pInst->PD_Scanline_Size + 1);
 
-	if(PD_Bit_Depth == 8)
+	if(pInst->PD_Bit_Depth == 8)
 		offset = 1;
 	else
 		offset = 2;
 
 	while(num_row--)
 	{
-		out_struct.y = (PCD_Global_Pix_Pos / PD_Global_Width) + PD_Top_Offset;
-		if(out_struct.y >= PD_LCD_Height)
+		out_struct.y = (pInst->PCD_Global_Pix_Pos / pInst->PD_Global_Width) + pInst->PD_Top_Offset;
+		if(out_struct.y >= pInst->PD_LCD_Height)
 		{
-			PD_Last_IDAT = PD_DONE_ALREADY;
+			pInst->PD_Last_IDAT = PD_DONE_ALREADY;
 			return PD_PROCESS_DONE;
 		}
 
-		if(PNG_Defiltering(PD_Scanline_Size, PD_Absolute_Perform) == PD_PROCESS_ERROR)
+		if(PNG_Defiltering(pInst, pInst->PD_Scanline_Size, PD_Absolute_Perform) == PD_PROCESS_ERROR)
 			return PD_PROCESS_ERROR;
 
 		processed_byte = 0;
 
-		if(PD_Color_Type == PD_COLOR_TRUE_ALPHA)
+		if(pInst->PD_Color_Type == PD_COLOR_TRUE_ALPHA)
 		{
-			for(i = 0;i < PD_Global_Width;i++)
+			for(i = 0;i < pInst->PD_Global_Width;i++)
 			{
-				out_struct.x = (PCD_Global_Pix_Pos++ % PD_Global_Width) + PD_Left_Offset;
-				if(out_struct.x >= PD_LCD_Width)
+				out_struct.x = (pInst->PCD_Global_Pix_Pos++ % pInst->PD_Global_Width) + pInst->PD_Left_Offset;
+				if(out_struct.x >= pInst->PD_LCD_Width)
 				{
-					PCD_Global_Pix_Pos += (PD_Global_Width - i - 1);
+					pInst->PCD_Global_Pix_Pos += (pInst->PD_Global_Width - i - 1);
 					break;
 				}
-				out_struct.Comp_1= PD_Up_Scanline[processed_byte];
+				out_struct.Comp_1= pInst->PD_Up_Scanline[processed_byte];
 				processed_byte += offset;
-				out_struct.Comp_2= PD_Up_Scanline[processed_byte];
+				out_struct.Comp_2= pInst->PD_Up_Scanline[processed_byte];
 				processed_byte += offset;
-				out_struct.Comp_3= PD_Up_Scanline[processed_byte];
+				out_struct.Comp_3= pInst->PD_Up_Scanline[processed_byte];
 				processed_byte += offset;
-				if(PD_Alpha_Use == 1)
-					out_struct.Comp_4 = PD_Up_Scanline[processed_byte];
+				if(pInst->PD_Alpha_Use == 1)
+					out_struct.Comp_4 = pInst->PD_Up_Scanline[processed_byte];
 			#if defined(PNGDEC_MOD_RGB_COMP4_RESET)
 				else
 					out_struct.Comp_4 = 0;
 			#endif
 				processed_byte += offset;
 				
-				out_struct.Offset = out_struct.y * PD_LCD_Width + out_struct.x;
-				(PD_Out_Struct.write_func)(out_struct);
+				out_struct.Offset = out_struct.y * pInst->PD_LCD_Width + out_struct.x;
+				(pInst->PD_Out_Struct.write_func)(out_struct);
 			}
 		}
 		else
@@ -2077,30 +3856,30 @@ static int Image_Origin_True(void)
 			out_struct.Comp_4 = 0;
 			#endif
 
-			for(i = 0;i < PD_Global_Width;i++)
+			for(i = 0;i < pInst->PD_Global_Width;i++)
 			{
-				out_struct.x = (PCD_Global_Pix_Pos++ % PD_Global_Width) + PD_Left_Offset;
-				if(out_struct.x >= PD_LCD_Width)
+				out_struct.x = (pInst->PCD_Global_Pix_Pos++ % pInst->PD_Global_Width) + pInst->PD_Left_Offset;
+				if(out_struct.x >= pInst->PD_LCD_Width)
 				{
-					PCD_Global_Pix_Pos += (PD_Global_Width - i - 1);
+					pInst->PCD_Global_Pix_Pos += (pInst->PD_Global_Width - i - 1);
 					break;
 				}
-				out_struct.Comp_1= PD_Up_Scanline[processed_byte];
+				out_struct.Comp_1= pInst->PD_Up_Scanline[processed_byte];
 				processed_byte += offset;
-				out_struct.Comp_2= PD_Up_Scanline[processed_byte];
+				out_struct.Comp_2= pInst->PD_Up_Scanline[processed_byte];
 				processed_byte += offset;
-				out_struct.Comp_3= PD_Up_Scanline[processed_byte];
+				out_struct.Comp_3= pInst->PD_Up_Scanline[processed_byte];
 				processed_byte += offset;
 				
-				out_struct.Offset = out_struct.y * PD_LCD_Width + out_struct.x;
-				(PD_Out_Struct.write_func)(out_struct);
+				out_struct.Offset = out_struct.y * pInst->PD_LCD_Width + out_struct.x;
+				(pInst->PD_Out_Struct.write_func)(out_struct);
 			}
 		}
 	}
 	return PD_PROCESS_DONE;
 }
 
-static int Image_Origin_Indexed(void)
+static int Image_Origin_Indexed(PD_INSTANCE *pInst)
 {
 	int i;
 	int processed_byte;
@@ -2114,188 +3893,188 @@ static int Image_Origin_Indexed(void)
 
 	QUEUE_POP_CHECK(prepared_bytes);
 	prepared_bytes--;
-	num_row = prepared_bytes / (PD_Scanline_Size + 1);
+	num_row = prepared_bytes / (pInst->PD_Scanline_Size + 1);
 	
 
-	ppb = 8 / PD_Bit_Depth;
+	ppb = 8 / pInst->PD_Bit_Depth;
 	idx_mask = ppb - 1;
 	while(num_row--)
 	{
-		out_struct.y = (PCD_Global_Pix_Pos / PD_Global_Width) + PD_Top_Offset;
-		if(out_struct.y >= PD_LCD_Height)
+		out_struct.y = (pInst->PCD_Global_Pix_Pos / pInst->PD_Global_Width) + pInst->PD_Top_Offset;
+		if(out_struct.y >= pInst->PD_LCD_Height)
 		{
-			PD_Last_IDAT = PD_DONE_ALREADY;
+			pInst->PD_Last_IDAT = PD_DONE_ALREADY;
 			return PD_PROCESS_DONE;
 		}
 
-		if(PNG_Defiltering(PD_Scanline_Size, PD_Absolute_Perform) == PD_PROCESS_ERROR)
+		if(PNG_Defiltering(pInst, pInst->PD_Scanline_Size, PD_Absolute_Perform) == PD_PROCESS_ERROR)
 			return PD_PROCESS_ERROR;
 
 		processed_byte = -1;
-		for(i = 0;i < PD_Global_Width;i++)
+		for(i = 0;i < pInst->PD_Global_Width;i++)
 		{
-			out_struct.x = (PCD_Global_Pix_Pos++ % PD_Global_Width) + PD_Left_Offset;
-			if(out_struct.x >= PD_LCD_Width)
+			out_struct.x = (pInst->PCD_Global_Pix_Pos++ % pInst->PD_Global_Width) + pInst->PD_Left_Offset;
+			if(out_struct.x >= pInst->PD_LCD_Width)
 			{
-				PCD_Global_Pix_Pos += (PD_Global_Width - i - 1);
+				pInst->PCD_Global_Pix_Pos += (pInst->PD_Global_Width - i - 1);
 				break;
 			}
 			if((uint32)(i & idx_mask) == 0)
 				processed_byte++;
-			index = (PD_Up_Scanline[i / ppb] & PD_Data_Mask[i & idx_mask]) >> PD_Data_Shift[i & idx_mask];
-			out_struct.Comp_1 = PD_Plte[index].R;
-			out_struct.Comp_2 = PD_Plte[index].G;
-			out_struct.Comp_3 = PD_Plte[index].B;
+			index = (pInst->PD_Up_Scanline[i / ppb] & pInst->PD_Data_Mask[i & idx_mask]) >> pInst->PD_Data_Shift[i & idx_mask];
+			out_struct.Comp_1 = pInst->PD_Plte[index].R;
+			out_struct.Comp_2 = pInst->PD_Plte[index].G;
+			out_struct.Comp_3 = pInst->PD_Plte[index].B;
 
-			if(PD_Alpha_Use == 1)
-				out_struct.Comp_4 = PD_Plte[index].Alpha;
+			if(pInst->PD_Alpha_Use == 1)
+				out_struct.Comp_4 = pInst->PD_Plte[index].Alpha;
 		#if defined(PNGDEC_MOD_RGB_COMP4_RESET)
 			else
 				out_struct.Comp_4 = 0;
 		#endif
 			
-			out_struct.Offset = out_struct.y * PD_LCD_Width + out_struct.x;
-			(PD_Out_Struct.write_func)(out_struct);
+			out_struct.Offset = out_struct.y * pInst->PD_LCD_Width + out_struct.x;
+			(pInst->PD_Out_Struct.write_func)(out_struct);
 		}
 	}
 	return PD_PROCESS_DONE;
 }
 
 
-static int Image_Resize_Grey(void)
+static int Image_Resize_Grey(PD_INSTANCE *pInst)
 {
 	int i;
 	uint32 prepared_bytes, num_row;
-	uint32 offset = (PD_Bit_Depth == 8)?1:2;
+	uint32 offset = (pInst->PD_Bit_Depth == 8)?1:2;
 
 	IM_PIX_INFO out_struct;
 	out_struct.Src_Fmt = IM_SRC_RGB;
 
 	QUEUE_POP_CHECK(prepared_bytes);
 	prepared_bytes--;
-	num_row = prepared_bytes / (PD_Scanline_Size + 1);
+	num_row = prepared_bytes / (pInst->PD_Scanline_Size + 1);
 
-	if(PD_Bit_Depth == 8 || PD_Bit_Depth == 16)
+	if(pInst->PD_Bit_Depth == 8 || pInst->PD_Bit_Depth == 16)
 	{
 		while(num_row--)
 		{
-			if(PD_Row == PD_Pixel_Map_Ver[PD_Resize_Ver_Idx])
+			if(pInst->PD_Row == pInst->PD_Pixel_Map_Ver[pInst->PD_Resize_Ver_Idx])
 			{
-				out_struct.y = (PCD_Global_Pix_Pos / PD_Resized_Width) + PD_Top_Offset;
-				if(out_struct.y >= PD_LCD_Height)
+				out_struct.y = (pInst->PCD_Global_Pix_Pos / pInst->PD_Resized_Width) + pInst->PD_Top_Offset;
+				if(out_struct.y >= pInst->PD_LCD_Height)
 				{
-					PD_Last_IDAT = PD_DONE_ALREADY;
+					pInst->PD_Last_IDAT = PD_DONE_ALREADY;
 					return PD_PROCESS_DONE;
 				}
 
-				if(PNG_Defiltering(PD_Scanline_Size, PD_Absolute_Perform) == PD_PROCESS_ERROR)
+				if(PNG_Defiltering(pInst, pInst->PD_Scanline_Size, PD_Absolute_Perform) == PD_PROCESS_ERROR)
 					return PD_PROCESS_ERROR;
-				PD_Resize_Ver_Idx++;
+				pInst->PD_Resize_Ver_Idx++;
 
-				if(PD_Color_Type == PD_COLOR_GREY_ALPHA)
+				if(pInst->PD_Color_Type == PD_COLOR_GREY_ALPHA)
 				{
-					for(i = 0;i < PD_Resized_Width;i++)
+					for(i = 0;i < pInst->PD_Resized_Width;i++)
 					{
-						out_struct.x = (PCD_Global_Pix_Pos++ % PD_Resized_Width) + PD_Left_Offset;
-						if(out_struct.x >= PD_LCD_Width)
+						out_struct.x = (pInst->PCD_Global_Pix_Pos++ % pInst->PD_Resized_Width) + pInst->PD_Left_Offset;
+						if(out_struct.x >= pInst->PD_LCD_Width)
 						{
-							PCD_Global_Pix_Pos += (PD_Resized_Width - i - 1);
+							pInst->PCD_Global_Pix_Pos += (pInst->PD_Resized_Width - i - 1);
 							break;
 						}
 						out_struct.Comp_1 = 
 						out_struct.Comp_2 = 
-						out_struct.Comp_3 = PD_Up_Scanline[PD_Pixel_Map_Hor[i] * PD_Bpp];
+						out_struct.Comp_3 = pInst->PD_Up_Scanline[pInst->PD_Pixel_Map_Hor[i] * pInst->PD_Bpp];
 
-						if(PD_Alpha_Use == 1)
-							out_struct.Comp_4 = PD_Up_Scanline[PD_Pixel_Map_Hor[i] * PD_Bpp + offset];
+						if(pInst->PD_Alpha_Use == 1)
+							out_struct.Comp_4 = pInst->PD_Up_Scanline[pInst->PD_Pixel_Map_Hor[i] * pInst->PD_Bpp + offset];
 						
-						out_struct.Offset = out_struct.y * PD_LCD_Width + out_struct.x;
-						(PD_Out_Struct.write_func)(out_struct);
+						out_struct.Offset = out_struct.y * pInst->PD_LCD_Width + out_struct.x;
+						(pInst->PD_Out_Struct.write_func)(out_struct);
 					}
 				}
 				else
 				{
-					for(i = 0;i < PD_Resized_Width;i++)
+					for(i = 0;i < pInst->PD_Resized_Width;i++)
 					{
-						out_struct.x = (PCD_Global_Pix_Pos++ % PD_Resized_Width) + PD_Left_Offset;
-						if(out_struct.x >= PD_LCD_Width)
+						out_struct.x = (pInst->PCD_Global_Pix_Pos++ % pInst->PD_Resized_Width) + pInst->PD_Left_Offset;
+						if(out_struct.x >= pInst->PD_LCD_Width)
 						{
-							PCD_Global_Pix_Pos += (PD_Resized_Width - i - 1);
+							pInst->PCD_Global_Pix_Pos += (pInst->PD_Resized_Width - i - 1);
 							break;
 						}
 						out_struct.Comp_1 = 
 						out_struct.Comp_2 = 
-						out_struct.Comp_3 = PD_Up_Scanline[PD_Pixel_Map_Hor[i] * PD_Bpp];
+						out_struct.Comp_3 = pInst->PD_Up_Scanline[pInst->PD_Pixel_Map_Hor[i] * pInst->PD_Bpp];
 						
-						out_struct.Offset = out_struct.y * PD_LCD_Width + out_struct.x;
-						(PD_Out_Struct.write_func)(out_struct);
+						out_struct.Offset = out_struct.y * pInst->PD_LCD_Width + out_struct.x;
+						(pInst->PD_Out_Struct.write_func)(out_struct);
 					}
 				}
 			}
 			else
 			{
-				if(PNG_Defiltering(PD_Scanline_Size, PD_Conditional_Skip) == PD_PROCESS_ERROR)
+				if(PNG_Defiltering(pInst, pInst->PD_Scanline_Size, PD_Conditional_Skip) == PD_PROCESS_ERROR)
 					return PD_PROCESS_ERROR;
 			}
-			PD_Row++;
+			pInst->PD_Row++;
 		}
 	}
-	else//PD_Bit_Depth == 1 or 2 or 4
+	else//pInst->PD_Bit_Depth == 1 or 2 or 4
 	{
 		int ppb;//pixel per byte
 		int idx_mask;
 		int index;
 
-		ppb = 8 / PD_Bit_Depth;
+		ppb = 8 / pInst->PD_Bit_Depth;
 		idx_mask = ppb - 1;
 		
 		while(num_row--)
 		{
-			if(PD_Row == PD_Pixel_Map_Ver[PD_Resize_Ver_Idx])
+			if(pInst->PD_Row == pInst->PD_Pixel_Map_Ver[pInst->PD_Resize_Ver_Idx])
 			{
-				out_struct.y = (PCD_Global_Pix_Pos / PD_Resized_Width) + PD_Top_Offset;
-				if(out_struct.y >= PD_LCD_Height)
+				out_struct.y = (pInst->PCD_Global_Pix_Pos / pInst->PD_Resized_Width) + pInst->PD_Top_Offset;
+				if(out_struct.y >= pInst->PD_LCD_Height)
 				{
-					PD_Last_IDAT = PD_DONE_ALREADY;
+					pInst->PD_Last_IDAT = PD_DONE_ALREADY;
 					return PD_PROCESS_DONE;
 				}
 
-				if(PNG_Defiltering(PD_Scanline_Size, PD_Absolute_Perform) == PD_PROCESS_ERROR)
+				if(PNG_Defiltering(pInst, pInst->PD_Scanline_Size, PD_Absolute_Perform) == PD_PROCESS_ERROR)
 					return PD_PROCESS_ERROR;
-				PD_Resize_Ver_Idx++;
+				pInst->PD_Resize_Ver_Idx++;
 
-				for(i = 0;i < PD_Resized_Width;i++)
+				for(i = 0;i < pInst->PD_Resized_Width;i++)
 				{
-					out_struct.x = (PCD_Global_Pix_Pos++ % PD_Resized_Width) + PD_Left_Offset;
-					if(out_struct.x >= PD_LCD_Width)
+					out_struct.x = (pInst->PCD_Global_Pix_Pos++ % pInst->PD_Resized_Width) + pInst->PD_Left_Offset;
+					if(out_struct.x >= pInst->PD_LCD_Width)
 					{
-						PCD_Global_Pix_Pos += (PD_Resized_Width - i - 1);
+						pInst->PCD_Global_Pix_Pos += (pInst->PD_Resized_Width - i - 1);
 						break;
 					}
-					index = PD_Pixel_Map_Hor[i];
+					index = pInst->PD_Pixel_Map_Hor[i];
 					out_struct.Comp_1 =
 					out_struct.Comp_2 = 
 					out_struct.Comp_3 = (
-						(PD_Up_Scanline[index / ppb] & PD_Data_Mask[index & idx_mask])
-						>> PD_Data_Shift[index & idx_mask] ) * PD_Scaler;
+						(pInst->PD_Up_Scanline[index / ppb] & pInst->PD_Data_Mask[index & idx_mask])
+						>> pInst->PD_Data_Shift[index & idx_mask] ) * pInst->PD_Scaler;
 					
-					out_struct.Offset = out_struct.y * PD_LCD_Width + out_struct.x;
-					(PD_Out_Struct.write_func)(out_struct);
+					out_struct.Offset = out_struct.y * pInst->PD_LCD_Width + out_struct.x;
+					(pInst->PD_Out_Struct.write_func)(out_struct);
 				}
 			}
 			else
 			{
-				if(PNG_Defiltering(PD_Scanline_Size, PD_Conditional_Skip) == PD_PROCESS_ERROR)
+				if(PNG_Defiltering(pInst, pInst->PD_Scanline_Size, PD_Conditional_Skip) == PD_PROCESS_ERROR)
 					return PD_PROCESS_ERROR;
 			}
-			PD_Row++;
+			pInst->PD_Row++;
 		}
 	}
 	return PD_PROCESS_DONE;
 }
 
 
-static int Image_Resize_True(void)
+static int Image_Resize_True(PD_INSTANCE *pInst)
 {
 	int i;
 	uint32 prepared_bytes, num_row;
@@ -2306,51 +4085,51 @@ static int Image_Resize_True(void)
 
 	QUEUE_POP_CHECK(prepared_bytes);
 	prepared_bytes--;
-	num_row = prepared_bytes / (PD_Scanline_Size + 1);
+	num_row = prepared_bytes / (pInst->PD_Scanline_Size + 1);
 
-	if(PD_Bit_Depth == 8)
+	if(pInst->PD_Bit_Depth == 8)
 		offset = 1;
 	else
 		offset = 2;
 
 	while(num_row--)
 	{
-		if(PD_Row == PD_Pixel_Map_Ver[PD_Resize_Ver_Idx])
+		if(pInst->PD_Row == pInst->PD_Pixel_Map_Ver[pInst->PD_Resize_Ver_Idx])
 		{
-			out_struct.y = (PCD_Global_Pix_Pos / PD_Resized_Width) + PD_Top_Offset;
-			if(out_struct.y >= PD_LCD_Height)
+			out_struct.y = (pInst->PCD_Global_Pix_Pos / pInst->PD_Resized_Width) + pInst->PD_Top_Offset;
+			if(out_struct.y >= pInst->PD_LCD_Height)
 			{
-				PD_Last_IDAT = PD_DONE_ALREADY;
+				pInst->PD_Last_IDAT = PD_DONE_ALREADY;
 				return PD_PROCESS_DONE;
 			}
 
-			if(PNG_Defiltering(PD_Scanline_Size, PD_Absolute_Perform) == PD_PROCESS_ERROR)
+			if(PNG_Defiltering(pInst, pInst->PD_Scanline_Size, PD_Absolute_Perform) == PD_PROCESS_ERROR)
 				return PD_PROCESS_ERROR;
-			PD_Resize_Ver_Idx++;
-			if(PD_Color_Type == PD_COLOR_TRUE_ALPHA)
+			pInst->PD_Resize_Ver_Idx++;
+			if(pInst->PD_Color_Type == PD_COLOR_TRUE_ALPHA)
 			{
-				for(i = 0;i < PD_Resized_Width;i++)
+				for(i = 0;i < pInst->PD_Resized_Width;i++)
 				{
-					out_struct.x = (PCD_Global_Pix_Pos++ % PD_Resized_Width) + PD_Left_Offset;					
-					if(out_struct.x >= PD_LCD_Width)
+					out_struct.x = (pInst->PCD_Global_Pix_Pos++ % pInst->PD_Resized_Width) + pInst->PD_Left_Offset;					
+					if(out_struct.x >= pInst->PD_LCD_Width)
 					{
-						PCD_Global_Pix_Pos += (PD_Resized_Width - i - 1);
+						pInst->PCD_Global_Pix_Pos += (pInst->PD_Resized_Width - i - 1);
 						break;
 					}
 
-					out_struct.Comp_1= PD_Up_Scanline[PD_Pixel_Map_Hor[i] * PD_Bpp];
-					out_struct.Comp_2= PD_Up_Scanline[PD_Pixel_Map_Hor[i] * PD_Bpp + offset];
-					out_struct.Comp_3= PD_Up_Scanline[PD_Pixel_Map_Hor[i] * PD_Bpp + offset * 2];
-					if(PD_Alpha_Use == 1)
-						out_struct.Comp_4 = PD_Up_Scanline[PD_Pixel_Map_Hor[i] * PD_Bpp + offset * 3];
+					out_struct.Comp_1= pInst->PD_Up_Scanline[pInst->PD_Pixel_Map_Hor[i] * pInst->PD_Bpp];
+					out_struct.Comp_2= pInst->PD_Up_Scanline[pInst->PD_Pixel_Map_Hor[i] * pInst->PD_Bpp + offset];
+					out_struct.Comp_3= pInst->PD_Up_Scanline[pInst->PD_Pixel_Map_Hor[i] * pInst->PD_Bpp + offset * 2];
+					if(pInst->PD_Alpha_Use == 1)
+						out_struct.Comp_4 = pInst->PD_Up_Scanline[pInst->PD_Pixel_Map_Hor[i] * pInst->PD_Bpp + offset * 3];
 				#if defined(PNGDEC_MOD_RGB_COMP4_RESET)
 					else
 						out_struct.Comp_4 = 0;
 				#endif
 						
 					
-					out_struct.Offset = out_struct.y * PD_LCD_Width + out_struct.x;
-					(PD_Out_Struct.write_func)(out_struct);
+					out_struct.Offset = out_struct.y * pInst->PD_LCD_Width + out_struct.x;
+					(pInst->PD_Out_Struct.write_func)(out_struct);
 				}
 			}
 			else
@@ -2359,34 +4138,34 @@ static int Image_Resize_True(void)
 				out_struct.Comp_4 = 0;
 			#endif
 
-				for(i = 0;i < PD_Resized_Width;i++)
+				for(i = 0;i < pInst->PD_Resized_Width;i++)
 				{
-					out_struct.x = (PCD_Global_Pix_Pos++ % PD_Resized_Width) + PD_Left_Offset;
-					if(out_struct.x >= PD_LCD_Width)
+					out_struct.x = (pInst->PCD_Global_Pix_Pos++ % pInst->PD_Resized_Width) + pInst->PD_Left_Offset;
+					if(out_struct.x >= pInst->PD_LCD_Width)
 					{
-						PCD_Global_Pix_Pos += (PD_Resized_Width - i - 1);
+						pInst->PCD_Global_Pix_Pos += (pInst->PD_Resized_Width - i - 1);
 						break;
 					}
-					out_struct.Comp_1= PD_Up_Scanline[PD_Pixel_Map_Hor[i] * PD_Bpp];
-					out_struct.Comp_2= PD_Up_Scanline[PD_Pixel_Map_Hor[i] * PD_Bpp + offset];
-					out_struct.Comp_3= PD_Up_Scanline[PD_Pixel_Map_Hor[i] * PD_Bpp + offset * 2];
+					out_struct.Comp_1= pInst->PD_Up_Scanline[pInst->PD_Pixel_Map_Hor[i] * pInst->PD_Bpp];
+					out_struct.Comp_2= pInst->PD_Up_Scanline[pInst->PD_Pixel_Map_Hor[i] * pInst->PD_Bpp + offset];
+					out_struct.Comp_3= pInst->PD_Up_Scanline[pInst->PD_Pixel_Map_Hor[i] * pInst->PD_Bpp + offset * 2];
 					
-					out_struct.Offset = out_struct.y * PD_LCD_Width + out_struct.x;
-					(PD_Out_Struct.write_func)(out_struct);
+					out_struct.Offset = out_struct.y * pInst->PD_LCD_Width + out_struct.x;
+					(pInst->PD_Out_Struct.write_func)(out_struct);
 				}
 			}			
 		}
 		else
 		{
-			if(PNG_Defiltering(PD_Scanline_Size, PD_Conditional_Skip) == PD_PROCESS_ERROR)
+			if(PNG_Defiltering(pInst, pInst->PD_Scanline_Size, PD_Conditional_Skip) == PD_PROCESS_ERROR)
 				return PD_PROCESS_ERROR;
 		}
-		PD_Row++;
+		pInst->PD_Row++;
 	}
 	return PD_PROCESS_DONE;
 }
 
-static int Image_Resize_Indexed(void)
+static int Image_Resize_Indexed(PD_INSTANCE *pInst)
 {
 	int i;
 	int ppb;//pixel per byte
@@ -2399,63 +4178,63 @@ static int Image_Resize_Indexed(void)
 
 	QUEUE_POP_CHECK(prepared_bytes);
 	prepared_bytes--;
-	num_row = prepared_bytes / (PD_Scanline_Size + 1);
+	num_row = prepared_bytes / (pInst->PD_Scanline_Size + 1);
 	
 
-	ppb = 8 / PD_Bit_Depth;
+	ppb = 8 / pInst->PD_Bit_Depth;
 	idx_mask = ppb - 1;
 	while(num_row--)
 	{
-		if(PD_Row == PD_Pixel_Map_Ver[PD_Resize_Ver_Idx])
+		if(pInst->PD_Row == pInst->PD_Pixel_Map_Ver[pInst->PD_Resize_Ver_Idx])
 		{
-			out_struct.y = (PCD_Global_Pix_Pos / PD_Resized_Width) + PD_Top_Offset;
-			if(out_struct.y >= PD_LCD_Height)
+			out_struct.y = (pInst->PCD_Global_Pix_Pos / pInst->PD_Resized_Width) + pInst->PD_Top_Offset;
+			if(out_struct.y >= pInst->PD_LCD_Height)
 			{
-				PD_Last_IDAT = PD_DONE_ALREADY;
+				pInst->PD_Last_IDAT = PD_DONE_ALREADY;
 				return PD_PROCESS_DONE;
 			}
 
-			if(PNG_Defiltering(PD_Scanline_Size, PD_Absolute_Perform) == PD_PROCESS_ERROR)
+			if(PNG_Defiltering(pInst, pInst->PD_Scanline_Size, PD_Absolute_Perform) == PD_PROCESS_ERROR)
 				return PD_PROCESS_ERROR;
-			PD_Resize_Ver_Idx++;
+			pInst->PD_Resize_Ver_Idx++;
 
-			for(i = 0;i < PD_Resized_Width;i++)
+			for(i = 0;i < pInst->PD_Resized_Width;i++)
 			{
-				out_struct.x = (PCD_Global_Pix_Pos++ % PD_Resized_Width) + PD_Left_Offset;
-				if(out_struct.x >= PD_LCD_Width)
+				out_struct.x = (pInst->PCD_Global_Pix_Pos++ % pInst->PD_Resized_Width) + pInst->PD_Left_Offset;
+				if(out_struct.x >= pInst->PD_LCD_Width)
 				{
-					PCD_Global_Pix_Pos += (PD_Resized_Width - i - 1);
+					pInst->PCD_Global_Pix_Pos += (pInst->PD_Resized_Width - i - 1);
 					break;
 				}
 				
-				index = PD_Pixel_Map_Hor[i];
-				index = (PD_Up_Scanline[index / ppb] & PD_Data_Mask[index & idx_mask]) >> PD_Data_Shift[index & idx_mask];
-				out_struct.Comp_1 = PD_Plte[index].R;
-				out_struct.Comp_2 = PD_Plte[index].G;
-				out_struct.Comp_3 = PD_Plte[index].B;
-
-				if(PD_Alpha_Use == 1)
-					out_struct.Comp_4 = PD_Plte[index].Alpha;
+				index = pInst->PD_Pixel_Map_Hor[i];
+				index = (pInst->PD_Up_Scanline[index / ppb] & pInst->PD_Data_Mask[index & idx_mask]) >> pInst->PD_Data_Shift[index & idx_mask];
+				out_struct.Comp_1 = pInst->PD_Plte[index].R;
+				out_struct.Comp_2 = pInst->PD_Plte[index].G;
+				out_struct.Comp_3 = pInst->PD_Plte[index].B;
+
+				if(pInst->PD_Alpha_Use == 1)
+					out_struct.Comp_4 = pInst->PD_Plte[index].Alpha;
 			#if defined(PNGDEC_MOD_RGB_COMP4_RESET)
 				else
 					out_struct.Comp_4 = 0;
 			#endif
 				
-				out_struct.Offset = out_struct.y * PD_LCD_Width + out_struct.x;
-				(PD_Out_Struct.write_func)(out_struct);
+				out_struct.Offset = out_struct.y * pInst->PD_LCD_Width + out_struct.x;
+				(pInst->PD_Out_Struct.write_func)(out_struct);
 			}
 		}
 		else
 		{
-			if(PNG_Defiltering(PD_Scanline_Size, PD_Conditional_Skip) == PD_PROCESS_ERROR)
+			if(PNG_Defiltering(pInst, pInst->PD_Scanline_Size, PD_Conditional_Skip) == PD_PROCESS_ERROR)
 				return PD_PROCESS_ERROR;
 		}
-		PD_Row++;
+		pInst->PD_Row++;
 	}
 	return PD_PROCESS_DONE;
 }
 
-static int Image_Origin_Grey_ADAM7(void)
+static int Image_Origin_Grey_ADAM7(PD_INSTANCE *pInst)
 {
 	int i;
 	int processed_byte;
@@ -2467,107 +4246,107 @@ static int Image_Origin_Grey_ADAM7(void)
 	IM_PIX_INFO out_struct;
 	out_struct.Src_Fmt = IM_SRC_RGB;
 	
-	if(PD_Bit_Depth == 8)
+	if(pInst->PD_Bit_Depth == 8)
 		offset = 1;
 	else
 		offset = 2;
 
-	ppb = 8 / PD_Bit_Depth;
+	ppb = 8 / pInst->PD_Bit_Depth;
 	idx_mask = ppb - 1;
 
 	while(1)
 	{
-		if(PD_Remaining_Row == 0)
-			PNG_Init_ADAM7_Map(PD_Current_Pass + 1);
+		if(pInst->PD_Remaining_Row == 0)
+			PNG_Init_ADAM7_Map(pInst, pInst->PD_Current_Pass + 1);
 
-		if(PD_Current_Pass > 7)
+		if(pInst->PD_Current_Pass > 7)
 			break;
 
 		QUEUE_POP_CHECK(prepared_bytes);
 		prepared_bytes--;
-		num_row = prepared_bytes / (PD_Scanline_Size + 1);
+		num_row = prepared_bytes / (pInst->PD_Scanline_Size + 1);
 
 		if(num_row == 0)
 			break;
 
-		if(num_row > PD_Remaining_Row)
-			num_row = PD_Remaining_Row;
-		PD_Remaining_Row -= num_row;
+		if(num_row > pInst->PD_Remaining_Row)
+			num_row = pInst->PD_Remaining_Row;
+		pInst->PD_Remaining_Row -= num_row;
 
-		hor_inc = PDRO_Hor_Incre[PD_Current_Pass - 1];
-		ver_inc = PDRO_Ver_Incre[PD_Current_Pass - 1];
-		hor_offset = PDRO_Hor_Start[PD_Current_Pass - 1] + PD_Left_Offset;
-		ver_offset = PDRO_Ver_Start[PD_Current_Pass - 1] + PD_Top_Offset;
+		hor_inc = PDRO_Hor_Incre[pInst->PD_Current_Pass - 1];
+		ver_inc = PDRO_Ver_Incre[pInst->PD_Current_Pass - 1];
+		hor_offset = PDRO_Hor_Start[pInst->PD_Current_Pass - 1] + pInst->PD_Left_Offset;
+		ver_offset = PDRO_Ver_Start[pInst->PD_Current_Pass - 1] + pInst->PD_Top_Offset;
 
 		while(num_row--)
 		{
-			if(PNG_Defiltering(PD_Scanline_Size, PD_Absolute_Perform) == PD_PROCESS_ERROR)
+			if(PNG_Defiltering(pInst, pInst->PD_Scanline_Size, PD_Absolute_Perform) == PD_PROCESS_ERROR)
 				return PD_PROCESS_ERROR;
-			out_struct.y = PD_Row * ver_inc + ver_offset;
-			if(out_struct.y < PD_LCD_Height)
+			out_struct.y = pInst->PD_Row * ver_inc + ver_offset;
+			if(out_struct.y < pInst->PD_LCD_Height)
 			{
 				processed_byte = 0;
-				if(PD_Color_Type == PD_COLOR_GREY_ALPHA)
+				if(pInst->PD_Color_Type == PD_COLOR_GREY_ALPHA)
 				{
-					for(i = 0;i < PD_ADAM7_Width;i++)
+					for(i = 0;i < pInst->PD_ADAM7_Width;i++)
 					{
 						out_struct.x = i * hor_inc + hor_offset;
-						if(out_struct.x >= PD_LCD_Width)
+						if(out_struct.x >= pInst->PD_LCD_Width)
 						{
 							break;
 						}
 						
-						out_struct.Offset = out_struct.y * PD_LCD_Width + out_struct.x;
+						out_struct.Offset = out_struct.y * pInst->PD_LCD_Width + out_struct.x;
 						
-						if(PD_Bit_Depth < 8)
+						if(pInst->PD_Bit_Depth < 8)
 						{
 							out_struct.Comp_1 = out_struct.Comp_2 = out_struct.Comp_3 = 
-								((PD_Up_Scanline[i / ppb] & PD_Data_Mask[i & idx_mask])
-									>> PD_Data_Shift[i & idx_mask]) * PD_Scaler;
+								((pInst->PD_Up_Scanline[i / ppb] & pInst->PD_Data_Mask[i & idx_mask])
+									>> pInst->PD_Data_Shift[i & idx_mask]) * pInst->PD_Scaler;
 						}
 						else
 						{
-							out_struct.Comp_1 = out_struct.Comp_2 = out_struct.Comp_3 = PD_Up_Scanline[processed_byte];
+							out_struct.Comp_1 = out_struct.Comp_2 = out_struct.Comp_3 = pInst->PD_Up_Scanline[processed_byte];
 							processed_byte += offset;
-							if(PD_Alpha_Use == 1)
-								out_struct.Comp_4 = PD_Up_Scanline[processed_byte];
+							if(pInst->PD_Alpha_Use == 1)
+								out_struct.Comp_4 = pInst->PD_Up_Scanline[processed_byte];
 							processed_byte += offset;
 						}				
-						(PD_Out_Struct.write_func)(out_struct);
+						(pInst->PD_Out_Struct.write_func)(out_struct);
 					}
 				}
 				else
 				{
-					for(i = 0;i < PD_ADAM7_Width;i++)
+					for(i = 0;i < pInst->PD_ADAM7_Width;i++)
 					{
 						out_struct.x = i * hor_inc + hor_offset;
-						if(out_struct.x >= PD_LCD_Width)
+						if(out_struct.x >= pInst->PD_LCD_Width)
 						{
 							break;
 						}
-						if(PD_Bit_Depth < 8)
+						if(pInst->PD_Bit_Depth < 8)
 						{
 							out_struct.Comp_1 = out_struct.Comp_2 = out_struct.Comp_3 = 
-								((PD_Up_Scanline[i / ppb] & PD_Data_Mask[i & idx_mask])
-									>> PD_Data_Shift[i & idx_mask]) * PD_Scaler;
+								((pInst->PD_Up_Scanline[i / ppb] & pInst->PD_Data_Mask[i & idx_mask])
+									>> pInst->PD_Data_Shift[i & idx_mask]) * pInst->PD_Scaler;
 						}
 						else
 						{
-							out_struct.Comp_1 = out_struct.Comp_2 = out_struct.Comp_3 = PD_Up_Scanline[processed_byte];
+							out_struct.Comp_1 = out_struct.Comp_2 = out_struct.Comp_3 = pInst->PD_Up_Scanline[processed_byte];
 							processed_byte += offset;
 						}				
-						out_struct.Offset = out_struct.y * PD_LCD_Width + out_struct.x;
-						(PD_Out_Struct.write_func)(out_struct);
+						out_struct.Offset = out_struct.y * pInst->PD_LCD_Width + out_struct.x;
+						(pInst->PD_Out_Struct.write_func)(out_struct);
 					}
 				}
 			}
-			PD_Row++;
+			pInst->PD_Row++;
 		}
 	}
 	return PD_PROCESS_DONE;
 }
 
-static int Image_Origin_True_ADAM7(void)
+static int Image_Origin_True_ADAM7(PD_INSTANCE *pInst)
 {
 	int i;
 	int processed_byte;
@@ -2578,58 +4357,58 @@ static int Image_Origin_True_ADAM7(void)
 	IM_PIX_INFO out_struct;
 	out_struct.Src_Fmt = IM_SRC_RGB;
 
-	if(PD_Bit_Depth == 8)
+	if(pInst->PD_Bit_Depth == 8)
 		offset = 1;
 	else
 		offset = 2;
 	
 	while(1)
 	{
-		if(PD_Remaining_Row == 0)
-			PNG_Init_ADAM7_Map(PD_Current_Pass + 1);
+		if(pInst->PD_Remaining_Row == 0)
+			PNG_Init_ADAM7_Map(pInst, pInst->PD_Current_Pass + 1);
 
 		QUEUE_POP_CHECK(prepared_bytes);
 		prepared_bytes--;
-		num_row = prepared_bytes / (PD_Scanline_Size + 1);
+		num_row = prepared_bytes / (pInst->PD_Scanline_Size + 1);
 		
 		if(num_row == 0)
 			break;
 
-		if(num_row > PD_Remaining_Row)
-			num_row = PD_Remaining_Row;
+		if(num_row > pInst->PD_Remaining_Row)
+			num_row = pInst->PD_Remaining_Row;
 
-		PD_Remaining_Row -= num_row;
+		pInst->PD_Remaining_Row -= num_row;
 		
-		hor_inc = PDRO_Hor_Incre[PD_Current_Pass - 1];
-		ver_inc = PDRO_Ver_Incre[PD_Current_Pass - 1];
-		hor_offset = PDRO_Hor_Start[PD_Current_Pass - 1] + PD_Left_Offset;
-		ver_offset = PDRO_Ver_Start[PD_Current_Pass - 1] + PD_Top_Offset;
+		hor_inc = PDRO_Hor_Incre[pInst->PD_Current_Pass - 1];
+		ver_inc = PDRO_Ver_Incre[pInst->PD_Current_Pass - 1];
+		hor_offset = PDRO_Hor_Start[pInst->PD_Current_Pass - 1] + pInst->PD_Left_Offset;
+		ver_offset = PDRO_Ver_Start[pInst->PD_Current_Pass - 1] + pInst->PD_Top_Offset;
 		
 		while(num_row--)
 		{
-			if(PNG_Defiltering(PD_Scanline_Size, PD_Absolute_Perform) == PD_PROCESS_ERROR)
+			if(PNG_Defiltering(pInst, pInst->PD_Scanline_Size, PD_Absolute_Perform) == PD_PROCESS_ERROR)
 				return PD_PROCESS_ERROR;
-			out_struct.y = PD_Row * ver_inc + ver_offset;
-			if(out_struct.y < PD_LCD_Height)
+			out_struct.y = pInst->PD_Row * ver_inc + ver_offset;
+			if(out_struct.y < pInst->PD_LCD_Height)
 			{
 				processed_byte = 0;
-				if(PD_Color_Type == PD_COLOR_TRUE_ALPHA)
+				if(pInst->PD_Color_Type == PD_COLOR_TRUE_ALPHA)
 				{
-					for(i = 0;i < PD_ADAM7_Width;i++)
+					for(i = 0;i < pInst->PD_ADAM7_Width;i++)
 					{
 						out_struct.x = i * hor_inc + hor_offset;
-						if(out_struct.x >= PD_LCD_Width)
+						if(out_struct.x >= pInst->PD_LCD_Width)
 						{
 							break;
 						}
-						out_struct.Comp_1= PD_Up_Scanline[processed_byte];
+						out_struct.Comp_1= pInst->PD_Up_Scanline[processed_byte];
 						processed_byte += offset;
-						out_struct.Comp_2= PD_Up_Scanline[processed_byte];
+						out_struct.Comp_2= pInst->PD_Up_Scanline[processed_byte];
 						processed_byte += offset;
-						out_struct.Comp_3= PD_Up_Scanline[processed_byte];
+						out_struct.Comp_3= pInst->PD_Up_Scanline[processed_byte];
 						processed_byte += offset;
-						if(PD_Alpha_Use == 1)
-							out_struct.Comp_4 = PD_Up_Scanline[processed_byte];
+						if(pInst->PD_Alpha_Use == 1)
+							out_struct.Comp_4 = pInst->PD_Up_Scanline[processed_byte];
 					#if defined(PNGDEC_MOD_RGB_COMP4_RESET)
 						else
 							out_struct.Comp_4 = 0;
@@ -2637,8 +4416,8 @@ static int Image_Origin_True_ADAM7(void)
 
 						processed_byte += offset;
 						
-						out_struct.Offset = out_struct.y * PD_LCD_Width + out_struct.x;
-						(PD_Out_Struct.write_func)(out_struct);
+						out_struct.Offset = out_struct.y * pInst->PD_LCD_Width + out_struct.x;
+						(pInst->PD_Out_Struct.write_func)(out_struct);
 					}
 				}
 				else
@@ -2647,30 +4426,30 @@ static int Image_Origin_True_ADAM7(void)
 					out_struct.Comp_4 = 0;
 				#endif
 
-					for(i = 0;i < PD_ADAM7_Width;i++)
+					for(i = 0;i < pInst->PD_ADAM7_Width;i++)
 					{
 						out_struct.x = i * hor_inc + hor_offset;
-						if(out_struct.x >= PD_LCD_Width)
+						if(out_struct.x >= pInst->PD_LCD_Width)
 							break;
-						out_struct.Comp_1= PD_Up_Scanline[processed_byte];
+						out_struct.Comp_1= pInst->PD_Up_Scanline[processed_byte];
 						processed_byte += offset;
-						out_struct.Comp_2= PD_Up_Scanline[processed_byte];
+						out_struct.Comp_2= pInst->PD_Up_Scanline[processed_byte];
 						processed_byte += offset;
-						out_struct.Comp_3= PD_Up_Scanline[processed_byte];
+						out_struct.Comp_3= pInst->PD_Up_Scanline[processed_byte];
 						processed_byte += offset;
 						
-						out_struct.Offset = out_struct.y * PD_LCD_Width + out_struct.x;
-						(PD_Out_Struct.write_func)(out_struct);
+						out_struct.Offset = out_struct.y * pInst->PD_LCD_Width + out_struct.x;
+						(pInst->PD_Out_Struct.write_func)(out_struct);
 					}
 				}
 			}
-			PD_Row++;
+			pInst->PD_Row++;
 		}
 	}
 	return PD_PROCESS_DONE;
 }
 
-static int Image_Origin_Indexed_ADAM7(void)
+static int Image_Origin_Indexed_ADAM7(PD_INSTANCE *pInst)
 {
 	int i;
 	int processed_byte;
@@ -2683,68 +4462,68 @@ static int Image_Origin_Indexed_ADAM7(void)
 	IM_PIX_INFO out_struct;
 	out_struct.Src_Fmt = IM_SRC_RGB;
 
-	ppb = 8 / PD_Bit_Depth;
+	ppb = 8 / pInst->PD_Bit_Depth;
 	idx_mask = ppb - 1;
 	while(1)
 	{
-		if(PD_Remaining_Row == 0)
-			PNG_Init_ADAM7_Map(PD_Current_Pass + 1);
+		if(pInst->PD_Remaining_Row == 0)
+			PNG_Init_ADAM7_Map(pInst, pInst->PD_Current_Pass + 1);
 
 		QUEUE_POP_CHECK(prepared_bytes);
 		prepared_bytes--;
-		num_row = prepared_bytes / (PD_Scanline_Size + 1);
+		num_row = prepared_bytes / (pInst->PD_Scanline_Size + 1);
 
 		if(num_row == 0)
 			break;
 
-		if(num_row > PD_Remaining_Row)
-			num_row = PD_Remaining_Row;
+		if(num_row > pInst->PD_Remaining_Row)
+			num_row = pInst->PD_Remaining_Row;
 
-		PD_Remaining_Row -= num_row;
+		pInst->PD_Remaining_Row -= num_row;
 
-		hor_inc = PDRO_Hor_Incre[PD_Current_Pass - 1];
-		ver_inc = PDRO_Ver_Incre[PD_Current_Pass - 1];
-		hor_offset = PDRO_Hor_Start[PD_Current_Pass - 1] + PD_Left_Offset;
-		ver_offset = PDRO_Ver_Start[PD_Current_Pass - 1] + PD_Top_Offset;
+		hor_inc = PDRO_Hor_Incre[pInst->PD_Current_Pass - 1];
+		ver_inc = PDRO_Ver_Incre[pInst->PD_Current_Pass - 1];
+		hor_offset = PDRO_Hor_Start[pInst->PD_Current_Pass - 1] + pInst->PD_Left_Offset;
+		ver_offset = PDRO_Ver_Start[pInst->PD_Current_Pass - 1] + pInst->PD_Top_Offset;
 		
 		while(num_row--)
 		{
-			if(PNG_Defiltering(PD_Scanline_Size, PD_Absolute_Perform) == PD_PROCESS_ERROR)
+			if(PNG_Defiltering(pInst, pInst->PD_Scanline_Size, PD_Absolute_Perform) == PD_PROCESS_ERROR)
 				return PD_PROCESS_ERROR;
-			out_struct.y = PD_Row * ver_inc + ver_offset;
-			if(out_struct.y < PD_LCD_Height)
+			out_struct.y = pInst->PD_Row * ver_inc + ver_offset;
+			if(out_struct.y < pInst->PD_LCD_Height)
 			{
 				processed_byte = -1;
-				for(i = 0;i < PD_ADAM7_Width;i++)
+				for(i = 0;i < pInst->PD_ADAM7_Width;i++)
 				{
 					out_struct.x = i * hor_inc + hor_offset;
-					if(out_struct.x >= PD_LCD_Width)
+					if(out_struct.x >= pInst->PD_LCD_Width)
 						break;
 					if((uint32)(i & idx_mask) == 0)
 						processed_byte++;
-					index = (PD_Up_Scanline[i / ppb] & PD_Data_Mask[i & idx_mask]) >> PD_Data_Shift[i & idx_mask];
-					out_struct.Comp_1 = PD_Plte[index].R;
-					out_struct.Comp_2 = PD_Plte[index].G;
-					out_struct.Comp_3 = PD_Plte[index].B;
+					index = (pInst->PD_Up_Scanline[i / ppb] & pInst->PD_Data_Mask[i & idx_mask]) >> pInst->PD_Data_Shift[i & idx_mask];
+					out_struct.Comp_1 = pInst->PD_Plte[index].R;
+					out_struct.Comp_2 = pInst->PD_Plte[index].G;
+					out_struct.Comp_3 = pInst->PD_Plte[index].B;
 
-					if(PD_Alpha_Use == 1)
-						out_struct.Comp_4 = PD_Plte[index].Alpha;
+					if(pInst->PD_Alpha_Use == 1)
+						out_struct.Comp_4 = pInst->PD_Plte[index].Alpha;
 				#if defined(PNGDEC_MOD_RGB_COMP4_RESET)
 					else
 						out_struct.Comp_4 = 0;
 				#endif
 					
-					out_struct.Offset = out_struct.y * PD_LCD_Width + out_struct.x;
-					(PD_Out_Struct.write_func)(out_struct);
+					out_struct.Offset = out_struct.y * pInst->PD_LCD_Width + out_struct.x;
+					(pInst->PD_Out_Struct.write_func)(out_struct);
 				}
 			}
-			PD_Row++;
+			pInst->PD_Row++;
 		}
 	}
 	return PD_PROCESS_DONE;
 }
 
-static int Image_Resize_Grey_ADAM7(void)
+static int Image_Resize_Grey_ADAM7(PD_INSTANCE *pInst)
 {
 	int i;
 	uint32 hor_inc, ver_inc, hor_offset, ver_offset;
@@ -2752,15 +4531,15 @@ static int Image_Resize_Grey_ADAM7(void)
 	uint32 temp;
 	uint32 offset;
 	IM_PIX_INFO out_struct;
-	int ppb = 8 / PD_Bit_Depth;
+	int ppb = 8 / pInst->PD_Bit_Depth;
 	int idx_mask = ppb - 1;
 	int category;
 
 	out_struct.Src_Fmt = IM_SRC_RGB;
 	
-	if(PD_Bit_Depth == 8 || PD_Bit_Depth == 16)
+	if(pInst->PD_Bit_Depth == 8 || pInst->PD_Bit_Depth == 16)
 	{
-		if(PD_Bit_Depth == 0)
+		if(pInst->PD_Bit_Depth == 0)
 			offset = 1;
 		else
 			offset = 2;
@@ -2771,112 +4550,120 @@ static int Image_Resize_Grey_ADAM7(void)
 	
 	while(1)
 	{
-		if(PD_Remaining_Row == 0 && PD_Resize_Ver_Idx == PD_ADAM7_Height)
-			PNG_Init_ADAM7_Map(PD_Current_Pass + 1);
+		if(pInst->PD_Remaining_Row == 0 && pInst->PD_Resize_Ver_Idx == pInst->PD_ADAM7_Height)
+			PNG_Init_ADAM7_Map(pInst, pInst->PD_Current_Pass + 1);
+
+	#if defined(PNGDEC_OPT_ADAM7_THUMBNAIL)
+		if(pInst->PD_Thumb_Pass && pInst->PD_Current_Pass > pInst->PD_Thumb_Pass)
+		{
+			pInst->PD_Last_IDAT = PD_DONE_ALREADY;	//no sample in the passes left
+			break;
+		}
+	#endif
 
 		QUEUE_POP_CHECK(prepared_bytes);
 		prepared_bytes--;
-		num_row = prepared_bytes / (PD_Scanline_Size + 1);
+		num_row = prepared_bytes / (pInst->PD_Scanline_Size + 1);
 		
 		if(num_row == 0)
 			break;
 
-		if(num_row > PD_Remaining_Row)
-			num_row = PD_Remaining_Row;
+		if(num_row > pInst->PD_Remaining_Row)
+			num_row = pInst->PD_Remaining_Row;
 
-		PD_Remaining_Row -= num_row;
+		pInst->PD_Remaining_Row -= num_row;
 		
-		hor_inc = PDRO_Hor_Incre[PD_Current_Pass - 1];
-		ver_inc = PDRO_Ver_Incre[PD_Current_Pass - 1];
-		hor_offset = PDRO_Hor_Start[PD_Current_Pass - 1];
-		ver_offset = PDRO_Ver_Start[PD_Current_Pass - 1];
+		hor_inc = PDRO_Hor_Incre[pInst->PD_Current_Pass - 1];
+		ver_inc = PDRO_Ver_Incre[pInst->PD_Current_Pass - 1];
+		hor_offset = PDRO_Hor_Start[pInst->PD_Current_Pass - 1];
+		ver_offset = PDRO_Ver_Start[pInst->PD_Current_Pass - 1];
 
-		for(;PD_Row < PD_Resized_Height;PD_Row++)
+		for(;pInst->PD_Row < pInst->PD_Resized_Height;pInst->PD_Row++)
 		{
-			if((PD_Pixel_Map_Ver[PD_Row] - ver_offset) % ver_inc == 0)
+			if((pInst->PD_Pixel_Map_Ver[pInst->PD_Row] - ver_offset) % ver_inc == 0)
 			{
-				temp = (PD_Pixel_Map_Ver[PD_Row] - ver_offset) / ver_inc;
-				while(PD_Resize_Ver_Idx != temp)
+				temp = (pInst->PD_Pixel_Map_Ver[pInst->PD_Row] - ver_offset) / ver_inc;
+				while(pInst->PD_Resize_Ver_Idx != temp)
 				{
-					if(PNG_Defiltering(PD_Scanline_Size, PD_Conditional_Skip) == PD_PROCESS_ERROR)
+					if(PNG_Defiltering(pInst, pInst->PD_Scanline_Size, PD_Conditional_Skip) == PD_PROCESS_ERROR)
 						return PD_PROCESS_ERROR;
 					num_row--;
-					PD_Resize_Ver_Idx++;
+					pInst->PD_Resize_Ver_Idx++;
 					if(num_row == 0)
 						return PD_PROCESS_DONE;
 				}
 
-				if(PNG_Defiltering(PD_Scanline_Size, PD_Absolute_Perform) == PD_PROCESS_ERROR)
+				if(PNG_Defiltering(pInst, pInst->PD_Scanline_Size, PD_Absolute_Perform) == PD_PROCESS_ERROR)
 					return PD_PROCESS_ERROR;
 				num_row--;
-				PD_Resize_Ver_Idx++;
+				pInst->PD_Resize_Ver_Idx++;
 				
-				out_struct.y = PD_Row + PD_Top_Offset;
-				if(out_struct.y < PD_LCD_Height)
+				out_struct.y = pInst->PD_Row + pInst->PD_Top_Offset;
+				if(out_struct.y < pInst->PD_LCD_Height)
 				{
-					if(PD_Color_Type == PD_COLOR_GREY_ALPHA)
+					if(pInst->PD_Color_Type == PD_COLOR_GREY_ALPHA)
 					{
-						for(i = 0;i < PD_Resized_Width;i++)
+						for(i = 0;i < pInst->PD_Resized_Width;i++)
 						{
-							if((PD_Pixel_Map_Hor[i] - hor_offset) % hor_inc == 0)
+							if((pInst->PD_Pixel_Map_Hor[i] - hor_offset) % hor_inc == 0)
 							{
-								out_struct.x = i + PD_Left_Offset;
-								if(out_struct.x >= PD_LCD_Width)
+								out_struct.x = i + pInst->PD_Left_Offset;
+								if(out_struct.x >= pInst->PD_LCD_Width)
 									break;
-								temp = (PD_Pixel_Map_Hor[i] - hor_offset) / hor_inc;
+								temp = (pInst->PD_Pixel_Map_Hor[i] - hor_offset) / hor_inc;
 								out_struct.Comp_1 = 
 								out_struct.Comp_2 = 
-								out_struct.Comp_3 = PD_Up_Scanline[temp * PD_Bpp];
+								out_struct.Comp_3 = pInst->PD_Up_Scanline[temp * pInst->PD_Bpp];
 
-								if(PD_Alpha_Use == 1)
-									out_struct.Comp_4 = PD_Up_Scanline[temp * PD_Bpp + offset];
+								if(pInst->PD_Alpha_Use == 1)
+									out_struct.Comp_4 = pInst->PD_Up_Scanline[temp * pInst->PD_Bpp + offset];
 								
-								out_struct.Offset = out_struct.y * PD_LCD_Width + out_struct.x;
-								(PD_Out_Struct.write_func)(out_struct);
+								out_struct.Offset = out_struct.y * pInst->PD_LCD_Width + out_struct.x;
+								(pInst->PD_Out_Struct.write_func)(out_struct);
 							}
 						}
 					}
 					else
 					{
-						for(i = 0;i < PD_Resized_Width;i++)
+						for(i = 0;i < pInst->PD_Resized_Width;i++)
 						{
-							if((PD_Pixel_Map_Hor[i] - hor_offset) % hor_inc == 0)
+							if((pInst->PD_Pixel_Map_Hor[i] - hor_offset) % hor_inc == 0)
 							{
-								out_struct.x = i + PD_Left_Offset;
-								if(out_struct.x >= PD_LCD_Width)
+								out_struct.x = i + pInst->PD_Left_Offset;
+								if(out_struct.x >= pInst->PD_LCD_Width)
 									break;
-								temp = (PD_Pixel_Map_Hor[i] - hor_offset) / hor_inc;
+								temp = (pInst->PD_Pixel_Map_Hor[i] - hor_offset) / hor_inc;
 								if(category == 0)
 									out_struct.Comp_1 = 
 									out_struct.Comp_2 = 
-									out_struct.Comp_3 = PD_Up_Scanline[temp * PD_Bpp];
+									out_struct.Comp_3 = pInst->PD_Up_Scanline[temp * pInst->PD_Bpp];
 								else
 									out_struct.Comp_1 = 
 									out_struct.Comp_2 = 
-									out_struct.Comp_3 = ((PD_Up_Scanline[temp / ppb] & PD_Data_Mask[temp & idx_mask]) >> PD_Data_Shift[temp & idx_mask]) * PD_Scaler;
+									out_struct.Comp_3 = ((pInst->PD_Up_Scanline[temp / ppb] & pInst->PD_Data_Mask[temp & idx_mask]) >> pInst->PD_Data_Shift[temp & idx_mask]) * pInst->PD_Scaler;
 								
-								out_struct.Offset = out_struct.y * PD_LCD_Width + out_struct.x;
-								(PD_Out_Struct.write_func)(out_struct);
+								out_struct.Offset = out_struct.y * pInst->PD_LCD_Width + out_struct.x;
+								(pInst->PD_Out_Struct.write_func)(out_struct);
 							}
 						}
 					}
 				}
 				if(num_row == 0)
 				{
-					PD_Row++;
+					pInst->PD_Row++;
 					return PD_PROCESS_DONE;
 				}
 			}
 		}
-		while(PD_Resize_Ver_Idx != PD_ADAM7_Height)
+		while(pInst->PD_Resize_Ver_Idx != pInst->PD_ADAM7_Height)
 		{
-			if(PNG_Defiltering(PD_Scanline_Size, PD_Absolute_Skip) == PD_PROCESS_ERROR)
+			if(PNG_Defiltering(pInst, pInst->PD_Scanline_Size, PD_Absolute_Skip) == PD_PROCESS_ERROR)
 				return PD_PROCESS_ERROR;
 			num_row--;
-			PD_Resize_Ver_Idx++;
+			pInst->PD_Resize_Ver_Idx++;
 			if(num_row == 0)
 			{
-				PD_Row++;
+				pInst->PD_Row++;
 				return PD_PROCESS_DONE;
 			}
 		}
@@ -2886,7 +4673,7 @@ static int Image_Resize_Grey_ADAM7(void)
 }
 
 
-static int Image_Resize_True_ADAM7(void)
+static int Image_Resize_True_ADAM7(PD_INSTANCE *pInst)
 {
 	int i;
 	uint32 hor_inc, ver_inc, hor_offset, ver_offset;
@@ -2897,79 +4684,87 @@ static int Image_Resize_True_ADAM7(void)
 	IM_PIX_INFO out_struct;
 	out_struct.Src_Fmt = IM_SRC_RGB;
 
-	if(PD_Bit_Depth == 8)
+	if(pInst->PD_Bit_Depth == 8)
 		offset = 1;
 	else
 		offset = 2;
 	
 	while(1)
 	{
-		if(PD_Remaining_Row == 0 && PD_Resize_Ver_Idx == PD_ADAM7_Height)
-			PNG_Init_ADAM7_Map(PD_Current_Pass + 1);
+		if(pInst->PD_Remaining_Row == 0 && pInst->PD_Resize_Ver_Idx == pInst->PD_ADAM7_Height)
+			PNG_Init_ADAM7_Map(pInst, pInst->PD_Current_Pass + 1);
+
+	#if defined(PNGDEC_OPT_ADAM7_THUMBNAIL)
+		if(pInst->PD_Thumb_Pass && pInst->PD_Current_Pass > pInst->PD_Thumb_Pass)
+		{
+			pInst->PD_Last_IDAT = PD_DONE_ALREADY;	//no sample in the passes left
+			break;
+		}
+	#endif
 
 		QUEUE_POP_CHECK(prepared_bytes);
 		prepared_bytes--;
-		num_row = prepared_bytes / (PD_Scanline_Size + 1);
+		num_row = prepared_bytes / (pInst->PD_Scanline_Size + 1);
 		
 		if(num_row == 0)
 			break;
 
-		if(num_row > PD_Remaining_Row)
-			num_row = PD_Remaining_Row;
+		if(num_row > pInst->PD_Remaining_Row)
+			num_row = pInst->PD_Remaining_Row;
 
-		PD_Remaining_Row -= num_row;
+		pInst->PD_Remaining_Row -= num_row;
 		
-		hor_inc = PDRO_Hor_Incre[PD_Current_Pass - 1];
-		ver_inc = PDRO_Ver_Incre[PD_Current_Pass - 1];
-		hor_offset = PDRO_Hor_Start[PD_Current_Pass - 1];
-		ver_offset = PDRO_Ver_Start[PD_Current_Pass - 1];
+		hor_inc = PDRO_Hor_Incre[pInst->PD_Current_Pass - 1];
+		ver_inc = PDRO_Ver_Incre[pInst->PD_Current_Pass - 1];
+		hor_offset = PDRO_Hor_Start[pInst->PD_Current_Pass - 1];
+		ver_offset = PDRO_Ver_Start[pInst->PD_Current_Pass - 1];
 
-		for(;PD_Row < PD_Resized_Height;PD_Row++)
+		for(;pInst->PD_Row < pInst->PD_Resized_Height;pInst->PD_Row++)
 		{
-			if((PD_Pixel_Map_Ver[PD_Row] - ver_offset) % ver_inc == 0)
+			if((pInst->PD_Pixel_Map_Ver[pInst->PD_Row] - ver_offset) % ver_inc == 0)
 			{
-				temp = (PD_Pixel_Map_Ver[PD_Row] - ver_offset) / ver_inc;
-				while(PD_Resize_Ver_Idx != temp)
+				temp = (pInst->PD_Pixel_Map_Ver[pInst->PD_Row] - ver_offset) / ver_inc;
+				while(pInst->PD_Resize_Ver_Idx != temp)
 				{
-					if(PNG_Defiltering(PD_Scanline_Size, PD_Absolute_Perform) == PD_PROCESS_ERROR)
+					if(PNG_Defiltering(pInst, pInst->PD_Scanline_Size, PD_Absolute_Perform) == PD_PROCESS_ERROR)
 						return PD_PROCESS_ERROR;
 					num_row--;
-					PD_Resize_Ver_Idx++;
+					pInst->PD_Resize_Ver_Idx++;
 					if(num_row == 0)
 						return PD_PROCESS_DONE;
 				}
 
-				if(PNG_Defiltering(PD_Scanline_Size, PD_Absolute_Perform) == PD_PROCESS_ERROR)
+				if(PNG_Defiltering(pInst, pInst->PD_Scanline_Size, PD_Absolute_Perform) == PD_PROCESS_ERROR)
 					return PD_PROCESS_ERROR;
 				num_row--;
-				PD_Resize_Ver_Idx++;
+				pInst->PD_Resize_Ver_Idx++;
 
-				out_struct.y = PD_Row + PD_Top_Offset;
-				if(out_struct.y < PD_LCD_Height)
+				out_struct.y = pInst->PD_Row + pInst->PD_Top_Offset;
+				if(out_struct.y < pInst->PD_LCD_Height)
 				{
-					if(PD_Color_Type == PD_COLOR_TRUE_ALPHA)
+					if(pInst->PD_Color_Type == PD_COLOR_TRUE_ALPHA)
 					{
-						for(i = 0;i < PD_Resized_Width;i++)
+						for(i = 0;i < pInst->PD_Resized_Width;i++)
 						{
-							if((PD_Pixel_Map_Hor[i] - hor_offset) % hor_inc == 0)
+							if((pInst->PD_Pixel_Map_Hor[i] - hor_offset) % hor_inc == 0)
 							{
-								out_struct.x = i + PD_Left_Offset;
-								if(out_struct.x >= PD_LCD_Width)
+								out_struct.x = i + pInst->PD_Left_Offset;
+								if(out_struct.x >= pInst->PD_LCD_Width)
 									break;
-								temp = (PD_Pixel_Map_Hor[i] - hor_offset) / hor_inc;
-								out_struct.Comp_1 = PD_Up_Scanline[temp * PD_Bpp];
-								out_struct.Comp_2 = PD_Up_Scanline[temp * PD_Bpp + offset];
-								out_struct.Comp_3 = PD_Up_Scanline[temp * PD_Bpp + offset * 2];
+								temp = (pInst->PD_Pixel_Map_Hor[i] - hor_offset) / hor_inc;
+								out_struct.Comp_1 = pInst->PD_Up_Scanline[temp * pInst->PD_Bpp];
+								out_struct.Comp_2 = pInst->PD_Up_Scanline[temp * pInst->PD_Bpp + offset];
+								out_struct.Comp_3 = pInst->PD_Up_Scanline[temp * pInst->PD_Bpp + offset * 2];
 
-								if(PD_Alpha_Use == 1)
-									out_struct.Comp_4 = PD_Up_Scanline[temp * PD_Bpp + offset * 3];
+								if(pInst->PD_Alpha_Use == 1)
+									out_struct.Comp_4 = pInst->PD_Up_Scanline[temp * pInst->PD_Bpp + offset * 3];
 							#if defined(PNGDEC_MOD_RGB_COMP4_RESET)
 								else
 									out_struct.Comp_4 = 0;
 							#endif
 								
-								out_struct.Offset = out_struct.y * PD_LCD_Width + out_struct.x;
-								(PD_Out_Struct.write_func)(out_struct);
+								out_struct.Offset = out_struct.y * pInst->PD_LCD_Width + out_struct.x;
+								(pInst->PD_Out_Struct.write_func)(out_struct);
 							}
 						}
 					}
@@ -2979,40 +4774,40 @@ static int Image_Resize_True_ADAM7(void)
 						out_struct.Comp_4 = 0;
 					#endif
 
-						for(i = 0;i < PD_Resized_Width;i++)
+						for(i = 0;i < pInst->PD_Resized_Width;i++)
 						{
-							if((PD_Pixel_Map_Hor[i] - hor_offset) % hor_inc == 0)
+							if((pInst->PD_Pixel_Map_Hor[i] - hor_offset) % hor_inc == 0)
 							{
-								out_struct.x = i + PD_Left_Offset;
-								if(out_struct.x >= PD_LCD_Width)
+								out_struct.x = i + pInst->PD_Left_Offset;
+								if(out_struct.x >= pInst->PD_LCD_Width)
 									break;
-								temp = (PD_Pixel_Map_Hor[i] - hor_offset) / hor_inc;
-								out_struct.Comp_1 = PD_Up_Scanline[temp * PD_Bpp];
-								out_struct.Comp_2 = PD_Up_Scanline[temp * PD_Bpp + offset];
-								out_struct.Comp_3 = PD_Up_Scanline[temp * PD_Bpp + offset * 2];
+								temp = (pInst->PD_Pixel_Map_Hor[i] - hor_offset) / hor_inc;
+								out_struct.Comp_1 = pInst->PD_Up_Scanline[temp * pInst->PD_Bpp];
+								out_struct.Comp_2 = pInst->PD_Up_Scanline[temp * pInst->PD_Bpp + offset];
+								out_struct.Comp_3 = pInst->PD_Up_Scanline[temp * pInst->PD_Bpp + offset * 2];
 								
-								out_struct.Offset = out_struct.y * PD_LCD_Width + out_struct.x;
-								(PD_Out_Struct.write_func)(out_struct);
+								out_struct.Offset = out_struct.y * pInst->PD_LCD_Width + out_struct.x;
+								(pInst->PD_Out_Struct.write_func)(out_struct);
 							}
 						}
 					}
 				}
 				if(num_row == 0)
 				{
-					PD_Row++;
+					pInst->PD_Row++;
 					return PD_PROCESS_DONE;
 				}
 			}
 		}
-		while(PD_Resize_Ver_Idx != PD_ADAM7_Height)
+		while(pInst->PD_Resize_Ver_Idx != pInst->PD_ADAM7_Height)
 		{
-			if(PNG_Defiltering(PD_Scanline_Size, PD_Absolute_Skip) == PD_PROCESS_ERROR)
+			if(PNG_Defiltering(pInst, pInst->PD_Scanline_Size, PD_Absolute_Skip) == PD_PROCESS_ERROR)
 				return PD_PROCESS_ERROR;
 			num_row--;
-			PD_Resize_Ver_Idx++;
+			pInst->PD_Resize_Ver_Idx++;
 			if(num_row == 0)
 			{
-				PD_Row++;
+				pInst->PD_Row++;
 				return PD_PROCESS_DONE;
 			}
 		}
@@ -3021,7 +4816,7 @@ static int Image_Resize_True_ADAM7(void)
 	return PD_PROCESS_DONE;
 }
 
-static int Image_Resize_Indexed_ADAM7(void)
+static int Image_Resize_Indexed_ADAM7(PD_INSTANCE *pInst)
 {
 	int i;
 	uint32 hor_inc, ver_inc, hor_offset, ver_offset;
@@ -3034,94 +4829,102 @@ static int Image_Resize_Indexed_ADAM7(void)
 	IM_PIX_INFO out_struct;
 	out_struct.Src_Fmt = IM_SRC_RGB;
 
-	ppb = 8 / PD_Bit_Depth;
+	ppb = 8 / pInst->PD_Bit_Depth;
 	idx_mask = ppb - 1;
 
 	while(1)
 	{
-		if(PD_Remaining_Row == 0 && PD_Resize_Ver_Idx == PD_ADAM7_Height)
-			PNG_Init_ADAM7_Map(PD_Current_Pass + 1);
+		if(pInst->PD_Remaining_Row == 0 && pInst->PD_Resize_Ver_Idx == pInst->PD_ADAM7_Height)
+			PNG_Init_ADAM7_Map(pInst, pInst->PD_Current_Pass + 1);
+
+	#if defined(PNGDEC_OPT_ADAM7_THUMBNAIL)
+		if(pInst->PD_Thumb_Pass && pInst->PD_Current_Pass > pInst->PD_Thumb_Pass)
+		{
+			pInst->PD_Last_IDAT = PD_DONE_ALREADY;	//no sample in the passes left
+			break;
+		}
+	#endif
 
 		QUEUE_POP_CHECK(prepared_bytes);
 		prepared_bytes--;
-		num_row = prepared_bytes / (PD_Scanline_Size + 1);
+		num_row = prepared_bytes / (pInst->PD_Scanline_Size + 1);
 		
 		if(num_row == 0)
 			break;
 
-		if(num_row > PD_Remaining_Row)
-			num_row = PD_Remaining_Row;
+		if(num_row > pInst->PD_Remaining_Row)
+			num_row = pInst->PD_Remaining_Row;
 
-		PD_Remaining_Row -= num_row;
+		pInst->PD_Remaining_Row -= num_row;
 		
-		hor_inc = PDRO_Hor_Incre[PD_Current_Pass - 1];
-		ver_inc = PDRO_Ver_Incre[PD_Current_Pass - 1];
-		hor_offset = PDRO_Hor_Start[PD_Current_Pass - 1];
-		ver_offset = PDRO_Ver_Start[PD_Current_Pass - 1];
+		hor_inc = PDRO_Hor_Incre[pInst->PD_Current_Pass - 1];
+		ver_inc = PDRO_Ver_Incre[pInst->PD_Current_Pass - 1];
+		hor_offset = PDRO_Hor_Start[pInst->PD_Current_Pass - 1];
+		ver_offset = PDRO_Ver_Start[pInst->PD_Current_Pass - 1];
 
-		for(;PD_Row < PD_Resized_Height;PD_Row++)
+		for(;pInst->PD_Row < pInst->PD_Resized_Height;pInst->PD_Row++)
 		{
-			if((PD_Pixel_Map_Ver[PD_Row] - ver_offset) % ver_inc == 0)
+			if((pInst->PD_Pixel_Map_Ver[pInst->PD_Row] - ver_offset) % ver_inc == 0)
 			{
-				temp = (PD_Pixel_Map_Ver[PD_Row] - ver_offset) / ver_inc;
-				while(PD_Resize_Ver_Idx != temp)
+				temp = (pInst->PD_Pixel_Map_Ver[pInst->PD_Row] - ver_offset) / ver_inc;
+				while(pInst->PD_Resize_Ver_Idx != temp)
 				{
-					if(PNG_Defiltering(PD_Scanline_Size, PD_Conditional_Skip) == PD_PROCESS_ERROR)
+					if(PNG_Defiltering(pInst, pInst->PD_Scanline_Size, PD_Conditional_Skip) == PD_PROCESS_ERROR)
 						return PD_PROCESS_ERROR;
 					num_row--;
-					PD_Resize_Ver_Idx++;
+					pInst->PD_Resize_Ver_Idx++;
 					if(num_row == 0)
 						return PD_PROCESS_DONE;
 				}
 
-				if(PNG_Defiltering(PD_Scanline_Size, PD_Absolute_Perform) == PD_PROCESS_ERROR)
+				if(PNG_Defiltering(pInst, pInst->PD_Scanline_Size, PD_Absolute_Perform) == PD_PROCESS_ERROR)
 					return PD_PROCESS_ERROR;
 				num_row--;
-				PD_Resize_Ver_Idx++;
+				pInst->PD_Resize_Ver_Idx++;
 
-				out_struct.y = PD_Row + PD_Top_Offset;
-				if(out_struct.y < PD_LCD_Height)
+				out_struct.y = pInst->PD_Row + pInst->PD_Top_Offset;
+				if(out_struct.y < pInst->PD_LCD_Height)
 				{
-					for(i = 0;i < PD_Resized_Width;i++)
+					for(i = 0;i < pInst->PD_Resized_Width;i++)
 					{
-						if((PD_Pixel_Map_Hor[i] - hor_offset) % hor_inc == 0)
+						if((pInst->PD_Pixel_Map_Hor[i] - hor_offset) % hor_inc == 0)
 						{
-							out_struct.x = i + PD_Left_Offset;
-							if(out_struct.x >= PD_LCD_Width)
+							out_struct.x = i + pInst->PD_Left_Offset;
+							if(out_struct.x >= pInst->PD_LCD_Width)
 								break;
-							temp = (PD_Pixel_Map_Hor[i] - hor_offset) / hor_inc;
-							temp = (PD_Up_Scanline[temp / ppb] & PD_Data_Mask[temp & idx_mask]) >> PD_Data_Shift[temp & idx_mask];
-							out_struct.Comp_1 = PD_Plte[temp].R;
-							out_struct.Comp_2 = PD_Plte[temp].G;
-							out_struct.Comp_3 = PD_Plte[temp].B;
-							if(PD_Alpha_Use == 1)
-								out_struct.Comp_4 = PD_Plte[temp].Alpha;
+							temp = (pInst->PD_Pixel_Map_Hor[i] - hor_offset) / hor_inc;
+							temp = (pInst->PD_Up_Scanline[temp / ppb] & pInst->PD_Data_Mask[temp & idx_mask]) >> pInst->PD_Data_Shift[temp & idx_mask];
+							out_struct.Comp_1 = pInst->PD_Plte[temp].R;
+							out_struct.Comp_2 = pInst->PD_Plte[temp].G;
+							out_struct.Comp_3 = pInst->PD_Plte[temp].B;
+							if(pInst->PD_Alpha_Use == 1)
+								out_struct.Comp_4 = pInst->PD_Plte[temp].Alpha;
 						#if defined(PNGDEC_MOD_RGB_COMP4_RESET)
 							else
 								out_struct.Comp_4 = 0;
 						#endif
 							
-							out_struct.Offset = out_struct.y * PD_LCD_Width + out_struct.x;
-							(PD_Out_Struct.write_func)(out_struct);
+							out_struct.Offset = out_struct.y * pInst->PD_LCD_Width + out_struct.x;
+							(pInst->PD_Out_Struct.write_func)(out_struct);
 						}
 					}
 				}
 				if(num_row == 0)
 				{
-					PD_Row++;
+					pInst->PD_Row++;
 					return PD_PROCESS_DONE;
 				}
 			}
 		}
-		while(PD_Resize_Ver_Idx != PD_ADAM7_Height)
+		while(pInst->PD_Resize_Ver_Idx != pInst->PD_ADAM7_Height)
 		{
-			if(PNG_Defiltering(PD_Scanline_Size, PD_Absolute_Skip) == PD_PROCESS_ERROR)
+			if(PNG_Defiltering(pInst, pInst->PD_Scanline_Size, PD_Absolute_Skip) == PD_PROCESS_ERROR)
 				return PD_PROCESS_ERROR;
 			num_row--;
-			PD_Resize_Ver_Idx++;
+			pInst->PD_Resize_Ver_Idx++;
 			if(num_row == 0)
 			{
-				PD_Row++;
+				pInst->PD_Row++;
 				return PD_PROCESS_DONE;
 			}
 		}
@@ -3133,975 +4936,3506 @@ static int Image_Resize_Indexed_ADAM7(void)
 
 
 //////////////////////
-//Header Parsing Related
+//Row Output Related (PD_OUTPUT_ROW, PD_OUTPUT_SURFACE)
 //////////////////////
-static int PNG_Check_PNG_Marker(void)
+
+//The number of pixels of a row which are placed inside the LCD
+static uint32 PNG_Row_Visible(PD_INSTANCE *pInst, uint32 x, uint32 x_step, uint32 count)
 {
-	uint32 marker_ret;
+	uint32 visible;
 
-	READWORD(marker_ret);
-	if(marker_ret == PD_MARKER_PNG1)
+	if(x >= pInst->PD_LCD_Width)
+		return 0;
+
+	visible = (pInst->PD_LCD_Width - x + x_step - 1) / x_step;
+	return (count < visible) ? count : visible;
+}
+
+static void PNG_Narrow16_C(uint8 *dst, const uint8 *src, uint32 count, uint32 round)
+{
+	uint32 i;
+
+	if(round)
 	{
-		READWORD(marker_ret);
-		
-		if( PD_nPngDecErrorCode < 0 ) {
-			return PD_PROCESS_ERROR;
-		}
-	
-		if(marker_ret == PD_MARKER_PNG2)
-			return PD_PROCESS_DONE;
+		for(i = 0;i < count;i++, src += 2)
+			dst[i] = PD_SAMPLE8(src, 1);
+		return;
 	}
-	return PD_PROCESS_ERROR;
+	for(i = 0;i < count;i++, src += 2)
+		dst[i] = src[0];
 }
 
-static int PNG_Parse_IHDR_Chunk(int iOption)
+static void PNG_Swap16_C(uint16 *dst, const uint8 *src, uint32 count)
 {
-	uint32 stream_out;
-	READWORD(PD_Chunk_Size);
-	if(PD_Chunk_Size != PD_IHDR_CHUNK_SIZE)
-		return PD_PROCESS_ERROR;
-
-#if defined(PNGDEC_CHECK_CHUNK)
-	PD_nPngDecCheck_Chunk |= ( 1 << PNGDEC_CHUNK_IHDR );
-#endif
+	uint32 i;
 
-	READWORD(stream_out);
-	if(stream_out != PD_MARKER_IHDR)
-		return PD_PROCESS_ERROR;
+	for(i = 0;i < count;i++, src += 2)
+		dst[i] = (uint16)PD_LOAD_BE16(src);
+}
 
-	READWORD(PD_Global_Width);
-	READWORD(PD_Global_Height);
+#if defined(PD_DEFILTER_SSE2)
+//16 samples a step : the high byte is the low byte of a little-endian load, rounding is done as
+//(v - (v >> 8) - ((v >> 7) & 1) + 128) >> 8, which is round(v * 255 / 65535) and stays below 1 << 16
+static PD_SSE2_TARGET void PNG_Narrow16_SSE2(uint8 *dst, const uint8 *src, uint32 count, uint32 round)
+{
+	const __m128i low = _mm_set1_epi16(0x00FF);
+	const __m128i one = _mm_set1_epi16(1);
+	const __m128i half = _mm_set1_epi16(128);
+	__m128i a, b;
+	uint32 i;
 
-	READBYTE(PD_Bit_Depth);		// 1,2,4,8,16
-	#if defined(PNGDEC_STABILITY_BIT_DEPTH)
-	switch( PD_Bit_Depth )
+	for(i = 0;i + 16 <= count;i += 16)
 	{
-	case 1:
-	case 2:
-	case 4:
-	case 8:
-	case 16:
-		break;
-	default:
-		return PD_PROCESS_ERROR;
-	}	
-	#endif
-	READBYTE(PD_Color_Type);
+		a = _mm_loadu_si128((const __m128i *)(src + i * 2));
+		b = _mm_loadu_si128((const __m128i *)(src + i * 2 + 16));
+		if(round)
+		{
+			a = _mm_or_si128(_mm_slli_epi16(a, 8), _mm_srli_epi16(a, 8));
+			b = _mm_or_si128(_mm_slli_epi16(b, 8), _mm_srli_epi16(b, 8));
+			a = _mm_sub_epi16(_mm_sub_epi16(a, _mm_srli_epi16(a, 8)), _mm_and_si128(_mm_srli_epi16(a, 7), one));
+			b = _mm_sub_epi16(_mm_sub_epi16(b, _mm_srli_epi16(b, 8)), _mm_and_si128(_mm_srli_epi16(b, 7), one));
+			a = _mm_srli_epi16(_mm_add_epi16(a, half), 8);
+			b = _mm_srli_epi16(_mm_add_epi16(b, half), 8);
+		}
+		else
+		{
+			a = _mm_and_si128(a, low);
+			b = _mm_and_si128(b, low);
+		}
+		_mm_storeu_si128((__m128i *)(dst + i), _mm_packus_epi16(a, b));
+	}
+	PNG_Narrow16_C(dst + i, src + i * 2, count - i, round);
+}
 
-	READBYTE(PD_Compression_Method);
-	if(PD_Compression_Method != 0)
-		return PD_PROCESS_ERROR;
-	
-	READBYTE(stream_out);//Filter Method
-	if(stream_out != 0)
-		return PD_PROCESS_ERROR;
-	
-	READBYTE(PD_Interlace_Method);
-	if(PD_Interlace_Method > PD_INTERLACE_ADAM)
-		return PD_PROCESS_ERROR;
+static PD_SSE2_TARGET void PNG_Swap16_SSE2(uint16 *dst, const uint8 *src, uint32 count)
+{
+	__m128i a;
+	uint32 i;
 
-	if( PD_nPngDecErrorCode < 0 ) {
-		return PD_PROCESS_ERROR;
+	for(i = 0;i + 8 <= count;i += 8)
+	{
+		a = _mm_loadu_si128((const __m128i *)(src + i * 2));
+		_mm_storeu_si128((__m128i *)(dst + i), _mm_or_si128(_mm_slli_epi16(a, 8), _mm_srli_epi16(a, 8)));
 	}
+	PNG_Swap16_C(dst + i, src + i * 2, count - i);
+}
+#endif //PD_DEFILTER_SSE2
 
-#ifdef PNGDEC_SUPPORT_ISDBT_PNG
-	if( iOption& (1<<4) )
+#if defined(PD_DEFILTER_NEON)
+//16 samples a step, high and low bytes apart by vld2q_u8
+static void PNG_Narrow16_NEON(uint8 *dst, const uint8 *src, uint32 count, uint32 round)
+{
+	uint8x16x2_t v;
+	uint16x8_t a, b;
+	uint32 i;
+
+	for(i = 0;i + 16 <= count;i += 16)
 	{
-		if( 
-			( PD_Bit_Depth == 8 )
-			&& ( PD_Color_Type == 3 )
-			&& ( PD_Interlace_Method == 0 )
-		  )
+		v = vld2q_u8(src + i * 2);
+		if(round)
 		{
-			PD_Bit_Depth = 8;
-			PD_Color_Type = PD_COLOR_GREY;
+			a = vorrq_u16(vshll_n_u8(vget_low_u8(v.val[0]), 8), vmovl_u8(vget_low_u8(v.val[1])));
+			b = vorrq_u16(vshll_n_u8(vget_high_u8(v.val[0]), 8), vmovl_u8(vget_high_u8(v.val[1])));
+			a = vsubq_u16(vsubq_u16(a, vshrq_n_u16(a, 8)), vandq_u16(vshrq_n_u16(a, 7), vdupq_n_u16(1)));
+			b = vsubq_u16(vsubq_u16(b, vshrq_n_u16(b, 8)), vandq_u16(vshrq_n_u16(b, 7), vdupq_n_u16(1)));
+			vst1q_u8(dst + i, vcombine_u8(vaddhn_u16(a, vdupq_n_u16(128)), vaddhn_u16(b, vdupq_n_u16(128))));
 		}
+		else
+			vst1q_u8(dst + i, v.val[0]);
 	}
+	PNG_Narrow16_C(dst + i, src + i * 2, count - i, round);
+}
+
+static void PNG_Swap16_NEON(uint16 *dst, const uint8 *src, uint32 count)
+{
+	uint32 i;
+
+	for(i = 0;i + 8 <= count;i += 8)
+		vst1q_u8((uint8 *)(dst + i), vrev16q_u8(vld1q_u8(src + i * 2)));
+	PNG_Swap16_C(dst + i, src + i * 2, count - i);
+}
+#endif //PD_DEFILTER_NEON
+
+//Kernels for this CPU
+static Narrow16_Func_Ptr PNG_Select_Narrow16(void)
+{
+#if defined(PD_DEFILTER_SSE2)
+	if(PD_SSE2_CHECK())
+		return PNG_Narrow16_SSE2;
+#elif defined(PD_DEFILTER_NEON)
+	return PNG_Narrow16_NEON;
 #endif
+	return PNG_Narrow16_C;
+}
 
-	if((PD_LCD_Width >= PD_Global_Width) && (PD_LCD_Height >= PD_Global_Height))
-		PD_Image_Smaller_LCD = PD_TRUE;
-	else
-		PD_Image_Smaller_LCD = PD_FALSE;
+static Swap16_Func_Ptr PNG_Select_Swap16(void)
+{
+#if defined(PD_DEFILTER_SSE2)
+	if(PD_SSE2_CHECK())
+		return PNG_Swap16_SSE2;
+#elif defined(PD_DEFILTER_NEON)
+	return PNG_Swap16_NEON;
+#endif
+	return PNG_Swap16_C;
+}
+
+//Convert pixels of PD_Up_Scanline into PD_Row_Buf (IM_ROW_PIXEL_SIZE bytes per pixel)
+//	map == NULL : i-th pixel comes from source pixel (start + i)
+//	map != NULL : i-th pixel comes from source pixel ((map[i] - map_off) >> map_shift)
+#define PD_ROW_SRC(i)	((map == NULL) ? (start + (i)) : (((uint32)map[i] - map_off) >> map_shift))
+
+#if defined(PNGDEC_OPT_PLTE_LUT)
+static void PNG_Plte_Expand_C(uint32 *dst, const uint8 *src, const uint32 *lut, uint32 count)
+{
+	uint32 i;
 
-	switch(PD_Color_Type)
+	for(i = 0;i + 4 <= count;i += 4)
 	{
-	case PD_COLOR_GREY:
-		if(!(PD_Bit_Depth == 1 || PD_Bit_Depth == 2 || PD_Bit_Depth == 4 || PD_Bit_Depth == 8 || PD_Bit_Depth == 16))
-			return PD_PROCESS_ERROR;
-			
-		if(PD_Image_Smaller_LCD == PD_TRUE)
+		dst[i] = lut[src[i]];
+		dst[i + 1] = lut[src[i + 1]];
+		dst[i + 2] = lut[src[i + 2]];
+		dst[i + 3] = lut[src[i + 3]];
+	}
+	for(;i < count;i++)
+		dst[i] = lut[src[i]];
+}
+
+#if defined(PD_PLTE_AVX2)
+//8 indices widened to 32 bits and gathered from lut at once
+static PD_PLTE_AVX2_TARGET void PNG_Plte_Expand_AVX2(uint32 *dst, const uint8 *src, const uint32 *lut, uint32 count)
+{
+	__m256i idx;
+	uint32 i;
+
+	for(i = 0;i + 8 <= count;i += 8)
+	{
+		idx = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)(src + i)));
+		_mm256_storeu_si256((__m256i *)(dst + i), _mm256_i32gather_epi32((const int *)lut, idx, 4));
+	}
+	for(;i < count;i++)
+		dst[i] = lut[src[i]];
+}
+#endif //PD_PLTE_AVX2
+
+//Kernel for this CPU (a 1 KB table is beyond the NEON table lookups : C on ARM)
+static Plte_Func_Ptr PNG_Select_Plte(void)
+{
+#if defined(PD_PLTE_AVX2)
+	if(PD_PLTE_AVX2_CHECK())
+		return PNG_Plte_Expand_AVX2;
+#endif
+	return PNG_Plte_Expand_C;
+}
+
+//Fold PD_Plte (and its tRNS alpha), or the levels of a 1/2/4-bit grey image, into the tables of the output,
+//once the output is known
+static void PNG_Init_Plte_Lut(PD_INSTANCE *pInst)
+{
+	uint8 *entry;
+	uint32 i, num, r, g, b, alpha;
+
+	if(pInst->PD_Color_Type == PD_COLOR_INDEX)
+		num = PD_PLTE_TABLE_IDX;
+	else if(pInst->PD_Color_Type == PD_COLOR_GREY && pInst->PD_Bit_Depth < 8)
+		num = (uint32)1 << pInst->PD_Bit_Depth;
+	else
+	{
+		pInst->PD_Plte_On = 0;
+		return;
+	}
+
+	pInst->PD_Plte_On = 1;
+	pInst->PD_Plte_Direct = (pInst->PD_Out_Struct.OUTPUT_MODE == PD_OUTPUT_SURFACE &&
+							 (pInst->PD_Out_Struct.DST_FORMAT == PD_PIXFMT_ARGB8888 ||
+							  pInst->PD_Out_Struct.DST_FORMAT == PD_PIXFMT_RGB565 ||
+							  PD_PIXFMT_IS_GREY(pInst->PD_Out_Struct.DST_FORMAT)));
+
+	for(i = 0;i < num;i++)
+	{
+		if(pInst->PD_Color_Type == PD_COLOR_INDEX)
 		{
-			if(PD_Interlace_Method == PD_INTERLACE_ADAM)
-				PNG_Decode_Image = Image_Origin_Grey_ADAM7;
-			else
-				PNG_Decode_Image = Image_Origin_Grey;
+			r = pInst->PD_Plte[i].R;
+			g = pInst->PD_Plte[i].G;
+			b = pInst->PD_Plte[i].B;
+			alpha = (pInst->PD_Alpha_Use == 1) ? pInst->PD_Plte[i].Alpha : 0;
 		}
 		else
 		{
-			if(PD_Interlace_Method == PD_INTERLACE_ADAM)
-				PNG_Decode_Image = Image_Resize_Grey_ADAM7;
-			else
-				PNG_Decode_Image = Image_Resize_Grey;
+			r = g = b = (uint8)(i * pInst->PD_Scaler);
+			alpha = 0;		//no alpha channel (PNG_Convert_Row)
 		}
-		PD_Compo_Num = 1;
-		break;
-	case PD_COLOR_TRUE:
-		if(!(PD_Bit_Depth == 8 || PD_Bit_Depth == 16))
-			return PD_PROCESS_ERROR;
 
-		if(PD_Image_Smaller_LCD == PD_TRUE)
+		entry = (uint8 *)&pInst->PD_Plte_Row[i];
+		entry[0] = (uint8)r;
+		entry[1] = (uint8)g;
+		entry[2] = (uint8)b;
+		entry[3] = (uint8)alpha;
+
+		if(pInst->PD_Out_Struct.DST_FORMAT == PD_PIXFMT_RGB565)
+			pInst->PD_Plte_Dst[i] = ((r & 0xF8) << 8) | ((g & 0xFC) << 3) | (b >> 3);
+		else if(PD_PIXFMT_IS_GREY(pInst->PD_Out_Struct.DST_FORMAT))	//L8 : grey, LA88 : grey, alpha << 8
+			pInst->PD_Plte_Dst[i] = PD_RGB2L(r, g, b) | (((pInst->PD_Alpha_Use == 1) ? alpha : 0xFF) << 8);
+		else
+			pInst->PD_Plte_Dst[i] = (((pInst->PD_Alpha_Use == 1) ? alpha : 0xFF) << 24) | (r << 16) | (g << 8) | b;
+	}
+}
+
+//Expand count palette indices (or grey levels) of PD_Up_Scanline into out, out_step entries apart, through lut
+//	1, 2 and 4-bit indices are taken a whole byte at a time with constant shifts once start is on a byte
+#define PD_IDX_SUB(s)		((src[(s) >> ppb_shift] >> (8 - bit_depth * (((s) & idx_mask) + 1))) & val_mask)
+#define PD_IDX_PUT(k, v)	out[(k) * out_step] = lut[v]
+
+static void PNG_Expand_Indexed(PD_INSTANCE *pInst, const uint32 *lut, uint32 *out, uint32 out_step, uint32 count,
+							   uint32 start, const uint16 *map, uint32 map_off, uint32 map_shift)
+{
+	const uint8 *src = pInst->PD_Up_Scanline;
+	uint32 bit_depth = pInst->PD_Bit_Depth;
+	uint32 ppb_shift = (bit_depth == 1) ? 3 : ((bit_depth == 2) ? 2 : 1);	//log2(pixel per byte)
+	uint32 idx_mask = (1 << ppb_shift) - 1;
+	uint32 val_mask = (1 << bit_depth) - 1;
+	uint32 i = 0, s, b;
+
+	if(bit_depth == 8)
+	{
+		if(map == NULL && out_step == 1)
 		{
-			if(PD_Interlace_Method == PD_INTERLACE_ADAM)
-				PNG_Decode_Image = Image_Origin_True_ADAM7;
-			else
-				PNG_Decode_Image = Image_Origin_True;
+			(pInst->PD_Plte_Expand)(out, src + start, lut, count);
+			return;
 		}
-		else
+		for(;i < count;i++, out += out_step)
+			*out = lut[src[PD_ROW_SRC(i)]];
+		return;
+	}
+
+	if(map == NULL)
+	{
+		for(;i < count && ((start + i) & idx_mask);i++, out += out_step)
+			*out = lut[PD_IDX_SUB(start + i)];
+
+		s = (start + i) >> ppb_shift;
+		switch(bit_depth)
 		{
-			if(PD_Interlace_Method == PD_INTERLACE_ADAM)
-				PNG_Decode_Image = Image_Resize_True_ADAM7;
-			else
-				PNG_Decode_Image = Image_Resize_True;
+		case 1:
+			for(;i + 8 <= count;i += 8, out += 8 * out_step)
+			{
+				b = src[s++];
+				PD_IDX_PUT(0, b >> 7);			PD_IDX_PUT(1, (b >> 6) & 1);
+				PD_IDX_PUT(2, (b >> 5) & 1);	PD_IDX_PUT(3, (b >> 4) & 1);
+				PD_IDX_PUT(4, (b >> 3) & 1);	PD_IDX_PUT(5, (b >> 2) & 1);
+				PD_IDX_PUT(6, (b >> 1) & 1);	PD_IDX_PUT(7, b & 1);
+			}
+			break;
+		case 2:
+			for(;i + 4 <= count;i += 4, out += 4 * out_step)
+			{
+				b = src[s++];
+				PD_IDX_PUT(0, b >> 6);			PD_IDX_PUT(1, (b >> 4) & 3);
+				PD_IDX_PUT(2, (b >> 2) & 3);	PD_IDX_PUT(3, b & 3);
+			}
+			break;
+		default:
+			for(;i + 2 <= count;i += 2, out += 2 * out_step)
+			{
+				b = src[s++];
+				PD_IDX_PUT(0, b >> 4);			PD_IDX_PUT(1, b & 15);
+			}
+			break;
 		}
-		PD_Compo_Num = 3;
-		break;
-	case PD_COLOR_INDEX:
-		if(!(PD_Bit_Depth == 1 || PD_Bit_Depth == 2 || PD_Bit_Depth == 4 || PD_Bit_Depth == 8))
-			return PD_PROCESS_ERROR;
+	}
+
+	for(;i < count;i++, out += out_step)
+	{
+		s = PD_ROW_SRC(i);
+		*out = lut[PD_IDX_SUB(s)];
+	}
+}
+
+#undef PD_IDX_SUB
+#undef PD_IDX_PUT
+#endif //PNGDEC_OPT_PLTE_LUT
+
+//16-bit rows : a run of the source is narrowed at once into the front of PD_Row_Buf, then spread
+//backwards into IM_ROW_PIXEL_SIZE bytes per pixel (pixel i is written past the samples of pixels below i)
+static void PNG_Convert_Row16(PD_INSTANCE *pInst, uint32 count, uint32 start, const uint16 *map, uint32 map_off, uint32 map_shift)
+{
+	const uint8 *src = pInst->PD_Up_Scanline;
+	uint8 *dst = pInst->PD_Row_Buf;
+	uint32 channels = pInst->PD_Bpp >> 1;
+	uint32 round = pInst->PD_Round16;
+	uint32 alpha_on = (pInst->PD_Alpha_Use == 1 && (channels == 2 || channels == 4));
+	const uint8 *p;
+	uint8 *px;
+	uint32 i;
+	uint8 r, g, b;
+
+	if(map == NULL)
+	{
+		(pInst->PD_Narrow16)(dst, src + start * pInst->PD_Bpp, count * channels, round);
+		switch(channels)
+		{
+		case 4:
+			if(!alpha_on)
+				for(i = 0;i < count;i++)
+					dst[i * IM_ROW_PIXEL_SIZE + 3] = 0;
+			break;
+		case 3:
+			for(i = count;i-- > 0;)
+			{
+				p = dst + i * 3;
+				px = dst + i * IM_ROW_PIXEL_SIZE;
+				r = p[0];
+				g = p[1];
+				b = p[2];
+				px[0] = r;
+				px[1] = g;
+				px[2] = b;
+				px[3] = 0;
+			}
+			break;
+		case 2:
+			for(i = count;i-- > 0;)
+			{
+				p = dst + i * 2;
+				px = dst + i * IM_ROW_PIXEL_SIZE;
+				g = p[0];
+				b = alpha_on ? p[1] : 0;
+				px[0] = px[1] = px[2] = g;
+				px[3] = b;
+			}
+			break;
+		default:
+			for(i = count;i-- > 0;)
+			{
+				px = dst + i * IM_ROW_PIXEL_SIZE;
+				g = dst[i];
+				px[0] = px[1] = px[2] = g;
+				px[3] = 0;
+			}
+			break;
+		}
+		return;
+	}
 
-		if(PD_Image_Smaller_LCD == PD_TRUE)
+	for(i = 0;i < count;i++, dst += IM_ROW_PIXEL_SIZE)
+	{
+		p = src + PD_ROW_SRC(i) * pInst->PD_Bpp;
+		if(channels >= 3)
 		{
-			if(PD_Interlace_Method == PD_INTERLACE_ADAM)
-				PNG_Decode_Image = Image_Origin_Indexed_ADAM7;
-			else
-				PNG_Decode_Image = Image_Origin_Indexed;
+			dst[0] = PD_SAMPLE8(p, round);
+			dst[1] = PD_SAMPLE8(p + 2, round);
+			dst[2] = PD_SAMPLE8(p + 4, round);
 		}
 		else
+			dst[0] = dst[1] = dst[2] = PD_SAMPLE8(p, round);
+		dst[3] = alpha_on ? PD_SAMPLE8(p + (channels - 1) * 2, round) : 0;
+	}
+}
+
+static void PNG_Convert_Row(PD_INSTANCE *pInst, uint32 count, uint32 start, const uint16 *map, uint32 map_off, uint32 map_shift)
+{
+	const uint8 *src = pInst->PD_Up_Scanline;
+	uint8 *dst = pInst->PD_Row_Buf;
+	uint32 bpp = pInst->PD_Bpp;
+	uint32 i, s;
+
+	if(pInst->PD_Bit_Depth == 16)
+	{
+		PNG_Convert_Row16(pInst, count, start, map, map_off, map_shift);
+		return;
+	}
+
+#if defined(PNGDEC_OPT_PLTE_LUT)
+	if(pInst->PD_Plte_On)
+	{
+		PNG_Expand_Indexed(pInst, pInst->PD_Plte_Row, (uint32 *)dst, 1, count, start, map, map_off, map_shift);
+		return;
+	}
+#endif
+
+	if(pInst->PD_Bit_Depth < 8)
+	{
+		uint32 bit_depth = pInst->PD_Bit_Depth;
+		uint32 ppb_shift = (bit_depth == 1) ? 3 : ((bit_depth == 2) ? 2 : 1);	//log2(pixel per byte)
+		uint32 idx_mask = (1 << ppb_shift) - 1;
+		uint32 val_mask = (1 << bit_depth) - 1;
+		uint32 value;
+
+		for(i = 0;i < count;i++, dst += IM_ROW_PIXEL_SIZE)
 		{
-			if(PD_Interlace_Method == PD_INTERLACE_ADAM)
-				PNG_Decode_Image = Image_Resize_Indexed_ADAM7;
+			s = PD_ROW_SRC(i);
+			value = (src[s >> ppb_shift] >> (8 - bit_depth * ((s & idx_mask) + 1))) & val_mask;
+			if(pInst->PD_Color_Type == PD_COLOR_INDEX)
+			{
+				dst[0] = pInst->PD_Plte[value].R;
+				dst[1] = pInst->PD_Plte[value].G;
+				dst[2] = pInst->PD_Plte[value].B;
+				dst[3] = (pInst->PD_Alpha_Use == 1) ? pInst->PD_Plte[value].Alpha : 0;
+			}
 			else
-				PNG_Decode_Image = Image_Resize_Indexed;
+			{
+				dst[0] = dst[1] = dst[2] = (uint8)(value * pInst->PD_Scaler);
+				dst[3] = 0;
+			}
 		}
-		PD_Compo_Num = 1;
-		break;
-	case PD_COLOR_GREY_ALPHA:
-		if(!(PD_Bit_Depth == 8 || PD_Bit_Depth == 16))
-			return PD_PROCESS_ERROR;
+		return;
+	}
 
-		if(PD_Image_Smaller_LCD == PD_TRUE)
+	switch(pInst->PD_Color_Type)
+	{
+	case PD_COLOR_GREY:
+		for(i = 0;i < count;i++, dst += IM_ROW_PIXEL_SIZE)
 		{
-			if(PD_Interlace_Method == PD_INTERLACE_ADAM)
-				PNG_Decode_Image = Image_Origin_Grey_ADAM7;
-			else
-				PNG_Decode_Image = Image_Origin_Grey;
+			s = PD_ROW_SRC(i) * bpp;
+			dst[0] = dst[1] = dst[2] = src[s];
+			dst[3] = 0;
 		}
-		else
+		break;
+	case PD_COLOR_GREY_ALPHA:
+		for(i = 0;i < count;i++, dst += IM_ROW_PIXEL_SIZE)
 		{
-			if(PD_Interlace_Method == PD_INTERLACE_ADAM)
-				PNG_Decode_Image = Image_Resize_Grey_ADAM7;
-			else
-				PNG_Decode_Image = Image_Resize_Grey;
+			s = PD_ROW_SRC(i) * bpp;
+			dst[0] = dst[1] = dst[2] = src[s];
+			dst[3] = (pInst->PD_Alpha_Use == 1) ? src[s + 1] : 0;
 		}
-		PD_Alpha_Available = PD_ALPHA_AVAILABLE;
-		PD_Compo_Num = 2;
 		break;
+	case PD_COLOR_TRUE:
 	case PD_COLOR_TRUE_ALPHA:
-		if(!(PD_Bit_Depth == 8 || PD_Bit_Depth == 16))
-			return PD_PROCESS_ERROR;
-
-		if(PD_Image_Smaller_LCD == PD_TRUE)
+		for(i = 0;i < count;i++, dst += IM_ROW_PIXEL_SIZE)
 		{
-			if(PD_Interlace_Method == PD_INTERLACE_ADAM)
-				PNG_Decode_Image = Image_Origin_True_ADAM7;
-			else
-				PNG_Decode_Image = Image_Origin_True;
+			s = PD_ROW_SRC(i) * bpp;
+			dst[0] = src[s];
+			dst[1] = src[s + 1];
+			dst[2] = src[s + 2];
+			dst[3] = (pInst->PD_Alpha_Use == 1 && pInst->PD_Color_Type == PD_COLOR_TRUE_ALPHA) ? src[s + 3] : 0;
 		}
-		else
+		break;
+	case PD_COLOR_INDEX:
+		for(i = 0;i < count;i++, dst += IM_ROW_PIXEL_SIZE)
 		{
-			if(PD_Interlace_Method == PD_INTERLACE_ADAM)
-				PNG_Decode_Image = Image_Resize_True_ADAM7;
-			else
-				PNG_Decode_Image = Image_Resize_True;
+			s = src[PD_ROW_SRC(i)];
+			dst[0] = pInst->PD_Plte[s].R;
+			dst[1] = pInst->PD_Plte[s].G;
+			dst[2] = pInst->PD_Plte[s].B;
+			dst[3] = (pInst->PD_Alpha_Use == 1) ? pInst->PD_Plte[s].Alpha : 0;
 		}
-		PD_Alpha_Available = PD_ALPHA_AVAILABLE;
-		PD_Compo_Num = 4;
 		break;
-	default :
-		return PD_PROCESS_ERROR;
 	}
+}
 
-	switch(PD_Bit_Depth)
+//Write the palette indices of PD_Up_Scanline into the surface (PD_PIXFMT_INDEX8, PD_PIXFMT_INDEX_PACKED)
+static void PNG_Write_Index_Row(PD_INSTANCE *pInst, uint32 x, uint32 x_step, uint32 y, uint32 count,
+								uint32 start, const uint16 *map, uint32 map_off, uint32 map_shift)
+{
+	const uint8 *src = pInst->PD_Up_Scanline;
+	uint8 *dst = pInst->PD_Out_Struct.pDstAddr[0] + (long)y * pInst->PD_Out_Struct.iDstPitch[0];
+	uint32 bit_depth = pInst->PD_Bit_Depth;
+	uint32 ppb_shift = (bit_depth == 1) ? 3 : ((bit_depth == 2) ? 2 : ((bit_depth == 4) ? 1 : 0));	//log2(pixel per byte)
+	uint32 idx_mask = (1 << ppb_shift) - 1;
+	uint32 val_mask = (1 << bit_depth) - 1;
+	uint32 i = 0, s, shift, value;
+
+	if(pInst->PD_Out_Struct.DST_FORMAT == PD_PIXFMT_INDEX8 || bit_depth == 8)
 	{
-	case 1:
-		PD_Data_Mask = PDRO_Depth_Mask;
-		PD_Data_Shift = PDRO_Depth_Shift;
-		break;
-	case 2:
-		PD_Data_Mask = &(PDRO_Depth_Mask[8]);
-		PD_Data_Shift = &(PDRO_Depth_Shift[8]);
-		break;
-	case 4:
-		PD_Data_Mask = &(PDRO_Depth_Mask[12]);
-		PD_Data_Shift = &(PDRO_Depth_Shift[12]);
-		break;
-	case 8:
-		PD_Data_Mask = &(PDRO_Depth_Mask[14]);
-		PD_Data_Shift = &(PDRO_Depth_Shift[14]);
-		break;
-	default:
-		break;
+		if(bit_depth == 8 && map == NULL && x_step == 1)
+		{
+			memcpy(dst + x, src + start, count);
+			return;
+		}
+		for(;i < count;i++, x += x_step)
+		{
+			s = PD_ROW_SRC(i);
+			dst[x] = (uint8)((src[s >> ppb_shift] >> (8 - bit_depth * ((s & idx_mask) + 1))) & val_mask);
+		}
+		return;
 	}
 
-	PD_Scaler = 255 / (((uint32)1 << PD_Bit_Depth) - 1);
+	//packed : whole bytes are copied where the source and the surface bits line up
+	if(map == NULL && x_step == 1 && ((x ^ start) & idx_mask) == 0)
+	{
+		for(;i < count && ((x + i) & idx_mask);i++)
+		{
+			s = start + i;
+			shift = 8 - bit_depth * (((x + i) & idx_mask) + 1);
+			value = (src[s >> ppb_shift] >> shift) & val_mask;
+			dst[(x + i) >> ppb_shift] = (uint8)((dst[(x + i) >> ppb_shift] & ~(val_mask << shift)) | (value << shift));
+		}
+		s = (count - i) >> ppb_shift;
+		memcpy(dst + ((x + i) >> ppb_shift), src + ((start + i) >> ppb_shift), s);
+		i += s << ppb_shift;
+		x += i;
+	}
 
-	return PNG_Check_CRC();
+	for(;i < count;i++, x += x_step)
+	{
+		s = PD_ROW_SRC(i);
+		value = (src[s >> ppb_shift] >> (8 - bit_depth * ((s & idx_mask) + 1))) & val_mask;
+		shift = 8 - bit_depth * ((x & idx_mask) + 1);
+		dst[x >> ppb_shift] = (uint8)((dst[x >> ppb_shift] & ~(val_mask << shift)) | (value << shift));
+	}
 }
 
-static int PNG_Search_PLTE_Chunk(void)
+//Write the samples of a grey (+ alpha) PD_Up_Scanline into the surface (PD_PIXFMT_L8, PD_PIXFMT_LA88)
+//	8-bit rows in the layout of the surface are copied, 16-bit ones narrowed by PD_Narrow16
+static void PNG_Write_Grey_Row(PD_INSTANCE *pInst, uint32 x, uint32 x_step, uint32 y, uint32 count,
+							   uint32 start, const uint16 *map, uint32 map_off, uint32 map_shift)
 {
-	int iteration = 50;
-	uint32 stream_out;
-
-	while(iteration--)
+	const uint8 *src = pInst->PD_Up_Scanline;
+	uint8 *dst = pInst->PD_Out_Struct.pDstAddr[0] + (long)y * pInst->PD_Out_Struct.iDstPitch[0];
+	uint32 bpp = pInst->PD_Bpp;
+	uint32 offset = (pInst->PD_Bit_Depth == 16) ? 2 : 1;
+	uint32 round = pInst->PD_Round16;
+	uint32 size = (pInst->PD_Out_Struct.DST_FORMAT == PD_PIXFMT_LA88) ? 2 : 1;
+	uint32 alpha_on = (pInst->PD_Alpha_Use == 1 && pInst->PD_Color_Type == PD_COLOR_GREY_ALPHA);
+	uint8 alpha = (pInst->PD_Alpha_Use == 1) ? 0 : 0xFF;	//no alpha channel : as PNG_Convert_Row and ARGB8888
+	uint8 *out = dst + x * size;
+	uint32 i, s;
+
+	//1/2/4-bit grey without PNGDEC_OPT_PLTE_LUT (PD_Plte_Dst otherwise)
+	if(pInst->PD_Bit_Depth < 8)
 	{
-		READWORD(PD_Chunk_Size);
-		READWORD(stream_out);
+		uint32 bit_depth = pInst->PD_Bit_Depth;
+		uint32 ppb_shift = (bit_depth == 1) ? 3 : ((bit_depth == 2) ? 2 : 1);	//log2(pixel per byte)
+		uint32 idx_mask = (1 << ppb_shift) - 1;
+		uint32 val_mask = (1 << bit_depth) - 1;
 
-		if( PD_nPngDecErrorCode < 0 ) {
-			return PD_PROCESS_ERROR;
-		}
-		
-		switch(stream_out)
+		for(i = 0;i < count;i++, out += x_step * size)
 		{
-		case PD_MARKER_tIME:
-		case PD_MARKER_zTXt:
-		case PD_MARKER_tEXt:
-		case PD_MARKER_iTXt:
-		case PD_MARKER_pHYs:
-		case PD_MARKER_sPLT:
-		case PD_MARKER_iCCP:
-		case PD_MARKER_sRGB:
-		case PD_MARKER_sBIT:
-		case PD_MARKER_gAMA:
-		case PD_MARKER_cHRM:	
-	#if defined(PNGDEC_ADD_ANCILLARY_CHUNK_EXT120130)
-		case PD_MARKER_fRAc:
-		case PD_MARKER_gIFg:
-		case PD_MARKER_gIFt:
-		case PD_MARKER_gIFx:
-		case PD_MARKER_oFFs:
-		case PD_MARKER_pCAL:
-		case PD_MARKER_sCAL:
-		case PD_MARKER_sTER:			
-	#endif
-	#if defined(PNGDEC_SKIP_TRNS_BEFORE_PLTE)
-		case PD_MARKER_tRNS:
-	#endif
-			PNG_Skip_Current_Chunk();
-			break;
-		case PD_MARKER_IHDR:
-		case PD_MARKER_IDAT:
-		case PD_MARKER_IEND:
-			return PD_PROCESS_ERROR;
+			s = PD_ROW_SRC(i);
+			out[0] = (uint8)(((src[s >> ppb_shift] >> (8 - bit_depth * ((s & idx_mask) + 1))) & val_mask) * pInst->PD_Scaler);
+			if(size == 2)
+				out[1] = alpha;
+		}
+		return;
+	}
 
-		case PD_MARKER_bKGD:
-		case PD_MARKER_hIST:
-	#if !defined(PNGDEC_SKIP_TRNS_BEFORE_PLTE)
-		case PD_MARKER_tRNS:
-			return PD_PROCESS_ERROR;
-	#endif
+	if(map == NULL && x_step == 1 && bpp == size * offset && (size == 1 || alpha_on))
+	{
+		if(offset == 2)
+			(pInst->PD_Narrow16)(out, src + start * bpp, count * size, round);
+		else
+			memcpy(out, src + start * bpp, count * size);
+		return;
+	}
 
-		case PD_MARKER_PLTE:
-		#if defined(PNGDEC_CHECK_CHUNK)
-			PD_nPngDecCheck_Chunk |= ( 1 << PNGDEC_CHUNK_PLTE );
-		#endif
-			return PD_PROCESS_DONE;
-		default:
-		#if !defined(PNGDEC_STABILITY_READ_UNKNOWN_ANC_CHUNK_SKIP)
-			return PD_PROCESS_ERROR;
-		#else
-			PNG_Skip_Current_Chunk();
-			break;
-		#endif
+	if(offset == 2)
+	{
+		for(i = 0;i < count;i++, out += x_step * size)
+		{
+			s = PD_ROW_SRC(i) * bpp;
+			out[0] = PD_SAMPLE8(src + s, round);
+			if(size == 2)
+				out[1] = alpha_on ? PD_SAMPLE8(src + s + 2, round) : alpha;
 		}
+		return;
 	}
-	return PD_PROCESS_ERROR;
-}
-
-static int PNG_Parse_PLTE_Chunk(void)
-{
-	int i;
-	PD_Plte_Entry_Num = PD_Chunk_Size / 3;
-	
-	if(PD_Chunk_Size % 3 != 0)
-		return PD_PROCESS_ERROR;
 
-	for(i = 0;i < PD_Plte_Entry_Num;i++)
+	if(size == 1)
 	{
-		READBYTE(PD_Plte[i].R);
-		READBYTE(PD_Plte[i].G);
-		READBYTE(PD_Plte[i].B);
+		for(i = 0;i < count;i++, out += x_step)
+			*out = src[PD_ROW_SRC(i) * bpp];
+		return;
 	}
 
-	return PNG_Check_CRC();
+	for(i = 0;i < count;i++, out += x_step * 2)
+	{
+		s = PD_ROW_SRC(i) * bpp;
+		out[0] = src[s];
+		out[1] = alpha_on ? src[s + 1] : alpha;
+	}
 }
 
-
-
-//////////////////////
-//Decoding Related
-//////////////////////
-
-static int PNG_Decode_ZLIB(void)
+//Write the samples of a 16-bit PD_Up_Scanline into the surface (PD_PIXFMT_RGBA16, PD_PIXFMT_L16)
+//	rows in the layout of the surface are byte-swapped by PD_Swap16
+static void PNG_Write_Wide_Row(PD_INSTANCE *pInst, uint32 x, uint32 x_step, uint32 y, uint32 count,
+							   uint32 start, const uint16 *map, uint32 map_off, uint32 map_shift)
 {
-	uint8 stream_out_1;
-	uint8 stream_out_2;
-	uint16 fcheck;
-	uint8 temp;
-
-	NEEDBITS_IDAT(16);
-	READBITS(8, stream_out_1);
-	
-	SHOWBITS(8, stream_out_2);
-	DROPBITS(5);
-
-	fcheck = ((stream_out_1 << 8) + stream_out_2) % 31;
-	if(fcheck != 0)
-		return PD_PROCESS_ERROR;
-
-	if((stream_out_1 & 0x0F) != 8)
-		return PD_PROCESS_ERROR;
-
-	PD_Window_Size = 256 << (stream_out_1 >> 4);
-	if(PD_Window_Size > 32768)
-		return PD_PROCESS_ERROR;
-
-	READBITS(1, temp);
-	if(temp)
-		return PD_PROCESS_ERROR;
-	
-	READBITS(2, PD_ZLIB_Flevel);
-
-	if( PD_nPngDecErrorCode < 0 ) {
-		return PD_PROCESS_ERROR;
+	const uint8 *src = pInst->PD_Up_Scanline;
+	uint8 *dst = pInst->PD_Out_Struct.pDstAddr[0] + (long)y * pInst->PD_Out_Struct.iDstPitch[0];
+	uint32 bpp = pInst->PD_Bpp;
+	uint32 channels = bpp >> 1;
+	uint32 size = (pInst->PD_Out_Struct.DST_FORMAT == PD_PIXFMT_RGBA16) ? 4 : 1;
+	uint32 alpha_on = (pInst->PD_Alpha_Use == 1 && (channels == 2 || channels == 4));
+	uint16 alpha = (pInst->PD_Alpha_Use == 1) ? 0 : 0xFFFF;	//no alpha channel : as PNG_Convert_Row and ARGB8888
+	uint16 *out = (uint16 *)dst + x * size;
+	const uint8 *p;
+	uint32 i, r, g, b;
+
+	if(map == NULL && x_step == 1 && ((size == 4 && channels == 4 && alpha_on) || (size == 1 && channels == 1)))
+	{
+		(pInst->PD_Swap16)(out, src + start * bpp, count * size);
+		return;
 	}
 
-	return PD_PROCESS_DONE;
+	for(i = 0;i < count;i++, out += x_step * size)
+	{
+		p = src + PD_ROW_SRC(i) * bpp;
+		r = g = b = PD_LOAD_BE16(p);
+		if(channels >= 3)
+		{
+			g = PD_LOAD_BE16(p + 2);
+			b = PD_LOAD_BE16(p + 4);
+		}
+		if(size == 1)
+		{
+			out[0] = (uint16)((77 * r + 150 * g + 29 * b + 128) >> 8);
+			continue;
+		}
+		out[0] = (uint16)r;
+		out[1] = (uint16)g;
+		out[2] = (uint16)b;
+		out[3] = alpha_on ? (uint16)PD_LOAD_BE16(p + (channels - 1) * 2) : alpha;
+	}
 }
 
-static int PNG_Decode_Block_Header(void)
+#undef PD_ROW_SRC
+
+//Write PD_Row_Buf into the destination surface (PD_OUTPUT_SURFACE)
+static void PNG_Write_Surface_Row(PD_INSTANCE *pInst, uint32 x, uint32 x_step, uint32 y, uint32 count)
 {
-	NEEDBITS_IDAT(3);
-	READBITS(1, PD_Last_Block);
-	READBITS(2, PD_Deflate_Type);
-	if(PD_Deflate_Type == 3)
-		return PD_PROCESS_ERROR;
+	const uint8 *src = pInst->PD_Row_Buf;
+	uint8 *dst = pInst->PD_Out_Struct.pDstAddr[0] + (long)y * pInst->PD_Out_Struct.iDstPitch[0];
+	uint32 i;
+	int r, g, b;
 
-	if( PD_nPngDecErrorCode < 0 )
-		return PD_PROCESS_ERROR;
-	
-	return PD_PROCESS_DONE;
+	switch(pInst->PD_Out_Struct.DST_FORMAT)
+	{
+	case PD_PIXFMT_RGB565:
+		{
+			uint16 *out = (uint16 *)dst + x;
+			for(i = 0;i < count;i++, src += IM_ROW_PIXEL_SIZE, out += x_step)
+				*out = (uint16)(((src[0] & 0xF8) << 8) | ((src[1] & 0xFC) << 3) | (src[2] >> 3));
+		}
+		break;
+	case PD_PIXFMT_ARGB8888:
+		{
+			uint32 *out = (uint32 *)dst + x;
+			uint32 alpha = (pInst->PD_Alpha_Use == 1) ? 0 : 0xFF000000;
+			for(i = 0;i < count;i++, src += IM_ROW_PIXEL_SIZE, out += x_step)
+				*out = alpha | ((uint32)src[3] << 24) | ((uint32)src[0] << 16) | ((uint32)src[1] << 8) | src[2];
+		}
+		break;
+	case PD_PIXFMT_RGB888:
+		{
+			uint8 *out = dst + x * 3;
+			for(i = 0;i < count;i++, src += IM_ROW_PIXEL_SIZE, out += x_step * 3)
+			{
+				out[0] = src[2];
+				out[1] = src[1];
+				out[2] = src[0];
+			}
+		}
+		break;
+	case PD_PIXFMT_YUV444:
+		{
+			uint8 *out_u = pInst->PD_Out_Struct.pDstAddr[1] + (long)y * pInst->PD_Out_Struct.iDstPitch[1];
+			uint8 *out_v = pInst->PD_Out_Struct.pDstAddr[2] + (long)y * pInst->PD_Out_Struct.iDstPitch[2];
+			for(i = 0;i < count;i++, src += IM_ROW_PIXEL_SIZE, x += x_step)
+			{
+				r = src[0];
+				g = src[1];
+				b = src[2];
+				dst[x] = PD_RGB2Y(r, g, b);
+				out_u[x] = PD_RGB2U(r, g, b);
+				out_v[x] = PD_RGB2V(r, g, b);
+			}
+		}
+		break;
+	case PD_PIXFMT_YUV420:
+		{
+			uint8 *out_u = pInst->PD_Out_Struct.pDstAddr[1] + (long)(y >> 1) * pInst->PD_Out_Struct.iDstPitch[1];
+			uint8 *out_v = pInst->PD_Out_Struct.pDstAddr[2] + (long)(y >> 1) * pInst->PD_Out_Struct.iDstPitch[2];
+			for(i = 0;i < count;i++, src += IM_ROW_PIXEL_SIZE, x += x_step)
+			{
+				r = src[0];
+				g = src[1];
+				b = src[2];
+				dst[x] = PD_RGB2Y(r, g, b);
+				if(((x | y) & 1) == 0)
+				{
+					out_u[x >> 1] = PD_RGB2U(r, g, b);
+					out_v[x >> 1] = PD_RGB2V(r, g, b);
+				}
+			}
+		}
+		break;
+	case PD_PIXFMT_L8:
+		{
+			uint8 *out = dst + x;
+			for(i = 0;i < count;i++, src += IM_ROW_PIXEL_SIZE, out += x_step)
+				*out = PD_RGB2L(src[0], src[1], src[2]);
+		}
+		break;
+	case PD_PIXFMT_LA88:
+		{
+			uint8 *out = dst + x * 2;
+			uint32 alpha_on = (pInst->PD_Alpha_Use == 1);
+			for(i = 0;i < count;i++, src += IM_ROW_PIXEL_SIZE, out += x_step * 2)
+			{
+				out[0] = PD_RGB2L(src[0], src[1], src[2]);
+				out[1] = alpha_on ? src[3] : 0xFF;
+			}
+		}
+		break;
+	case PD_PIXFMT_RGBA16:
+		{
+			uint16 *out = (uint16 *)dst + x * 4;
+			uint32 alpha_on = (pInst->PD_Alpha_Use == 1);
+			for(i = 0;i < count;i++, src += IM_ROW_PIXEL_SIZE, out += x_step * 4)
+			{
+				out[0] = (uint16)(src[0] * 257);
+				out[1] = (uint16)(src[1] * 257);
+				out[2] = (uint16)(src[2] * 257);
+				out[3] = alpha_on ? (uint16)(src[3] * 257) : 0xFFFF;
+			}
+		}
+		break;
+	case PD_PIXFMT_L16:
+		{
+			uint16 *out = (uint16 *)dst + x;
+			for(i = 0;i < count;i++, src += IM_ROW_PIXEL_SIZE, out += x_step)
+				*out = (uint16)(PD_RGB2L(src[0], src[1], src[2]) * 257);
+		}
+		break;
+	}
 }
 
-static int PNG_Copy_Block(void)
+//Write PD_Row_Buf pixel by pixel (PD_OUTPUT_PIXEL)
+static void PNG_Write_Pixel_Row(PD_INSTANCE *pInst, uint32 x, uint32 x_step, uint32 y, uint32 count)
 {
-	int i;
-	int msg_ret;
-	int copy_length;
-	uint16 temp;
-	
-	if(PD_Still_Decoding == PD_DONE_ALREADY)
-	{
-		int temp = PD_Valid_Bit & 7;
-
-		NEEDBITS_IDAT(temp);
-		DROPBITS(temp);
+	const uint8 *src = pInst->PD_Row_Buf;
+	IM_PIX_INFO out_struct;
+	uint32 i;
 
-		NEEDBITS_IDAT(16);
-		READBITS(16, PD_Len2Copy);
-		
-		NEEDBITS_IDAT(16);
-		READBITS(16, temp);
-		if(PD_Len2Copy != (temp ^ 0xffff))
-			return PD_PROCESS_ERROR;
+	out_struct.Src_Fmt = IM_SRC_RGB;
+	out_struct.y = y;
+	for(i = 0;i < count;i++, src += IM_ROW_PIXEL_SIZE, x += x_step)
+	{
+		out_struct.x = x;
+		out_struct.Comp_1 = src[0];
+		out_struct.Comp_2 = src[1];
+		out_struct.Comp_3 = src[2];
+		out_struct.Comp_4 = src[3];
+		out_struct.Offset = y * pInst->PD_LCD_Width + x;
+		(pInst->PD_Out_Struct.write_func)(out_struct);
 	}
+}
 
-	QUEUE_PUSH_CHECK(copy_length);
+static void PNG_Output_Row(PD_INSTANCE *pInst, uint32 x, uint32 x_step, uint32 y, uint32 count)
+{
+	IM_ROW_INFO row_info;
 
-	if(copy_length <= 0)
+	if(pInst->PD_Out_Struct.OUTPUT_MODE == PD_OUTPUT_SURFACE)
 	{
-		msg_ret = PD_PROCESS_DONE;
-		PD_Still_Decoding = PD_DONE_YET;
+		PNG_Write_Surface_Row(pInst, x, x_step, y, count);
+		return;
 	}
-	else
+	if(pInst->PD_Out_Struct.OUTPUT_MODE == PD_OUTPUT_PIXEL)
 	{
-		if(PD_Len2Copy > copy_length)
-		{
-			PD_Len2Copy -= copy_length;
-			msg_ret = PD_PROCESS_DONE;
-			PD_Still_Decoding = PD_DONE_YET;
-		}
-		else
+		PNG_Write_Pixel_Row(pInst, x, x_step, y, count);
+		return;
+	}
+
+	row_info.pPixel = pInst->PD_Row_Buf;
+	row_info.Width = count;
+	row_info.x = x;
+	row_info.x_step = x_step;
+	row_info.y = y;
+	row_info.Src_Fmt = IM_SRC_RGB;
+	row_info.pUserData = pInst->PD_Out_Struct.pRowUserData;
+
+	(pInst->PD_Out_Struct.write_row_func)(&row_info);
+}
+
+//PNG_Convert_Row and PNG_Output_Row, indexed and 1/2/4-bit grey rows of ARGB8888 / RGB565 / L8 / LA88
+//surfaces go straight from the tables, grey images into L8 / LA88 surfaces and 16-bit images into RGBA16 / L16
+//surfaces straight from PD_Up_Scanline
+static void PNG_Put_Row(PD_INSTANCE *pInst, uint32 x, uint32 x_step, uint32 y, uint32 count,
+						uint32 start, const uint16 *map, uint32 map_off, uint32 map_shift)
+{
+#if defined(PNGDEC_OPT_PLTE_LUT)
+	if(pInst->PD_Plte_On && pInst->PD_Plte_Direct)
+	{
+		uint8 *dst = pInst->PD_Out_Struct.pDstAddr[0] + (long)y * pInst->PD_Out_Struct.iDstPitch[0];
+		const uint32 *pixel = (const uint32 *)pInst->PD_Row_Buf;
+		uint32 i;
+
+		if(pInst->PD_Out_Struct.DST_FORMAT == PD_PIXFMT_ARGB8888)
 		{
-			copy_length = PD_Len2Copy;
-			msg_ret = PD_PROCESS_CONTINUE;
-			PD_Still_Decoding = PD_DONE_ALREADY;
+			PNG_Expand_Indexed(pInst, pInst->PD_Plte_Dst, (uint32 *)dst + x, x_step, count, start, map, map_off, map_shift);
+			return;
 		}
-		while(copy_length >= 512)
+
+		//RGB565, L8, LA88 : the 16 / 8-bit entries are narrowed from PD_Row_Buf
+		PNG_Expand_Indexed(pInst, pInst->PD_Plte_Dst, (uint32 *)pInst->PD_Row_Buf, 1, count, start, map, map_off, map_shift);
+		switch(pInst->PD_Out_Struct.DST_FORMAT)
 		{
-			for(i = 0;i < (512 >> 1);i++)
+		case PD_PIXFMT_RGB565:
 			{
-				NEEDBITS_IDAT(16);
-				READBITS(16, temp);
-				QUEUE_PUSH(temp & 0xFF);
-				QUEUE_PUSH(temp >> 8);
+				uint16 *out = (uint16 *)dst + x;
+				for(i = 0;i < count;i++, out += x_step)
+					*out = (uint16)pixel[i];
 			}
-			copy_length -= 512;
+			break;
+		case PD_PIXFMT_L8:
+			{
+				uint8 *out = dst + x;
+				for(i = 0;i < count;i++, out += x_step)
+					*out = (uint8)pixel[i];
+			}
+			break;
+		default:
+			{
+				uint8 *out = dst + x * 2;
+				for(i = 0;i < count;i++, out += x_step * 2)
+				{
+					out[0] = (uint8)pixel[i];
+					out[1] = (uint8)(pixel[i] >> 8);
+				}
+			}
+			break;
 		}
-		for(i = 0;i < copy_length;i++)
+		return;
+	}
+#endif
+	if(pInst->PD_Out_Struct.OUTPUT_MODE == PD_OUTPUT_SURFACE)
+	{
+		if(PD_PIXFMT_IS_INDEX(pInst->PD_Out_Struct.DST_FORMAT))
 		{
-			NEEDBITS_IDAT(8);
-			READBITS(8, temp);
-			QUEUE_PUSH(temp);
+			PNG_Write_Index_Row(pInst, x, x_step, y, count, start, map, map_off, map_shift);
+			return;
+		}
+		if(PD_PIXFMT_IS_GREY(pInst->PD_Out_Struct.DST_FORMAT) &&
+		   (pInst->PD_Color_Type == PD_COLOR_GREY || pInst->PD_Color_Type == PD_COLOR_GREY_ALPHA))
+		{
+			PNG_Write_Grey_Row(pInst, x, x_step, y, count, start, map, map_off, map_shift);
+			return;
+		}
+		if(PD_PIXFMT_IS_WIDE(pInst->PD_Out_Struct.DST_FORMAT) && pInst->PD_Bit_Depth == 16)
+		{
+			PNG_Write_Wide_Row(pInst, x, x_step, y, count, start, map, map_off, map_shift);
+			return;
 		}
 	}
-	
-	return msg_ret;
+	PNG_Convert_Row(pInst, count, start, map, map_off, map_shift);
+	PNG_Output_Row(pInst, x, x_step, y, count);
 }
 
-static int PNG_Decode_Block(void)
+#if defined(PNGDEC_OPT_RESIZE_AREA)
+//////////////////////
+//Area Reduction Related (PD_INIT_OPT_RESIZE_AREA)
+//////////////////////
+/*	Every source row is converted into PD_Row_Buf (premultiplied by alpha when it is used) and
+	each box of bound[i] .. bound[i + 1] - 1 source pixels is averaged into 8.8 fixed-point :
+	sum * ((1 << 24) / width) >> 16 stays below 1 << 32. The averages of the rows of an output
+	row are summed in PD_Area_Acc (at most 65535 rows of 0xFF00) and divided when its last row is in.
+*/
+static void PNG_Area_Row_C(uint32 *acc, const uint8 *src, const uint16 *bound, const uint32 *rcp, uint32 count)
 {
-	int i;
-	int valid_length;
-	uint16 ext;
-	uint8 result;
-	uint16 temp;
-	
-	huft * table;
+	uint32 i, s, e;
+	uint32 r, g, b, a;
 
-	if(PD_Still_Decoding == PD_DONE_YET)
+	for(i = 0;i < count;i++, acc += 4)
 	{
-		QUEUE_PUSH_CHECK(valid_length);
-		if(valid_length < PD_Len2Copy)
-			return PD_PROCESS_ERROR;
-		for(i = 0;i < PD_Len2Copy;i++)
+		r = g = b = a = 0;
+		for(s = bound[i], e = bound[i + 1];s < e;s++)
 		{
-			QUEUE_VISIT(result, PD_Dist2Copy);
-			QUEUE_PUSH(result);
+			r += src[s * IM_ROW_PIXEL_SIZE];
+			g += src[s * IM_ROW_PIXEL_SIZE + 1];
+			b += src[s * IM_ROW_PIXEL_SIZE + 2];
+			a += src[s * IM_ROW_PIXEL_SIZE + 3];
 		}
+		acc[0] += (r * rcp[i]) >> 16;
+		acc[1] += (g * rcp[i]) >> 16;
+		acc[2] += (b * rcp[i]) >> 16;
+		acc[3] += (a * rcp[i]) >> 16;
 	}
-	PD_Still_Decoding = PD_DONE_YET;
-	while(1)
+}
+
+//16-bit sums of up to 512 pixels (2 pixels per step, 256 steps of 0xFF) before they are widened
+#define PD_AREA_SPAN	512
+
+#if defined(PD_DEFILTER_SSE2)
+static PD_SSE2_TARGET void PNG_Area_Row_SSE2(uint32 *acc, const uint8 *src, const uint16 *bound, const uint32 *rcp, uint32 count)
+{
+	const __m128i zero = _mm_setzero_si128();
+	__m128i sum16, sum32, mul, even, odd;
+	uint32 i, s, e, stop, px;
+
+	for(i = 0;i < count;i++, acc += 4)
 	{
-		#if defined(PNGDEC_CHECK_EOF)
-			if( PD_nPngDecErrorCode < 0 ) {
-			#if defined(PNGDEC_CHECK_EOF_2)
-				if( PD_nPngDecErrorCode == TC_PNGDEC_ERR_STREAM_READING)
-					return PD_nPngDecErrorCode;
-			#endif
-				return PD_PROCESS_ERROR;
+		sum32 = zero;
+		for(s = bound[i], e = bound[i + 1];s < e;)
+		{
+			stop = (e - s > PD_AREA_SPAN) ? s + PD_AREA_SPAN : e;
+			sum16 = zero;
+			for(;s + 2 <= stop;s += 2)
+				sum16 = _mm_add_epi16(sum16, _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)(src + s * IM_ROW_PIXEL_SIZE)), zero));
+			if(s < stop)
+			{
+				memcpy(&px, src + s * IM_ROW_PIXEL_SIZE, 4);
+				sum16 = _mm_add_epi16(sum16, _mm_unpacklo_epi8(_mm_cvtsi32_si128((int)px), zero));
+				s++;
 			}
-		#endif
+			sum32 = _mm_add_epi32(sum32, _mm_add_epi32(_mm_unpacklo_epi16(sum16, zero), _mm_unpackhi_epi16(sum16, zero)));
+		}
 
-		QUEUE_PUSH_CHECK(valid_length);
-		if(valid_length <= 0)
+		//R, B and G, A are multiplied in two 64-bit lanes each
+		mul = _mm_set1_epi32((int)rcp[i]);
+		even = _mm_srli_epi64(_mm_mul_epu32(sum32, mul), 16);
+		odd = _mm_srli_epi64(_mm_mul_epu32(_mm_srli_epi64(sum32, 32), mul), 16);
+		sum32 = _mm_unpacklo_epi32(_mm_shuffle_epi32(even, 0x08), _mm_shuffle_epi32(odd, 0x08));
+		_mm_storeu_si128((__m128i *)acc, _mm_add_epi32(_mm_loadu_si128((const __m128i *)acc), sum32));
+	}
+}
+#endif //PD_DEFILTER_SSE2
+
+#if defined(PD_DEFILTER_NEON)
+static void PNG_Area_Row_NEON(uint32 *acc, const uint8 *src, const uint16 *bound, const uint32 *rcp, uint32 count)
+{
+	uint16x8_t sum16;
+	uint32x4_t sum32;
+	uint32 i, s, e, stop, px;
+
+	for(i = 0;i < count;i++, acc += 4)
+	{
+		sum32 = vdupq_n_u32(0);
+		for(s = bound[i], e = bound[i + 1];s < e;)
 		{
-			PD_Still_Decoding = PD_DONE_ALREADY;
-			return PD_PROCESS_DONE;
+			stop = (e - s > PD_AREA_SPAN) ? s + PD_AREA_SPAN : e;
+			sum16 = vdupq_n_u16(0);
+			for(;s + 2 <= stop;s += 2)
+				sum16 = vaddw_u8(sum16, vld1_u8(src + s * IM_ROW_PIXEL_SIZE));
+			if(s < stop)
+			{
+				memcpy(&px, src + s * IM_ROW_PIXEL_SIZE, 4);
+				sum16 = vaddw_u8(sum16, vcreate_u8((uint64)px));
+				s++;
+			}
+			sum32 = vaddq_u32(sum32, vaddl_u16(vget_low_u16(sum16), vget_high_u16(sum16)));
 		}
-			
-		NEEDBITS_IDAT(PD_Lookup_Bit_Literal);
-		SHOWBITS(PD_Lookup_Bit_Literal, temp);
-		table = PD_Huff_Liter + temp;
-		ext = table->e;
-		if(ext > 16)
+		vst1q_u32(acc, vaddq_u32(vld1q_u32(acc), vshrq_n_u32(vmulq_n_u32(sum32, rcp[i]), 16)));
+	}
+}
+#endif //PD_DEFILTER_NEON
+
+//Kernel for this CPU
+static Area_Func_Ptr PNG_Select_Area(void)
+{
+#if defined(PD_DEFILTER_SSE2)
+	if(PD_SSE2_CHECK())
+		return PNG_Area_Row_SSE2;
+#elif defined(PD_DEFILTER_NEON)
+	return PNG_Area_Row_NEON;
+#endif
+	return PNG_Area_Row_C;
+}
+
+//c * a / 255 for the count pixels of PD_Row_Buf
+static void PNG_Area_Premultiply(uint8 *pixel, uint32 count)
+{
+	uint32 i, t;
+
+	for(i = 0;i < count;i++, pixel += IM_ROW_PIXEL_SIZE)
+	{
+		if(pixel[3] == 0xFF)
+			continue;
+		t = pixel[0] * pixel[3] + 128;
+		pixel[0] = (uint8)((t + (t >> 8)) >> 8);
+		t = pixel[1] * pixel[3] + 128;
+		pixel[1] = (uint8)((t + (t >> 8)) >> 8);
+		t = pixel[2] * pixel[3] + 128;
+		pixel[2] = (uint8)((t + (t >> 8)) >> 8);
+	}
+}
+
+//Average the sums of 'rows' source rows into PD_Row_Buf and clear them
+static void PNG_Area_Output(PD_INSTANCE *pInst, uint32 rows)
+{
+	uint32 *acc = pInst->PD_Area_Acc;
+	uint8 *dst = pInst->PD_Row_Buf;
+	uint64 rcp = ((uint64)1 << 32) / rows;
+	uint32 i, c, v, a;
+
+	acc += pInst->PD_Crop_Left * 4;
+	for(i = pInst->PD_Crop_Left;i < pInst->PD_Crop_Right;i++, acc += 4, dst += IM_ROW_PIXEL_SIZE)
+	{
+		a = (uint32)((acc[3] * rcp) >> 32);		//8.8
+		for(c = 0;c < 3;c++)
 		{
-			do
+			v = (uint32)((acc[c] * rcp) >> 32);
+			if(!pInst->PD_Area_Premul)
+				v = (v + 128) >> 8;
+			else if(a == 0)
+				v = 0;
+			else
 			{
-				if(ext == 99)
-					return PD_PROCESS_ERROR;
-				DROPBITS(table->b);
-				ext -= 16;
-				NEEDBITS_IDAT(ext);
-				SHOWBITS(ext, temp);
-			#if !defined(PNGDEC_MOD_TYPE_STRUCT_HUFT)
-				table = table->v.t + temp;
-			#else
-				table = (huft *)table->v.t + temp;
-			#endif
-				ext = table ->e;
-			}while(ext > 16);
+				v = (v * 255 + (a >> 1)) / a;
+				if(v > 255)
+					v = 255;
+			}
+			dst[c] = (uint8)v;
 		}
-		DROPBITS(table->b);
-		
-		if(ext == 16)
+		dst[3] = (uint8)((a + 128) >> 8);
+		acc[0] = acc[1] = acc[2] = acc[3] = 0;
+	}
+}
+#endif //PNGDEC_OPT_RESIZE_AREA
+
+//Non-interlaced image, original size or resized
+//	Only the rows and columns of the crop rectangle are converted, inflating ends after its last row.
+static int Image_Row_Normal(PD_INSTANCE *pInst)
+{
+	uint32 prepared_bytes, num_row;
+	uint32 v, y, count;
+
+	QUEUE_POP_CHECK(prepared_bytes);
+	prepared_bytes--;
+	num_row = prepared_bytes / (pInst->PD_Scanline_Size + 1);
+
+	while(num_row--)
+	{
+		v = (pInst->PD_Image_Smaller_LCD == PD_TRUE) ? pInst->PD_Row : pInst->PD_Resize_Ver_Idx;
+		if(v >= pInst->PD_Crop_Bottom)
 		{
-			QUEUE_PUSH((uint8)(table->v.n));
+			pInst->PD_Last_IDAT = PD_DONE_ALREADY;
+			return PD_PROCESS_DONE;
 		}
-		else if(ext == 15)
+
+		if(v < pInst->PD_Crop_Top ||
+			(pInst->PD_Image_Smaller_LCD != PD_TRUE &&
+			 (v >= pInst->PD_Resized_Height || pInst->PD_Row != pInst->PD_Pixel_Map_Ver[v])))
 		{
-			PD_Still_Decoding = PD_DONE_ALREADY;
-			return PD_PROCESS_CONTINUE;
+			if(PNG_Defiltering(pInst, pInst->PD_Scanline_Size, PD_Conditional_Skip) == PD_PROCESS_ERROR)
+				return PD_PROCESS_ERROR;
+			pInst->PD_Row++;
+			continue;
 		}
-		else
+
+		y = v - pInst->PD_Crop_Top + pInst->PD_Top_Offset;
+		if(y >= pInst->PD_LCD_Height)
 		{
-			NEEDBITS_IDAT(ext);
-			READBITS(ext, temp);
-			PD_Len2Copy = table->v.n + temp;
+			pInst->PD_Last_IDAT = PD_DONE_ALREADY;
+			return PD_PROCESS_DONE;
+		}
 
-			NEEDBITS_IDAT(PD_Lookup_Bit_Distance);
-			SHOWBITS(PD_Lookup_Bit_Distance, temp);
-			table = PD_Huff_Dist + temp;
-			ext = table->e;
-			if(ext > 16)
-			{
-				do
-				{
-					if(ext == 99)
-						return PD_PROCESS_ERROR;
-					DROPBITS(table->b);
-					ext -= 16;
-					NEEDBITS_IDAT(ext);
-					SHOWBITS(ext, temp);
-				#if !defined(PNGDEC_MOD_TYPE_STRUCT_HUFT)
-					table = table->v.t + temp;
-				#else
-					table = (huft *)table->v.t + temp;
-				#endif
-					ext = table->e;
-				}while(ext > 16);
-			}
-			DROPBITS(table->b);
-			
-			NEEDBITS_IDAT(ext);
-			READBITS(ext, temp);
-			PD_Dist2Copy = table->v.n + temp;
+		if(PNG_Defiltering(pInst, pInst->PD_Scanline_Size, PD_Absolute_Perform) == PD_PROCESS_ERROR)
+			return PD_PROCESS_ERROR;
 
-			if(PD_Len2Copy > valid_length)
-			{
-				return PD_PROCESS_DONE;
-			}
+		count = PNG_Row_Visible(pInst, pInst->PD_Left_Offset, 1, pInst->PD_Crop_Right - pInst->PD_Crop_Left);
+		if(count)
+		{
+			if(pInst->PD_Image_Smaller_LCD == PD_TRUE)
+				PNG_Put_Row(pInst, pInst->PD_Left_Offset, 1, y, count, pInst->PD_Crop_Left, NULL, 0, 0);
 			else
-			{
-				for(i = 0;i < PD_Len2Copy;i++)
-				{
-					QUEUE_VISIT(result, PD_Dist2Copy);
-					QUEUE_PUSH(result);
-				}
-			}
+				PNG_Put_Row(pInst, pInst->PD_Left_Offset, 1, y, count, 0, pInst->PD_Pixel_Map_Hor + pInst->PD_Crop_Left, 0, 0);
 		}
+
+		if(pInst->PD_Image_Smaller_LCD != PD_TRUE)
+			pInst->PD_Resize_Ver_Idx++;
+		pInst->PD_Row++;
 	}
 	return PD_PROCESS_DONE;
 }
 
-
-//////////////////////
-//Initialization Function
-//////////////////////
-
-int TCCXXX_PNGDEC_Init(
-				PD_INIT		*pInitInstanceMem,
-				PD_CALLBACKS	*callbacks
-				)
+#if defined(PNGDEC_OPT_RESIZE_AREA)
+//Non-interlaced image larger than the LCD, PD_INIT_OPT_RESIZE_AREA (every output mode)
+//	Every source row is added to the sums of its output row, which is output with its last source row.
+static int Image_Resize_Area(PD_INSTANCE *pInst)
 {
-	int msg_ret = 0;	
+	uint32 prepared_bytes, num_row;
+	uint32 y, count;
 
-	PD_LCD_Width = pInitInstanceMem->lcd_width;
-	PD_LCD_Height = pInitInstanceMem->lcd_height;
-	PD_Datasource = pInitInstanceMem->datasource;
+	QUEUE_POP_CHECK(prepared_bytes);
+	prepared_bytes--;
+	num_row = prepared_bytes / (pInst->PD_Scanline_Size + 1);
 
-#if defined(PNGDEC_REPORT_BITDEPTH)
-	pInitInstanceMem->pixel_depth = 0;
-#endif
+	while(num_row--)
+	{
+		y = pInst->PD_Resize_Ver_Idx - pInst->PD_Crop_Top + pInst->PD_Top_Offset;
+		if(y >= pInst->PD_LCD_Height || pInst->PD_Resize_Ver_Idx >= pInst->PD_Crop_Bottom)
+		{
+			pInst->PD_Last_IDAT = PD_DONE_ALREADY;
+			return PD_PROCESS_DONE;
+		}
 
-#if defined(PNGDEC_CHECK_EOF_2)
-	PD_TotFileSize = pInitInstanceMem->iTotFileSize;
-	if( PD_TotFileSize == 0 )
-		return PD_RETURN_INIT_FAIL;
+		//above the boxes of the crop rectangle
+		if(pInst->PD_Row < pInst->PD_Pixel_Map_Ver[pInst->PD_Resize_Ver_Idx])
+		{
+			if(PNG_Defiltering(pInst, pInst->PD_Scanline_Size, PD_Conditional_Skip) == PD_PROCESS_ERROR)
+				return PD_PROCESS_ERROR;
+			pInst->PD_Row++;
+			continue;
+		}
 
-	PD_ReadFileBytes = 0;
-	PD_Read_Point_Max = 0;
-#endif
+		if(PNG_Defiltering(pInst, pInst->PD_Scanline_Size, PD_Absolute_Perform) == PD_PROCESS_ERROR)
+			return PD_PROCESS_ERROR;
 
-	PD_callbacks.read_func = callbacks->read_func;
+		count = pInst->PD_Pixel_Map_Hor[pInst->PD_Crop_Right];		//the source pixels right of the rectangle are not needed
+		PNG_Convert_Row(pInst, count, 0, NULL, 0, 0);
+		if(pInst->PD_Area_Premul)
+			PNG_Area_Premultiply(pInst->PD_Row_Buf, count);
+		(pInst->PD_Area_Row)(pInst->PD_Area_Acc + pInst->PD_Crop_Left * 4, pInst->PD_Row_Buf, pInst->PD_Pixel_Map_Hor + pInst->PD_Crop_Left,
+							 pInst->PD_Area_Rcp + pInst->PD_Crop_Left, pInst->PD_Crop_Right - pInst->PD_Crop_Left);
+		pInst->PD_Row++;
 
-#if defined(PNGDEC_OPTI_INSTANCE_MEM)
-	msg_ret = PNG_Init_instanceMem((char *)pInitInstanceMem->pInstanceBuf, PD_INSTANCE_MEM_SIZE);
-	if( msg_ret )
-		return PD_RETURN_INIT_FAIL;
+		if(pInst->PD_Row == pInst->PD_Pixel_Map_Ver[pInst->PD_Resize_Ver_Idx + 1])
+		{
+			PNG_Area_Output(pInst, pInst->PD_Row - pInst->PD_Pixel_Map_Ver[pInst->PD_Resize_Ver_Idx]);
+			count = PNG_Row_Visible(pInst, pInst->PD_Left_Offset, 1, pInst->PD_Crop_Right - pInst->PD_Crop_Left);
+			if(count)
+				PNG_Output_Row(pInst, pInst->PD_Left_Offset, 1, y, count);
+			pInst->PD_Resize_Ver_Idx++;
+		}
+	}
+	return PD_PROCESS_DONE;
+}
 #endif
-	
-	PNG_Init_Variable();
 
-	PNG_Init_IO();
-	
-	msg_ret = PNG_Check_PNG_Marker();
-	if(msg_ret == PD_PROCESS_ERROR)
-		return PD_RETURN_INIT_FAIL;
-	
-	msg_ret = PNG_Parse_IHDR_Chunk(pInitInstanceMem->iOption);
-	if(msg_ret == PD_PROCESS_ERROR)
-		return PD_RETURN_INIT_FAIL;
+//ADAM7 interlaced image, original size or resized
+//	Each pass row is output as soon as it is defiltered. In the resized case the columns of
+//	the current pass are output as runs of adjacent pixels.
+static int Image_Row_ADAM7(PD_INSTANCE *pInst)
+{
+	uint32 hor_inc, ver_inc, hor_offset, ver_offset;
+	uint32 hor_mask, hor_shift;
+	uint32 prepared_bytes, num_row;
+	uint32 temp, x, y, count;
+	uint32 i, run;
 
-	if(PD_Color_Type == PD_COLOR_INDEX)
+	while(1)
 	{
-		msg_ret = PNG_Search_PLTE_Chunk();
-		if(msg_ret == PD_PROCESS_ERROR)
+		if(pInst->PD_Remaining_Row == 0 &&
+			(pInst->PD_Image_Smaller_LCD == PD_TRUE || pInst->PD_Resize_Ver_Idx == pInst->PD_ADAM7_Height))
+			PNG_Init_ADAM7_Map(pInst, pInst->PD_Current_Pass + 1);
+
+	#if defined(PNGDEC_OPT_ADAM7_THUMBNAIL)
+		if(pInst->PD_Thumb_Pass && pInst->PD_Current_Pass > pInst->PD_Thumb_Pass)
 		{
-			return PD_RETURN_INIT_FAIL;
+			pInst->PD_Last_IDAT = PD_DONE_ALREADY;	//no sample in the passes left
+			break;
 		}
-		else
+	#endif
+
+		if(pInst->PD_Current_Pass > 7)
+			break;
+
+		QUEUE_POP_CHECK(prepared_bytes);
+		prepared_bytes--;
+		num_row = prepared_bytes / (pInst->PD_Scanline_Size + 1);
+
+		if(num_row == 0)
+			break;
+
+		if(num_row > pInst->PD_Remaining_Row)
+			num_row = pInst->PD_Remaining_Row;
+		pInst->PD_Remaining_Row -= num_row;
+
+		hor_inc = PDRO_Hor_Incre[pInst->PD_Current_Pass - 1];
+		ver_inc = PDRO_Ver_Incre[pInst->PD_Current_Pass - 1];
+		hor_offset = PDRO_Hor_Start[pInst->PD_Current_Pass - 1];
+		ver_offset = PDRO_Ver_Start[pInst->PD_Current_Pass - 1];
+
+		if(pInst->PD_Image_Smaller_LCD == PD_TRUE)
+		{
+			while(num_row--)
+			{
+				if(PNG_Defiltering(pInst, pInst->PD_Scanline_Size, PD_Absolute_Perform) == PD_PROCESS_ERROR)
+					return PD_PROCESS_ERROR;
+
+				y = pInst->PD_Row * ver_inc + ver_offset + pInst->PD_Top_Offset;
+				if(y < pInst->PD_LCD_Height)
+				{
+					x = hor_offset + pInst->PD_Left_Offset;
+					count = PNG_Row_Visible(pInst, x, hor_inc, pInst->PD_ADAM7_Width);
+					if(count)
+					{
+						PNG_Put_Row(pInst, x, hor_inc, y, count, 0, NULL, 0, 0);
+					}
+				}
+				pInst->PD_Row++;
+			}
+			continue;
+		}
+
+		hor_mask = hor_inc - 1;
+		hor_shift = (hor_inc == 8) ? 3 : (hor_inc >> 1);	//log2(hor_inc)
+
+		for(;pInst->PD_Row < pInst->PD_Resized_Height;pInst->PD_Row++)
+		{
+			if((pInst->PD_Pixel_Map_Ver[pInst->PD_Row] - ver_offset) % ver_inc == 0)
+			{
+				temp = (pInst->PD_Pixel_Map_Ver[pInst->PD_Row] - ver_offset) / ver_inc;
+				while(pInst->PD_Resize_Ver_Idx != temp)
+				{
+					if(PNG_Defiltering(pInst, pInst->PD_Scanline_Size, PD_Conditional_Skip) == PD_PROCESS_ERROR)
+						return PD_PROCESS_ERROR;
+					num_row--;
+					pInst->PD_Resize_Ver_Idx++;
+					if(num_row == 0)
+						return PD_PROCESS_DONE;
+				}
+
+				if(PNG_Defiltering(pInst, pInst->PD_Scanline_Size, PD_Absolute_Perform) == PD_PROCESS_ERROR)
+					return PD_PROCESS_ERROR;
+				num_row--;
+				pInst->PD_Resize_Ver_Idx++;
+
+				y = pInst->PD_Row + pInst->PD_Top_Offset;
+				if(y < pInst->PD_LCD_Height)
+				{
+					count = PNG_Row_Visible(pInst, pInst->PD_Left_Offset, 1, pInst->PD_Resized_Width);
+					i = 0;
+					while(i < count)
+					{
+						//skip the columns of the other passes, then collect a run of this pass
+						while(i < count && (((uint32)pInst->PD_Pixel_Map_Hor[i] - hor_offset) & hor_mask) != 0)
+							i++;
+						run = i;
+						while(i < count && (((uint32)pInst->PD_Pixel_Map_Hor[i] - hor_offset) & hor_mask) == 0)
+							i++;
+						if(i > run)
+						{
+							PNG_Put_Row(pInst, run + pInst->PD_Left_Offset, 1, y, i - run,
+										0, pInst->PD_Pixel_Map_Hor + run, hor_offset, hor_shift);
+						}
+					}
+				}
+				if(num_row == 0)
+				{
+					pInst->PD_Row++;
+					return PD_PROCESS_DONE;
+				}
+			}
+		}
+		while(pInst->PD_Resize_Ver_Idx != pInst->PD_ADAM7_Height)
+		{
+			if(PNG_Defiltering(pInst, pInst->PD_Scanline_Size, PD_Absolute_Skip) == PD_PROCESS_ERROR)
+				return PD_PROCESS_ERROR;
+			num_row--;
+			pInst->PD_Resize_Ver_Idx++;
+			if(num_row == 0)
+			{
+				pInst->PD_Row++;
+				return PD_PROCESS_DONE;
+			}
+		}
+	}
+	return PD_PROCESS_DONE;
+}
+
+
+
+//////////////////////
+//Header Parsing Related
+//////////////////////
+static int PNG_Check_PNG_Marker(PD_INSTANCE *pInst)
+{
+	uint32 marker_ret;
+
+	READWORD(marker_ret);
+	if(marker_ret == PD_MARKER_PNG1)
+	{
+		READWORD(marker_ret);
+		
+		if( pInst->PD_nPngDecErrorCode < 0 ) {
+			return PD_PROCESS_ERROR;
+		}
+	
+		if(marker_ret == PD_MARKER_PNG2)
+			return PD_PROCESS_DONE;
+	}
+	return PD_PROCESS_ERROR;
+}
+
+static int PNG_Parse_IHDR_Chunk(PD_INSTANCE *pInst, int iOption)
+{
+	uint32 stream_out;
+	READWORD(pInst->PD_Chunk_Size);
+	if(pInst->PD_Chunk_Size != PD_IHDR_CHUNK_SIZE)
+		return PD_PROCESS_ERROR;
+#if defined(PNGDEC_STABILITY_CHECK_CRC)
+	PNG_Start_CRC(pInst);
+#endif
+
+#if defined(PNGDEC_CHECK_CHUNK)
+	pInst->PD_nPngDecCheck_Chunk |= ( 1 << PNGDEC_CHUNK_IHDR );
+#endif
+
+	READWORD(stream_out);
+	if(stream_out != PD_MARKER_IHDR)
+		return PD_PROCESS_ERROR;
+
+	READWORD(pInst->PD_Global_Width);
+	READWORD(pInst->PD_Global_Height);
+
+	READBYTE(pInst->PD_Bit_Depth);		// 1,2,4,8,16
+	#if defined(PNGDEC_STABILITY_BIT_DEPTH)
+	switch( pInst->PD_Bit_Depth )
+	{
+	case 1:
+	case 2:
+	case 4:
+	case 8:
+	case 16:
+		break;
+	default:
+		return PD_PROCESS_ERROR;
+	}	
+	#endif
+	READBYTE(pInst->PD_Color_Type);
+
+	READBYTE(pInst->PD_Compression_Method);
+	if(pInst->PD_Compression_Method != 0)
+		return PD_PROCESS_ERROR;
+	
+	READBYTE(stream_out);//Filter Method
+	if(stream_out != 0)
+		return PD_PROCESS_ERROR;
+	
+	READBYTE(pInst->PD_Interlace_Method);
+	if(pInst->PD_Interlace_Method > PD_INTERLACE_ADAM)
+		return PD_PROCESS_ERROR;
+
+	if( pInst->PD_nPngDecErrorCode < 0 ) {
+		return PD_PROCESS_ERROR;
+	}
+
+#ifdef PNGDEC_SUPPORT_ISDBT_PNG
+	if( iOption& (1<<4) )
+	{
+		if( 
+			( pInst->PD_Bit_Depth == 8 )
+			&& ( pInst->PD_Color_Type == 3 )
+			&& ( pInst->PD_Interlace_Method == 0 )
+		  )
+		{
+			pInst->PD_Bit_Depth = 8;
+			pInst->PD_Color_Type = PD_COLOR_GREY;
+		}
+	}
+#endif
+
+	if((pInst->PD_LCD_Width >= pInst->PD_Global_Width) && (pInst->PD_LCD_Height >= pInst->PD_Global_Height))
+		pInst->PD_Image_Smaller_LCD = PD_TRUE;
+	else
+		pInst->PD_Image_Smaller_LCD = PD_FALSE;
+
+	switch(pInst->PD_Color_Type)
+	{
+	case PD_COLOR_GREY:
+		if(!(pInst->PD_Bit_Depth == 1 || pInst->PD_Bit_Depth == 2 || pInst->PD_Bit_Depth == 4 || pInst->PD_Bit_Depth == 8 || pInst->PD_Bit_Depth == 16))
+			return PD_PROCESS_ERROR;
+			
+		if(pInst->PD_Image_Smaller_LCD == PD_TRUE)
+		{
+			if(pInst->PD_Interlace_Method == PD_INTERLACE_ADAM)
+				pInst->PNG_Decode_Image = Image_Origin_Grey_ADAM7;
+			else
+				pInst->PNG_Decode_Image = Image_Origin_Grey;
+		}
+		else
+		{
+			if(pInst->PD_Interlace_Method == PD_INTERLACE_ADAM)
+				pInst->PNG_Decode_Image = Image_Resize_Grey_ADAM7;
+			else
+				pInst->PNG_Decode_Image = Image_Resize_Grey;
+		}
+		pInst->PD_Compo_Num = 1;
+		break;
+	case PD_COLOR_TRUE:
+		if(!(pInst->PD_Bit_Depth == 8 || pInst->PD_Bit_Depth == 16))
+			return PD_PROCESS_ERROR;
+
+		if(pInst->PD_Image_Smaller_LCD == PD_TRUE)
+		{
+			if(pInst->PD_Interlace_Method == PD_INTERLACE_ADAM)
+				pInst->PNG_Decode_Image = Image_Origin_True_ADAM7;
+			else
+				pInst->PNG_Decode_Image = Image_Origin_True;
+		}
+		else
+		{
+			if(pInst->PD_Interlace_Method == PD_INTERLACE_ADAM)
+				pInst->PNG_Decode_Image = Image_Resize_True_ADAM7;
+			else
+				pInst->PNG_Decode_Image = Image_Resize_True;
+		}
+		pInst->PD_Compo_Num = 3;
+		break;
+	case PD_COLOR_INDEX:
+		if(!(pInst->PD_Bit_Depth == 1 || pInst->PD_Bit_Depth == 2 || pInst->PD_Bit_Depth == 4 || pInst->PD_Bit_Depth == 8))
+			return PD_PROCESS_ERROR;
+
+		if(pInst->PD_Image_Smaller_LCD == PD_TRUE)
+		{
+			if(pInst->PD_Interlace_Method == PD_INTERLACE_ADAM)
+				pInst->PNG_Decode_Image = Image_Origin_Indexed_ADAM7;
+			else
+				pInst->PNG_Decode_Image = Image_Origin_Indexed;
+		}
+		else
+		{
+			if(pInst->PD_Interlace_Method == PD_INTERLACE_ADAM)
+				pInst->PNG_Decode_Image = Image_Resize_Indexed_ADAM7;
+			else
+				pInst->PNG_Decode_Image = Image_Resize_Indexed;
+		}
+		pInst->PD_Compo_Num = 1;
+		break;
+	case PD_COLOR_GREY_ALPHA:
+		if(!(pInst->PD_Bit_Depth == 8 || pInst->PD_Bit_Depth == 16))
+			return PD_PROCESS_ERROR;
+
+		if(pInst->PD_Image_Smaller_LCD == PD_TRUE)
+		{
+			if(pInst->PD_Interlace_Method == PD_INTERLACE_ADAM)
+				pInst->PNG_Decode_Image = Image_Origin_Grey_ADAM7;
+			else
+				pInst->PNG_Decode_Image = Image_Origin_Grey;
+		}
+		else
+		{
+			if(pInst->PD_Interlace_Method == PD_INTERLACE_ADAM)
+				pInst->PNG_Decode_Image = Image_Resize_Grey_ADAM7;
+			else
+				pInst->PNG_Decode_Image = Image_Resize_Grey;
+		}
+		pInst->PD_Alpha_Available = PD_ALPHA_AVAILABLE;
+		pInst->PD_Compo_Num = 2;
+		break;
+	case PD_COLOR_TRUE_ALPHA:
+		if(!(pInst->PD_Bit_Depth == 8 || pInst->PD_Bit_Depth == 16))
+			return PD_PROCESS_ERROR;
+
+		if(pInst->PD_Image_Smaller_LCD == PD_TRUE)
+		{
+			if(pInst->PD_Interlace_Method == PD_INTERLACE_ADAM)
+				pInst->PNG_Decode_Image = Image_Origin_True_ADAM7;
+			else
+				pInst->PNG_Decode_Image = Image_Origin_True;
+		}
+		else
+		{
+			if(pInst->PD_Interlace_Method == PD_INTERLACE_ADAM)
+				pInst->PNG_Decode_Image = Image_Resize_True_ADAM7;
+			else
+				pInst->PNG_Decode_Image = Image_Resize_True;
+		}
+		pInst->PD_Alpha_Available = PD_ALPHA_AVAILABLE;
+		pInst->PD_Compo_Num = 4;
+		break;
+	default :
+		return PD_PROCESS_ERROR;
+	}
+
+	switch(pInst->PD_Bit_Depth)
+	{
+	case 1:
+		pInst->PD_Data_Mask = PDRO_Depth_Mask;
+		pInst->PD_Data_Shift = PDRO_Depth_Shift;
+		break;
+	case 2:
+		pInst->PD_Data_Mask = &(PDRO_Depth_Mask[8]);
+		pInst->PD_Data_Shift = &(PDRO_Depth_Shift[8]);
+		break;
+	case 4:
+		pInst->PD_Data_Mask = &(PDRO_Depth_Mask[12]);
+		pInst->PD_Data_Shift = &(PDRO_Depth_Shift[12]);
+		break;
+	case 8:
+		pInst->PD_Data_Mask = &(PDRO_Depth_Mask[14]);
+		pInst->PD_Data_Shift = &(PDRO_Depth_Shift[14]);
+		break;
+	default:
+		break;
+	}
+
+	pInst->PD_Scaler = 255 / (((uint32)1 << pInst->PD_Bit_Depth) - 1);
+
+	return PNG_Check_CRC(pInst);
+}
+
+static int PNG_Search_PLTE_Chunk(PD_INSTANCE *pInst)
+{
+	int iteration = PD_CHUNK_SEARCH_NUM;
+	uint32 stream_out;
+
+	while(iteration--)
+	{
+		READWORD(pInst->PD_Chunk_Size);
+	#if defined(PNGDEC_STABILITY_CHECK_CRC)
+		PNG_Start_CRC(pInst);
+	#endif
+		READWORD(stream_out);
+
+		if( pInst->PD_nPngDecErrorCode < 0 ) {
+			return PD_PROCESS_ERROR;
+		}
+	#if defined(PNGDEC_OPT_CHUNK_SEEK)
+		PNG_Index_Chunk(pInst, stream_out);
+	#endif
+		
+		switch(stream_out)
+		{
+		case PD_MARKER_tIME:
+		case PD_MARKER_zTXt:
+		case PD_MARKER_tEXt:
+		case PD_MARKER_iTXt:
+		case PD_MARKER_pHYs:
+		case PD_MARKER_sPLT:
+		case PD_MARKER_iCCP:
+		case PD_MARKER_sRGB:
+		case PD_MARKER_sBIT:
+		case PD_MARKER_gAMA:
+		case PD_MARKER_cHRM:	
+	#if defined(PNGDEC_ADD_ANCILLARY_CHUNK_EXT120130)
+		case PD_MARKER_fRAc:
+		case PD_MARKER_gIFg:
+		case PD_MARKER_gIFt:
+		case PD_MARKER_gIFx:
+		case PD_MARKER_oFFs:
+		case PD_MARKER_pCAL:
+		case PD_MARKER_sCAL:
+		case PD_MARKER_sTER:			
+	#endif
+	#if defined(PNGDEC_SKIP_TRNS_BEFORE_PLTE)
+		case PD_MARKER_tRNS:
+	#endif
+			PNG_Skip_Current_Chunk(pInst);
+			break;
+		case PD_MARKER_IHDR:
+		case PD_MARKER_IDAT:
+		case PD_MARKER_IEND:
+			return PD_PROCESS_ERROR;
+
+		case PD_MARKER_bKGD:
+		case PD_MARKER_hIST:
+	#if !defined(PNGDEC_SKIP_TRNS_BEFORE_PLTE)
+		case PD_MARKER_tRNS:
+			return PD_PROCESS_ERROR;
+	#endif
+
+		case PD_MARKER_PLTE:
+		#if defined(PNGDEC_CHECK_CHUNK)
+			pInst->PD_nPngDecCheck_Chunk |= ( 1 << PNGDEC_CHUNK_PLTE );
+		#endif
+			return PD_PROCESS_DONE;
+		default:
+		#if !defined(PNGDEC_STABILITY_READ_UNKNOWN_ANC_CHUNK_SKIP)
+			return PD_PROCESS_ERROR;
+		#else
+			PNG_Skip_Current_Chunk(pInst);
+			break;
+		#endif
+		}
+	}
+	return PD_PROCESS_ERROR;
+}
+
+static int PNG_Parse_PLTE_Chunk(PD_INSTANCE *pInst)
+{
+	int i;
+	pInst->PD_Plte_Entry_Num = pInst->PD_Chunk_Size / 3;
+	
+	if(pInst->PD_Chunk_Size % 3 != 0)
+		return PD_PROCESS_ERROR;
+
+	for(i = 0;i < pInst->PD_Plte_Entry_Num;i++)
+	{
+		READBYTE(pInst->PD_Plte[i].R);
+		READBYTE(pInst->PD_Plte[i].G);
+		READBYTE(pInst->PD_Plte[i].B);
+	}
+
+	return PNG_Check_CRC(pInst);
+}
+
+
+
+//////////////////////
+//Decoding Related
+//////////////////////
+
+static int PNG_Decode_ZLIB(PD_INSTANCE *pInst)
+{
+	uint8 stream_out_1;
+	uint8 stream_out_2;
+	uint16 fcheck;
+	uint8 temp;
+
+	NEEDBITS_IDAT(16);
+	READBITS(8, stream_out_1);
+	
+	SHOWBITS(8, stream_out_2);
+	DROPBITS(5);
+
+	fcheck = ((stream_out_1 << 8) + stream_out_2) % 31;
+	if(fcheck != 0)
+		return PD_PROCESS_ERROR;
+
+	if((stream_out_1 & 0x0F) != 8)
+		return PD_PROCESS_ERROR;
+
+	pInst->PD_Window_Size = 256 << (stream_out_1 >> 4);
+	if(pInst->PD_Window_Size > 32768)
+		return PD_PROCESS_ERROR;
+
+	READBITS(1, temp);
+	if(temp)
+		return PD_PROCESS_ERROR;
+	
+	READBITS(2, pInst->PD_ZLIB_Flevel);
+
+	if( pInst->PD_nPngDecErrorCode < 0 ) {
+		return PD_PROCESS_ERROR;
+	}
+
+#if defined(PNGDEC_STABILITY_CHECK_ADLER)
+	pInst->PD_Adler = 1;
+	pInst->PD_Adler_Ptr = pInst->PD_Ptr_Block_Dec;
+#endif
+
+	return PD_PROCESS_DONE;
+}
+
+static int PNG_Decode_Block_Header(PD_INSTANCE *pInst)
+{
+	NEEDBITS_IDAT(3);
+	READBITS(1, pInst->PD_Last_Block);
+	READBITS(2, pInst->PD_Deflate_Type);
+	if(pInst->PD_Deflate_Type == 3)
+		return PD_PROCESS_ERROR;
+
+	if( pInst->PD_nPngDecErrorCode < 0 )
+		return PD_PROCESS_ERROR;
+	
+	return PD_PROCESS_DONE;
+}
+
+static int PNG_Copy_Block(PD_INSTANCE *pInst)
+{
+	int i;
+	int msg_ret;
+	int copy_length;
+	uint16 temp;
+	
+	if(pInst->PD_Still_Decoding == PD_DONE_ALREADY)
+	{
+		int temp = pInst->PD_Valid_Bit & 7;
+
+		NEEDBITS_IDAT(temp);
+		DROPBITS(temp);
+
+		NEEDBITS_IDAT(16);
+		READBITS(16, pInst->PD_Len2Copy);
+		
+		NEEDBITS_IDAT(16);
+		READBITS(16, temp);
+		if(pInst->PD_Len2Copy != (temp ^ 0xffff))
+			return PD_PROCESS_ERROR;
+	}
+
+	QUEUE_PUSH_CHECK(copy_length);
+	if(copy_length > pInst->PD_Push_Limit)
+		copy_length = pInst->PD_Push_Limit;
+
+	if(copy_length <= 0)
+	{
+		msg_ret = PD_PROCESS_DONE;
+		pInst->PD_Still_Decoding = PD_DONE_YET;
+	}
+	else
+	{
+		//a full queue leaves no room for the PD_FILT_UP pushed after the last block : go on next time
+		if(pInst->PD_Len2Copy >= copy_length)
+		{
+			pInst->PD_Len2Copy -= copy_length;
+			msg_ret = PD_PROCESS_DONE;
+			pInst->PD_Still_Decoding = PD_DONE_YET;
+		}
+		else
+		{
+			copy_length = pInst->PD_Len2Copy;
+			msg_ret = PD_PROCESS_CONTINUE;
+			pInst->PD_Still_Decoding = PD_DONE_ALREADY;
+		}
+		while(copy_length >= 512)
+		{
+			for(i = 0;i < (512 >> 1);i++)
+			{
+				NEEDBITS_IDAT(16);
+				READBITS(16, temp);
+				QUEUE_PUSH(temp & 0xFF);
+				QUEUE_PUSH(temp >> 8);
+			}
+			copy_length -= 512;
+		}
+		for(i = 0;i < copy_length;i++)
+		{
+			NEEDBITS_IDAT(8);
+			READBITS(8, temp);
+			QUEUE_PUSH(temp);
+		}
+	}
+	
+	return msg_ret;
+}
+
+//Bit buffer and ring-queue write pointer are kept in locals inside the inflate loop
+//LZ77 match copy inside the ring queue (byte by byte where either side wraps)
+//	dist 1 : memset, dist 2 ~ 7 : pattern repeated by words, dist >= 8 : 16/8-byte words
+//	Nothing is written past the match : the rest of the ring is still window history.
+static void PNG_Copy_Match(uint8 *deflate_buf, uint32 ptr_block_dec, uint32 length, uint32 distance)
+{
+	uint32 i = 0;
+#if defined(PNGDEC_OPT_FAST_MATCH_COPY)
+	uint32 pos = ptr_block_dec & PD_RING_QUEUE_MASK;
+
+	if(pos >= distance && pos + length <= PD_DEFLATE_BUF_LEN)
+	{
+		uint8 *dst = deflate_buf + pos;
+		const uint8 *src = dst - distance;
+
+		if(distance == 1)
+		{
+			PNGD_MEMSET(dst, src[0], length);
+			return;
+		}
+
+		if(distance < 8)
+		{
+			//the output repeats with a period of distance, so also of step (>= 8)
+			uint32 step = distance;
+			while(step < 8)
+				step += distance;
+			for(;i < step && i < length;i++)
+				dst[i] = src[i];
+			for(;i + 8 <= length;i += 8)
+				memcpy(dst + i, dst + i - step, 8);
+		}
+		else if(length >= 8)
+		{
+			if(distance >= 16)
+			{
+				for(;i + 16 <= length;i += 16)
+					memcpy(dst + i, src + i, 16);
+			}
+			for(;i + 8 <= length;i += 8)
+				memcpy(dst + i, src + i, 8);
+			//last word overlaps bytes already written with the same values
+			if(i < length)
+				memcpy(dst + length - 8, src + length - 8, 8);
+			return;
+		}
+
+		for(;i < length;i++)
+			dst[i] = src[i];
+		return;
+	}
+#endif
+
+	for(;i < length;i++, ptr_block_dec++)
+		deflate_buf[PD_RING_QUEUE_MASK & ptr_block_dec] = deflate_buf[PD_RING_QUEUE_MASK & (ptr_block_dec - distance)];
+}
+
+#define LOCAL_NEEDBITS(bits)				\
+{							\
+	if(valid_bit < (bits))				\
+	{						\
+		pInst->PD_2nd_Strm = bit_buf;		\
+		pInst->PD_Valid_Bit = (int16)valid_bit;	\
+		PNG_Refill_Bits_IDAT(pInst, bits);	\
+		bit_buf = pInst->PD_2nd_Strm;		\
+		valid_bit = pInst->PD_Valid_Bit;	\
+	}						\
+}
+
+#define LOCAL_DROPBITS(bits)		\
+{					\
+	bit_buf >>= (bits);		\
+	valid_bit -= (bits);		\
+}
+
+#define LOCAL_SAVE()					\
+{							\
+	pInst->PD_2nd_Strm = bit_buf;			\
+	pInst->PD_Valid_Bit = (int16)valid_bit;		\
+	pInst->PD_Ptr_Block_Dec = ptr_block_dec;		\
+}
+
+static int PNG_Decode_Block(PD_INSTANCE *pInst)
+{
+	int i;
+	int valid_length;
+	uint32 entry, type, temp;
+	uint32 length, distance;
+
+	uint8 * deflate_buf = pInst->PD_Deflate_Buf;
+	const uint32 * table_liter = pInst->PD_Huff_Liter;
+	const uint32 * table_dist = pInst->PD_Huff_Dist;
+	int bits_liter = pInst->PD_Lookup_Bit_Literal;
+	int bits_dist = pInst->PD_Lookup_Bit_Distance;
+	uint32 mask_liter = PDRO_Bit_Mask[bits_liter];
+	uint32 mask_dist = PDRO_Bit_Mask[bits_dist];
+	PD_BITBUF bit_buf;
+	int valid_bit;
+	uint32 ptr_block_dec;
+
+	if(pInst->PD_Liter2Push_Num)
+	{
+		QUEUE_PUSH_CHECK(valid_length);
+		if(valid_length < pInst->PD_Liter2Push_Num)
+			return PD_PROCESS_ERROR;
+		for(i = 0;i < pInst->PD_Liter2Push_Num;i++)
+			QUEUE_PUSH((uint8)(pInst->PD_Liter2Push >> (i << 3)));
+		pInst->PD_Liter2Push_Num = 0;
+	}
+
+	if(pInst->PD_Still_Decoding == PD_DONE_YET)
+	{
+		QUEUE_PUSH_CHECK(valid_length);
+		if(valid_length < pInst->PD_Len2Copy)
+			return PD_PROCESS_ERROR;
+		PNG_Copy_Match(deflate_buf, pInst->PD_Ptr_Block_Dec, pInst->PD_Len2Copy, pInst->PD_Dist2Copy);
+		pInst->PD_Ptr_Block_Dec += pInst->PD_Len2Copy;
+	}
+	pInst->PD_Still_Decoding = PD_DONE_YET;
+
+	QUEUE_PUSH_CHECK(valid_length);
+	if(valid_length > pInst->PD_Push_Limit)
+		valid_length = pInst->PD_Push_Limit;
+	bit_buf = pInst->PD_2nd_Strm;
+	valid_bit = pInst->PD_Valid_Bit;
+	ptr_block_dec = pInst->PD_Ptr_Block_Dec;
+	while(1)
+	{
+		#if defined(PNGDEC_CHECK_EOF)
+			if( pInst->PD_nPngDecErrorCode < 0 ) {
+				LOCAL_SAVE();
+			#if defined(PNGDEC_CHECK_EOF_2)
+				if( pInst->PD_nPngDecErrorCode == TC_PNGDEC_ERR_STREAM_READING)
+					return pInst->PD_nPngDecErrorCode;
+			#endif
+				return PD_PROCESS_ERROR;
+			}
+		#endif
+
+		if(valid_length <= 0)
+		{
+			LOCAL_SAVE();
+			pInst->PD_Still_Decoding = PD_DONE_ALREADY;
+			return PD_PROCESS_DONE;
+		}
+
+		LOCAL_NEEDBITS(bits_liter);
+		entry = table_liter[bit_buf & mask_liter];
+		type = PD_HUFF_TYPE(entry);
+		if(type == PD_HUFF_TYPE_SUBTABLE)
+		{
+			LOCAL_DROPBITS(PD_HUFF_BITS(entry));
+			LOCAL_NEEDBITS(PD_HUFF_EXTRA(entry));
+			entry = table_liter[PD_HUFF_BASE(entry) + (bit_buf & PDRO_Bit_Mask[PD_HUFF_EXTRA(entry)])];
+			type = PD_HUFF_TYPE(entry);
+		}
+		LOCAL_DROPBITS(PD_HUFF_BITS(entry));
+
+		if(type == 1)
+		{
+			deflate_buf[PD_RING_QUEUE_MASK & (ptr_block_dec++)] = PD_HUFF_LITER(entry, 0);
+			valid_length--;
+		}
+		else if(type <= PD_HUFF_LITER_MAX)
+		{
+			//packed literals : keep the ones which do not fit for the next call
+			for(i = 0;i < (int)type && valid_length > 0;i++, valid_length--)
+				deflate_buf[PD_RING_QUEUE_MASK & (ptr_block_dec++)] = PD_HUFF_LITER(entry, i);
+			if(i < (int)type)
+			{
+				pInst->PD_Liter2Push = entry >> (8 + (i << 3));
+				pInst->PD_Liter2Push_Num = (uint8)(type - i);
+			}
+		}
+		else if(type == PD_HUFF_TYPE_LENGTH)
+		{
+			LOCAL_NEEDBITS(PD_HUFF_EXTRA(entry));
+			temp = (uint32)bit_buf & PDRO_Bit_Mask[PD_HUFF_EXTRA(entry)];
+			LOCAL_DROPBITS(PD_HUFF_EXTRA(entry));
+			length = PD_HUFF_BASE(entry) + temp;
+
+			LOCAL_NEEDBITS(bits_dist);
+			entry = table_dist[bit_buf & mask_dist];
+			if(PD_HUFF_TYPE(entry) == PD_HUFF_TYPE_SUBTABLE)
+			{
+				LOCAL_DROPBITS(PD_HUFF_BITS(entry));
+				LOCAL_NEEDBITS(PD_HUFF_EXTRA(entry));
+				entry = table_dist[PD_HUFF_BASE(entry) + (bit_buf & PDRO_Bit_Mask[PD_HUFF_EXTRA(entry)])];
+			}
+			if(PD_HUFF_TYPE(entry) != PD_HUFF_TYPE_LENGTH)
+			{
+				LOCAL_SAVE();
+				return PD_PROCESS_ERROR;
+			}
+			LOCAL_DROPBITS(PD_HUFF_BITS(entry));
+
+			LOCAL_NEEDBITS(PD_HUFF_EXTRA(entry));
+			temp = (uint32)bit_buf & PDRO_Bit_Mask[PD_HUFF_EXTRA(entry)];
+			LOCAL_DROPBITS(PD_HUFF_EXTRA(entry));
+			distance = PD_HUFF_BASE(entry) + temp;
+
+			pInst->PD_Len2Copy = (uint16)length;
+			pInst->PD_Dist2Copy = (uint16)distance;
+			if((int)length > valid_length)
+			{
+				LOCAL_SAVE();
+				return PD_PROCESS_DONE;
+			}
+
+			PNG_Copy_Match(deflate_buf, ptr_block_dec, length, distance);
+			ptr_block_dec += length;
+			valid_length -= length;
+		}
+		else if(type == PD_HUFF_TYPE_END)
+		{
+			LOCAL_SAVE();
+			pInst->PD_Still_Decoding = PD_DONE_ALREADY;
+			return PD_PROCESS_CONTINUE;
+		}
+		else
+		{
+			LOCAL_SAVE();
+			return PD_PROCESS_ERROR;
+		}
+	}
+	return PD_PROCESS_DONE;
+}
+
+
+//////////////////////
+//Initialization Function
+//////////////////////
+
+static int TCCXXX_PNGDEC_Init(
+				PD_INSTANCE	*pInst,
+				PD_INIT		*pInitInstanceMem,
+				PD_CALLBACKS	*callbacks
+				)
+{
+	int msg_ret = 0;	
+
+	pInst->PD_LCD_Width = pInitInstanceMem->lcd_width;
+	pInst->PD_LCD_Height = pInitInstanceMem->lcd_height;
+	pInst->PD_Datasource = pInitInstanceMem->datasource;
+	pInst->PD_Cancel = 0;
+#if defined(PNGDEC_OPT_STATS)
+	PNGD_MEMSET(&pInst->PD_Stats, 0, sizeof(PD_STATS));
+#endif
+#if defined(PNGDEC_OPT_CHUNK_SEEK)
+	pInst->PD_Chunk_Num = 0;
+#endif
+
+#if defined(PNGDEC_REPORT_BITDEPTH)
+	pInitInstanceMem->pixel_depth = 0;
+#endif
+
+	pInst->PD_TotFileSize = pInitInstanceMem->iTotFileSize;
+#if defined(PNGDEC_CHECK_EOF_2)
+	if( pInst->PD_TotFileSize == 0 )
+		return PD_RETURN_INIT_FAIL;
+
+	pInst->PD_ReadFileBytes = 0;
+	pInst->PD_Read_Point_Max = 0;
+#endif
+
+	pInst->PD_Push_On = (pInitInstanceMem->iOption & PD_INIT_OPT_PUSH_INPUT) ? 1 : 0;
+	pInst->PD_Round16 = (pInitInstanceMem->iOption & PD_INIT_OPT_ROUND_16) ? 1 : 0;
+	pInst->PD_Crop_On = (pInitInstanceMem->iOption & PD_INIT_OPT_CROP) ? 1 : 0;
+	pInst->PD_Pipeline_On = (pInitInstanceMem->iOption & PD_INIT_OPT_PIPELINE) ? 1 : 0;
+	if( pInitInstanceMem->iOption & (PD_INIT_OPT_MEMORY_INPUT | PD_INIT_OPT_PUSH_INPUT) )
+	{
+		if( (pInitInstanceMem->pSrcBuf == NULL) || (pInitInstanceMem->iTotFileSize == 0) )
+			return PD_RETURN_INIT_FAIL;
+		pInst->PD_Src_Buf = pInitInstanceMem->pSrcBuf;
+		pInst->PD_callbacks.read_func = NULL;
+	}
+	else
+	{
+		if( (callbacks == NULL) || (callbacks->read_func == NULL) )
+			return PD_RETURN_INIT_FAIL;
+		pInst->PD_Src_Buf = NULL;
+		pInst->PD_callbacks.read_func = callbacks->read_func;
+	}
+	pInst->PD_callbacks.seek_func = NULL;
+#if defined(PNGDEC_OPT_CHUNK_SEEK)
+	if( (pInitInstanceMem->iOption & PD_INIT_OPT_SEEKABLE_INPUT) && (pInst->PD_Src_Buf == NULL) )
+		pInst->PD_callbacks.seek_func = callbacks->seek_func;
+#endif
+
+	PNG_Init_Variable(pInst);
+
+	PNG_Init_IO(pInst);
+	
+	msg_ret = PNG_Check_PNG_Marker(pInst);
+	if(msg_ret == PD_PROCESS_ERROR)
+		return PD_RETURN_INIT_FAIL;
+	
+	msg_ret = PNG_Parse_IHDR_Chunk(pInst, pInitInstanceMem->iOption);
+	if(msg_ret == PD_PROCESS_ERROR)
+		return PD_RETURN_INIT_FAIL;
+
+	if(pInst->PD_Color_Type == PD_COLOR_INDEX)
+	{
+		msg_ret = PNG_Search_PLTE_Chunk(pInst);
+		if(msg_ret == PD_PROCESS_ERROR)
+		{
+			return PD_RETURN_INIT_FAIL;
+		}
+		else
+		{
+			msg_ret = PNG_Parse_PLTE_Chunk(pInst);
+			if(msg_ret == PD_PROCESS_ERROR)
+				return PD_RETURN_INIT_FAIL;
+		}
+	}
+
+	msg_ret = PNG_Search_IDAT_Chunk(pInst, 0);
+	if(msg_ret != PD_PROCESS_DONE)
+		return PD_RETURN_INIT_FAIL;
+
+	if(pInst->PD_Alpha_Available == PD_ALPHA_AVAILABLE)
+		pInitInstanceMem->alpha_available = PD_ALPHA_AVAILABLE;
+	else 
+		pInitInstanceMem->alpha_available = PD_ALPHA_DISABLE;
+
+	pInst->PD_Bpp = ((pInst->PD_Bit_Depth * pInst->PD_Compo_Num - 1) >> 3) + 1;	// 1,2,3,4,6,8
+	pInst->PD_Scanline_Size = ((pInst->PD_Global_Width * pInst->PD_Bit_Depth * pInst->PD_Compo_Num - 1) >> 3) + 1;
+	pInst->PD_Global_Scanline_Size = pInst->PD_Scanline_Size + pInst->PD_Bpp;
+
+	pInitInstanceMem->image_width = pInst->PD_Global_Width;
+	pInitInstanceMem->image_height = pInst->PD_Global_Height;
+
+	if(pInst->PD_Image_Smaller_LCD == PD_TRUE)
+	{
+		pInst->PD_Resized_Width = pInst->PD_Global_Width;
+		pInst->PD_Resized_Height = pInst->PD_Global_Height;
+	#if !defined(PNGDEC_MOD_MEM_ALIGN)
+		pInitInstanceMem->heap_size = (pInst->PD_Scanline_Size + pInst->PD_Bpp)
+									 + pInst->PD_Resized_Width * IM_ROW_PIXEL_SIZE;
+	#else 
+		pInitInstanceMem->heap_size = (((pInst->PD_Scanline_Size + pInst->PD_Bpp 
+									    + pInst->PD_Resized_Width * IM_ROW_PIXEL_SIZE + 63)>>2)<<2);
+	#endif
+	}
+	else
+	{
+		int TX,TY;
+		TX=(pInst->PD_Global_Width << 16) / pInst->PD_LCD_Width;
+		TY=(pInst->PD_Global_Height << 16) / pInst->PD_LCD_Height;
+		if(TX > TY)	//Resize based on horizontal direction
+		{
+			pInst->PD_Resized_Width = pInst->PD_LCD_Width;		
+			pInst->PD_Resized_Height = (pInst->PD_Global_Height << 16) / TX;
+
+		#if defined(PNGDEC_MOD_DIV0)
+			pInst->PD_Resized_Height = (pInst->PD_Global_Height << 16) / TX;
+			if( pInst->PD_Resized_Height == 0 ) 
+				pInst->PD_Resized_Height = 1;
+		#endif
+		}
+		else		//Resize based on vertical direction
+		{
+			pInst->PD_Resized_Height = pInst->PD_LCD_Height;
+			pInst->PD_Resized_Width = (pInst->PD_Global_Width << 16) / TY;
+
+		#if defined(PNGDEC_MOD_DIV0)
+			if( pInst->PD_Resized_Width == 0 )
+				pInst->PD_Resized_Width = 1;
+		#endif
+		}
+	#if !defined(PNGDEC_MOD_MEM_ALIGN)
+		pInitInstanceMem->heap_size = (pInst->PD_Scanline_Size + pInst->PD_Bpp * 2)
+									 + pInst->PD_Resized_Width * 2 + pInst->PD_Resized_Height * 2
+									 + pInst->PD_Resized_Width * IM_ROW_PIXEL_SIZE;
+	#else
+		pInitInstanceMem->heap_size = (( (pInst->PD_Scanline_Size + pInst->PD_Bpp * 2)
+									    + pInst->PD_Resized_Width * 2 + pInst->PD_Resized_Height * 2
+									    + pInst->PD_Resized_Width * IM_ROW_PIXEL_SIZE + 63 
+									  )>>2)<<2;
+	#endif
+
+	#if defined(PNGDEC_OPT_RESIZE_AREA)
+		//a whole source row instead of an output row, the ends of the boxes, box sums and reciprocals
+		pInst->PD_Area_On = ((pInitInstanceMem->iOption & PD_INIT_OPT_RESIZE_AREA) && pInst->PD_Interlace_Method != PD_INTERLACE_ADAM);
+		if(pInst->PD_Area_On)
+			pInitInstanceMem->heap_size += (pInst->PD_Global_Width - pInst->PD_Resized_Width) * IM_ROW_PIXEL_SIZE
+										 + pInst->PD_Resized_Width * 5 * sizeof(uint32) + 16;
+	#endif
+	#if defined(PNGDEC_OPT_ADAM7_THUMBNAIL)
+		if((pInitInstanceMem->iOption & PD_INIT_OPT_THUMBNAIL) && pInst->PD_Interlace_Method == PD_INTERLACE_ADAM)
+			pInst->PD_Thumb_Pass = PNG_Thumbnail_Pass(pInst);
+	#endif
+	}
+
+	pInst->PD_Cur_Job = PD_JOB_DECODE_INIT;
+	pInst->PD_Out_Struct.RESOURCE_OCCUPATION = 1;
+
+#if defined(PNGDEC_REPORT_BITDEPTH)
+	{
+		int tpxlDepth = 0;
+
+		switch( pInst->PD_Color_Type )
+		{
+		case 0:	//Greyscale
+			tpxlDepth = pInst->PD_Bit_Depth;
+			break;
+		case 2:	//Truecolor
+			tpxlDepth = pInst->PD_Bit_Depth * 3;
+			break;
+		case 3:	//Indexed-color
+			tpxlDepth = 24;
+			break;
+		case 4:	//Greyscale with alpah
+			tpxlDepth = pInst->PD_Bit_Depth * 2;
+			break;			
+		case 6:	//Truecolor with alpha
+			tpxlDepth = pInst->PD_Bit_Depth * 4;
+			break;
+		}
+		pInitInstanceMem->pixel_depth = tpxlDepth;
+	}
+#endif
+
+	return PD_RETURN_INIT_DONE;
+}
+
+
+//////////////////////
+//Push Input (PD_INIT_OPT_PUSH_INPUT)
+//////////////////////
+//An inflate job only starts when the bytes it may read are pushed already, and the block
+//decoding is given no more room in the ring queue than the pushed data can fill : the jobs
+//stop at the end of a symbol, of a stored block part or of a chunk, where they go on from
+//once more data is pushed. Nothing is checked once the whole file is in.
+
+//Passes over the chunks at *pPos up to an IDAT header, as PNG_Search_IDAT_Chunk.
+//Returns 1 with *pPos on the IDAT data and *pLen its length, 0 if a chunk is not all in yet, -1 after IEND.
+static int PNG_Push_Next_IDAT(PD_INSTANCE *pInst, uint32 *pPos, uint32 *pLen)
+{
+	const BYTE *buf = pInst->PD_FileBuf_Ptr;
+	uint32 end = (uint32)pInst->PD_Read_Point_End;
+	uint32 pos = *pPos;
+	uint32 len, type;
+
+	while(end - pos >= 8)
+	{
+		len = PD_LOAD_BE32(buf + pos);
+		type = PD_LOAD_BE32(buf + pos + 4);
+		pos += 8;
+		if(type == PD_MARKER_IDAT)
+		{
+			*pPos = pos;
+			*pLen = len;
+			return 1;
+		}
+		if(end - pos < len || end - pos - len < 4)
+			return 0;
+		pos += len + 4;
+		if(type == PD_MARKER_IEND)
+			return -1;
+	}
+	return 0;
+}
+
+//Bits of zlib data which can be read from the bit buffer on without running out of the pushed bytes
+//(more than want bytes are not looked for). With complete, only the data of chunks whose CRC is in counts.
+static uint32 PNG_Push_Bits(PD_INSTANCE *pInst, uint32 want, int complete)
+{
+	uint32 end = (uint32)pInst->PD_Read_Point_End;
+	uint32 pos = (uint32)pInst->PD_Read_Point;
+	uint32 left = 0;
+	uint32 avail = 0;
+
+	if(pInst->PD_Used_Byte < pInst->PD_Chunk_Size)
+		left = pInst->PD_Chunk_Size - pInst->PD_Used_Byte;
+
+	while(avail <= want)
+	{
+		if(end - pos < left || end - pos - left < 4)
+		{
+			//the rest of the chunk or its CRC is not in yet
+			if(!complete)
+				avail += (end - pos < left) ? end - pos : left;
+			else if(pos == (uint32)pInst->PD_Read_Point)
+				return 0;
+			break;
+		}
+		avail += left;
+		pos += left + 4;
+		if(PNG_Push_Next_IDAT(pInst, &pos, &left) <= 0)
+			break;
+	}
+
+	if(avail > want)
+		avail = want + 1;
+	return (uint32)pInst->PD_Valid_Bit + (avail << 3);
+}
+
+//Returns 1 if the next inflate job could read past the pushed bytes, otherwise 0 with PD_Push_Limit set
+static int PNG_Push_Wait(PD_INSTANCE *pInst)
+{
+	uint32 pos, len, bits;
+
+	pInst->PD_Push_Limit = PD_DEFLATE_BUF_LEN;
+	if(!pInst->PD_Push_On || (uint32)pInst->PD_Read_Point_End >= pInst->PD_TotFileSize)
+		return 0;
+
+	switch(pInst->PD_Cur_Job)
+	{
+	case PD_JOB_SEARCH_IDAT:
+		pos = (uint32)pInst->PD_Read_Point - (pInst->PD_Valid_Bit >> 3);
+		return PNG_Push_Next_IDAT(pInst, &pos, &len) == 0;
+	case PD_JOB_DECODE_HEADER:
+		return PNG_Push_Bits(pInst, (16 + PD_PUSH_AHEAD_BITS) >> 3, 0) < 16 + PD_PUSH_AHEAD_BITS;
+	case PD_JOB_DECODE_BLOCK_HEADER:
+		return PNG_Push_Bits(pInst, (3 + PD_PUSH_AHEAD_BITS) >> 3, 0) < 3 + PD_PUSH_AHEAD_BITS;
+	case PD_JOB_BUILD_VARHUFF:
+		return PNG_Push_Bits(pInst, (PD_PUSH_VARHUFF_BITS + PD_PUSH_AHEAD_BITS) >> 3, 0) < PD_PUSH_VARHUFF_BITS + PD_PUSH_AHEAD_BITS;
+	case PD_JOB_DECODE_COPY:
+		//8 bits a byte
+		bits = PNG_Push_Bits(pInst, (PD_DEFLATE_BUF_LEN * 8 + PD_PUSH_COPY_BITS + PD_PUSH_AHEAD_BITS) >> 3, 0);
+		if(bits < 8 + PD_PUSH_COPY_BITS + PD_PUSH_AHEAD_BITS)
+			return 1;
+		pInst->PD_Push_Limit = (int32)((bits - PD_PUSH_COPY_BITS - PD_PUSH_AHEAD_BITS) >> 3);
+		return 0;
+	case PD_JOB_DECODE_BLOCK:
+		//15 bits a literal, 48 bits a match of 3 bytes or more
+		bits = PNG_Push_Bits(pInst, (PD_DEFLATE_BUF_LEN * 16 + PD_PUSH_BLOCK_BITS + PD_PUSH_AHEAD_BITS) >> 3, 0);
+		if(bits < 16 + PD_PUSH_BLOCK_BITS + PD_PUSH_AHEAD_BITS)
+			return 1;
+		pInst->PD_Push_Limit = (int32)((bits - PD_PUSH_BLOCK_BITS - PD_PUSH_AHEAD_BITS) >> 4);
+		return 0;
+	case PD_JOB_END_ZLIB:
+		//the Adler-32, the rest of its chunk and the CRC
+		return PNG_Push_Bits(pInst, (PD_PUSH_ADLER_BITS + 7) >> 3, 1) < PD_PUSH_ADLER_BITS;
+	default:
+		return 0;
+	}
+}
+
+
+//////////////////////
+//Inflate Jobs
+//////////////////////
+//Runs PD_Cur_Job (IDAT search, zlib header, deflate blocks into the ring queue) and sets the next job.
+//Returns PD_PROCESS_CONTINUE, PD_PROCESS_DONE (queue is full : decode the image, then the same job again),
+//PD_PROCESS_EOF (no more data) or PD_PROCESS_ERROR.
+static int PNG_Inflate_Job(PD_INSTANCE *pInst)
+{
+	int msg_ret;
+#if defined(PNGDEC_OPT_STATS)
+	uint32 ptr_block_dec = pInst->PD_Ptr_Block_Dec;
+#endif
+
+	switch(pInst->PD_Cur_Job)
+	{
+	////////////////////////////////////////
+	//(1)Search for IDAT Chunk
+	////////////////////////////////////////
+	case PD_JOB_SEARCH_IDAT:
+		msg_ret = PNG_Search_IDAT_Chunk(pInst, 1);
+		if(msg_ret == PD_PROCESS_EOF || msg_ret == PD_PROCESS_ERROR)
+			return msg_ret;
+		pInst->PD_Cur_Job = PD_JOB_DECODE_HEADER;
+		break;
+
+	////////////////////////////////////////
+	//(2)Decode ZLIB Header & 3-bit Block Header
+	////////////////////////////////////////
+	case PD_JOB_DECODE_HEADER:
+		msg_ret = PNG_Decode_ZLIB(pInst);
+		if(msg_ret != PD_PROCESS_DONE)
+			return PD_PROCESS_ERROR;
+		pInst->PD_Cur_Job = PD_JOB_DECODE_BLOCK_HEADER;
+		break;
+
+	case PD_JOB_DECODE_BLOCK_HEADER:
+		msg_ret = PNG_Decode_Block_Header(pInst);
+		if(msg_ret != PD_PROCESS_DONE)
+			return PD_PROCESS_ERROR;
+		
+		switch(pInst->PD_Deflate_Type)
+		{
+		case PD_DEFLATE_NOCOMP:
+			PD_STATS_ADD(blocks[PD_STATS_BLOCK_STORED], 1);
+			pInst->PD_Cur_Job = PD_JOB_DECODE_COPY;
+			break;
+		case PD_DEFLATE_FIXHUFF:
+			PD_STATS_ADD(blocks[PD_STATS_BLOCK_FIXED], 1);
+			if(pInst->PD_FixHuff_Done == PD_DONE_YET)
+				pInst->PD_Cur_Job = PD_JOB_BUILD_FIXHUFF;
+			else
+				pInst->PD_Cur_Job = PD_JOB_DECODE_BLOCK;
+			break;
+		case PD_DEFLATE_VARHUFF:
+			PD_STATS_ADD(blocks[PD_STATS_BLOCK_DYNAMIC], 1);
+			pInst->PD_Cur_Job = PD_JOB_BUILD_VARHUFF;
+			break;
+		default:
+			return PD_PROCESS_ERROR;
+		}
+		
+		break;
+
+	////////////////////////////////////////
+	//(3)Build Up Huffman Table
+	////////////////////////////////////////
+	case PD_JOB_BUILD_FIXHUFF:
+		msg_ret = PNG_Generate_FixHuff_Table(pInst);
+		if(msg_ret != PD_PROCESS_DONE)
+			return PD_PROCESS_ERROR;
+		
+		pInst->PD_Cur_Job = PD_JOB_DECODE_BLOCK;
+		break;
+	case PD_JOB_BUILD_VARHUFF:
+		msg_ret = PNG_Generate_VarHuff_Table(pInst);
+		if(msg_ret != PD_PROCESS_DONE)
+			return PD_PROCESS_ERROR;
+		
+		pInst->PD_Cur_Job = PD_JOB_DECODE_BLOCK;
+		break;
+
+	////////////////////////////////////////
+	//(4)Decode Block acorrding to Compression Options
+	////////////////////////////////////////
+	case PD_JOB_DECODE_COPY:
+		msg_ret = PNG_Copy_Block(pInst);
+		PD_STATS_ADD(inflated_bytes[PD_STATS_BLOCK_STORED], pInst->PD_Ptr_Block_Dec - ptr_block_dec);
+	#if defined(PNGDEC_STABILITY_CHECK_ADLER)
+		if(pInst->PD_Adler_On)
+			PNG_Update_Adler32(pInst);
+	#endif
+
+		pInst->PD_Prev_Job = PD_JOB_DECODE_COPY;
+		if( pInst->PD_nPngDecErrorCode < 0 ) {
+			return PD_PROCESS_ERROR;
+		}
+	
+		if(msg_ret == PD_PROCESS_ERROR)
+			return PD_PROCESS_ERROR;
+		else if(msg_ret == PD_PROCESS_CONTINUE)
+		{
+			if(pInst->PD_Last_Block)
+				pInst->PD_Cur_Job = PD_JOB_END_ZLIB;
+			else
+			{
+				pInst->PD_Cur_Job = PD_JOB_DECODE_BLOCK_HEADER;
+			}
+		}
+		else
+			return PD_PROCESS_DONE;
+		break;
+	case PD_JOB_DECODE_BLOCK:
+		msg_ret = PNG_Decode_Block(pInst);
+		PD_STATS_ADD(inflated_bytes[(pInst->PD_Deflate_Type == PD_DEFLATE_FIXHUFF) ? PD_STATS_BLOCK_FIXED : PD_STATS_BLOCK_DYNAMIC],
+					 pInst->PD_Ptr_Block_Dec - ptr_block_dec);
+	#if defined(PNGDEC_STABILITY_CHECK_ADLER)
+		if(pInst->PD_Adler_On)
+			PNG_Update_Adler32(pInst);
+	#endif
+
+		pInst->PD_Prev_Job = PD_JOB_DECODE_BLOCK;
+		if( pInst->PD_nPngDecErrorCode < 0 ) {
+		#if defined(PNGDEC_CHECK_EOF_2)
+			if( pInst->PD_nPngDecErrorCode == TC_PNGDEC_ERR_STREAM_READING )
+			{
+				return PD_PROCESS_EOF;
+			}
+		#endif
+			return PD_PROCESS_ERROR;
+		}
+	
+		if(msg_ret == PD_PROCESS_ERROR)
+			return PD_PROCESS_ERROR;
+		else if(msg_ret == PD_PROCESS_CONTINUE)
+		{
+			if(pInst->PD_Last_Block)
+				pInst->PD_Cur_Job = PD_JOB_END_ZLIB;
+			else
+			{
+				pInst->PD_Cur_Job = PD_JOB_DECODE_BLOCK_HEADER;
+			}
+		}
+		else
+			return PD_PROCESS_DONE;
+		break;
+
+	////////////////////////////////////////
+	//(5)Adler-32 and CRC after the last block
+	////////////////////////////////////////
+	case PD_JOB_END_ZLIB:
+		QUEUE_PUSH(PD_FILT_UP);
+		if(PNG_Check_Adler32(pInst) == PD_PROCESS_ERROR)
+			return PD_PROCESS_ERROR;
+		PNG_Check_CRC(pInst);
+		pInst->PD_Cur_Job = PD_JOB_SEARCH_IDAT;
+		break;
+	default:
+		return PD_PROCESS_ERROR;
+	}
+
+	return PD_PROCESS_CONTINUE;
+}
+
+#if defined(PD_PIPELINE)
+//////////////////////
+//Two-thread Pipeline (PD_PIPELINE_2THREADS)
+//////////////////////
+//Single producer / single consumer on the ring queue :
+//	the producer thread runs PNG_Inflate_Job, fills [PD_Pipe_Filled, PD_Pipe_Used + 32KB) and publishes PD_Pipe_Filled,
+//	the caller's thread runs PNG_Decode_Image, takes [PD_Pipe_Used, PD_Pipe_Filled) and publishes PD_Pipe_Used.
+//A stale pointer only hides free space or data for a while. A side waits by polling, then on PD_Pipe_Cond :
+//it raises PD_Pipe_Sleep before testing again and the other side tests PD_Pipe_Sleep after publishing
+//(all sequentially consistent), so a wake-up cannot be lost.
+typedef int (PIPE_READY) (PD_INSTANCE *pInst, uint32 arg);
+
+static void PNG_Pipe_Wake(PD_INSTANCE *pInst, int who)
+{
+	if(PD_ATOMIC_LOAD_SC(&pInst->PD_Pipe_Sleep[who]))
+	{
+		pthread_mutex_lock(&pInst->PD_Pipe_Mutex);
+		pthread_cond_broadcast(&pInst->PD_Pipe_Cond);
+		pthread_mutex_unlock(&pInst->PD_Pipe_Mutex);
+	}
+}
+
+static void PNG_Pipe_Wait(PD_INSTANCE *pInst, int who, PIPE_READY *ready, uint32 arg)
+{
+	int i;
+
+	for(i = 0;i < PD_PIPE_SPIN;i++)
+	{
+		if(ready(pInst, arg))
+			return;
+		PD_CPU_RELAX();
+	}
+
+	PD_ATOMIC_STORE_SC(&pInst->PD_Pipe_Sleep[who], 1);
+	pthread_mutex_lock(&pInst->PD_Pipe_Mutex);
+	while(!ready(pInst, arg))
+		pthread_cond_wait(&pInst->PD_Pipe_Cond, &pInst->PD_Pipe_Mutex);
+	pthread_mutex_unlock(&pInst->PD_Pipe_Mutex);
+	PD_ATOMIC_STORE_SC(&pInst->PD_Pipe_Sleep[who], 0);
+}
+
+//Producer : at least need bytes are free, or the consumer quits
+static int PNG_Pipe_Space_Ready(PD_INSTANCE *pInst, uint32 need)
+{
+	return (PD_DEFLATE_BUF_LEN - (pInst->PD_Ptr_Block_Dec - PD_ATOMIC_LOAD_SC(&pInst->PD_Pipe_Used)) >= need) ||
+			PD_ATOMIC_LOAD_SC(&pInst->PD_Pipe_Stop);
+}
+
+//Consumer : more than filled is published, or the producer is over
+static int PNG_Pipe_Data_Ready(PD_INSTANCE *pInst, uint32 filled)
+{
+	return (PD_ATOMIC_LOAD_SC(&pInst->PD_Pipe_Filled) != filled) ||
+			(PD_ATOMIC_LOAD_SC(&pInst->PD_Pipe_End) != PD_PROCESS_CONTINUE);
+}
+
+//QUEUE_PUSH_CHECK of the producer : batches are limited so that the consumer gets rows early
+static uint32 PNG_Pipe_Push_Check(PD_INSTANCE *pInst)
+{
+	uint32 size = PD_DEFLATE_BUF_LEN - (pInst->PD_Ptr_Block_Dec - PD_ATOMIC_LOAD(&pInst->PD_Pipe_Used));
+
+	return (size > PD_PIPE_BATCH) ? PD_PIPE_BATCH : size;
+}
+
+//QUEUE_POP_CHECK of the consumer : hands the rows taken so far back to the producer first
+static uint32 PNG_Pipe_Pop_Check(PD_INSTANCE *pInst)
+{
+	uint32 size;
+
+	PD_ATOMIC_STORE_SC(&pInst->PD_Pipe_Used, pInst->PD_Ptr_Image_Dec);
+	PNG_Pipe_Wake(pInst, PD_PIPE_PRODUCER);
+
+	size = PD_ATOMIC_LOAD(&pInst->PD_Pipe_Filled) - pInst->PD_Ptr_Image_Dec;
+	return (size > pInst->PD_Pipe_Batch) ? pInst->PD_Pipe_Batch : size;
+}
+
+static void * PNG_Pipe_Producer(void *arg)
+{
+	PD_INSTANCE *pInst = (PD_INSTANCE *)arg;
+	int msg_ret = PD_PROCESS_CONTINUE;
+	uint32 need;
+#if defined(PNGDEC_OPT_STATS)
+	uint64 stats_t;
+	uint32 stats_job;
+#endif
+
+	while(msg_ret != PD_PROCESS_EOF && msg_ret != PD_PROCESS_ERROR)
+	{
+		if(pInst->PD_Cur_Job == PD_JOB_DECODE_COPY || pInst->PD_Cur_Job == PD_JOB_DECODE_BLOCK)
+		{
+			//PNG_Decode_Block fails without room for what is left from its last run
+			need = 1;
+			if(pInst->PD_Cur_Job == PD_JOB_DECODE_BLOCK)
+			{
+				need += pInst->PD_Liter2Push_Num;
+				if(pInst->PD_Still_Decoding == PD_DONE_YET)
+					need += pInst->PD_Len2Copy;
+			}
+			PNG_Pipe_Wait(pInst, PD_PIPE_PRODUCER, PNG_Pipe_Space_Ready, need);
+		}
+		if(PD_ATOMIC_LOAD_SC(&pInst->PD_Pipe_Stop))
+		{
+			msg_ret = PD_PROCESS_ERROR;
+			break;
+		}
+
+		PD_STATS_START(pInst->PD_Cur_Job);
+		msg_ret = PNG_Inflate_Job(pInst);
+		PD_STATS_STOP();
+
+		PD_ATOMIC_STORE_SC(&pInst->PD_Pipe_Filled, pInst->PD_Ptr_Block_Dec);
+		PNG_Pipe_Wake(pInst, PD_PIPE_CONSUMER);
+	}
+
+	PD_ATOMIC_STORE_SC(&pInst->PD_Pipe_End, msg_ret);
+	PNG_Pipe_Wake(pInst, PD_PIPE_CONSUMER);
+	return NULL;
+}
+
+//Starts the producer thread at PD_Cur_Job : PD_PROCESS_DONE, or PD_PROCESS_ERROR to decode on the caller's thread only
+static int PNG_Pipe_Start(PD_INSTANCE *pInst)
+{
+	if(pInst->PD_Out_Struct.PIPELINE_MODE != PD_PIPELINE_2THREADS || pInst->PD_Push_On)
+		return PD_PROCESS_ERROR;
+	//resized ADAM7 output depends on how the rows are split between calls : keep it on one thread
+	if(pInst->PD_Interlace_Method == PD_INTERLACE_ADAM && pInst->PD_Image_Smaller_LCD != PD_TRUE)
+		return PD_PROCESS_ERROR;
+	//the two stages would only take turns on a single CPU
+	if(PD_CPU_COUNT() < 2)
+		return PD_PROCESS_ERROR;
+
+	if(pthread_mutex_init(&pInst->PD_Pipe_Mutex, NULL) != 0)
+		return PD_PROCESS_ERROR;
+	if(pthread_cond_init(&pInst->PD_Pipe_Cond, NULL) != 0)
+	{
+		pthread_mutex_destroy(&pInst->PD_Pipe_Mutex);
+		return PD_PROCESS_ERROR;
+	}
+
+	pInst->PD_Pipe_Filled = pInst->PD_Ptr_Block_Dec;
+	pInst->PD_Pipe_Used = pInst->PD_Ptr_Image_Dec;
+	pInst->PD_Pipe_Batch = PD_PIPE_BATCH + pInst->PD_Global_Scanline_Size + 1;	//one row at least
+	pInst->PD_Pipe_End = PD_PROCESS_CONTINUE;
+	pInst->PD_Pipe_Stop = 0;
+	pInst->PD_Pipe_Sleep[PD_PIPE_PRODUCER] = 0;
+	pInst->PD_Pipe_Sleep[PD_PIPE_CONSUMER] = 0;
+	pInst->PD_Pipe_On = 1;
+
+	if(pthread_create(&pInst->PD_Pipe_Thread, NULL, PNG_Pipe_Producer, pInst) != 0)
+	{
+		pInst->PD_Pipe_On = 0;
+		pthread_cond_destroy(&pInst->PD_Pipe_Cond);
+		pthread_mutex_destroy(&pInst->PD_Pipe_Mutex);
+		return PD_PROCESS_ERROR;
+	}
+	return PD_PROCESS_DONE;
+}
+
+//Waits for the producer thread : everything it wrote is visible afterwards
+static int PNG_Pipe_Join(PD_INSTANCE *pInst)
+{
+	pthread_join(pInst->PD_Pipe_Thread, NULL);
+	pthread_cond_destroy(&pInst->PD_Pipe_Cond);
+	pthread_mutex_destroy(&pInst->PD_Pipe_Mutex);
+	pInst->PD_Pipe_On = 0;
+
+	return pInst->PD_Pipe_End;
+}
+
+static void PNG_Pipe_Stop(PD_INSTANCE *pInst)
+{
+	if(pInst->PD_Pipe_On)
+	{
+		PD_ATOMIC_STORE_SC(&pInst->PD_Pipe_Stop, 1);
+		PNG_Pipe_Wake(pInst, PD_PIPE_PRODUCER);
+		PNG_Pipe_Join(pInst);
+	}
+}
+
+//Decodes the rows published so far on the caller's thread, or waits for more.
+//Returns PD_PROCESS_CONTINUE, PD_PROCESS_DONE (the image is complete) or PD_PROCESS_ERROR.
+//Once the producer is over, the last rows are left to PD_JOB_DECODE_IMAGE.
+static int PNG_Pipe_Decode_Image(PD_INSTANCE *pInst)
+{
+	int msg_ret;
+	uint32 image_dec = pInst->PD_Ptr_Image_Dec;
+	uint32 filled;
+
+	if(PD_ATOMIC_LOAD(&pInst->PD_Pipe_End) != PD_PROCESS_CONTINUE)
+	{
+		msg_ret = PNG_Pipe_Join(pInst);
+		pInst->PD_Cur_Job = PD_JOB_DECODE_IMAGE;
+		if(msg_ret == PD_PROCESS_ERROR)
+		{
+			//take every row inflated before the error, however far the consumer was :
+			//the image is complete if they reach the bottom of the LCD (as when the consumer gets there first)
+			if(pInst->PD_Ptr_Block_Dec - image_dec > 1 &&
+				pInst->PNG_Decode_Image(pInst) == PD_PROCESS_DONE && pInst->PD_Last_IDAT == PD_DONE_ALREADY)
+				return PD_PROCESS_DONE;
+			return PD_PROCESS_ERROR;
+		}
+		pInst->PD_Last_IDAT = PD_DONE_ALREADY;
+		return PD_PROCESS_CONTINUE;
+	}
+
+	filled = PD_ATOMIC_LOAD(&pInst->PD_Pipe_Filled);
+	if(filled - image_dec > 1)	//a row needs the filter type of the next one
+	{
+		msg_ret = pInst->PNG_Decode_Image(pInst);
+		if(msg_ret != PD_PROCESS_DONE || pInst->PD_Last_IDAT == PD_DONE_ALREADY)
+		{
+			//failed, or the bottom of the LCD is reached : the rest of the stream is not needed
+			PNG_Pipe_Stop(pInst);
+			pInst->PD_Cur_Job = PD_JOB_DECODE_IMAGE;
+			return (msg_ret != PD_PROCESS_DONE) ? PD_PROCESS_ERROR : PD_PROCESS_DONE;
+		}
+		if(pInst->PD_Ptr_Image_Dec != image_dec)
+			return PD_PROCESS_CONTINUE;
+	}
+
+	PNG_Pipe_Wait(pInst, PD_PIPE_CONSUMER, PNG_Pipe_Data_Ready, filled);
+	return PD_PROCESS_CONTINUE;
+}
+#endif
+
+#if defined(PNGDEC_OPT_TIME_SLICE)
+//////////////////////
+//Time Slices (TCCXXX_PNG_Dec_DecodeTimed)
+//////////////////////
+//Microseconds from PD_CUSTOM_DECODE.time_func or the monotonic clock
+static uint32 PNG_Slice_Time(PD_INSTANCE *pInst)
+{
+#if defined(PD_CLOCK_MONOTONIC)
+	struct timespec ts;
+#endif
+
+	if(pInst->PD_Slice_Clock != NULL)
+		return (uint32)(pInst->PD_Slice_Clock)();
+#if defined(PD_CLOCK_MONOTONIC)
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint32)ts.tv_sec * 1000000 + (uint32)(ts.tv_nsec / 1000);
+#else
+	return 0;
+#endif
+}
+
+//Returns 1 once the time budget of the running call is spent
+static int PNG_Slice_Over(PD_INSTANCE *pInst)
+{
+#if !defined(PD_CLOCK_MONOTONIC)
+	if(pInst->PD_Slice_Clock == NULL)
+		return 1;		//no clock : one routine a call
+#endif
+	return (uint32)(PNG_Slice_Time(pInst) - pInst->PD_Slice_Start) >= pInst->PD_Slice_Budget;
+}
+#endif
+
+//Routines left in this call after one more : RESOURCE_OCCUPATION counts them,
+//TCCXXX_PNG_Dec_DecodeTimed() looks at the clock instead
+static int PNG_Routine_Left(PD_INSTANCE *pInst, int routine_count)
+{
+#if defined(PNGDEC_OPT_TIME_SLICE)
+	if(pInst->PD_Slice_On)
+		return !PNG_Slice_Over(pInst);
+#endif
+	return routine_count - 1;
+}
+
+//////////////////////
+//Decoding Function
+//////////////////////
+static int TCCXXX_PNGDEC_Decode(PD_INSTANCE *pInst, PD_CUSTOM_DECODE *out_info)
+{
+	int msg_ret;
+	int routine_count = pInst->PD_Out_Struct.RESOURCE_OCCUPATION;
+	uint32 image_dec;
+#if defined(PNGDEC_OPT_STATS)
+	uint64 stats_t;
+	uint32 stats_job;
+#endif
+
+#if defined(PNGDEC_STABILITY_ERROR_HANDLE)
+	#if !defined(PNGDEC_CHECK_EOF_2)
+		#if defined(PD_PIPELINE)
+	if(!pInst->PD_Pipe_On)	//written by the producer thread
+		#endif
+	pInst->PD_nPngDecErrorCode = 0; //init.
+	#endif
+#endif
+
+	while(routine_count)
+	{
+		if(pInst->PD_Cancel)
+		{
+		#if defined(PD_PIPELINE)
+			PNG_Pipe_Stop(pInst);
+		#endif
+		#if defined(PNGDEC_STABILITY_ERROR_HANDLE)
+			pInst->PD_nPngDecErrorCode = TC_PNGDEC_ERR_CANCELED;
+		#endif
+			return PD_RETURN_DECODE_FAIL;
+		}
+
+	#if defined(PD_PIPELINE)
+		if(pInst->PD_Pipe_On)
+		{
+			PD_STATS_START(PD_JOB_DECODE_IMAGE);
+			msg_ret = PNG_Pipe_Decode_Image(pInst);
+			PD_STATS_STOP();
+			if(msg_ret == PD_PROCESS_ERROR)
+				return PD_RETURN_DECODE_FAIL;
+			else if(msg_ret == PD_PROCESS_DONE)
+				return PD_RETURN_DECODE_DONE;
+			routine_count = PNG_Routine_Left(pInst, routine_count);
+			continue;
+		}
+	#endif
+
+		switch(pInst->PD_Cur_Job)
+		{
+		case PD_JOB_DECODE_INIT:
+			PD_STATS_START(PD_JOB_DECODE_INIT);
+		#if defined(PNGDEC_MOD_API20081013)
+			pInst->PD_Out_Struct = *out_info;
+		#else
+			pInst->PD_Out_Struct = *out_info;
+		#endif
+			if(!pInst->PD_Crop_On)
+				pInst->PD_Out_Struct.CROP_IMAGE = 0;
+			if(!pInst->PD_Pipeline_On)
+				pInst->PD_Out_Struct.PIPELINE_MODE = PD_PIPELINE_NONE;
+			if(pInst->PD_Out_Struct.OUTPUT_MODE != PD_OUTPUT_ROW && pInst->PD_Out_Struct.OUTPUT_MODE != PD_OUTPUT_SURFACE)
+				pInst->PD_Out_Struct.OUTPUT_MODE = PD_OUTPUT_PIXEL;		//unknown modes : write_func
+			if(pInst->PD_Out_Struct.OUTPUT_MODE != PD_OUTPUT_SURFACE)
+				pInst->PD_Out_Struct.DST_FORMAT = PD_PIXFMT_RGB565;		//PNG_Init_Plte_Lut() does not see a stale value
+			switch(pInst->PD_Out_Struct.RESOURCE_OCCUPATION)
+			{
+			case PD_RESOURCE_LEVEL_NONE:
+				pInst->PD_Out_Struct.RESOURCE_OCCUPATION = 2;
+				break;
+			case PD_RESOURCE_LEVEL_LOW:
+				pInst->PD_Out_Struct.RESOURCE_OCCUPATION = 5;
+				break;
+			case PD_RESOURCE_LEVEL_MID:
+				pInst->PD_Out_Struct.RESOURCE_OCCUPATION = 10;
+				break;
+			case PD_RESOURCE_LEVEL_HIGH:
+				pInst->PD_Out_Struct.RESOURCE_OCCUPATION = 15;
+				break;
+			case PD_RESOURCE_LEVEL_ALL:
+				pInst->PD_Out_Struct.RESOURCE_OCCUPATION = 100;
+				break;
+			default: // == PD_RESOURCE_LEVEL_ALL
+				pInst->PD_Out_Struct.RESOURCE_OCCUPATION = 100;
+				break;
+			}
+
+			routine_count = pInst->PD_Out_Struct.RESOURCE_OCCUPATION;
+		#if defined(PNGDEC_OPT_RESIZE_AREA)
+			//palette indices are not averaged : nearest sampling
+			if(pInst->PD_Out_Struct.OUTPUT_MODE == PD_OUTPUT_SURFACE && PD_PIXFMT_IS_INDEX(pInst->PD_Out_Struct.DST_FORMAT))
+				pInst->PD_Area_On = 0;
+		#endif
+			PNG_Init_Heap(pInst);
+
+		#if defined(PNGDEC_STABILITY_CHECK_ADLER)
+			pInst->PD_Adler_On = (pInst->PD_Out_Struct.ERROR_DET_MODE == PD_ERROR_CHK_ALL || pInst->PD_Out_Struct.ERROR_DET_MODE == PD_ERROR_CHK_ADLER);
+		#endif
+		#if defined(PNGDEC_STABILITY_CHECK_CRC)
+			if(pInst->PD_Out_Struct.ERROR_DET_MODE == PD_ERROR_CHK_ALL || pInst->PD_Out_Struct.ERROR_DET_MODE == PD_ERROR_CHK_CRC)
+			{
+				if(pInst->PD_Crc_Error)
+				{
+					pInst->PD_nPngDecErrorCode = TC_PNGDEC_ERR_CHUNK_CRC;
+					return PD_RETURN_DECODE_FAIL;
+				}
+				pInst->PD_Crc_Mode = PD_CRC_ON;
+			}
+			else
+			{
+				pInst->PD_Crc_Mode = PD_CRC_OFF;
+				pInst->PD_Crc_Active = 0;
+			}
+		#endif
+
+			if(((pInst->PD_Color_Type == PD_COLOR_GREY_ALPHA) ||
+				(pInst->PD_Color_Type == PD_COLOR_TRUE_ALPHA) ||
+				(pInst->PD_Alpha_Available == PD_ALPHA_AVAILABLE)) && 
+			#if defined(PNGDEC_MOD_API20081013)
+				(out_info->USE_ALPHA_DATA == PD_ALPHA_AVAILABLE))
+			#else
+				(out_info->USE_ALPHA_DATA == PD_ALPHA_AVAILABLE))
+			#endif
+				pInst->PD_Alpha_Use = 1;
+			else
+				pInst->PD_Alpha_Use = 0;
+
+			if(pInst->PD_Out_Struct.OUTPUT_MODE == PD_OUTPUT_ROW || pInst->PD_Out_Struct.OUTPUT_MODE == PD_OUTPUT_SURFACE)
+			{
+				if(pInst->PD_Out_Struct.OUTPUT_MODE == PD_OUTPUT_ROW)
+				{
+					if(pInst->PD_Out_Struct.write_row_func == NULL)
+					{
+						pInst->PD_nPngDecErrorCode = TC_PNGDEC_ERR_ROW_FUNC;
+						return PD_RETURN_DECODE_FAIL;
+					}
+				}
+				else
+				{
+					if(pInst->PD_Out_Struct.DST_FORMAT > PD_PIXFMT_L16 || pInst->PD_Out_Struct.DST_FORMAT < 0)
+					{
+						pInst->PD_nPngDecErrorCode = TC_PNGDEC_ERR_DST_FORMAT;
+						return PD_RETURN_DECODE_FAIL;
+					}
+					if(pInst->PD_Out_Struct.pDstAddr[0] == NULL ||
+						((pInst->PD_Out_Struct.DST_FORMAT == PD_PIXFMT_YUV444 || pInst->PD_Out_Struct.DST_FORMAT == PD_PIXFMT_YUV420) &&
+						 (pInst->PD_Out_Struct.pDstAddr[1] == NULL || pInst->PD_Out_Struct.pDstAddr[2] == NULL)))
+					{
+						pInst->PD_nPngDecErrorCode = TC_PNGDEC_ERR_DST_ADDR;
+						return PD_RETURN_DECODE_FAIL;
+					}
+					if(PD_PIXFMT_IS_INDEX(pInst->PD_Out_Struct.DST_FORMAT) && pInst->PD_Color_Type != PD_COLOR_INDEX)
+					{
+						pInst->PD_nPngDecErrorCode = TC_PNGDEC_ERR_DST_FORMAT;
+						return PD_RETURN_DECODE_FAIL;
+					}
+				}
+
+				if(pInst->PD_Interlace_Method == PD_INTERLACE_ADAM)
+					pInst->PNG_Decode_Image = Image_Row_ADAM7;
+				else
+					pInst->PNG_Decode_Image = Image_Row_Normal;
+			}
+		#if defined(PNGDEC_OPT_PLTE_LUT)
+			PNG_Init_Plte_Lut(pInst);
+		#endif
+		#if defined(PNGDEC_OPT_RESIZE_AREA)
+			if(pInst->PD_Area_On)
+			{
+				pInst->PNG_Decode_Image = Image_Resize_Area;
+				pInst->PD_Area_Premul = (pInst->PD_Alpha_Use == 1 &&
+										 pInst->PD_Color_Type != PD_COLOR_GREY && pInst->PD_Color_Type != PD_COLOR_TRUE);
+			}
+		#endif
+
+			if(PNG_Init_Crop(pInst) == PD_PROCESS_ERROR)
+			{
+				pInst->PD_nPngDecErrorCode = TC_PNGDEC_ERR_CROP;
+				return PD_RETURN_DECODE_FAIL;
+			}
+			if(pInst->PD_Out_Struct.CROP_IMAGE && pInst->PNG_Decode_Image != Image_Row_Normal)
+			{
+			#if defined(PNGDEC_OPT_RESIZE_AREA)
+				if(!pInst->PD_Area_On)
+			#endif
+				pInst->PNG_Decode_Image = Image_Row_Normal;	//PD_OUTPUT_PIXEL as well
+			}
+			
+			pInst->PD_Cur_Job = PD_JOB_DECODE_HEADER;
+		#if defined(PD_PIPELINE)
+			PNG_Pipe_Start(pInst);
+		#endif
+			PD_STATS_STOP();
+			break;
+
+		////////////////////////////////////////
+		//(4)Decode Image by using Data in Ring-Queue
+		////////////////////////////////////////
+		case PD_JOB_DECODE_IMAGE:
+			image_dec = pInst->PD_Ptr_Image_Dec;
+			PD_STATS_START(PD_JOB_DECODE_IMAGE);
+			msg_ret = pInst->PNG_Decode_Image(pInst);
+			PD_STATS_STOP();
+
+			if(msg_ret != PD_PROCESS_DONE)
+				return PD_RETURN_DECODE_FAIL;
+
+			if( pInst->PD_nPngDecErrorCode < 0 ) {
+			#if defined(PNGDEC_CHECK_EOF_2)
+				if( pInst->PD_nPngDecErrorCode == TC_PNGDEC_ERR_STREAM_READING)
+				{
+					if(msg_ret != PD_PROCESS_DONE)
+					{
+						return PD_PROCESS_ERROR;
+					}else
+					{
+						pInst->PD_Last_IDAT = PD_DONE_ALREADY;
+					}
+				}else
+			#endif
+				{
+					return PD_PROCESS_ERROR;
+				}
+			}
+
+			if(pInst->PD_Last_IDAT == PD_DONE_ALREADY)
+			{
+				//the resized ADAM7 routines return at the end of each pass : take the passes left in the queue
+				if(pInst->PD_Interlace_Method != PD_INTERLACE_ADAM || pInst->PD_Ptr_Image_Dec == image_dec)
+					return PD_RETURN_DECODE_DONE;
+				break;
+			}
+
+			pInst->PD_Cur_Job = pInst->PD_Prev_Job;
+			break;
+
+		////////////////////////////////////////
+		//(1)~(4)Search for IDAT Chunk, Decode ZLIB & Blocks into Ring-Queue
+		////////////////////////////////////////
+		default:
+			if(PNG_Push_Wait(pInst))
+				return PD_RETURN_NEED_MORE_DATA;
+		#if defined(PNGDEC_OPT_TIME_SLICE)
+			//the image job takes the rows of each slice before the clock is read again
+			if(pInst->PD_Slice_On && pInst->PD_Push_Limit > PD_SLICE_BYTES)
+				pInst->PD_Push_Limit = PD_SLICE_BYTES;
+		#endif
+			PD_STATS_START(pInst->PD_Cur_Job);
+			msg_ret = PNG_Inflate_Job(pInst);
+			PD_STATS_STOP();
+			if(msg_ret == PD_PROCESS_ERROR)
+				return PD_RETURN_DECODE_FAIL;
+			else if(msg_ret == PD_PROCESS_EOF)
+			{
+				pInst->PD_Last_IDAT = PD_DONE_ALREADY;
+				pInst->PD_Cur_Job = PD_JOB_DECODE_IMAGE;
+			}
+			else if(msg_ret == PD_PROCESS_DONE)
+				pInst->PD_Cur_Job = PD_JOB_DECODE_IMAGE;
+			break;
+		}
+		
+		routine_count = PNG_Routine_Left(pInst, routine_count);
+	}
+	return PD_RETURN_DECODE_PROCESSING;
+}
+
+
+
+/****************************************************************
+	API
+****************************************************************/
+
+//////////////////////
+//Instance Functions (multi-instance)
+//////////////////////
+PD_HANDLE TCCXXX_PNG_Dec_Create(void * pInstanceBuf, unsigned int iBufSize)
+{
+	return (PD_HANDLE)PNG_Init_instanceMem((char *)pInstanceBuf, iBufSize);
+}
+
+int TCCXXX_PNG_Dec_Init(PD_HANDLE hPngDec, PD_INIT * pInit, PD_CALLBACKS * pCallbacks)
+{
+	PD_INSTANCE *pInst = (PD_INSTANCE *)hPngDec;
+
+	if( (pInst == NULL) || (pInst->PD_Magic != PD_INSTANCE_MAGIC) || (pInit == NULL) )
+		return PD_RETURN_INIT_FAIL;
+
+#if defined(PD_PIPELINE)
+	PNG_Pipe_Stop(pInst);	//the last image was not decoded to the end
+#endif
+	pInst->PD_nPngDecErrorCode = 0;
+	if( TCCXXX_PNGDEC_Init(pInst, pInit, pCallbacks) == PD_RETURN_INIT_DONE )
+		return PD_RETURN_INIT_DONE;
+
+	//push input : the headers are not all in yet
+	if( (pInit->iOption & PD_INIT_OPT_PUSH_INPUT) && (pInst->PD_nPngDecErrorCode == TC_PNGDEC_ERR_STREAM_READING)
+		&& ((uint32)pInst->PD_Read_Point_End < pInst->PD_TotFileSize) )
+		return PD_RETURN_NEED_MORE_DATA;
+	return PD_RETURN_INIT_FAIL;
+}
+
+int TCCXXX_PNG_Dec_Decode(PD_HANDLE hPngDec, PD_CUSTOM_DECODE * pDecode)
+{
+	PD_INSTANCE *pInst = (PD_INSTANCE *)hPngDec;
+
+	if( (pInst == NULL) || (pInst->PD_Magic != PD_INSTANCE_MAGIC) || (pDecode == NULL) )
+		return PD_RETURN_DECODE_FAIL;
+
+	return TCCXXX_PNGDEC_Decode(pInst, pDecode);
+}
+
+int TCCXXX_PNG_Dec_DecodeTimed(PD_HANDLE hPngDec, PD_CUSTOM_DECODE * pDecode, unsigned int iBudgetUs)
+{
+	PD_INSTANCE *pInst = (PD_INSTANCE *)hPngDec;
+	int ret;
+
+	if( (pInst == NULL) || (pInst->PD_Magic != PD_INSTANCE_MAGIC) || (pDecode == NULL) )
+		return PD_RETURN_DECODE_FAIL;
+
+#if defined(PNGDEC_OPT_TIME_SLICE)
+	pInst->PD_Slice_Clock = pDecode->time_func;
+	pInst->PD_Slice_Budget = iBudgetUs;
+	pInst->PD_Slice_Start = PNG_Slice_Time(pInst);
+	pInst->PD_Slice_On = 1;
+	ret = TCCXXX_PNGDEC_Decode(pInst, pDecode);
+	pInst->PD_Slice_On = 0;
+#else
+	(void)iBudgetUs;
+	ret = TCCXXX_PNGDEC_Decode(pInst, pDecode);
+#endif
+	return ret;
+}
+
+int TCCXXX_PNG_Dec_Cancel(PD_HANDLE hPngDec)
+{
+	PD_INSTANCE *pInst = (PD_INSTANCE *)hPngDec;
+
+	if( (pInst == NULL) || (pInst->PD_Magic != PD_INSTANCE_MAGIC) )
+		return PD_RETURN_DECODE_FAIL;
+
+	pInst->PD_Cancel = 1;
+	return PD_RETURN_DECODE_DONE;
+}
+
+int TCCXXX_PNG_Dec_Push(PD_HANDLE hPngDec, unsigned int iFilledBytes)
+{
+	PD_INSTANCE *pInst = (PD_INSTANCE *)hPngDec;
+
+	if( (pInst == NULL) || (pInst->PD_Magic != PD_INSTANCE_MAGIC) )
+		return PD_RETURN_DECODE_FAIL;
+
+	pInst->PD_Push_Size = iFilledBytes;
+
+	//decoding (or init) in progress : more of the file can be read
+	if( pInst->PD_Push_On && (pInst->PD_Src_Buf != NULL) )
+	{
+		if( iFilledBytes > pInst->PD_TotFileSize )
+			iFilledBytes = pInst->PD_TotFileSize;
+		if( (int32)iFilledBytes > pInst->PD_Read_Point_End )
+		{
+			pInst->PD_Read_Point_End = (int32)iFilledBytes;
+		#if defined(PNGDEC_CHECK_EOF_2)
+			pInst->PD_Read_Point_Max = iFilledBytes;
+		#endif
+		}
+	}
+	return PD_RETURN_DECODE_DONE;
+}
+
+int TCCXXX_PNG_Dec_GetError(PD_HANDLE hPngDec)
+{
+	PD_INSTANCE *pInst = (PD_INSTANCE *)hPngDec;
+
+	if( (pInst == NULL) || (pInst->PD_Magic != PD_INSTANCE_MAGIC) )
+		return PD_RETURN_DECODE_FAIL;
+
+#if defined(PNGDEC_STABILITY_ERROR_HANDLE)
+	return pInst->PD_nPngDecErrorCode;
+#else
+	return 0;
+#endif
+}
+
+int TCCXXX_PNG_Dec_GetChunkIndex(PD_HANDLE hPngDec, PD_CHUNK_INFO * pIndex, int iMaxNum)
+{
+	PD_INSTANCE *pInst = (PD_INSTANCE *)hPngDec;
+#if defined(PNGDEC_OPT_CHUNK_SEEK)
+	int i;
+#endif
+
+	if( (pInst == NULL) || (pInst->PD_Magic != PD_INSTANCE_MAGIC) || (pIndex == NULL) || (iMaxNum <= 0) )
+		return 0;
+
+#if defined(PNGDEC_OPT_CHUNK_SEEK)
+	if( iMaxNum > pInst->PD_Chunk_Num )
+		iMaxNum = pInst->PD_Chunk_Num;
+	for(i = 0;i < iMaxNum;i++)
+		pIndex[i] = pInst->PD_Chunk_Index[i];
+	return iMaxNum;
+#else
+	return 0;
+#endif
+}
+
+int TCCXXX_PNG_Dec_GetPalette(PD_HANDLE hPngDec, unsigned int * pPalette, int * pEntryNum)
+{
+	PD_INSTANCE *pInst = (PD_INSTANCE *)hPngDec;
+	uint32 i, alpha;
+
+	if( (pInst == NULL) || (pInst->PD_Magic != PD_INSTANCE_MAGIC) || (pPalette == NULL) ||
+		(pInst->PD_Color_Type != PD_COLOR_INDEX) )
+		return PD_RETURN_DECODE_FAIL;
+
+	for(i = 0;i < PD_PLTE_TABLE_IDX;i++)
+	{
+		if(i >= pInst->PD_Plte_Entry_Num)
 		{
-			msg_ret = PNG_Parse_PLTE_Chunk();
-			if(msg_ret == PD_PROCESS_ERROR)
-				return PD_RETURN_INIT_FAIL;
+			pPalette[i] = 0;
+			continue;
 		}
+		alpha = pInst->PD_Alpha_Available ? pInst->PD_Plte[i].Alpha : 0xFF;
+		pPalette[i] = (alpha << 24) | ((uint32)pInst->PD_Plte[i].R << 16) | ((uint32)pInst->PD_Plte[i].G << 8) | pInst->PD_Plte[i].B;
 	}
+	if(pEntryNum != NULL)
+		*pEntryNum = (int)pInst->PD_Plte_Entry_Num;
+	return PD_RETURN_DECODE_DONE;
+}
 
-	msg_ret = PNG_Search_IDAT_Chunk(0);
-	if(msg_ret != PD_PROCESS_DONE)
-		return PD_RETURN_INIT_FAIL;
+int TCCXXX_PNG_Dec_GetStats(PD_HANDLE hPngDec, PD_STATS * pStats)
+{
+	PD_INSTANCE *pInst = (PD_INSTANCE *)hPngDec;
 
-	if(PD_Alpha_Available == PD_ALPHA_AVAILABLE)
-		pInitInstanceMem->alpha_available = PD_ALPHA_AVAILABLE;
-	else 
-		pInitInstanceMem->alpha_available = PD_ALPHA_DISABLE;
+	if( (pInst == NULL) || (pInst->PD_Magic != PD_INSTANCE_MAGIC) || (pStats == NULL) )
+		return PD_RETURN_DECODE_FAIL;
 
-	PD_Bpp = ((PD_Bit_Depth * PD_Compo_Num - 1) >> 3) + 1;	// 1,2,3,4,6,8
-	PD_Scanline_Size = ((PD_Global_Width * PD_Bit_Depth * PD_Compo_Num - 1) >> 3) + 1;
-	PD_Global_Scanline_Size = PD_Scanline_Size + PD_Bpp;
+#if defined(PNGDEC_OPT_STATS)
+	*pStats = pInst->PD_Stats;
+	return PD_RETURN_DECODE_DONE;
+#else
+	PNGD_MEMSET(pStats, 0, sizeof(PD_STATS));
+	return PD_RETURN_DECODE_FAIL;
+#endif
+}
 
-	pInitInstanceMem->image_width = PD_Global_Width;
-	pInitInstanceMem->image_height = PD_Global_Height;
+void TCCXXX_PNG_Dec_Destroy(PD_HANDLE hPngDec)
+{
+	PD_INSTANCE *pInst = (PD_INSTANCE *)hPngDec;
 
-	if(PD_Image_Smaller_LCD == PD_TRUE)
+	if( (pInst != NULL) && (pInst->PD_Magic == PD_INSTANCE_MAGIC) )
 	{
-		PD_Resized_Width = PD_Global_Width;
-		PD_Resized_Height = PD_Global_Height;
-	#if !defined(PNGDEC_MOD_MEM_ALIGN)
-		pInitInstanceMem->heap_size = (PD_Scanline_Size + PD_Bpp);
-	#else 
-		pInitInstanceMem->heap_size = (((PD_Scanline_Size + PD_Bpp + 63)>>2)<<2);
+	#if defined(PD_PIPELINE)
+		PNG_Pipe_Stop(pInst);
 	#endif
+		pInst->PD_Magic = 0;
 	}
-	else
+}
+
+//////////////////////
+//Batch Functions (thread pool)
+//////////////////////
+/*	Work stealing : every thread owns a range [begin, end) of the item array, packed in one
+	64-bit word. The owner takes items from the front of its range, a thread whose range is
+	empty takes the back half of another thread's range. Both update the range by compare-and-swap,
+	so every item is handed out once. A thread leaves the batch when it finds every range empty.
+	The caller's thread is thread 0, the pool threads wait for the next batch in between.
+*/
+#define		PD_BATCH_MAGIC			0x50444242	//"PDBB"
+#define		PD_BATCH_MAX_THREADS	64
+#define		PD_BATCH_RANGE(b, e)	(((uint64)(e) << 32) | (uint32)(b))
+
+typedef struct _PD_BATCH_POOL PD_BATCH_POOL;
+
+typedef struct {
+	uint64			PD_Batch_Range;			//[begin, end) of the items this thread owns
+	PD_BATCH_POOL	*PD_Batch_Pool;
+	uint8			*PD_Batch_Inst;			//instance buffer (PD_INSTANCE_MEM_SIZE)
+	uint8			*PD_Batch_Heap;			//Heap_Memory of the items without one
+	uint32			PD_Batch_Heap_Size;
+#if defined(PD_BATCH_THREADS)
+	pthread_t		PD_Batch_Thread;
+#endif
+	uint8			PD_Batch_Pad[64];		//keeps the ranges of two threads out of one cache line
+}PD_BATCH_WORKER;
+
+struct _PD_BATCH_POOL {
+	uint32			PD_Batch_Magic;			//PD_BATCH_MAGIC while the pool is valid
+	int				PD_Batch_Threads;		//the caller's thread included
+	PD_BATCH_WORKER	*PD_Batch_Worker;
+	PD_BATCH_ITEM	*PD_Batch_Items;		//the batch being decoded
+#if defined(PD_BATCH_THREADS)
+	pthread_mutex_t	PD_Batch_Mutex;
+	pthread_cond_t	PD_Batch_Start_Cond;	//a batch is posted or the pool is destroyed
+	pthread_cond_t	PD_Batch_Done_Cond;		//the last pool thread left the batch
+	uint32			PD_Batch_Id;			//changes when a batch is posted
+	int				PD_Batch_Busy;			//pool threads still in the batch
+	int				PD_Batch_Quit;
+#endif
+};
+
+static void PNG_Batch_Decode_Item(PD_BATCH_WORKER *pWorker, PD_BATCH_ITEM *pItem)
+{
+	PD_HANDLE hPngDec;
+	PD_CUSTOM_DECODE decode;
+	int msg_ret = PD_RETURN_DECODE_FAIL;
+	int error = 0;
+
+	hPngDec = TCCXXX_PNG_Dec_Create(pWorker->PD_Batch_Inst, PD_INSTANCE_MEM_SIZE);
+	if(TCCXXX_PNG_Dec_Init(hPngDec, &pItem->init, &pItem->callbacks) == PD_RETURN_INIT_DONE)
 	{
-		int TX,TY;
-		TX=(PD_Global_Width << 16) / PD_LCD_Width;
-		TY=(PD_Global_Height << 16) / PD_LCD_Height;
-		if(TX > TY)	//Resize based on horizontal direction
+		decode = pItem->decode;
+		decode.PIPELINE_MODE = PD_PIPELINE_NONE;	//the other images keep the CPUs busy
+		if(decode.Heap_Memory == NULL)
 		{
-			PD_Resized_Width = PD_LCD_Width;		
-			PD_Resized_Height = (PD_Global_Height << 16) / TX;
-
-		#if defined(PNGDEC_MOD_DIV0)
-			PD_Resized_Height = (PD_Global_Height << 16) / TX;
-			if( PD_Resized_Height == 0 ) 
-				PD_Resized_Height = 1;
-		#endif
+			if(pWorker->PD_Batch_Heap_Size < pItem->init.heap_size)
+			{
+				free(pWorker->PD_Batch_Heap);
+				pWorker->PD_Batch_Heap = (uint8 *)malloc(pItem->init.heap_size);
+				pWorker->PD_Batch_Heap_Size = (pWorker->PD_Batch_Heap != NULL) ? pItem->init.heap_size : 0;
+			}
+			decode.Heap_Memory = pWorker->PD_Batch_Heap;
 		}
-		else		//Resize based on vertical direction
-		{
-			PD_Resized_Height = PD_LCD_Height;
-			PD_Resized_Width = (PD_Global_Width << 16) / TY;
 
-		#if defined(PNGDEC_MOD_DIV0)
-			if( PD_Resized_Width == 0 )
-				PD_Resized_Width = 1;
-		#endif
+		if(decode.Heap_Memory != NULL)
+		{
+			do {
+				msg_ret = TCCXXX_PNG_Dec_Decode(hPngDec, &decode);
+			} while(msg_ret == PD_RETURN_DECODE_PROCESSING);
 		}
-	#if !defined(PNGDEC_MOD_MEM_ALIGN)
-		pInitInstanceMem->heap_size = (PD_Scanline_Size + PD_Bpp * 2)
-									 + PD_Resized_Width * 2 + PD_Resized_Height * 2;
-	#else
-		pInitInstanceMem->heap_size = (( (PD_Scanline_Size + PD_Bpp * 2)
-									    + PD_Resized_Width * 2 + PD_Resized_Height * 2 + 63 
-									  )>>2)<<2;
+	#if defined(PNGDEC_STABILITY_ERROR_HANDLE)
+		else
+			error = TC_PNGDEC_ERR_BATCH_MEMORY;
 	#endif
 	}
 
-	PD_Cur_Job = PD_JOB_DECODE_INIT;
-	PD_Out_Struct.RESOURCE_OCCUPATION = 1;
+	if(msg_ret != PD_RETURN_DECODE_DONE && error == 0)
+		error = TCCXXX_PNG_Dec_GetError(hPngDec);
+	TCCXXX_PNG_Dec_Destroy(hPngDec);
 
-#if defined(PNGDEC_REPORT_BITDEPTH)
+	pItem->iResult = msg_ret;
+	pItem->iError = error;
+	if(pItem->done_func != NULL)
+		pItem->done_func(pItem);
+}
+
+#if defined(PD_BATCH_THREADS)
+//Returns the index of the next item for thread 'self', -1 when the batch is over
+static int PNG_Batch_Take(PD_BATCH_POOL *pPool, int self)
+{
+	uint64 *own = &pPool->PD_Batch_Worker[self].PD_Batch_Range;
+	uint64 *victim;
+	uint64 range;
+	uint32 begin, end, take;
+	int i;
+
+	range = PD_ATOMIC_LOAD(own);
+	for(;;)
 	{
-		int tpxlDepth = 0;
+		begin = (uint32)range;
+		end = (uint32)(range >> 32);
+		if(begin >= end)
+			break;
+		if(PD_ATOMIC_CAS(own, &range, PD_BATCH_RANGE(begin + 1, end)))
+			return (int)begin;
+	}
 
-		switch( PD_Color_Type )
+	for(i = 1; i < pPool->PD_Batch_Threads; i++)
+	{
+		victim = &pPool->PD_Batch_Worker[(self + i) % pPool->PD_Batch_Threads].PD_Batch_Range;
+		range = PD_ATOMIC_LOAD(victim);
+		for(;;)
 		{
-		case 0:	//Greyscale
-			tpxlDepth = PD_Bit_Depth;
-			break;
-		case 2:	//Truecolor
-			tpxlDepth = PD_Bit_Depth * 3;
-			break;
-		case 3:	//Indexed-color
-			tpxlDepth = 24;
-			break;
-		case 4:	//Greyscale with alpah
-			tpxlDepth = PD_Bit_Depth * 2;
-			break;			
-		case 6:	//Truecolor with alpha
-			tpxlDepth = PD_Bit_Depth * 4;
-			break;
+			begin = (uint32)range;
+			end = (uint32)(range >> 32);
+			if(begin >= end)
+				break;
+			take = (end - begin + 1) >> 1;
+			if(PD_ATOMIC_CAS(victim, &range, PD_BATCH_RANGE(begin, end - take)))
+			{
+				//nobody takes from an empty range, so the owner may simply store the stolen one
+				PD_ATOMIC_STORE_SC(own, PD_BATCH_RANGE(end - take + 1, end));
+				return (int)(end - take);
+			}
 		}
-		pInitInstanceMem->pixel_depth = tpxlDepth;
 	}
-#endif
-
-	return PD_RETURN_INIT_DONE;
+	return -1;
 }
 
+static void PNG_Batch_Work(PD_BATCH_POOL *pPool, int self)
+{
+	int idx;
 
-//////////////////////
-//Decoding Function
-//////////////////////
-int TCCXXX_PNGDEC_Decode(PD_CUSTOM_DECODE *out_info)
+	while((idx = PNG_Batch_Take(pPool, self)) >= 0)
+		PNG_Batch_Decode_Item(&pPool->PD_Batch_Worker[self], &pPool->PD_Batch_Items[idx]);
+}
+
+static void * PNG_Batch_Thread(void *arg)
 {
-	int msg_ret;
-	int routine_count = PD_Out_Struct.RESOURCE_OCCUPATION;
+	PD_BATCH_WORKER *pWorker = (PD_BATCH_WORKER *)arg;
+	PD_BATCH_POOL *pPool = pWorker->PD_Batch_Pool;
+	uint32 batch_id = 0;
 
-#if defined(PNGDEC_STABILITY_ERROR_HANDLE)
-	#if !defined(PNGDEC_CHECK_EOF_2)
-	PD_nPngDecErrorCode = 0; //init.
-	#endif
+	pthread_mutex_lock(&pPool->PD_Batch_Mutex);
+	for(;;)
+	{
+		while(!pPool->PD_Batch_Quit && pPool->PD_Batch_Id == batch_id)
+			pthread_cond_wait(&pPool->PD_Batch_Start_Cond, &pPool->PD_Batch_Mutex);
+		if(pPool->PD_Batch_Quit)
+			break;
+		batch_id = pPool->PD_Batch_Id;
+		pthread_mutex_unlock(&pPool->PD_Batch_Mutex);
+
+		PNG_Batch_Work(pPool, (int)(pWorker - pPool->PD_Batch_Worker));
+
+		pthread_mutex_lock(&pPool->PD_Batch_Mutex);
+		if(--pPool->PD_Batch_Busy == 0)
+			pthread_cond_signal(&pPool->PD_Batch_Done_Cond);
+	}
+	pthread_mutex_unlock(&pPool->PD_Batch_Mutex);
+
+	return NULL;
+}
 #endif
 
-	while(routine_count)
-	{
-		switch(PD_Cur_Job)
-		{
-		case PD_JOB_DECODE_INIT:
-		#if defined(PNGDEC_MOD_API20081013)
-			PD_Out_Struct = *out_info;
-		#else
-			PD_Out_Struct = *out_info;
-		#endif
-			switch(PD_Out_Struct.RESOURCE_OCCUPATION)
-			{
-			case PD_RESOURCE_LEVEL_NONE:
-				PD_Out_Struct.RESOURCE_OCCUPATION = 2;
-				break;
-			case PD_RESOURCE_LEVEL_LOW:
-				PD_Out_Struct.RESOURCE_OCCUPATION = 5;
-				break;
-			case PD_RESOURCE_LEVEL_MID:
-				PD_Out_Struct.RESOURCE_OCCUPATION = 10;
-				break;
-			case PD_RESOURCE_LEVEL_HIGH:
-				PD_Out_Struct.RESOURCE_OCCUPATION = 15;
-				break;
-			case PD_RESOURCE_LEVEL_ALL:
-				PD_Out_Struct.RESOURCE_OCCUPATION = 100;
-				break;
-			default: // == PD_RESOURCE_LEVEL_ALL
-				PD_Out_Struct.RESOURCE_OCCUPATION = 100;
-				break;
-			}
+static void PNG_Batch_Free(PD_BATCH_POOL *pPool)
+{
+	int i;
 
-			routine_count = PD_Out_Struct.RESOURCE_OCCUPATION;
-			PNG_Init_Heap();
+	for(i = 0; i < pPool->PD_Batch_Threads; i++)
+	{
+		free(pPool->PD_Batch_Worker[i].PD_Batch_Inst);
+		free(pPool->PD_Batch_Worker[i].PD_Batch_Heap);
+	}
+	free(pPool->PD_Batch_Worker);
+	free(pPool);
+}
 
-			if(((PD_Color_Type == PD_COLOR_GREY_ALPHA) ||
-				(PD_Color_Type == PD_COLOR_TRUE_ALPHA) ||
-				(PD_Alpha_Available == PD_ALPHA_AVAILABLE)) && 
-			#if defined(PNGDEC_MOD_API20081013)
-				(out_info->USE_ALPHA_DATA == PD_ALPHA_AVAILABLE))
-			#else
-				(out_info->USE_ALPHA_DATA == PD_ALPHA_AVAILABLE))
-			#endif
-				PD_Alpha_Use = 1;
-			else
-				PD_Alpha_Use = 0;
-			
-			PD_Cur_Job = PD_JOB_DECODE_HEADER;
-			break;
+PD_BATCH_HANDLE TCCXXX_PNG_Batch_Create(int iThreads)
+{
+	PD_BATCH_POOL *pPool;
+	PD_BATCH_WORKER *pWorker;
+	int i;
 
-		////////////////////////////////////////
-		//(1)Search for IDAT Chunk
-		////////////////////////////////////////
-		case PD_JOB_SEARCH_IDAT:
-			msg_ret = PNG_Search_IDAT_Chunk(1);
-			if(msg_ret == PD_PROCESS_EOF)
-			{
-				PD_Last_IDAT = PD_DONE_ALREADY;
-				PD_Cur_Job = PD_JOB_DECODE_IMAGE;
-			}
-			else if(msg_ret == PD_PROCESS_ERROR)
-				return PD_RETURN_DECODE_FAIL;
-			else
-				PD_Cur_Job = PD_JOB_DECODE_HEADER;
-			break;
+#if defined(PD_BATCH_THREADS)
+	if(iThreads <= 0)
+		iThreads = (int)PD_CPU_COUNT();
+	if(iThreads > PD_BATCH_MAX_THREADS)
+		iThreads = PD_BATCH_MAX_THREADS;
+	if(iThreads <= 0)
+		iThreads = 1;
+#else
+	iThreads = 1;		//the caller's thread only
+#endif
 
-		////////////////////////////////////////
-		//(2)Decode ZLIB Header & 3-bit Block Header
-		////////////////////////////////////////
-		case PD_JOB_DECODE_HEADER:
-			msg_ret = PNG_Decode_ZLIB();
-			if(msg_ret != PD_PROCESS_DONE)
-				return PD_RETURN_DECODE_FAIL;
-			PD_Cur_Job = PD_JOB_DECODE_BLOCK_HEADER;
-			break;
+	pPool = (PD_BATCH_POOL *)calloc(1, sizeof(PD_BATCH_POOL));
+	if(pPool == NULL)
+		return NULL;
+	pPool->PD_Batch_Worker = (PD_BATCH_WORKER *)calloc(iThreads, sizeof(PD_BATCH_WORKER));
+	if(pPool->PD_Batch_Worker == NULL)
+	{
+		free(pPool);
+		return NULL;
+	}
 
-		case PD_JOB_DECODE_BLOCK_HEADER:
-			msg_ret = PNG_Decode_Block_Header();
-			if(msg_ret != PD_PROCESS_DONE)
-				return PD_RETURN_DECODE_FAIL;
-			
-			switch(PD_Deflate_Type)
-			{
-			case PD_DEFLATE_NOCOMP:
-				PD_Cur_Job = PD_JOB_DECODE_COPY;
-				break;
-			case PD_DEFLATE_FIXHUFF:
-				if(PD_FixHuff_Done == PD_DONE_YET)
-					PD_Cur_Job = PD_JOB_BUILD_FIXHUFF;
-				else
-					PD_Cur_Job = PD_JOB_DECODE_BLOCK;
-				break;
-			case PD_DEFLATE_VARHUFF:
-				PD_Cur_Job = PD_JOB_BUILD_VARHUFF;
-				break;
-			default:
-				return PD_RETURN_DECODE_FAIL;
-			}
-			
-			break;
+#if defined(PD_BATCH_THREADS)
+	if(pthread_mutex_init(&pPool->PD_Batch_Mutex, NULL) != 0)
+	{
+		PNG_Batch_Free(pPool);
+		return NULL;
+	}
+	if(pthread_cond_init(&pPool->PD_Batch_Start_Cond, NULL) != 0)
+	{
+		pthread_mutex_destroy(&pPool->PD_Batch_Mutex);
+		PNG_Batch_Free(pPool);
+		return NULL;
+	}
+	if(pthread_cond_init(&pPool->PD_Batch_Done_Cond, NULL) != 0)
+	{
+		pthread_cond_destroy(&pPool->PD_Batch_Start_Cond);
+		pthread_mutex_destroy(&pPool->PD_Batch_Mutex);
+		PNG_Batch_Free(pPool);
+		return NULL;
+	}
+#endif
 
-		////////////////////////////////////////
-		//(3)Build Up Huffman Table
-		////////////////////////////////////////
-		case PD_JOB_BUILD_FIXHUFF:
-			msg_ret = PNG_Generate_FixHuff_Table();
-			if(msg_ret != PD_PROCESS_DONE)
-				return PD_RETURN_DECODE_FAIL;
-			
-			PD_Cur_Job = PD_JOB_DECODE_BLOCK;
+	//a thread which cannot get its instance buffer or be started leaves the pool smaller
+	for(i = 0; i < iThreads; i++)
+	{
+		pWorker = &pPool->PD_Batch_Worker[i];
+		pWorker->PD_Batch_Pool = pPool;
+		pWorker->PD_Batch_Inst = (uint8 *)malloc(PD_INSTANCE_MEM_SIZE);
+		if(pWorker->PD_Batch_Inst == NULL)
 			break;
-		case PD_JOB_BUILD_VARHUFF:
-			msg_ret = PNG_Generate_VarHuff_Table();
-			if(msg_ret != PD_PROCESS_DONE)
-				return PD_RETURN_DECODE_FAIL;
-			
-			PD_Cur_Job = PD_JOB_DECODE_BLOCK;
+	#if defined(PD_BATCH_THREADS)
+		if(i > 0 && pthread_create(&pWorker->PD_Batch_Thread, NULL, PNG_Batch_Thread, pWorker) != 0)
+		{
+			free(pWorker->PD_Batch_Inst);
+			pWorker->PD_Batch_Inst = NULL;
 			break;
+		}
+	#endif
+	}
+	pPool->PD_Batch_Threads = i;
+	pPool->PD_Batch_Magic = PD_BATCH_MAGIC;
 
-		////////////////////////////////////////
-		//(4)Decode Block acorrding to Compression Options
-		////////////////////////////////////////
-		case PD_JOB_DECODE_COPY:
-			msg_ret = PNG_Copy_Block();
+	if(i == 0)
+	{
+		TCCXXX_PNG_Batch_Destroy((PD_BATCH_HANDLE)pPool);
+		return NULL;
+	}
+	return (PD_BATCH_HANDLE)pPool;
+}
 
-			PD_Prev_Job = PD_JOB_DECODE_COPY;
-			if( PD_nPngDecErrorCode < 0 ) {
-				return PD_PROCESS_ERROR;
-			}
-		
-			if(msg_ret == PD_PROCESS_ERROR)
-				return PD_RETURN_DECODE_FAIL;
-			else if(msg_ret == PD_PROCESS_CONTINUE)
-			{
-				if(PD_Last_Block)
-				{
-					QUEUE_PUSH(PD_FILT_UP);
-					PNG_Check_Adler32();
-					PNG_Check_CRC();
-					PD_Cur_Job = PD_JOB_SEARCH_IDAT;
-				}
-				else
-				{
-					PD_Cur_Job = PD_JOB_DECODE_BLOCK_HEADER;
-				}
-			}
-			else
-				PD_Cur_Job = PD_JOB_DECODE_IMAGE;
-			break;
-		case PD_JOB_DECODE_BLOCK:
-			msg_ret = PNG_Decode_Block();
+int TCCXXX_PNG_Batch_Decode(PD_BATCH_HANDLE hBatch, PD_BATCH_ITEM * pItems, int iCount)
+{
+	PD_BATCH_POOL *pPool = (PD_BATCH_POOL *)hBatch;
+	int i;
 
-			PD_Prev_Job = PD_JOB_DECODE_BLOCK;
-			if( PD_nPngDecErrorCode < 0 ) {
-			#if defined(PNGDEC_CHECK_EOF_2)
-				if( PD_nPngDecErrorCode == TC_PNGDEC_ERR_STREAM_READING )
-				{
-					PD_Cur_Job = PD_JOB_DECODE_IMAGE;
-					break;
-				}
-			#endif
-				return PD_PROCESS_ERROR;
-			}
-		
-			if(msg_ret == PD_PROCESS_ERROR)
-				return PD_RETURN_DECODE_FAIL;
-			else if(msg_ret == PD_PROCESS_CONTINUE)
-			{
-				if(PD_Last_Block)
-				{
-					QUEUE_PUSH(PD_FILT_UP);
-					PNG_Check_Adler32();
-					PNG_Check_CRC();
-					PD_Cur_Job = PD_JOB_SEARCH_IDAT;
-				}
-				else
-				{
-					PD_Cur_Job = PD_JOB_DECODE_BLOCK_HEADER;
-				}
-			}
-			else
-				PD_Cur_Job = PD_JOB_DECODE_IMAGE;
-			break;
+	if( (pPool == NULL) || (pPool->PD_Batch_Magic != PD_BATCH_MAGIC) || (pItems == NULL) || (iCount < 0) )
+		return PD_RETURN_BATCH_FAIL;
 
-		////////////////////////////////////////
-		//(4)Decode Image by using Data in Ring-Queue
-		////////////////////////////////////////
-		case PD_JOB_DECODE_IMAGE:
-			msg_ret = PNG_Decode_Image();
+#if defined(PD_BATCH_THREADS)
+	pPool->PD_Batch_Items = pItems;
+	for(i = 0; i < pPool->PD_Batch_Threads; i++)
+		pPool->PD_Batch_Worker[i].PD_Batch_Range = PD_BATCH_RANGE(
+				(uint64)iCount * i / pPool->PD_Batch_Threads,
+				(uint64)iCount * (i + 1) / pPool->PD_Batch_Threads);
 
-			if(msg_ret != PD_PROCESS_DONE)
-				return PD_RETURN_DECODE_FAIL;
+	pthread_mutex_lock(&pPool->PD_Batch_Mutex);
+	pPool->PD_Batch_Busy = pPool->PD_Batch_Threads - 1;
+	pPool->PD_Batch_Id++;
+	pthread_cond_broadcast(&pPool->PD_Batch_Start_Cond);
+	pthread_mutex_unlock(&pPool->PD_Batch_Mutex);
 
-			if( PD_nPngDecErrorCode < 0 ) {
-			#if defined(PNGDEC_CHECK_EOF_2)
-				if( PD_nPngDecErrorCode == TC_PNGDEC_ERR_STREAM_READING)
-				{
-					if(msg_ret != PD_PROCESS_DONE)
-					{
-						return PD_PROCESS_ERROR;
-					}else
-					{
-						PD_Last_IDAT = PD_DONE_ALREADY;
-					}
-				}else
-			#endif
-				{
-					return PD_PROCESS_ERROR;
-				}
-			}
+	PNG_Batch_Work(pPool, 0);
 
-			if(PD_Last_IDAT == PD_DONE_ALREADY)
-				return PD_RETURN_DECODE_DONE;
+	pthread_mutex_lock(&pPool->PD_Batch_Mutex);
+	while(pPool->PD_Batch_Busy > 0)
+		pthread_cond_wait(&pPool->PD_Batch_Done_Cond, &pPool->PD_Batch_Mutex);
+	pthread_mutex_unlock(&pPool->PD_Batch_Mutex);
+#else
+	for(i = 0; i < iCount; i++)
+		PNG_Batch_Decode_Item(&pPool->PD_Batch_Worker[0], &pItems[i]);
+#endif
 
-			PD_Cur_Job = PD_Prev_Job;
-			break;		
-		default:
-			return PD_RETURN_DECODE_FAIL;
-		}
-		
-		routine_count--;
+	for(i = 0; i < iCount; i++)
+	{
+		if(pItems[i].iResult != PD_RETURN_DECODE_DONE)
+			return PD_RETURN_BATCH_PARTIAL;
 	}
-	return PD_RETURN_DECODE_PROCESSING;
+	return PD_RETURN_BATCH_DONE;
 }
 
+void TCCXXX_PNG_Batch_Destroy(PD_BATCH_HANDLE hBatch)
+{
+	PD_BATCH_POOL *pPool = (PD_BATCH_POOL *)hBatch;
+#if defined(PD_BATCH_THREADS)
+	int i;
+#endif
 
+	if( (pPool == NULL) || (pPool->PD_Batch_Magic != PD_BATCH_MAGIC) )
+		return;
 
-/****************************************************************
-	API
-****************************************************************/
+#if defined(PD_BATCH_THREADS)
+	pthread_mutex_lock(&pPool->PD_Batch_Mutex);
+	pPool->PD_Batch_Quit = 1;
+	pthread_cond_broadcast(&pPool->PD_Batch_Start_Cond);
+	pthread_mutex_unlock(&pPool->PD_Batch_Mutex);
+
+	for(i = 1; i < pPool->PD_Batch_Threads; i++)
+		pthread_join(pPool->PD_Batch_Worker[i].PD_Batch_Thread, NULL);
+
+	pthread_cond_destroy(&pPool->PD_Batch_Done_Cond);
+	pthread_cond_destroy(&pPool->PD_Batch_Start_Cond);
+	pthread_mutex_destroy(&pPool->PD_Batch_Mutex);
+#endif
+	pPool->PD_Batch_Magic = 0;
+	PNG_Batch_Free(pPool);
+}
 
 //////////////////////
-//Init. or Decoding Function
+//Init. or Decoding Function (single instance)
 //////////////////////
 int TCCXXX_PNG_Decode(int iOp, void * pParam1, void * pParam2, int iOption)
 {
@@ -4110,10 +8444,23 @@ int TCCXXX_PNG_Decode(int iOp, void * pParam1, void * pParam2, int iOption)
 	switch( iOp )
 	{
 	case PD_DEC_INIT:
-		msg_ret = TCCXXX_PNGDEC_Init( (PD_INIT*)pParam1, (PD_CALLBACKS*)pParam2 );
+		PD_Default_Inst = TCCXXX_PNG_Dec_Create( ((PD_INIT*)pParam1)->pInstanceBuf, PD_INSTANCE_MEM_SIZE );
+		msg_ret = TCCXXX_PNG_Dec_Init( PD_Default_Inst, (PD_INIT*)pParam1, (PD_CALLBACKS*)pParam2 );
+	#if defined(PNGDEC_CHECK_CHUNK)
+		if( PD_Default_Inst != NULL )
+			PD_nPngDecCheck_Chunk = PD_Default_Inst->PD_nPngDecCheck_Chunk;
+	#endif
 		break;
 	case PD_DEC_DECODE:
-		msg_ret = TCCXXX_PNGDEC_Decode( (PD_CUSTOM_DECODE*)pParam1 );
+		msg_ret = TCCXXX_PNG_Dec_Decode( PD_Default_Inst, (PD_CUSTOM_DECODE*)pParam1 );
+	#if defined(PNGDEC_CHECK_CHUNK)
+		#if defined(PD_PIPELINE)
+		if( PD_Default_Inst != NULL && !PD_Default_Inst->PD_Pipe_On )	//updated by the producer thread until it is joined
+		#else
+		if( PD_Default_Inst != NULL )
+		#endif
+			PD_nPngDecCheck_Chunk = PD_Default_Inst->PD_nPngDecCheck_Chunk;
+	#endif
 		break;
 	default:
 		break;